@@ -0,0 +1,60 @@
+#.rst:
+# FindLZ4
+# --------------
+#
+# FindLZ4.cmake
+#
+# Result Variables
+# ^^^^^^^^^^^^^^^^
+#
+# This module defines the following variables::
+#
+#   LZ4_FOUND               - True if LZ4 has been found and can be used
+#
+# and the following imported targets::
+#
+#   LZ4::LZ4                - The LZ4 library
+
+cmake_minimum_required(VERSION 3.11.4)
+
+set(LZ4_ROOT "${LZ4_ROOT}" CACHE PATH "Hint for finding LZ4 root directory")
+
+find_path(LZ4_INCLUDE_DIR
+    NAMES "lz4.h"
+    HINTS "${LZ4_ROOT}"
+    PATH_SUFFIXES include
+)
+
+find_library(LZ4_LIBRARY
+    NAMES lz4 liblz4
+    HINTS "${LZ4_ROOT}"
+    PATH_SUFFIXES lib
+)
+
+# Set LZ4_FOUND
+include(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LZ4
+    FOUND_VAR LZ4_FOUND
+    REQUIRED_VARS LZ4_LIBRARY LZ4_INCLUDE_DIR
+)
+
+if(LZ4_FOUND)
+    message(STATUS "Found the LZ4")
+
+    add_library(LZ4::LZ4 UNKNOWN IMPORTED)
+
+    if(EXISTS "${LZ4_LIBRARY}")
+        set_target_properties(LZ4::LZ4 PROPERTIES
+            INTERFACE_INCLUDE_DIRECTORIES "${LZ4_INCLUDE_DIR}"
+            IMPORTED_LINK_INTERFACE_LANGUAGES "C"
+            IMPORTED_LOCATION "${LZ4_LIBRARY}"
+        )
+    endif()
+
+    # Make variables changeable to the advanced user
+    mark_as_advanced(
+        LZ4_INCLUDE_DIR
+        LZ4_LIBRARY
+        LZ4_ROOT
+    )
+endif()
@@ -2,6 +2,8 @@
 set(${PROJECT_NAME}_header_root
     "${PROJECT_SOURCE_DIR}/include/rpplugins/${RPPLUGINS_ID}/plugin.hpp"
     "${PROJECT_SOURCE_DIR}/include/rpplugins/${RPPLUGINS_ID}/recording_stage.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpplugins/${RPPLUGINS_ID}/video_writer.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpplugins/${RPPLUGINS_ID}/yuv_converter.hpp"
 )
 
 set(${PROJECT_NAME}_headers
@@ -15,8 +17,18 @@ source_group("${RPPLUGINS_ID}" FILES ${${PROJECT_NAME}_header_root})
 
 # list source
 set(${PROJECT_NAME}_source_root
+    "${PROJECT_SOURCE_DIR}/src/async_readback.cpp"
+    "${PROJECT_SOURCE_DIR}/src/async_readback.hpp"
+    "${PROJECT_SOURCE_DIR}/src/config_recording.cpp"
+    "${PROJECT_SOURCE_DIR}/src/ffmpeg_video_backend.cpp"
+    "${PROJECT_SOURCE_DIR}/src/mjpeg_video_backend.cpp"
     "${PROJECT_SOURCE_DIR}/src/plugin.cpp"
     "${PROJECT_SOURCE_DIR}/src/recording_stage.cpp"
+    "${PROJECT_SOURCE_DIR}/src/streaming_video_writer.cpp"
+    "${PROJECT_SOURCE_DIR}/src/streaming_video_writer.hpp"
+    "${PROJECT_SOURCE_DIR}/src/video_backend.cpp"
+    "${PROJECT_SOURCE_DIR}/src/video_backend.hpp"
+    "${PROJECT_SOURCE_DIR}/src/y4m_video_backend.cpp"
 )
 
 set(${PROJECT_NAME}_sources
@@ -28,6 +28,8 @@
 
 #include <graphicsOutput.h>
 
+#include "rpplugins/recording/video_writer.hpp"
+
 namespace rpplugins {
 
 class RecordingStage;
@@ -43,6 +45,14 @@ public:
 
     void on_stage_setup(void) override;
 
+    /**
+     * Create a writer which streams recorded frames to a video file.
+     *
+     * @return  nullptr if the backend is not available.
+     */
+    virtual std::unique_ptr<VideoWriter> create_video_writer(const Filename& path,
+        const VideoWriterOptions& options = VideoWriterOptions());
+
 private:
     static RequrieType require_plugins_;
 };
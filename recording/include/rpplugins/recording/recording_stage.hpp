@@ -24,6 +24,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <tuple>
 
 #include <render_pipeline/rpcore/render_stage.hpp>
@@ -33,11 +35,44 @@
 
 #include <boost/optional.hpp>
 
+#include "rpplugins/recording/yuv_converter.hpp"
+
 namespace rpplugins {
 
+class AsyncReadbackCallback;
+
 class RecordingStage : public rpcore::RenderStage
 {
 public:
+    /** Frame read back by asynchronous recording target. */
+    struct RecordingFrame
+    {
+        /**
+         * Tightly packed 8-bit pixels. Rows are stored from bottom to top.
+         * For YUV frames, this is a YUV 4:2:0 image of width * height * 3 / 2 bytes with rows from top.
+         */
+        const unsigned char* data;
+        int width;
+        int height;
+        int num_components;
+        boost::optional<YUVLayout> yuv_layout;
+
+        /** Index of the frame counted from 1. Gaps mean dropped frames. */
+        uint64_t frame_index;
+    };
+
+    /** Called in the draw thread. The data is valid only in the call. */
+    using FrameCallback = std::function<void(const RecordingFrame&)>;
+
+    struct AsyncStatistics
+    {
+        uint64_t captured_frames = 0;
+        uint64_t delivered_frames = 0;
+
+        /** Frames not captured because all pixel buffers are waiting for GPU. */
+        uint64_t dropped_frames = 0;
+    };
+
     RecordingStage(rpcore::RenderPipeline& pipeline): RenderStage(pipeline, "RecordingStage") {}
     ~RecordingStage() override;
 
@@ -72,6 +107,44 @@ public:
         GraphicsOutput::RenderTextureMode rtmode = GraphicsOutput::RenderTextureMode::RTM_copy_ram,
         const Filename& fragment_shader_path = Filename());
 
+    /**
+     * Recording basic 2D texture without stalling the pipeline.
+     *
+     * Unlike RTM_copy_ram, the target is read back to a ring of @p ring_size pixel buffers
+     * and each frame is given to @p callback when GPU finishes the copy (about ring_size - 1 frames later).
+     * If GPU is slower than that, new frames are dropped.
+     */
+    virtual rpcore::RenderTarget* make_async_recording_target(
+        const std::string& target_name,
+        Texture* source_texture,
+        const FrameCallback& callback,
+        int ring_size = 3,
+        const Filename& fragment_shader_path = Filename());
+
+    /**
+     * Recording 2D texture to 8-bit YUV 4:2:0 planes on GPU.
+     *
+     * The target has a single channel and (width, height * 3 / 2) size, and its rows are
+     * the rows of NV12 or I420 image from the top. So, reading back it moves 1.5 bytes per pixel.
+     * The size of the texture should be even. convert_rgb_to_yuv420 is the CPU reference of the conversion.
+     */
+    virtual rpcore::RenderTarget* make_yuv_recording_target(
+        const std::string& target_name,
+        Texture* source_texture,
+        YUVLayout layout,
+        GraphicsOutput::RenderTextureMode rtmode = GraphicsOutput::RenderTextureMode::RTM_copy_ram);
+
+    /** Asynchronous version of make_yuv_recording_target. See make_async_recording_target. */
+    virtual rpcore::RenderTarget* make_async_yuv_recording_target(
+        const std::string& target_name,
+        Texture* source_texture,
+        YUVLayout layout,
+        const FrameCallback& callback,
+        int ring_size = 3);
+
+    /** Get statistics of the target made by make_async_recording_target. */
+    virtual const AsyncStatistics* get_async_statistics(const rpcore::RenderTarget* target) const;
+
 private:
     std::string get_plugin_id() const override;
 
@@ -79,7 +152,10 @@ private:
         const std::string& target_name,
         Texture* source_texture,
         GraphicsOutput::RenderTextureMode rtmode,
-        const Filename& fragment_shader_path);
+        const Filename& fragment_shader_path,
+        boost::optional<YUVLayout> yuv_layout = boost::none);
+
+    void attach_async_readback(size_t index, const FrameCallback& callback, int ring_size);
 
     void reload_recording_target_shader(size_t index);
 
@@ -96,8 +172,13 @@ private:
         Texture* source_texture;
         Filename shader_path;
         boost::optional<int> layer;
+        boost::optional<YUVLayout> yuv_layout;
+        AsyncReadbackCallback* async_readback = nullptr;
     };
     std::vector<TargetInfo> recording_targets_;
+
+    /** Set the size of source texture and the layout to the shader of YUV target. */
+    void set_yuv_layout_input(TargetInfo& target_info);
 };
 
 }
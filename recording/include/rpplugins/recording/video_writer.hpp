@@ -0,0 +1,115 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "rpplugins/recording/recording_stage.hpp"
+
+namespace rpplugins {
+
+/**
+ * Streaming writer of recorded frames.
+ *
+ * Frames are copied to a bounded queue and encoded by a dedicated thread,
+ * so push can be called from FrameCallback of asynchronous recording targets.
+ * The format of the video (size, components, YUV layout) is the format of the first frame,
+ * and frames having other formats are dropped.
+ *
+ * Use RecordingPlugin::create_video_writer to create a writer.
+ */
+class VideoWriter
+{
+public:
+    /** Behavior of push when the queue is full. */
+    enum class DropPolicy
+    {
+        drop_newest,    ///< drop the pushed frame
+        drop_oldest,    ///< drop the oldest frame in the queue
+        block,          ///< wait until encoder thread takes a frame (backpressure to the caller)
+    };
+
+    struct Statistics
+    {
+        size_t queue_depth = 0;
+        size_t max_queue_depth = 0;
+
+        uint64_t pushed_frames = 0;
+        uint64_t written_frames = 0;
+
+        /** Frames dropped by DropPolicy, format mismatch or encoding failure. */
+        uint64_t dropped_frames = 0;
+
+        /** Average time (in milliseconds) to encode and write a frame. */
+        double average_encode_time = 0;
+    };
+
+public:
+    virtual ~VideoWriter() = default;
+
+    /**
+     * Copy a frame to the queue.
+     *
+     * @return  false if the frame is dropped.
+     */
+    virtual bool push(const RecordingStage::RecordingFrame& frame) = 0;
+
+    /** Write the queued frames and close the file. It is called by destructor. */
+    virtual void close() = 0;
+
+    /** Check if the writer accepts frames. It is false after closing or failure of backend. */
+    virtual bool is_open() const = 0;
+
+    virtual Statistics get_statistics() const = 0;
+};
+
+struct VideoWriterOptions
+{
+    /**
+     * Name of backend: "y4m", "mjpeg" or "ffmpeg".
+     * If empty, it is chosen by the extension of path (".y4m", ".avi" and others for FFmpeg).
+     *
+     * "y4m" writes raw YUV 4:2:0 and "mjpeg" writes Motion JPEG in AVI which requires RGB frames.
+     * "ffmpeg" is available only if the plugin is built with FFmpeg.
+     */
+    std::string backend;
+
+    int fps = 90;
+
+    size_t queue_capacity = 8;
+    VideoWriter::DropPolicy drop_policy = VideoWriter::DropPolicy::drop_newest;
+
+    /** JPEG quality [1, 100] of "mjpeg". */
+    int quality = 90;
+
+    /** Encoder name of "ffmpeg" (ex, libx264). If empty, the default encoder of the container is used. */
+    std::string codec;
+
+    /** Bit rate of "ffmpeg". If 0, the default of encoder is used. */
+    int64_t bit_rate = 0;
+};
+
+}
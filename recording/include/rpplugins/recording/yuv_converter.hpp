@@ -0,0 +1,127 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace rpplugins {
+
+/** Memory layout of 8-bit YUV 4:2:0 image. Both have a full Y plane followed by chroma. */
+enum class YUVLayout
+{
+    nv12,   ///< interleaved UV plane
+    i420,   ///< U plane followed by V plane
+};
+
+/**
+ * Convert 8-bit RGB(A) image to YUV 4:2:0 (BT.601, limited range).
+ *
+ * This is the CPU reference of "recording_yuv420.frag.glsl" and gives the same bytes
+ * from the same 8-bit RGB values. Chroma is computed from the rounded average of 2x2 pixels.
+ *
+ * @param   rgb             Tightly packed pixels with @p num_components (3 or 4) channels.
+ * @param   width           Width of image. It should be even.
+ * @param   height          Height of image. It should be even.
+ * @param   bottom_up       Rows of @p rgb are stored from bottom (ex, glReadPixels, RecordingFrame).
+ * @param   yuv             Output of width * height * 3 / 2 bytes with rows from top.
+ */
+void convert_rgb_to_yuv420(const unsigned char* rgb, int width, int height, int num_components, bool bottom_up,
+    YUVLayout layout, unsigned char* yuv);
+
+// ************************************************************************************************
+
+namespace detail {
+
+inline unsigned char rgb_to_y(int r, int g, int b)
+{
+    return static_cast<unsigned char>((66 * r + 129 * g + 25 * b + 4224) >> 8);
+}
+
+inline unsigned char rgb_to_u(int r, int g, int b)
+{
+    return static_cast<unsigned char>((-38 * r - 74 * g + 112 * b + 32896) >> 8);
+}
+
+inline unsigned char rgb_to_v(int r, int g, int b)
+{
+    return static_cast<unsigned char>((112 * r - 94 * g - 18 * b + 32896) >> 8);
+}
+
+}
+
+inline void convert_rgb_to_yuv420(const unsigned char* rgb, int width, int height, int num_components, bool bottom_up,
+    YUVLayout layout, unsigned char* yuv)
+{
+    const int chroma_width = width / 2;
+    const int chroma_height = height / 2;
+
+    auto pixel = [&](int x, int y) {
+        return rgb + (size_t(bottom_up ? height - 1 - y : y) * width + x) * num_components;
+    };
+
+    unsigned char* y_plane = yuv;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const unsigned char* p = pixel(x, y);
+            y_plane[size_t(y) * width + x] = detail::rgb_to_y(p[0], p[1], p[2]);
+        }
+    }
+
+    unsigned char* chroma = yuv + size_t(width) * height;
+    for (int cy = 0; cy < chroma_height; ++cy)
+    {
+        for (int cx = 0; cx < chroma_width; ++cx)
+        {
+            int sum[3] = { 0, 0, 0 };
+            for (int k = 0; k < 4; ++k)
+            {
+                const unsigned char* p = pixel(cx * 2 + (k & 1), cy * 2 + (k >> 1));
+                sum[0] += p[0];
+                sum[1] += p[1];
+                sum[2] += p[2];
+            }
+
+            const int r = (sum[0] + 2) >> 2;
+            const int g = (sum[1] + 2) >> 2;
+            const int b = (sum[2] + 2) >> 2;
+
+            const size_t index = size_t(cy) * chroma_width + cx;
+            if (layout == YUVLayout::nv12)
+            {
+                chroma[index * 2 + 0] = detail::rgb_to_u(r, g, b);
+                chroma[index * 2 + 1] = detail::rgb_to_v(r, g, b);
+            }
+            else
+            {
+                chroma[index] = detail::rgb_to_u(r, g, b);
+                chroma[size_t(chroma_width) * chroma_height + index] = detail::rgb_to_v(r, g, b);
+            }
+        }
+    }
+}
+
+}
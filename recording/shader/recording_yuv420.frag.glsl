@@ -0,0 +1,68 @@
+#version 430
+
+// Write YUV 4:2:0 (BT.601, limited range) to single channel target of (width, height * 3 / 2).
+// Row r of the target is row r of NV12 or I420 image, so the image is read back from the top.
+// See convert_rgb_to_yuv420 of yuv_converter.hpp for CPU reference.
+
+uniform sampler2D source_texture;
+
+// (width, height, 1 if I420 otherwise NV12, 0)
+uniform ivec4 yuv_layout;
+
+out vec4 result;
+
+ivec3 fetch_rgb(int x, int y)
+{
+    // y is counted from the top of image
+    vec3 color = texelFetch(source_texture, ivec2(x, yuv_layout.y - 1 - y), 0).rgb;
+    return ivec3(round(clamp(color, 0.0, 1.0) * 255.0));
+}
+
+ivec3 fetch_chroma_rgb(int cx, int cy)
+{
+    ivec3 sum = fetch_rgb(cx * 2, cy * 2) + fetch_rgb(cx * 2 + 1, cy * 2) +
+        fetch_rgb(cx * 2, cy * 2 + 1) + fetch_rgb(cx * 2 + 1, cy * 2 + 1);
+    return (sum + 2) >> 2;
+}
+
+int rgb_to_y(ivec3 c) { return (66 * c.r + 129 * c.g + 25 * c.b + 4224) >> 8; }
+int rgb_to_u(ivec3 c) { return (-38 * c.r - 74 * c.g + 112 * c.b + 32896) >> 8; }
+int rgb_to_v(ivec3 c) { return (112 * c.r - 94 * c.g - 18 * c.b + 32896) >> 8; }
+
+void main()
+{
+    int width = yuv_layout.x;
+    int height = yuv_layout.y;
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+
+    int value;
+    if (coord.y < height)
+    {
+        value = rgb_to_y(fetch_rgb(coord.x, coord.y));
+    }
+    else
+    {
+        int chroma_width = width / 2;
+        int chroma_size = chroma_width * (height / 2);
+        int offset = (coord.y - height) * width + coord.x;
+
+        if (yuv_layout.z == 0)
+        {
+            // NV12: U and V are interleaved
+            int index = offset / 2;
+            ivec3 rgb = fetch_chroma_rgb(index % chroma_width, index / chroma_width);
+            value = (offset & 1) == 0 ? rgb_to_u(rgb) : rgb_to_v(rgb);
+        }
+        else if (offset < chroma_size)
+        {
+            value = rgb_to_u(fetch_chroma_rgb(offset % chroma_width, offset / chroma_width));
+        }
+        else
+        {
+            offset -= chroma_size;
+            value = rgb_to_v(fetch_chroma_rgb(offset % chroma_width, offset / chroma_width));
+        }
+    }
+
+    result = vec4(float(value) / 255.0);
+}
@@ -0,0 +1,263 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "async_readback.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+#include <geomDrawCallbackData.h>
+
+#include <render_pipeline/rpcore/render_target.hpp>
+
+namespace rpplugins {
+
+TypeHandle AsyncReadbackCallback::_type_handle;
+
+namespace {
+
+std::mutex released_objects_mutex;
+
+}
+
+AsyncReadbackCallback::AsyncReadbackCallback(rpcore::RenderTarget* target, int num_components, int ring_size,
+    boost::optional<YUVLayout> yuv_layout, const RecordingStage::FrameCallback& callback):
+    target_(target), num_components_(num_components), yuv_layout_(yuv_layout), callback_(callback)
+{
+    switch (num_components_)
+    {
+    case 1:
+        format_ = GL_RED;
+        break;
+    case 2:
+        format_ = GL_RG;
+        break;
+    case 3:
+        format_ = GL_RGB;
+        break;
+    default:
+        num_components_ = 4;
+        format_ = GL_RGBA;
+        break;
+    }
+
+    slots_.resize((std::max)(1, ring_size));
+}
+
+AsyncReadbackCallback::~AsyncReadbackCallback()
+{
+    // GL context may not be current in this thread
+    ReleasedObjects objects;
+    for (auto&& slot: slots_)
+    {
+        if (slot.pbo)
+            objects.pbos.push_back(slot.pbo);
+        if (slot.fence)
+            objects.fences.push_back(slot.fence);
+    }
+
+    if ((objects.pbos.empty() && objects.fences.empty()) || gsg_.was_deleted())
+        return;
+
+    objects.gsg = gsg_;
+    objects.glDeleteBuffers_ = glDeleteBuffers_;
+    objects.glDeleteSync_ = glDeleteSync_;
+
+    std::lock_guard<std::mutex> lock(released_objects_mutex);
+    get_released_objects().push_back(std::move(objects));
+}
+
+void AsyncReadbackCallback::do_callback(CallbackData* cbdata)
+{
+    if (!cbdata)
+        return;
+
+    cbdata->upcall();
+
+    auto glgsg = DCAST(GLGraphicsStateGuardian, static_cast<GeomDrawCallbackData*>(cbdata)->get_gsg());
+    if (!load_functions(glgsg))
+        return;
+
+    gsg_ = glgsg;
+    release_queued_objects(glgsg);
+
+    const auto& size = target_->get_size();
+    if (size[0] != width_ || size[1] != height_)
+        resize(size[0], size[1]);
+
+    const size_t ring_size = slots_.size();
+
+    // deliver signaled frames in the order of capture without waiting
+    while (pending_count_ > 0)
+    {
+        auto& slot = slots_[(head_ + ring_size - pending_count_) % ring_size];
+        if (!is_signaled(slot, 0))
+            break;
+
+        deliver(slot);
+        --pending_count_;
+    }
+
+    ++frame_index_;
+
+    if (pending_count_ == ring_size)
+    {
+        ++statistics_.dropped_frames;
+        return;
+    }
+
+    // queue the copy from the framebuffer of the target to the PBO
+    auto& slot = slots_[head_];
+    slot.frame_index = frame_index_;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer_(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glReadPixels(0, 0, width_, height_, format_, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer_(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    slot.fence = glFenceSync_(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    head_ = (head_ + 1) % ring_size;
+    ++pending_count_;
+    ++statistics_.captured_frames;
+}
+
+const RecordingStage::AsyncStatistics& AsyncReadbackCallback::get_statistics() const
+{
+    return statistics_;
+}
+
+std::vector<AsyncReadbackCallback::ReleasedObjects>& AsyncReadbackCallback::get_released_objects()
+{
+    static std::vector<ReleasedObjects> objects;
+    return objects;
+}
+
+void AsyncReadbackCallback::release_queued_objects(GLGraphicsStateGuardian* glgsg)
+{
+    std::lock_guard<std::mutex> lock(released_objects_mutex);
+
+    auto& released_objects = get_released_objects();
+    if (released_objects.empty())
+        return;
+
+    auto iter = std::remove_if(released_objects.begin(), released_objects.end(), [glgsg](const ReleasedObjects& objects) {
+        // objects are released with GL context of deleted GSG
+        if (objects.gsg.was_deleted())
+            return true;
+
+        if (objects.gsg.p() != glgsg)
+            return false;
+
+        for (auto fence: objects.fences)
+            objects.glDeleteSync_(fence);
+        if (!objects.pbos.empty())
+            objects.glDeleteBuffers_(static_cast<GLsizei>(objects.pbos.size()), objects.pbos.data());
+        return true;
+    });
+    released_objects.erase(iter, released_objects.end());
+}
+
+bool AsyncReadbackCallback::load_functions(GLGraphicsStateGuardian* glgsg)
+{
+    if (functions_loaded_)
+        return true;
+
+    glGenBuffers_ = reinterpret_cast<PFNGLGENBUFFERSPROC>(glgsg->get_extension_func("glGenBuffers"));
+    glDeleteBuffers_ = reinterpret_cast<PFNGLDELETEBUFFERSPROC>(glgsg->get_extension_func("glDeleteBuffers"));
+    glBindBuffer_ = reinterpret_cast<PFNGLBINDBUFFERPROC>(glgsg->get_extension_func("glBindBuffer"));
+    glBufferData_ = reinterpret_cast<PFNGLBUFFERDATAPROC>(glgsg->get_extension_func("glBufferData"));
+    glMapBufferRange_ = reinterpret_cast<PFNGLMAPBUFFERRANGEPROC>(glgsg->get_extension_func("glMapBufferRange"));
+    glUnmapBuffer_ = reinterpret_cast<PFNGLUNMAPBUFFERPROC>(glgsg->get_extension_func("glUnmapBuffer"));
+    glFenceSync_ = reinterpret_cast<PFNGLFENCESYNCPROC>(glgsg->get_extension_func("glFenceSync"));
+    glClientWaitSync_ = reinterpret_cast<PFNGLCLIENTWAITSYNCPROC>(glgsg->get_extension_func("glClientWaitSync"));
+    glDeleteSync_ = reinterpret_cast<PFNGLDELETESYNCPROC>(glgsg->get_extension_func("glDeleteSync"));
+
+    functions_loaded_ = glGenBuffers_ && glDeleteBuffers_ && glBindBuffer_ && glBufferData_ && glMapBufferRange_ &&
+        glUnmapBuffer_ && glFenceSync_ && glClientWaitSync_ && glDeleteSync_;
+
+    return functions_loaded_;
+}
+
+void AsyncReadbackCallback::resize(int width, int height)
+{
+    // pending frames have the previous size, so they are delivered before resizing
+    const size_t ring_size = slots_.size();
+    for (; pending_count_ > 0; --pending_count_)
+    {
+        auto& slot = slots_[(head_ + ring_size - pending_count_) % ring_size];
+        is_signaled(slot, GL_TIMEOUT_IGNORED);
+        deliver(slot);
+    }
+
+    width_ = width;
+    height_ = height;
+
+    const GLsizeiptr buffer_size = GLsizeiptr(width_) * height_ * num_components_;
+    for (auto&& slot: slots_)
+    {
+        if (slot.pbo == 0)
+            glGenBuffers_(1, &slot.pbo);
+
+        glBindBuffer_(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData_(GL_PIXEL_PACK_BUFFER, buffer_size, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer_(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+bool AsyncReadbackCallback::is_signaled(const Slot& slot, GLuint64 timeout_ns) const
+{
+    const GLenum result = glClientWaitSync_(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout_ns);
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+void AsyncReadbackCallback::deliver(Slot& slot)
+{
+    glDeleteSync_(slot.fence);
+    slot.fence = nullptr;
+
+    const GLsizeiptr buffer_size = GLsizeiptr(width_) * height_ * num_components_;
+
+    glBindBuffer_(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (auto data = glMapBufferRange_(GL_PIXEL_PACK_BUFFER, 0, buffer_size, GL_MAP_READ_BIT))
+    {
+        RecordingStage::RecordingFrame frame;
+        frame.data = static_cast<const unsigned char*>(data);
+        frame.width = width_;
+        frame.height = yuv_layout_ ? height_ * 2 / 3 : height_;
+        frame.num_components = num_components_;
+        frame.yuv_layout = yuv_layout_;
+        frame.frame_index = slot.frame_index;
+
+        if (callback_)
+            callback_(frame);
+
+        glUnmapBuffer_(GL_PIXEL_PACK_BUFFER);
+        ++statistics_.delivered_frames;
+    }
+    glBindBuffer_(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+}
@@ -0,0 +1,134 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <callbackObject.h>
+#include <glgsg.h>
+#include <weakPointerTo.h>
+
+#include "rpplugins/recording/recording_stage.hpp"
+
+namespace rpcore {
+class RenderTarget;
+}
+
+namespace rpplugins {
+
+/**
+ * Draw callback to read back a recording target asynchronously.
+ *
+ * In every frame, glReadPixels copies the target into the next pixel buffer object (PBO)
+ * of a ring and a fence is inserted after the copy. The oldest PBOs are mapped only after
+ * their fences are signaled, so the copy does not stall the pipeline.
+ * If all PBOs are pending, the frame is dropped instead of waiting for GPU.
+ *
+ * GL objects are created and used in the draw thread. When the callback is destroyed, they are queued
+ * and released in the next draw of other callback on the same GSG (or with GL context if there is none).
+ */
+class AsyncReadbackCallback : public CallbackObject
+{
+public:
+    AsyncReadbackCallback(rpcore::RenderTarget* target, int num_components, int ring_size,
+        boost::optional<YUVLayout> yuv_layout, const RecordingStage::FrameCallback& callback);
+    ~AsyncReadbackCallback() override;
+
+    void do_callback(CallbackData* cbdata) override;
+
+    const RecordingStage::AsyncStatistics& get_statistics() const;
+
+    ALLOC_DELETED_CHAIN(AsyncReadbackCallback);
+
+private:
+    struct Slot
+    {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        uint64_t frame_index = 0;
+    };
+
+    /** GL objects to be released in the draw thread of the GSG. */
+    struct ReleasedObjects
+    {
+        WPT(GLGraphicsStateGuardian) gsg;
+        std::vector<GLuint> pbos;
+        std::vector<GLsync> fences;
+        PFNGLDELETEBUFFERSPROC glDeleteBuffers_;
+        PFNGLDELETESYNCPROC glDeleteSync_;
+    };
+
+    /** Release objects queued by destroyed callbacks of @p glgsg. This should be called in the draw thread. */
+    static void release_queued_objects(GLGraphicsStateGuardian* glgsg);
+    static std::vector<ReleasedObjects>& get_released_objects();
+
+    bool load_functions(GLGraphicsStateGuardian* glgsg);
+    void resize(int width, int height);
+    bool is_signaled(const Slot& slot, GLuint64 timeout_ns) const;
+    void deliver(Slot& slot);
+
+    WPT(GLGraphicsStateGuardian) gsg_;
+    const rpcore::RenderTarget* target_;
+    GLenum format_;
+    int num_components_;
+    boost::optional<YUVLayout> yuv_layout_;
+    RecordingStage::FrameCallback callback_;
+
+    std::vector<Slot> slots_;
+    size_t head_ = 0;
+    size_t pending_count_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    uint64_t frame_index_ = 0;
+
+    RecordingStage::AsyncStatistics statistics_;
+
+    bool functions_loaded_ = false;
+    PFNGLGENBUFFERSPROC glGenBuffers_ = nullptr;
+    PFNGLDELETEBUFFERSPROC glDeleteBuffers_ = nullptr;
+    PFNGLBINDBUFFERPROC glBindBuffer_ = nullptr;
+    PFNGLBUFFERDATAPROC glBufferData_ = nullptr;
+    PFNGLMAPBUFFERRANGEPROC glMapBufferRange_ = nullptr;
+    PFNGLUNMAPBUFFERPROC glUnmapBuffer_ = nullptr;
+    PFNGLFENCESYNCPROC glFenceSync_ = nullptr;
+    PFNGLCLIENTWAITSYNCPROC glClientWaitSync_ = nullptr;
+    PFNGLDELETESYNCPROC glDeleteSync_ = nullptr;
+
+public:
+    static TypeHandle get_class_type() { return _type_handle; }
+    static void init_type()
+    {
+        CallbackObject::init_type();
+        register_type(_type_handle, "rpplugins::AsyncReadbackCallback", CallbackObject::get_class_type());
+    }
+    TypeHandle get_type() const override { return get_class_type(); }
+    TypeHandle force_init_type() override { init_type(); return get_class_type(); }
+
+private:
+    static TypeHandle _type_handle;
+};
+
+}
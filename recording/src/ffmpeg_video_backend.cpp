@@ -0,0 +1,280 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "video_backend.hpp"
+
+#if defined(RPPLUGINS_RECORDING_WITH_FFMPEG)
+
+#include <algorithm>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+}
+
+#include <render_pipeline/rpcore/rpobject.hpp>
+
+#include <fmt/format.h>
+
+namespace rpplugins {
+
+/** Video encoded by libavcodec from YUV 4:2:0 in a container of libavformat. */
+class FFmpegVideoBackend : public VideoBackend
+{
+public:
+    ~FFmpegVideoBackend() override;
+
+    bool open(const std::string& path, const VideoFormat& format, const VideoWriterOptions& options) override;
+    bool write(const unsigned char* data) override;
+    void close() override;
+
+private:
+    bool encode(AVFrame* frame);
+    void release();
+    void error(const std::string& message, int code) const;
+
+    VideoFormat format_;
+    std::vector<unsigned char> i420_;
+
+    AVFormatContext* format_context_ = nullptr;
+    AVCodecContext* codec_context_ = nullptr;
+    AVStream* stream_ = nullptr;
+    AVFrame* frame_ = nullptr;
+    AVPacket* packet_ = nullptr;
+    int64_t next_pts_ = 0;
+    bool header_written_ = false;
+};
+
+FFmpegVideoBackend::~FFmpegVideoBackend()
+{
+    release();
+}
+
+bool FFmpegVideoBackend::open(const std::string& path, const VideoFormat& format, const VideoWriterOptions& options)
+{
+    if (!format.yuv_layout && format.num_components < 3)
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, "FFmpeg backend requires RGB, RGBA or YUV frames.");
+        return false;
+    }
+
+    if (format.width % 2 != 0 || format.height % 2 != 0)
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, fmt::format("FFmpeg backend requires even size ({} x {}).", format.width, format.height));
+        return false;
+    }
+
+    format_ = format;
+
+    int ret = avformat_alloc_output_context2(&format_context_, nullptr, nullptr, path.c_str());
+    if (ret < 0)
+    {
+        error("Failed to find output format for " + path, ret);
+        return false;
+    }
+
+    const AVCodec* codec = options.codec.empty() ?
+        avcodec_find_encoder(format_context_->oformat->video_codec) :
+        avcodec_find_encoder_by_name(options.codec.c_str());
+    if (!codec)
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, fmt::format("Failed to find FFmpeg encoder ({}).",
+            options.codec.empty() ? "default" : options.codec));
+        return false;
+    }
+
+    stream_ = avformat_new_stream(format_context_, nullptr);
+    codec_context_ = avcodec_alloc_context3(codec);
+    frame_ = av_frame_alloc();
+    packet_ = av_packet_alloc();
+    if (!stream_ || !codec_context_ || !frame_ || !packet_)
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, "Failed to allocate FFmpeg objects.");
+        return false;
+    }
+
+    codec_context_->width = format_.width;
+    codec_context_->height = format_.height;
+    codec_context_->time_base = AVRational{ 1, (std::max)(options.fps, 1) };
+    codec_context_->framerate = AVRational{ (std::max)(options.fps, 1), 1 };
+    codec_context_->gop_size = (std::max)(options.fps, 1);
+    codec_context_->pix_fmt = AV_PIX_FMT_YUV420P;
+    if (options.bit_rate > 0)
+        codec_context_->bit_rate = options.bit_rate;
+    if (format_context_->oformat->flags & AVFMT_GLOBALHEADER)
+        codec_context_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    if ((ret = avcodec_open2(codec_context_, codec, nullptr)) < 0)
+    {
+        error("Failed to open FFmpeg encoder", ret);
+        return false;
+    }
+
+    avcodec_parameters_from_context(stream_->codecpar, codec_context_);
+    stream_->time_base = codec_context_->time_base;
+
+    frame_->format = codec_context_->pix_fmt;
+    frame_->width = codec_context_->width;
+    frame_->height = codec_context_->height;
+    if ((ret = av_frame_get_buffer(frame_, 0)) < 0)
+    {
+        error("Failed to allocate FFmpeg frame", ret);
+        return false;
+    }
+
+    if (!(format_context_->oformat->flags & AVFMT_NOFILE))
+    {
+        if ((ret = avio_open(&format_context_->pb, path.c_str(), AVIO_FLAG_WRITE)) < 0)
+        {
+            error("Failed to open file " + path, ret);
+            return false;
+        }
+    }
+
+    if ((ret = avformat_write_header(format_context_, nullptr)) < 0)
+    {
+        error("Failed to write header", ret);
+        return false;
+    }
+    header_written_ = true;
+
+    return true;
+}
+
+bool FFmpegVideoBackend::write(const unsigned char* data)
+{
+    convert_to_i420(data, format_, i420_);
+
+    int ret = av_frame_make_writable(frame_);
+    if (ret < 0)
+    {
+        error("Failed to make FFmpeg frame writable", ret);
+        return false;
+    }
+
+    // copy planes to the frame which may have padded lines
+    const int plane_widths[3] = { format_.width, format_.width / 2, format_.width / 2 };
+    const int plane_heights[3] = { format_.height, format_.height / 2, format_.height / 2 };
+    const unsigned char* src = i420_.data();
+    for (int plane = 0; plane < 3; ++plane)
+    {
+        av_image_copy_plane(frame_->data[plane], frame_->linesize[plane], src, plane_widths[plane],
+            plane_widths[plane], plane_heights[plane]);
+        src += size_t(plane_widths[plane]) * plane_heights[plane];
+    }
+
+    frame_->pts = next_pts_++;
+
+    return encode(frame_);
+}
+
+void FFmpegVideoBackend::close()
+{
+    if (header_written_)
+    {
+        // flush delayed packets
+        encode(nullptr);
+        av_write_trailer(format_context_);
+        header_written_ = false;
+    }
+
+    release();
+}
+
+bool FFmpegVideoBackend::encode(AVFrame* frame)
+{
+    int ret = avcodec_send_frame(codec_context_, frame);
+    if (ret < 0)
+    {
+        error("Failed to send frame to FFmpeg encoder", ret);
+        return false;
+    }
+
+    while (true)
+    {
+        ret = avcodec_receive_packet(codec_context_, packet_);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            return true;
+
+        if (ret < 0)
+        {
+            error("Failed to encode frame", ret);
+            return false;
+        }
+
+        av_packet_rescale_ts(packet_, codec_context_->time_base, stream_->time_base);
+        packet_->stream_index = stream_->index;
+
+        ret = av_interleaved_write_frame(format_context_, packet_);
+        if (ret < 0)
+        {
+            error("Failed to write packet", ret);
+            return false;
+        }
+    }
+}
+
+void FFmpegVideoBackend::release()
+{
+    av_packet_free(&packet_);
+    av_frame_free(&frame_);
+    avcodec_free_context(&codec_context_);
+
+    if (format_context_)
+    {
+        if (!(format_context_->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&format_context_->pb);
+        avformat_free_context(format_context_);
+        format_context_ = nullptr;
+    }
+    stream_ = nullptr;
+}
+
+void FFmpegVideoBackend::error(const std::string& message, int code) const
+{
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(code, buffer, sizeof(buffer));
+    rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, fmt::format("{}: {}", message, buffer));
+}
+
+std::unique_ptr<VideoBackend> create_ffmpeg_video_backend()
+{
+    return std::make_unique<FFmpegVideoBackend>();
+}
+
+}
+
+#else
+
+namespace rpplugins {
+
+std::unique_ptr<VideoBackend> create_ffmpeg_video_backend()
+{
+    return nullptr;
+}
+
+}
+
+#endif
@@ -0,0 +1,399 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "video_backend.hpp"
+
+#if defined(RPPLUGINS_RECORDING_WITH_JPEG)
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+#include <jpeglib.h>
+
+#include <render_pipeline/rpcore/rpobject.hpp>
+
+#include <fmt/format.h>
+
+namespace rpplugins {
+
+/** JPEG destination which writes to std::vector. */
+struct JPEGVectorDestination
+{
+    jpeg_destination_mgr pub;
+    std::vector<unsigned char>* buffer;
+
+    static void init_destination(j_compress_ptr cinfo)
+    {
+        auto dest = reinterpret_cast<JPEGVectorDestination*>(cinfo->dest);
+        dest->buffer->resize((std::max)(dest->buffer->capacity(), size_t(1) << 16));
+        dest->pub.next_output_byte = dest->buffer->data();
+        dest->pub.free_in_buffer = dest->buffer->size();
+    }
+
+    static boolean empty_output_buffer(j_compress_ptr cinfo)
+    {
+        auto dest = reinterpret_cast<JPEGVectorDestination*>(cinfo->dest);
+        const size_t used = dest->buffer->size();
+        dest->buffer->resize(used * 2);
+        dest->pub.next_output_byte = dest->buffer->data() + used;
+        dest->pub.free_in_buffer = dest->buffer->size() - used;
+        return TRUE;
+    }
+
+    static void term_destination(j_compress_ptr cinfo)
+    {
+        auto dest = reinterpret_cast<JPEGVectorDestination*>(cinfo->dest);
+        dest->buffer->resize(dest->buffer->size() - dest->pub.free_in_buffer);
+    }
+};
+
+/** libjpeg error manager which returns to the caller instead of exit. */
+struct JPEGErrorManager
+{
+    jpeg_error_mgr pub;
+    std::jmp_buf jump_buffer;
+
+    static void error_exit(j_common_ptr cinfo)
+    {
+        char message[JMSG_LENGTH_MAX];
+        (*cinfo->err->format_message)(cinfo, message);
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, std::string("JPEG error: ") + message);
+
+        std::longjmp(reinterpret_cast<JPEGErrorManager*>(cinfo->err)->jump_buffer, 1);
+    }
+};
+
+// ************************************************************************************************
+
+/**
+ * Motion JPEG in AVI (RIFF AVI 1.0) container.
+ *
+ * Headers are written with zero sizes in open and are updated in close.
+ * Files larger than 4 GB are not supported.
+ */
+class MJPEGVideoBackend : public VideoBackend
+{
+public:
+    ~MJPEGVideoBackend() override;
+
+    bool open(const std::string& path, const VideoFormat& format, const VideoWriterOptions& options) override;
+    bool write(const unsigned char* data) override;
+    void close() override;
+
+private:
+    struct IndexEntry
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    bool compress(const unsigned char* data);
+
+    void write_u16(uint16_t value);
+    void write_u32(uint32_t value);
+    void write_fourcc(const char* fourcc);
+    void patch_u32(std::streamoff position, uint32_t value);
+
+    std::ofstream file_;
+    VideoFormat format_;
+
+    jpeg_compress_struct cinfo_;
+    JPEGErrorManager error_manager_;
+    JPEGVectorDestination destination_;
+    bool cinfo_created_ = false;
+
+    std::vector<unsigned char> jpeg_;
+    std::vector<unsigned char> row_;
+    std::vector<IndexEntry> index_;
+    uint32_t max_frame_size_ = 0;
+
+    // positions of fields updated in close
+    std::streamoff riff_size_pos_ = 0;
+    std::streamoff total_frames_pos_ = 0;
+    std::streamoff avih_buffer_size_pos_ = 0;
+    std::streamoff stream_length_pos_ = 0;
+    std::streamoff strh_buffer_size_pos_ = 0;
+    std::streamoff movi_size_pos_ = 0;
+};
+
+MJPEGVideoBackend::~MJPEGVideoBackend()
+{
+    if (cinfo_created_)
+        jpeg_destroy_compress(&cinfo_);
+}
+
+bool MJPEGVideoBackend::open(const std::string& path, const VideoFormat& format, const VideoWriterOptions& options)
+{
+    if (format.yuv_layout || format.num_components == 2)
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, "MJPEG backend requires RGB, RGBA or grayscale frames.");
+        return false;
+    }
+
+    file_.open(path, std::ios::binary);
+    if (!file_)
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, fmt::format("Failed to open file: {}", path));
+        return false;
+    }
+
+    format_ = format;
+
+    cinfo_.err = jpeg_std_error(&error_manager_.pub);
+    error_manager_.pub.error_exit = &JPEGErrorManager::error_exit;
+    if (setjmp(error_manager_.jump_buffer))
+        return false;
+
+    jpeg_create_compress(&cinfo_);
+    cinfo_created_ = true;
+
+    destination_.pub.init_destination = &JPEGVectorDestination::init_destination;
+    destination_.pub.empty_output_buffer = &JPEGVectorDestination::empty_output_buffer;
+    destination_.pub.term_destination = &JPEGVectorDestination::term_destination;
+    destination_.buffer = &jpeg_;
+    cinfo_.dest = &destination_.pub;
+
+    cinfo_.image_width = format_.width;
+    cinfo_.image_height = format_.height;
+    cinfo_.input_components = format_.num_components == 1 ? 1 : 3;
+    cinfo_.in_color_space = format_.num_components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&cinfo_);
+    jpeg_set_quality(&cinfo_, (std::min)((std::max)(options.quality, 1), 100), TRUE);
+
+    row_.resize(size_t(format_.width) * 3);
+
+    // RIFF header
+    write_fourcc("RIFF");
+    riff_size_pos_ = file_.tellp();
+    write_u32(0);
+    write_fourcc("AVI ");
+
+    write_fourcc("LIST");
+    write_u32(4 + (8 + 56) + (12 + (8 + 56) + (8 + 40)));
+    write_fourcc("hdrl");
+
+    // main AVI header
+    write_fourcc("avih");
+    write_u32(56);
+    write_u32(uint32_t(1000000 / (std::max)(options.fps, 1)));     // microseconds per frame
+    write_u32(0);                                                   // max bytes per second
+    write_u32(0);                                                   // padding granularity
+    write_u32(0x10);                                                // AVIF_HASINDEX
+    total_frames_pos_ = file_.tellp();
+    write_u32(0);                                                   // total frames
+    write_u32(0);                                                   // initial frames
+    write_u32(1);                                                   // streams
+    avih_buffer_size_pos_ = file_.tellp();
+    write_u32(0);                                                   // suggested buffer size
+    write_u32(format_.width);
+    write_u32(format_.height);
+    for (int k = 0; k < 4; ++k)
+        write_u32(0);
+
+    write_fourcc("LIST");
+    write_u32(4 + (8 + 56) + (8 + 40));
+    write_fourcc("strl");
+
+    // stream header
+    write_fourcc("strh");
+    write_u32(56);
+    write_fourcc("vids");
+    write_fourcc("MJPG");
+    write_u32(0);                                                   // flags
+    write_u16(0);                                                   // priority
+    write_u16(0);                                                   // language
+    write_u32(0);                                                   // initial frames
+    write_u32(1);                                                   // scale
+    write_u32((std::max)(options.fps, 1));                          // rate
+    write_u32(0);                                                   // start
+    stream_length_pos_ = file_.tellp();
+    write_u32(0);                                                   // length
+    strh_buffer_size_pos_ = file_.tellp();
+    write_u32(0);                                                   // suggested buffer size
+    write_u32(0xFFFFFFFF);                                          // quality
+    write_u32(0);                                                   // sample size
+    write_u16(0);
+    write_u16(0);
+    write_u16(uint16_t(format_.width));
+    write_u16(uint16_t(format_.height));
+
+    // stream format (BITMAPINFOHEADER)
+    write_fourcc("strf");
+    write_u32(40);
+    write_u32(40);
+    write_u32(format_.width);
+    write_u32(format_.height);
+    write_u16(1);                                                   // planes
+    write_u16(24);                                                  // bit count
+    write_fourcc("MJPG");
+    write_u32(uint32_t(format_.width) * format_.height * 3);
+    for (int k = 0; k < 4; ++k)
+        write_u32(0);
+
+    write_fourcc("LIST");
+    movi_size_pos_ = file_.tellp();
+    write_u32(0);
+    write_fourcc("movi");
+
+    return bool(file_);
+}
+
+bool MJPEGVideoBackend::write(const unsigned char* data)
+{
+    if (!compress(data))
+        return false;
+
+    const uint32_t size = uint32_t(jpeg_.size());
+    const std::streamoff movi_begin = movi_size_pos_ + 4;
+    const std::streamoff position = file_.tellp();
+
+    // chunk, padding, index and headers should fit in 32-bit RIFF size
+    if (uint64_t(position) + size + 9 + (index_.size() + 1) * 16 > (std::numeric_limits<uint32_t>::max)())
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, "AVI file reaches 4 GB.");
+        return false;
+    }
+
+    index_.push_back({ uint32_t(position - movi_begin), size });
+    max_frame_size_ = (std::max)(max_frame_size_, size);
+
+    write_fourcc("00dc");
+    write_u32(size);
+    file_.write(reinterpret_cast<const char*>(jpeg_.data()), size);
+    if (size & 1)
+        file_.put(0);
+
+    return bool(file_);
+}
+
+void MJPEGVideoBackend::close()
+{
+    if (!file_.is_open())
+        return;
+
+    const std::streamoff movi_end = file_.tellp();
+
+    write_fourcc("idx1");
+    write_u32(uint32_t(index_.size() * 16));
+    for (const auto& entry: index_)
+    {
+        write_fourcc("00dc");
+        write_u32(0x10);                                            // AVIIF_KEYFRAME
+        write_u32(entry.offset);
+        write_u32(entry.size);
+    }
+
+    const std::streamoff file_end = file_.tellp();
+
+    patch_u32(riff_size_pos_, uint32_t(file_end - 8));
+    patch_u32(total_frames_pos_, uint32_t(index_.size()));
+    patch_u32(avih_buffer_size_pos_, max_frame_size_ + 8);
+    patch_u32(stream_length_pos_, uint32_t(index_.size()));
+    patch_u32(strh_buffer_size_pos_, max_frame_size_ + 8);
+    patch_u32(movi_size_pos_, uint32_t(movi_end - movi_size_pos_ - 4));
+
+    file_.close();
+}
+
+bool MJPEGVideoBackend::compress(const unsigned char* data)
+{
+    if (setjmp(error_manager_.jump_buffer))
+    {
+        jpeg_abort_compress(&cinfo_);
+        return false;
+    }
+
+    jpeg_start_compress(&cinfo_, TRUE);
+
+    // rows of frames are stored from bottom
+    const size_t stride = size_t(format_.width) * format_.num_components;
+    while (cinfo_.next_scanline < cinfo_.image_height)
+    {
+        const unsigned char* src = data + (format_.height - 1 - cinfo_.next_scanline) * stride;
+        JSAMPROW row = const_cast<JSAMPROW>(src);
+        if (format_.num_components == 4)
+        {
+            for (int x = 0; x < format_.width; ++x)
+            {
+                row_[x * 3 + 0] = src[x * 4 + 0];
+                row_[x * 3 + 1] = src[x * 4 + 1];
+                row_[x * 3 + 2] = src[x * 4 + 2];
+            }
+            row = row_.data();
+        }
+        jpeg_write_scanlines(&cinfo_, &row, 1);
+    }
+
+    jpeg_finish_compress(&cinfo_);
+
+    return true;
+}
+
+void MJPEGVideoBackend::write_u16(uint16_t value)
+{
+    const char bytes[2] = { char(value & 0xFF), char(value >> 8) };
+    file_.write(bytes, 2);
+}
+
+void MJPEGVideoBackend::write_u32(uint32_t value)
+{
+    const char bytes[4] = { char(value & 0xFF), char((value >> 8) & 0xFF), char((value >> 16) & 0xFF), char(value >> 24) };
+    file_.write(bytes, 4);
+}
+
+void MJPEGVideoBackend::write_fourcc(const char* fourcc)
+{
+    file_.write(fourcc, 4);
+}
+
+void MJPEGVideoBackend::patch_u32(std::streamoff position, uint32_t value)
+{
+    const std::streamoff current = file_.tellp();
+    file_.seekp(position);
+    write_u32(value);
+    file_.seekp(current);
+}
+
+std::unique_ptr<VideoBackend> create_mjpeg_video_backend()
+{
+    return std::make_unique<MJPEGVideoBackend>();
+}
+
+}
+
+#else
+
+namespace rpplugins {
+
+std::unique_ptr<VideoBackend> create_mjpeg_video_backend()
+{
+    return nullptr;
+}
+
+}
+
+#endif
@@ -30,6 +30,8 @@
 
 #include "rpplugins/recording/recording_stage.hpp"
 
+#include "streaming_video_writer.hpp"
+
 RENDER_PIPELINE_PLUGIN_CREATOR(rpplugins::RecordingPlugin)
 
 namespace rpplugins {
@@ -50,4 +52,15 @@ void RecordingPlugin::on_stage_setup(void)
     add_stage(std::make_unique<RecordingStage>(pipeline_));
 }
 
+std::unique_ptr<VideoWriter> RecordingPlugin::create_video_writer(const Filename& path, const VideoWriterOptions& options)
+{
+    const std::string os_path = path.to_os_specific();
+
+    auto backend = create_video_backend(os_path, options);
+    if (!backend)
+        return nullptr;
+
+    return std::make_unique<StreamingVideoWriter>(os_path, options, std::move(backend));
+}
+
 }
@@ -25,14 +25,18 @@
 #include "rpplugins/recording/recording_stage.hpp"
 
 #include <camera.h>
+#include <callbackNode.h>
 
 #include <render_pipeline/rpcore/render_pipeline.hpp>
 #include <render_pipeline/rpcore/render_target.hpp>
 #include <render_pipeline/rpcore/globals.hpp>
 #include <render_pipeline/rppanda/showbase/showbase.hpp>
+#include <render_pipeline/rpcore/util/post_process_region.hpp>
 
 #include <fmt/format.h>
 
+#include "async_readback.hpp"
+
 namespace rpplugins {
 
 RecordingStage::RequireType RecordingStage::required_inputs_;
@@ -62,7 +66,24 @@ void RecordingStage::set_dimensions()
 {
     for (auto&& target_info : recording_targets_)
     {
-        target_info.target->set_size(target_info.source_texture->get_x_size(), target_info.source_texture->get_y_size());
+        const int x_size = target_info.source_texture->get_x_size();
+        const int y_size = target_info.source_texture->get_y_size();
+        if (!target_info.yuv_layout)
+        {
+            target_info.target->set_size(x_size, y_size);
+            continue;
+        }
+
+        // chroma is subsampled by 2x2 pixels, so the previous size is kept
+        if (x_size % 2 != 0 || y_size % 2 != 0)
+        {
+            error(fmt::format("Cannot resize YUV recording target to odd size ({} x {}).", x_size, y_size));
+            continue;
+        }
+
+        // YUV planes are stacked vertically
+        target_info.target->set_size(x_size, y_size * 3 / 2);
+        set_yuv_layout_input(target_info);
     }
 }
 
@@ -117,6 +138,72 @@ rpcore::RenderTarget* RecordingStage::make_recording_target_as_mono(const std::s
     return target;
 }
 
+rpcore::RenderTarget* RecordingStage::make_async_recording_target(const std::string& target_name, Texture* source_texture,
+    const FrameCallback& callback, int ring_size, const Filename& fragment_shader_path)
+{
+    if (source_texture->get_z_size() != 1)
+    {
+        error("Asynchronous recording target supports only Texture2D.");
+        return nullptr;
+    }
+
+    // the texture is kept in GPU and copied to pixel buffers by the callback
+    auto target = make_recording_target(target_name, source_texture, GraphicsOutput::RenderTextureMode::RTM_bind_or_copy,
+        fragment_shader_path);
+    if (!target)
+        return nullptr;
+
+    attach_async_readback(recording_targets_.size() - 1, callback, ring_size);
+
+    return target;
+}
+
+rpcore::RenderTarget* RecordingStage::make_yuv_recording_target(const std::string& target_name, Texture* source_texture,
+    YUVLayout layout, GraphicsOutput::RenderTextureMode rtmode)
+{
+    if (source_texture->get_texture_type() != Texture::TextureType::TT_2d_texture)
+    {
+        error("Can make YUV recording target using only Texture2D.");
+        return nullptr;
+    }
+    else if (source_texture->get_x_size() % 2 != 0 || source_texture->get_y_size() % 2 != 0)
+    {
+        error(fmt::format("Cannot make YUV recording target using Texture with odd size ({} x {}).",
+            source_texture->get_x_size(), source_texture->get_y_size()));
+        return nullptr;
+    }
+
+    auto target = setup_recording_target(target_name, source_texture, rtmode, Filename(), layout);
+
+    target->prepare_buffer();
+    reload_recording_target_shader(recording_targets_.size() - 1);
+
+    return target;
+}
+
+rpcore::RenderTarget* RecordingStage::make_async_yuv_recording_target(const std::string& target_name, Texture* source_texture,
+    YUVLayout layout, const FrameCallback& callback, int ring_size)
+{
+    auto target = make_yuv_recording_target(target_name, source_texture, layout,
+        GraphicsOutput::RenderTextureMode::RTM_bind_or_copy);
+    if (!target)
+        return nullptr;
+
+    attach_async_readback(recording_targets_.size() - 1, callback, ring_size);
+
+    return target;
+}
+
+const RecordingStage::AsyncStatistics* RecordingStage::get_async_statistics(const rpcore::RenderTarget* target) const
+{
+    for (const auto& target_info: recording_targets_)
+    {
+        if (target_info.target == target && target_info.async_readback)
+            return &target_info.async_readback->get_statistics();
+    }
+    return nullptr;
+}
+
 std::string RecordingStage::get_plugin_id(void) const
 {
     return RPPLUGINS_ID_STRING;
@@ -126,15 +213,19 @@ rpcore::RenderTarget* RecordingStage::setup_recording_target(
     const std::string& target_name,
     Texture* source_texture,
     GraphicsOutput::RenderTextureMode rtmode,
-    const Filename& fragment_shader_path)
+    const Filename& fragment_shader_path,
+    boost::optional<YUVLayout> yuv_layout)
 {
     auto target = create_target(target_name);
 
     target->set_sort(*show_through_target_->get_sort() - 1);
-    target->set_size(source_texture->get_x_size(), source_texture->get_y_size());
+    if (yuv_layout)
+        target->set_size(source_texture->get_x_size(), source_texture->get_y_size() * 3 / 2);
+    else
+        target->set_size(source_texture->get_x_size(), source_texture->get_y_size());
     target->set_render_texture_mode(rtmode);
 
-    const auto num_components = source_texture->get_num_components();
+    const auto num_components = yuv_layout ? 1 : source_texture->get_num_components();
     const int component_bit = 8;
 
     switch (num_components)
@@ -163,19 +254,53 @@ rpcore::RenderTarget* RecordingStage::setup_recording_target(
     info.target = target;
     info.source_texture = source_texture;
     info.shader_path = fragment_shader_path;
+    info.yuv_layout = yuv_layout;
 
     recording_targets_.push_back(std::move(info));
 
     return target;
 }
 
+void RecordingStage::attach_async_readback(size_t index, const FrameCallback& callback, int ring_size)
+{
+    auto& target_info = recording_targets_[index];
+
+    PT(AsyncReadbackCallback) readback = new AsyncReadbackCallback(target_info.target,
+        target_info.yuv_layout ? 1 : target_info.source_texture->get_num_components(), ring_size,
+        target_info.yuv_layout, callback);
+    target_info.async_readback = readback;
+
+    PT(CallbackNode) readback_node = new CallbackNode("RecordingReadbackNode");
+    readback_node->set_draw_callback(readback);
+
+    // read after the target is drawn
+    auto readback_np = target_info.target->get_postprocess_region()->get_node().attach_new_node(readback_node);
+    readback_np.set_depth_test(false);
+    readback_np.set_depth_write(false);
+    readback_np.set_bin("unsorted", 10);
+}
+
+void RecordingStage::set_yuv_layout_input(TargetInfo& target_info)
+{
+    target_info.target->set_shader_input(ShaderInput("yuv_layout", LVecBase4i(
+        target_info.source_texture->get_x_size(),
+        target_info.source_texture->get_y_size(),
+        *target_info.yuv_layout == YUVLayout::i420 ? 1 : 0,
+        0)));
+}
+
 void RecordingStage::reload_recording_target_shader(size_t index)
 {
     auto& target_info = recording_targets_[index];
 
     const bool stereo_mode = target_info.source_texture->get_z_size() == 2;
 
-    if (target_info.shader_path.empty())
+    if (target_info.yuv_layout)
+    {
+        target_info.target->set_shader(load_plugin_shader({ "recording_yuv420.frag.glsl" }));
+        set_yuv_layout_input(target_info);
+    }
+    else if (target_info.shader_path.empty())
     {
         std::string shader_path = "recording.frag.glsl";
         if (target_info.layer)
@@ -0,0 +1,207 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "streaming_video_writer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <render_pipeline/rpcore/rpobject.hpp>
+
+#include <fmt/format.h>
+
+namespace rpplugins {
+
+StreamingVideoWriter::StreamingVideoWriter(const std::string& path, const VideoWriterOptions& options,
+    std::unique_ptr<VideoBackend> backend): path_(path), options_(options), backend_(std::move(backend))
+{
+    thread_ = std::thread(&StreamingVideoWriter::run, this);
+}
+
+StreamingVideoWriter::~StreamingVideoWriter()
+{
+    close();
+}
+
+bool StreamingVideoWriter::push(const RecordingStage::RecordingFrame& frame)
+{
+    VideoFormat format;
+    format.width = frame.width;
+    format.height = frame.height;
+    format.num_components = frame.num_components;
+    format.yuv_layout = frame.yuv_layout;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (closing_ || failed_)
+        return false;
+
+    ++statistics_.pushed_frames;
+
+    // the first frame decides the format of video
+    if (!format_)
+    {
+        format_ = format;
+    }
+    else if (*format_ != format)
+    {
+        ++statistics_.dropped_frames;
+        return false;
+    }
+
+    const size_t capacity = (std::max)(size_t(1), options_.queue_capacity);
+    if (queue_.size() >= capacity)
+    {
+        switch (options_.drop_policy)
+        {
+        case DropPolicy::drop_newest:
+            ++statistics_.dropped_frames;
+            return false;
+
+        case DropPolicy::drop_oldest:
+            free_buffers_.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+            ++statistics_.dropped_frames;
+            break;
+
+        case DropPolicy::block:
+            frame_popped_.wait(lock, [&]() { return queue_.size() < capacity || closing_ || failed_; });
+            if (closing_ || failed_)
+            {
+                ++statistics_.dropped_frames;
+                return false;
+            }
+            break;
+        }
+    }
+
+    std::vector<unsigned char> buffer;
+    if (!free_buffers_.empty())
+    {
+        buffer = std::move(free_buffers_.back());
+        free_buffers_.pop_back();
+    }
+    buffer.resize(format.get_frame_size());
+    std::memcpy(buffer.data(), frame.data, buffer.size());
+
+    queue_.push_back(std::move(buffer));
+    statistics_.queue_depth = queue_.size();
+    statistics_.max_queue_depth = (std::max)(statistics_.max_queue_depth, queue_.size());
+
+    lock.unlock();
+    frame_pushed_.notify_one();
+
+    return true;
+}
+
+void StreamingVideoWriter::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    frame_pushed_.notify_all();
+    frame_popped_.notify_all();
+
+    // the thread writes remaining frames before exit
+    if (thread_.joinable())
+        thread_.join();
+}
+
+bool StreamingVideoWriter::is_open() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !closing_ && !failed_;
+}
+
+VideoWriter::Statistics StreamingVideoWriter::get_statistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+void StreamingVideoWriter::run()
+{
+    bool opened = false;
+    std::vector<unsigned char> buffer;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!buffer.empty())
+                free_buffers_.push_back(std::move(buffer));
+
+            frame_pushed_.wait(lock, [this]() { return !queue_.empty() || closing_; });
+            if (queue_.empty())
+                break;
+
+            buffer = std::move(queue_.front());
+            queue_.pop_front();
+            statistics_.queue_depth = queue_.size();
+        }
+        frame_popped_.notify_one();
+
+        const auto begin_time = std::chrono::steady_clock::now();
+
+        // backend is opened with the format of the first frame
+        bool success = !failed_;
+        if (success && !opened)
+        {
+            success = opened = backend_->open(path_, *format_, options_);
+            if (opened)
+                rpcore::RPObject::global_info(RPPLUGINS_ID_STRING, fmt::format("Video writer is opened: {}", path_));
+        }
+        if (success)
+            success = backend_->write(buffer.data());
+
+        const double encode_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (success)
+            {
+                ++statistics_.written_frames;
+                total_encode_time_ += encode_time;
+                statistics_.average_encode_time = total_encode_time_ / statistics_.written_frames;
+            }
+            else
+            {
+                // frames are dropped after failure
+                if (!failed_)
+                    rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, fmt::format("Failed to write video: {}", path_));
+                failed_ = true;
+                ++statistics_.dropped_frames;
+            }
+        }
+        if (!success)
+            frame_popped_.notify_all();
+    }
+
+    if (opened)
+        backend_->close();
+}
+
+}
@@ -0,0 +1,72 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "video_backend.hpp"
+
+namespace rpplugins {
+
+/** VideoWriter which encodes frames in a dedicated thread. */
+class StreamingVideoWriter : public VideoWriter
+{
+public:
+    StreamingVideoWriter(const std::string& path, const VideoWriterOptions& options, std::unique_ptr<VideoBackend> backend);
+    ~StreamingVideoWriter() override;
+
+    bool push(const RecordingStage::RecordingFrame& frame) override;
+    void close() override;
+    bool is_open() const override;
+    Statistics get_statistics() const override;
+
+private:
+    void run();
+
+    const std::string path_;
+    const VideoWriterOptions options_;
+    std::unique_ptr<VideoBackend> backend_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable frame_pushed_;
+    std::condition_variable frame_popped_;
+
+    /** Frames waiting for the encoder and buffers reused for next frames. */
+    std::deque<std::vector<unsigned char>> queue_;
+    std::vector<std::vector<unsigned char>> free_buffers_;
+
+    boost::optional<VideoFormat> format_;
+    bool closing_ = false;
+    bool failed_ = false;
+    Statistics statistics_;
+    double total_encode_time_ = 0;
+
+    std::thread thread_;
+};
+
+}
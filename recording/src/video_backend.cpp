@@ -0,0 +1,113 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "video_backend.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include <render_pipeline/rpcore/rpobject.hpp>
+
+#include <fmt/format.h>
+
+namespace rpplugins {
+
+size_t VideoFormat::get_frame_size() const
+{
+    if (yuv_layout)
+        return size_t(width) * height * 3 / 2;
+    else
+        return size_t(width) * height * num_components;
+}
+
+bool VideoFormat::operator==(const VideoFormat& other) const
+{
+    return width == other.width && height == other.height && num_components == other.num_components &&
+        yuv_layout == other.yuv_layout;
+}
+
+std::unique_ptr<VideoBackend> create_video_backend(const std::string& path, const VideoWriterOptions& options)
+{
+    std::string backend = options.backend;
+    if (backend.empty())
+    {
+        const auto dot = path.rfind('.');
+        std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+
+        if (extension == "y4m")
+            backend = "y4m";
+        else if (extension == "avi")
+            backend = "mjpeg";
+        else
+            backend = "ffmpeg";
+    }
+
+    std::unique_ptr<VideoBackend> result;
+    if (backend == "y4m")
+        result = create_y4m_video_backend();
+    else if (backend == "mjpeg")
+        result = create_mjpeg_video_backend();
+    else if (backend == "ffmpeg")
+        result = create_ffmpeg_video_backend();
+    else
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, fmt::format("Unknown video backend: {}", backend));
+
+    if (!result)
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, fmt::format("Video backend ({}) is not available for {}", backend, path));
+
+    return result;
+}
+
+void convert_to_i420(const unsigned char* data, const VideoFormat& format, std::vector<unsigned char>& i420)
+{
+    const size_t luma_size = size_t(format.width) * format.height;
+    const size_t chroma_size = luma_size / 4;
+    i420.resize(luma_size + chroma_size * 2);
+
+    if (!format.yuv_layout)
+    {
+        convert_rgb_to_yuv420(data, format.width, format.height, format.num_components, true, YUVLayout::i420, i420.data());
+    }
+    else if (*format.yuv_layout == YUVLayout::i420)
+    {
+        std::memcpy(i420.data(), data, i420.size());
+    }
+    else
+    {
+        // de-interleave UV plane of NV12
+        std::memcpy(i420.data(), data, luma_size);
+        const unsigned char* uv = data + luma_size;
+        unsigned char* u = i420.data() + luma_size;
+        unsigned char* v = u + chroma_size;
+        for (size_t k = 0; k < chroma_size; ++k)
+        {
+            u[k] = uv[k * 2 + 0];
+            v[k] = uv[k * 2 + 1];
+        }
+    }
+}
+
+}
@@ -0,0 +1,81 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rpplugins/recording/video_writer.hpp"
+
+namespace rpplugins {
+
+/** Format of frames written by VideoBackend. */
+struct VideoFormat
+{
+    int width;
+    int height;
+    int num_components;
+    boost::optional<YUVLayout> yuv_layout;
+
+    /** Size of a frame in RecordingFrame::data. */
+    size_t get_frame_size() const;
+
+    bool operator==(const VideoFormat& other) const;
+    bool operator!=(const VideoFormat& other) const { return !(*this == other); }
+};
+
+/** Encoder and container used by the thread of StreamingVideoWriter. */
+class VideoBackend
+{
+public:
+    virtual ~VideoBackend() = default;
+
+    /** Open the file. Errors are logged by backend. */
+    virtual bool open(const std::string& path, const VideoFormat& format, const VideoWriterOptions& options) = 0;
+
+    /** Write a frame in the format given to open. */
+    virtual bool write(const unsigned char* data) = 0;
+
+    virtual void close() = 0;
+};
+
+/**
+ * Create a backend from VideoWriterOptions::backend or the extension of @p path.
+ * @return  nullptr if the backend is unknown or not built.
+ */
+std::unique_ptr<VideoBackend> create_video_backend(const std::string& path, const VideoWriterOptions& options);
+
+std::unique_ptr<VideoBackend> create_y4m_video_backend();
+std::unique_ptr<VideoBackend> create_mjpeg_video_backend();
+std::unique_ptr<VideoBackend> create_ffmpeg_video_backend();
+
+/**
+ * Convert a frame (RGB bottom-up, NV12 or I420) to I420 planes.
+ * RGB frames should have 3 or 4 components.
+ */
+void convert_to_i420(const unsigned char* data, const VideoFormat& format, std::vector<unsigned char>& i420);
+
+}
@@ -0,0 +1,98 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <fstream>
+
+#include <render_pipeline/rpcore/rpobject.hpp>
+
+#include <fmt/format.h>
+
+#include "video_backend.hpp"
+
+namespace rpplugins {
+
+/** Raw YUV 4:2:0 in YUV4MPEG2 stream. */
+class Y4MVideoBackend : public VideoBackend
+{
+public:
+    bool open(const std::string& path, const VideoFormat& format, const VideoWriterOptions& options) override;
+    bool write(const unsigned char* data) override;
+    void close() override;
+
+private:
+    std::ofstream file_;
+    VideoFormat format_;
+    std::vector<unsigned char> i420_;
+};
+
+bool Y4MVideoBackend::open(const std::string& path, const VideoFormat& format, const VideoWriterOptions& options)
+{
+    if (!format.yuv_layout && format.num_components < 3)
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, "Y4M backend requires RGB, RGBA or YUV frames.");
+        return false;
+    }
+
+    if (format.width % 2 != 0 || format.height % 2 != 0)
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, fmt::format("Y4M requires even size ({} x {}).", format.width, format.height));
+        return false;
+    }
+
+    file_.open(path, std::ios::binary);
+    if (!file_)
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, fmt::format("Failed to open file: {}", path));
+        return false;
+    }
+
+    format_ = format;
+
+    // chroma of convert_rgb_to_yuv420 is centered in 2x2 pixels
+    file_ << fmt::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg\n", format.width, format.height, options.fps);
+
+    return bool(file_);
+}
+
+bool Y4MVideoBackend::write(const unsigned char* data)
+{
+    convert_to_i420(data, format_, i420_);
+
+    file_ << "FRAME\n";
+    file_.write(reinterpret_cast<const char*>(i420_.data()), i420_.size());
+
+    return bool(file_);
+}
+
+void Y4MVideoBackend::close()
+{
+    file_.close();
+}
+
+std::unique_ptr<VideoBackend> create_y4m_video_backend()
+{
+    return std::make_unique<Y4MVideoBackend>();
+}
+
+}
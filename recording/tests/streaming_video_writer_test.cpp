@@ -0,0 +1,290 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "streaming_video_writer.hpp"
+
+using rpplugins::RecordingStage;
+using rpplugins::StreamingVideoWriter;
+using rpplugins::VideoBackend;
+using rpplugins::VideoFormat;
+using rpplugins::VideoWriter;
+using rpplugins::VideoWriterOptions;
+
+namespace {
+
+/** Writes of FakeVideoBackend. It is shared because the writer owns the backend. */
+struct FakeBackendState
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    int started_writes = 0;
+    int allowed_writes = 0;
+    bool closed = false;
+
+    /** The first byte of written frames. */
+    std::vector<int> written;
+
+    void wait_started_writes(int count)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return started_writes >= count; });
+    }
+
+    void allow_writes(int count)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            allowed_writes += count;
+        }
+        changed.notify_all();
+    }
+};
+
+/** Backend which blocks in write until the test allows it, so the queue of the writer is filled deterministically. */
+class FakeVideoBackend : public VideoBackend
+{
+public:
+    FakeVideoBackend(const std::shared_ptr<FakeBackendState>& state): state_(state) {}
+
+    bool open(const std::string&, const VideoFormat&, const VideoWriterOptions&) override { return true; }
+
+    bool write(const unsigned char* data) override
+    {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        const int index = ++state_->started_writes;
+        state_->changed.notify_all();
+        state_->changed.wait(lock, [&]() { return index <= state_->allowed_writes; });
+        state_->written.push_back(data[0]);
+        return true;
+    }
+
+    void close() override
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->closed = true;
+    }
+
+private:
+    std::shared_ptr<FakeBackendState> state_;
+};
+
+int failures_count = 0;
+
+void check(bool condition, const char* test_name, const char* expression)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "%s: check failed: %s\n", test_name, expression);
+        ++failures_count;
+    }
+}
+
+#define CHECK(condition) check((condition), test_name, #condition)
+
+bool push_frame(VideoWriter& writer, unsigned char value)
+{
+    // 2x2 RGB frame filled with the value
+    const std::vector<unsigned char> data(2 * 2 * 3, value);
+
+    RecordingStage::RecordingFrame frame;
+    frame.data = data.data();
+    frame.width = 2;
+    frame.height = 2;
+    frame.num_components = 3;
+    frame.frame_index = value;
+    return writer.push(frame);
+}
+
+void wait_pushed_frames(const VideoWriter& writer, uint64_t count)
+{
+    while (writer.get_statistics().pushed_frames < count)
+        std::this_thread::yield();
+}
+
+/**
+ * Create a writer whose queue (capacity 2) is full of frames 2 and 3,
+ * while the backend is blocked in the write of frame 1.
+ */
+std::unique_ptr<StreamingVideoWriter> create_full_writer(VideoWriter::DropPolicy policy,
+    const std::shared_ptr<FakeBackendState>& state, const char* test_name)
+{
+    VideoWriterOptions options;
+    options.queue_capacity = 2;
+    options.drop_policy = policy;
+
+    std::unique_ptr<StreamingVideoWriter> writer(new StreamingVideoWriter("fake", options,
+        std::unique_ptr<VideoBackend>(new FakeVideoBackend(state))));
+
+    CHECK(push_frame(*writer, 1));
+    state->wait_started_writes(1);
+    CHECK(push_frame(*writer, 2));
+    CHECK(push_frame(*writer, 3));
+    CHECK(writer->get_statistics().queue_depth == 2);
+
+    return writer;
+}
+
+void drop_newest()
+{
+    const char* test_name = "drop_newest";
+    auto state = std::make_shared<FakeBackendState>();
+    auto writer = create_full_writer(VideoWriter::DropPolicy::drop_newest, state, test_name);
+
+    CHECK(!push_frame(*writer, 4));
+
+    state->allow_writes(3);
+    writer->close();
+
+    const auto statistics = writer->get_statistics();
+    CHECK(statistics.pushed_frames == 4);
+    CHECK(statistics.dropped_frames == 1);
+    CHECK(statistics.written_frames == 3);
+    CHECK(statistics.max_queue_depth == 2);
+    CHECK((state->written == std::vector<int>{ 1, 2, 3 }));
+    CHECK(state->closed);
+}
+
+void drop_oldest()
+{
+    const char* test_name = "drop_oldest";
+    auto state = std::make_shared<FakeBackendState>();
+    auto writer = create_full_writer(VideoWriter::DropPolicy::drop_oldest, state, test_name);
+
+    CHECK(push_frame(*writer, 4));
+    CHECK(push_frame(*writer, 5));
+
+    state->allow_writes(3);
+    writer->close();
+
+    const auto statistics = writer->get_statistics();
+    CHECK(statistics.pushed_frames == 5);
+    CHECK(statistics.dropped_frames == 2);
+    CHECK(statistics.written_frames == 3);
+    CHECK((state->written == std::vector<int>{ 1, 4, 5 }));
+}
+
+void block()
+{
+    const char* test_name = "block";
+    auto state = std::make_shared<FakeBackendState>();
+    auto writer = create_full_writer(VideoWriter::DropPolicy::block, state, test_name);
+
+    std::atomic<bool> returned(false);
+    bool pushed = false;
+    std::thread pusher([&]() {
+        pushed = push_frame(*writer, 4);
+        returned = true;
+    });
+
+    // the pusher counts the frame before it waits for space
+    wait_pushed_frames(*writer, 4);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!returned);
+
+    // the encoder takes frame 2 after writing frame 1
+    state->allow_writes(1);
+    pusher.join();
+    CHECK(pushed);
+
+    state->allow_writes(3);
+    writer->close();
+
+    const auto statistics = writer->get_statistics();
+    CHECK(statistics.pushed_frames == 4);
+    CHECK(statistics.dropped_frames == 0);
+    CHECK(statistics.written_frames == 4);
+    CHECK((state->written == std::vector<int>{ 1, 2, 3, 4 }));
+}
+
+void close_while_blocked()
+{
+    const char* test_name = "close_while_blocked";
+    auto state = std::make_shared<FakeBackendState>();
+    auto writer = create_full_writer(VideoWriter::DropPolicy::block, state, test_name);
+
+    bool pushed = true;
+    std::thread pusher([&]() { pushed = push_frame(*writer, 4); });
+    wait_pushed_frames(*writer, 4);
+
+    // close waits for the encoder, but the blocked push returns before it
+    std::thread closer([&]() { writer->close(); });
+    pusher.join();
+    CHECK(!pushed);
+
+    state->allow_writes(3);
+    closer.join();
+
+    CHECK(!writer->is_open());
+    CHECK(!push_frame(*writer, 5));
+
+    const auto statistics = writer->get_statistics();
+    CHECK(statistics.pushed_frames == 4);
+    CHECK(statistics.dropped_frames == 1);
+    CHECK(statistics.written_frames == 3);
+    CHECK((state->written == std::vector<int>{ 1, 2, 3 }));
+    CHECK(state->closed);
+}
+
+}
+
+/** Check drop policies of StreamingVideoWriter with a backend controlled by the test. */
+int main()
+{
+    struct Test
+    {
+        const char* name;
+        void (*function)();
+    };
+
+    const Test tests[] = {
+        { "drop_newest", drop_newest },
+        { "drop_oldest", drop_oldest },
+        { "block", block },
+        { "close_while_blocked", close_while_blocked },
+    };
+
+    int failed_tests_count = 0;
+    for (const auto& test: tests)
+    {
+        const int previous_failures_count = failures_count;
+        test.function();
+
+        const bool passed = failures_count == previous_failures_count;
+        if (!passed)
+            ++failed_tests_count;
+        std::printf("[%s] %s\n", passed ? "PASS" : "FAIL", test.name);
+    }
+
+    return failed_tests_count == 0 ? 0 : 1;
+}
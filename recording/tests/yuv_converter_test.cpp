@@ -0,0 +1,189 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <rpplugins/recording/yuv_converter.hpp>
+
+using rpplugins::YUVLayout;
+
+namespace {
+
+/**
+ * CPU emulation of "recording_yuv420.frag.glsl".
+ *
+ * @p texture has 8-bit RGBA texels from the bottom row as a texture does,
+ * and the result has rows of the target in the order of glReadPixels.
+ */
+class YUV420ShaderEmulation
+{
+public:
+    YUV420ShaderEmulation(const std::vector<unsigned char>& texture, int width, int height, YUVLayout layout):
+        texture_(texture), width_(width), height_(height), i420_(layout == YUVLayout::i420)
+    {
+    }
+
+    std::vector<unsigned char> render() const
+    {
+        const int target_height = height_ * 3 / 2;
+        std::vector<unsigned char> target(size_t(width_) * target_height);
+        for (int y = 0; y < target_height; ++y)
+        {
+            for (int x = 0; x < width_; ++x)
+            {
+                // 8-bit UNORM target
+                const float result = float(main(x, y)) / 255.0f;
+                target[size_t(y) * width_ + x] = static_cast<unsigned char>(std::lround(result * 255.0f));
+            }
+        }
+        return target;
+    }
+
+private:
+    struct IVec3
+    {
+        int r, g, b;
+    };
+
+    IVec3 fetch_rgb(int x, int y) const
+    {
+        // texelFetch of 8-bit UNORM texture and round(clamp(color, 0.0, 1.0) * 255.0)
+        const unsigned char* texel = &texture_[(size_t(height_ - 1 - y) * width_ + x) * 4];
+        const auto to_int = [](unsigned char value) {
+            const float color = float(value) / 255.0f;
+            return int(std::round((std::min)((std::max)(color, 0.0f), 1.0f) * 255.0f));
+        };
+        return IVec3{ to_int(texel[0]), to_int(texel[1]), to_int(texel[2]) };
+    }
+
+    IVec3 fetch_chroma_rgb(int cx, int cy) const
+    {
+        const IVec3 a = fetch_rgb(cx * 2, cy * 2);
+        const IVec3 b = fetch_rgb(cx * 2 + 1, cy * 2);
+        const IVec3 c = fetch_rgb(cx * 2, cy * 2 + 1);
+        const IVec3 d = fetch_rgb(cx * 2 + 1, cy * 2 + 1);
+        return IVec3{
+            (a.r + b.r + c.r + d.r + 2) >> 2,
+            (a.g + b.g + c.g + d.g + 2) >> 2,
+            (a.b + b.b + c.b + d.b + 2) >> 2 };
+    }
+
+    static int rgb_to_y(IVec3 c) { return (66 * c.r + 129 * c.g + 25 * c.b + 4224) >> 8; }
+    static int rgb_to_u(IVec3 c) { return (-38 * c.r - 74 * c.g + 112 * c.b + 32896) >> 8; }
+    static int rgb_to_v(IVec3 c) { return (112 * c.r - 94 * c.g - 18 * c.b + 32896) >> 8; }
+
+    int main(int x, int y) const
+    {
+        if (y < height_)
+            return rgb_to_y(fetch_rgb(x, y));
+
+        const int chroma_width = width_ / 2;
+        const int chroma_size = chroma_width * (height_ / 2);
+        int offset = (y - height_) * width_ + x;
+
+        if (!i420_)
+        {
+            const int index = offset / 2;
+            const IVec3 rgb = fetch_chroma_rgb(index % chroma_width, index / chroma_width);
+            return (offset & 1) == 0 ? rgb_to_u(rgb) : rgb_to_v(rgb);
+        }
+        else if (offset < chroma_size)
+        {
+            return rgb_to_u(fetch_chroma_rgb(offset % chroma_width, offset / chroma_width));
+        }
+        else
+        {
+            offset -= chroma_size;
+            return rgb_to_v(fetch_chroma_rgb(offset % chroma_width, offset / chroma_width));
+        }
+    }
+
+    const std::vector<unsigned char>& texture_;
+    int width_;
+    int height_;
+    bool i420_;
+};
+
+bool check_same_bytes(int width, int height, YUVLayout layout, const std::vector<unsigned char>& texture)
+{
+    const std::vector<unsigned char> shader_result = YUV420ShaderEmulation(texture, width, height, layout).render();
+
+    // RecordingFrame has rows from the bottom like the texture
+    std::vector<unsigned char> cpu_result(size_t(width) * height * 3 / 2);
+    rpplugins::convert_rgb_to_yuv420(texture.data(), width, height, 4, true, layout, cpu_result.data());
+
+    if (shader_result == cpu_result)
+        return true;
+
+    for (size_t k = 0; k < cpu_result.size(); ++k)
+    {
+        if (shader_result[k] != cpu_result[k])
+        {
+            std::fprintf(stderr, "%d x %d (%s): byte %zu differs (shader %d, CPU %d)\n", width, height,
+                layout == YUVLayout::i420 ? "I420" : "NV12", k, shader_result[k], cpu_result[k]);
+            break;
+        }
+    }
+    return false;
+}
+
+}
+
+/** Compare CPU conversion with the emulation of the shader for random and extreme colors. */
+int main()
+{
+    std::mt19937 random(5);
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    int failures_count = 0;
+    const int sizes[][2] = { { 2, 2 }, { 6, 4 }, { 34, 18 }, { 320, 240 } };
+    for (const auto& size: sizes)
+    {
+        const int width = size[0];
+        const int height = size[1];
+
+        std::vector<unsigned char> texture(size_t(width) * height * 4);
+        for (auto& value: texture)
+            value = static_cast<unsigned char>(distribution(random));
+
+        std::vector<unsigned char> extreme(texture.size());
+        for (size_t k = 0; k < extreme.size(); ++k)
+            extreme[k] = (k * 7 / 3) % 2 == 0 ? 0 : 255;
+
+        for (auto layout: { YUVLayout::nv12, YUVLayout::i420 })
+        {
+            if (!check_same_bytes(width, height, layout, texture))
+                ++failures_count;
+            if (!check_same_bytes(width, height, layout, extreme))
+                ++failures_count;
+        }
+    }
+
+    std::printf("[%s] yuv420_cpu_matches_shader\n", failures_count == 0 ? "PASS" : "FAIL");
+    return failures_count == 0 ? 0 : 1;
+}
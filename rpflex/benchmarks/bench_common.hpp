@@ -0,0 +1,107 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace rpflex {
+namespace bench {
+
+/** Benchmark registered by RPFLEX_BENCHMARK. */
+struct Benchmark
+{
+    const char* name;
+    std::function<void()> func;
+};
+
+inline std::vector<Benchmark>& get_benchmarks()
+{
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+struct BenchmarkRegistrar
+{
+    BenchmarkRegistrar(const char* name, std::function<void()> func)
+    {
+        get_benchmarks().push_back({ name, std::move(func) });
+    }
+};
+
+/** Prevent the compiler from removing the computation of @p value. */
+template <class T>
+inline void keep(const T& value)
+{
+    static const void* volatile sink = nullptr;
+    sink = &value;
+    static_cast<void>(sink);
+}
+
+/**
+ * Run @p func for @p repeats times after one warm-up, and print the median time.
+ * @p setup runs before each run of @p func without timing.
+ *
+ * @return  Median time in milliseconds.
+ */
+template <class Setup, class Func>
+double measure(const char* label, int repeats, const Setup& setup, const Func& func)
+{
+    setup();
+    func();
+
+    std::vector<double> times;
+    times.reserve(repeats);
+    for (int k = 0; k < repeats; ++k)
+    {
+        setup();
+        const auto begin_time = std::chrono::steady_clock::now();
+        func();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count());
+    }
+
+    std::sort(times.begin(), times.end());
+    const double median = times[times.size() / 2];
+    std::printf("  %-48s %10.4f ms (min %.4f, max %.4f)\n", label, median, times.front(), times.back());
+    return median;
+}
+
+template <class Func>
+double measure(const char* label, int repeats, const Func& func)
+{
+    return measure(label, repeats, []() {}, func);
+}
+
+}
+}
+
+/** Define and register a benchmark. */
+#define RPFLEX_BENCHMARK(NAME) \
+    static void NAME(); \
+    static const rpflex::bench::BenchmarkRegistrar NAME##_registrar(#NAME, NAME); \
+    static void NAME()
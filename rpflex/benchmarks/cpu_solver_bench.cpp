@@ -0,0 +1,89 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+#include <string>
+
+#include <rpflex/flex_buffer.hpp>
+#include <rpflex/utils/parallel_for.hpp>
+
+#include "solver_backend.hpp"
+#include "bench_common.hpp"
+
+RPFLEX_BENCHMARK(cpu_solver_update)
+{
+    NvFlexParams params;
+    std::memset(&params, 0, sizeof(params));
+    params.numIterations = 3;
+    params.gravity[2] = -9.8f;
+    params.radius = 0.1f;
+    params.solidRestDistance = 0.1f;
+    params.collisionDistance = 0.05f;
+    params.relaxationFactor = 1.0f;
+    params.maxSpeed = 100.0f;
+    params.planes[0][2] = 1.0f;
+    params.numPlanes = 1;
+
+    for (int side: { 10, 22, 46 })
+    {
+        const int count = side * side * side;
+
+        rpflex::FlexBuffer buffer(nullptr);
+        for (int k = 0; k < count; ++k)
+        {
+            buffer.positions.push_back(LVecBase4f((k % side) * 0.1f, (k / side % side) * 0.1f, 0.1f + k / (side * side) * 0.1f, 1.0f));
+            buffer.velocities.push_back(LVecBase3f(0.0f));
+            buffer.phases.push_back(NvFlexMakePhase(0, eNvFlexPhaseSelfCollide));
+            buffer.active_indices.push_back(k);
+        }
+        buffer.unmap();
+
+        auto backend = rpflex::create_cpu_backend(count);
+        backend->set_params(params);
+        backend->set_particles(buffer.positions, count);
+        backend->set_velocities(buffer.velocities, count);
+        backend->set_phases(buffer.phases, count);
+        backend->set_active(buffer.active_indices, count);
+
+        const std::string label = "update (" + std::to_string(count) + " particles, 2 substeps)";
+        rpflex::bench::measure(label.c_str(), 10, [&]() { backend->update(1.0f / 60.0f, 2, false); });
+    }
+}
+
+RPFLEX_BENCHMARK(parallel_for_dispatch)
+{
+    std::vector<float> values(1 << 16, 1.0f);
+
+    rpflex::bench::measure("dispatch of empty tasks", 1000, [&]() {
+        rpflex::parallel_for(0, static_cast<int>(values.size()), 1, [&](int begin, int end) {});
+    });
+
+    rpflex::bench::measure("scale 65536 floats", 1000, [&]() {
+        rpflex::parallel_for(0, static_cast<int>(values.size()), 1024, [&](int begin, int end) {
+            for (int k = begin; k < end; ++k)
+                values[k] *= 1.0001f;
+        });
+    });
+    rpflex::bench::keep(values[0]);
+}
@@ -0,0 +1,139 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string>
+#include <vector>
+
+#include <geomNode.h>
+#include <geomTriangles.h>
+#include <geomVertexFormat.h>
+#include <geomVertexReader.h>
+#include <geomVertexWriter.h>
+
+#include <rpflex/utils/geom_extractor.hpp>
+
+#include "bench_common.hpp"
+
+namespace {
+
+/** Grid of (cells x cells) quads in one Geom. The format has normals to check the strided copy. */
+NodePath make_grid_model(int cells)
+{
+    const int vertices_per_row = cells + 1;
+
+    PT(GeomVertexData) vdata = new GeomVertexData("grid", GeomVertexFormat::get_v3n3(), GeomEnums::UH_static);
+    vdata->unclean_set_num_rows(vertices_per_row * vertices_per_row);
+
+    GeomVertexWriter vertex(vdata, InternalName::get_vertex());
+    GeomVertexWriter normal(vdata, InternalName::get_normal());
+    for (int y = 0; y < vertices_per_row; ++y)
+    {
+        for (int x = 0; x < vertices_per_row; ++x)
+        {
+            vertex.add_data3f(float(x), float(y), 0.0f);
+            normal.add_data3f(0.0f, 0.0f, 1.0f);
+        }
+    }
+
+    PT(GeomTriangles) triangles = new GeomTriangles(GeomEnums::UH_static);
+    triangles->set_index_type(GeomEnums::NT_uint32);
+    triangles->reserve_num_vertices(cells * cells * 6);
+    for (int y = 0; y < cells; ++y)
+    {
+        for (int x = 0; x < cells; ++x)
+        {
+            const int index = y * vertices_per_row + x;
+            triangles->add_vertices(index, index + 1, index + vertices_per_row + 1);
+            triangles->add_vertices(index, index + vertices_per_row + 1, index + vertices_per_row);
+        }
+    }
+
+    PT(Geom) geom = new Geom(vdata);
+    geom->add_primitive(triangles);
+
+    PT(GeomNode) geom_node = new GeomNode("grid");
+    geom_node->add_geom(geom);
+
+    return NodePath(geom_node);
+}
+
+/** Previous extraction reading every vertex and index through the per-element API. */
+void extract_per_vertex(NodePath geom_nodepath, std::vector<LVecBase3f>& positions, std::vector<int>& indices)
+{
+    const GeomNode* geom_node = DCAST(GeomNode, geom_nodepath.node());
+    CPT(Geom) geom = geom_node->get_geom(0);
+
+    LPoint3f lower;
+    LPoint3f upper;
+    bool found = false;
+    geom->calc_tight_bounds(lower, upper, found, Thread::get_current_thread());
+
+    CPT(GeomVertexData) vdata = geom->get_vertex_data();
+    GeomVertexReader vertex(vdata, "vertex");
+
+    const int vertices_count = vdata->get_num_rows();
+    positions.clear();
+    positions.reserve(vertices_count);
+    for (int k = 0; k < vertices_count; ++k)
+        positions.push_back(vertex.get_data3f());
+
+    indices.clear();
+    for (int index = 0, index_end = geom->get_num_primitives(); index < index_end; ++index)
+    {
+        const auto& primitive = geom->get_primitive(index);
+        indices.reserve(indices.size() + primitive->get_num_vertices());
+        for (int k = 0, k_end = primitive->get_num_vertices(); k < k_end; ++k)
+            indices.push_back(primitive->get_vertex(k));
+    }
+}
+
+}
+
+RPFLEX_BENCHMARK(geom_extraction)
+{
+    // 2 * cells^2 triangles
+    for (int cells: { 70, 224, 708 })
+    {
+        NodePath model = make_grid_model(cells);
+        const std::string suffix = " (" + std::to_string(2 * cells * cells) + " triangles)";
+
+        std::vector<LVecBase3f> positions;
+        std::vector<int> indices;
+        rpflex::bench::measure(("per-vertex reader" + suffix).c_str(), 5, [&]() {
+            extract_per_vertex(model, positions, indices);
+            rpflex::bench::keep(indices.back());
+        });
+
+        rpflex::TriangleMeshData mesh;
+        rpflex::bench::measure(("array handles" + suffix).c_str(), 5, [&]() {
+            rpflex::extract_triangle_mesh(model, mesh, false);
+            rpflex::bench::keep(mesh.indices.back());
+        });
+
+        rpflex::bench::measure(("array handles with welding" + suffix).c_str(), 5, [&]() {
+            rpflex::extract_triangle_mesh(model, mesh, true);
+            rpflex::bench::keep(mesh.indices.back());
+        });
+    }
+}
@@ -0,0 +1,110 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <rpflex/utils/helpers.hpp>
+
+#include "bench_common.hpp"
+
+namespace {
+
+std::vector<LVecBase4f> make_random_positions(int count)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+
+    std::vector<LVecBase4f> positions(count);
+    for (auto& position: positions)
+        position = LVecBase4f(distribution(random), distribution(random), distribution(random), 1.0f);
+    return positions;
+}
+
+}
+
+RPFLEX_BENCHMARK(particle_bounds)
+{
+    for (int count: { 100000, 1000000, 4000000 })
+    {
+        const auto positions = make_random_positions(count);
+        LVecBase3f lower;
+        LVecBase3f upper;
+
+        std::string label = "scalar loop (" + std::to_string(count) + " particles)";
+        rpflex::bench::measure(label.c_str(), 10, [&]() {
+            lower = LVecBase3f(FLT_MAX);
+            upper = LVecBase3f(-FLT_MAX);
+            for (const auto& position: positions)
+            {
+                lower = position.get_xyz().fmin(lower);
+                upper = position.get_xyz().fmax(upper);
+            }
+            rpflex::bench::keep(lower);
+        });
+
+        label = "SIMD (" + std::to_string(count) + " particles)";
+        rpflex::bench::measure(label.c_str(), 10, [&]() {
+            GetParticleBounds(positions.data(), 0, count, lower, upper);
+            rpflex::bench::keep(lower);
+        });
+
+        rpflex::FlexBuffer buffer(nullptr);
+        buffer.positions.assign(positions.data(), count);
+
+        label = "parallel SIMD (" + std::to_string(count) + " particles)";
+        rpflex::bench::measure(label.c_str(), 10, [&]() {
+            GetParticleBounds(buffer, lower, upper);
+            rpflex::bench::keep(lower);
+        });
+    }
+}
+
+RPFLEX_BENCHMARK(rigid_local_positions)
+{
+    const int particles_per_rigid = 64;
+
+    for (int rigids_count: { 1000, 10000, 50000 })
+    {
+        const int count = rigids_count * particles_per_rigid;
+        const auto positions = make_random_positions(count);
+
+        std::vector<int> offsets(rigids_count + 1);
+        std::vector<int> indices(count);
+        for (int r = 0; r <= rigids_count; ++r)
+            offsets[r] = r * particles_per_rigid;
+        for (int k = 0; k < count; ++k)
+            indices[k] = k;
+
+        std::vector<LVecBase3f> local_positions(count);
+
+        const std::string label = std::to_string(rigids_count) + " rigids of " + std::to_string(particles_per_rigid) + " particles";
+        rpflex::bench::measure(label.c_str(), 10, [&]() {
+            CalculateRigidLocalPositions(positions.data(), count, offsets.data(), indices.data(), rigids_count,
+                local_positions.data());
+            rpflex::bench::keep(local_positions[0]);
+        });
+    }
+}
@@ -0,0 +1,148 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <rpflex/particle_query.hpp>
+
+#include "bench_common.hpp"
+
+namespace {
+
+const float RADIUS = 0.05f;
+
+/** Particles in a cube with the density of about one particle per cell of 2 * RADIUS. */
+void make_random_scene(rpflex::FlexBuffer& buffer, int count)
+{
+    std::mt19937 random(11);
+    const float extent = std::cbrt(float(count)) * 2.0f * RADIUS;
+    std::uniform_real_distribution<float> distribution(0.0f, extent);
+
+    buffer.positions.resize(count);
+    buffer.phases.resize(count, 0);
+    buffer.active_indices.resize(count);
+    for (int k = 0; k < count; ++k)
+    {
+        buffer.positions[k] = LVecBase4f(distribution(random), distribution(random), distribution(random), 1.0f);
+        buffer.active_indices[k] = k;
+    }
+}
+
+int brute_force_radius(const rpflex::FlexBuffer& buffer, const LVecBase3f& center, float radius, std::vector<int>& indices)
+{
+    indices.clear();
+    const float radius_sq = radius * radius;
+    for (int k = 0, k_end = buffer.active_indices.size(); k < k_end; ++k)
+    {
+        const int index = buffer.active_indices[k];
+        if ((buffer.positions[index].get_xyz() - center).length_squared() <= radius_sq)
+            indices.push_back(index);
+    }
+    return int(indices.size());
+}
+
+int brute_force_ray(const rpflex::FlexBuffer& buffer, const LVecBase3f& origin, const LVecBase3f& direction, float max_distance)
+{
+    const float radius_sq = RADIUS * RADIUS;
+    int best_index = -1;
+    float best_t = max_distance;
+    for (int k = 0, k_end = buffer.active_indices.size(); k < k_end; ++k)
+    {
+        const int index = buffer.active_indices[k];
+        const LVecBase3f oc = buffer.positions[index].get_xyz() - origin;
+        const float tc = oc.dot(direction);
+        const float dist_sq = oc.dot(oc) - tc * tc;
+        if (dist_sq > radius_sq)
+            continue;
+
+        const float t = (std::max)(0.0f, tc - std::sqrt(radius_sq - dist_sq));
+        if (t < best_t && tc + std::sqrt(radius_sq - dist_sq) >= 0.0f)
+        {
+            best_t = t;
+            best_index = index;
+        }
+    }
+    return best_index;
+}
+
+}
+
+RPFLEX_BENCHMARK(particle_query)
+{
+    // each measure runs 100 queries
+    const int queries_count = 100;
+
+    for (int count: { 10000, 100000, 1000000 })
+    {
+        rpflex::FlexBuffer buffer(nullptr);
+        make_random_scene(buffer, count);
+
+        const float extent = std::cbrt(float(count)) * 2.0f * RADIUS;
+        std::mt19937 random(13);
+        std::uniform_real_distribution<float> distribution(0.0f, extent);
+        std::vector<LVecBase3f> centers(queries_count);
+        for (auto& center: centers)
+            center = LVecBase3f(distribution(random), distribution(random), distribution(random));
+
+        const std::string suffix = " (" + std::to_string(count) + " particles)";
+
+        rpflex::ParticleQuery query;
+        rpflex::bench::measure(("build" + suffix).c_str(), 10, [&]() {
+            query.build(buffer, 2.0f * RADIUS);
+            rpflex::bench::keep(query.get_particles_count());
+        });
+
+        std::vector<int> indices;
+        const float query_radius = 4.0f * RADIUS;
+        rpflex::bench::measure(("radius, brute force" + suffix).c_str(), 5, [&]() {
+            int found = 0;
+            for (const auto& center: centers)
+                found += brute_force_radius(buffer, center, query_radius, indices);
+            rpflex::bench::keep(found);
+        });
+        rpflex::bench::measure(("radius, grid" + suffix).c_str(), 5, [&]() {
+            int found = 0;
+            for (const auto& center: centers)
+                found += query.query_radius(center, query_radius, indices);
+            rpflex::bench::keep(found);
+        });
+
+        // rays along the diagonal of the cube from the lower corner
+        const LVecBase3f direction = LVecBase3f(1.0f).normalized();
+        rpflex::bench::measure(("ray, brute force" + suffix).c_str(), 5, [&]() {
+            int hit = 0;
+            for (const auto& center: centers)
+                hit += brute_force_ray(buffer, center - direction * extent, direction, 2.0f * extent);
+            rpflex::bench::keep(hit);
+        });
+        rpflex::bench::measure(("ray, grid" + suffix).c_str(), 5, [&]() {
+            int hit = 0;
+            for (const auto& center: centers)
+                hit += query.query_ray(center - direction * extent, direction, 2.0f * extent, RADIUS);
+            rpflex::bench::keep(hit);
+        });
+    }
+}
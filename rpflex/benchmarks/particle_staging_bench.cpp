@@ -0,0 +1,74 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string>
+
+#include <rpflex/flex_buffer.hpp>
+
+#include "particle_pool.hpp"
+#include "particle_staging.hpp"
+#include "bench_common.hpp"
+
+/** Time to add an instance while simulating (Plugin::add_instance_live) for the size of scene. */
+RPFLEX_BENCHMARK(live_instance_add)
+{
+    const int instance_particles = 1000;
+
+    for (int max_particles: { 10000, 100000, 1000000 })
+    {
+        // half of particles are used by instances
+        const int scene_particles = max_particles / 2;
+
+        rpflex::FlexBuffer buffer(nullptr);
+        buffer.positions.resize(max_particles, LVecBase4f(0.0f));
+        buffer.velocities.resize(max_particles, LVecBase3f(0.0f));
+        buffer.phases.resize(max_particles, 0);
+        for (int k = 0; k < scene_particles; ++k)
+            buffer.active_indices.push_back(k);
+
+        rpflex::ParticlePool pool;
+        pool.reset(max_particles, scene_particles);
+        rpflex::ParticleStaging staging(nullptr);
+
+        // remove the added instance
+        const auto setup = [&]() {
+            for (int k = staging.get_begin(); k < staging.get_end(); ++k)
+                pool.free(k, buffer.active_indices);
+        };
+
+        const std::string label = "add " + std::to_string(instance_particles) + " particles to " +
+            std::to_string(scene_particles) + " particles";
+        rpflex::bench::measure(label.c_str(), 20, setup, [&]() {
+            staging.begin(buffer, scene_particles);
+            for (int k = 0; k < instance_particles; ++k)
+            {
+                buffer.positions.push_back(LVecBase4f(float(k), 0.0f, 0.0f, 1.0f));
+                buffer.velocities.push_back(LVecBase3f(0.0f));
+                buffer.phases.push_back(0);
+            }
+            staging.end(buffer);
+            staging.commit(buffer, pool, max_particles);
+        });
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string>
+
+#include <rpflex/utils/sdf_builder.hpp>
+
+#include "bench_common.hpp"
+
+namespace {
+
+rpflex::TriangleMeshData make_box_mesh(const LVecBase3f& half_extents)
+{
+    rpflex::TriangleMeshData mesh;
+    for (int k = 0; k < 8; ++k)
+    {
+        mesh.positions.emplace_back(
+            (k & 1) ? half_extents[0] : -half_extents[0],
+            (k & 2) ? half_extents[1] : -half_extents[1],
+            (k & 4) ? half_extents[2] : -half_extents[2]);
+    }
+
+    mesh.indices = {
+        0, 2, 1, 1, 2, 3,
+        4, 5, 6, 5, 7, 6,
+        0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7,
+        0, 4, 2, 2, 4, 6,
+        1, 3, 5, 3, 7, 5,
+    };
+    mesh.update_bounds();
+
+    return mesh;
+}
+
+}
+
+RPFLEX_BENCHMARK(sdf_builder)
+{
+    const auto mesh = make_box_mesh(LVecBase3f(1.0f, 0.6f, 0.3f));
+
+    for (int dimension: { 32, 64, 128 })
+    {
+        rpflex::SignedDistanceField sdf;
+        const std::string label = std::to_string(dimension) + "^3 grid";
+        rpflex::bench::measure(label.c_str(), 5, [&]() {
+            rpflex::build_signed_distance_field(mesh, dimension, sdf);
+            rpflex::bench::keep(sdf.distances[0]);
+        });
+    }
+}
@@ -0,0 +1,4 @@
+include(CMakeFindDependencyMacro)
+if(NOT TARGET Threads::Threads)
+    find_dependency(Threads)
+endif()
@@ -1,15 +1,32 @@
 # list header
 set(${PROJECT_NAME}_header_utils
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/cloth.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/convex_decomposition.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/convex_hull.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/geom_extractor.hpp"
     "${PROJECT_SOURCE_DIR}/include/rpflex/utils/helpers.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/mesh_simplifier.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/parallel_for.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/particle_renderer.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/sdf_builder.hpp"
     "${PROJECT_SOURCE_DIR}/include/rpflex/utils/shape.hpp"
     "${PROJECT_SOURCE_DIR}/include/rpflex/utils/shape_box.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/shape_convex.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/shape_sdf.hpp"
     "${PROJECT_SOURCE_DIR}/include/rpflex/utils/triangle_mesh.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/utils/triangle_renderer.hpp"
 )
 
 set(${PROJECT_NAME}_header_root
     "${PROJECT_SOURCE_DIR}/include/rpflex/flex_buffer.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/flex_vector.hpp"
     "${PROJECT_SOURCE_DIR}/include/rpflex/instance_interface.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/particle_query.hpp"
     "${PROJECT_SOURCE_DIR}/include/rpflex/plugin.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/profiler.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/rigid_activity_tracker.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/rigid_binding_table.hpp"
+    "${PROJECT_SOURCE_DIR}/include/rpflex/triangle_mesh_registry.hpp"
 )
 
 set(${PROJECT_NAME}_headers
@@ -25,7 +42,19 @@ source_group("rpflex" FILES ${${PROJECT_NAME}_header_root})
 
 # list source
 set(${PROJECT_NAME}_source_root
+    "${PROJECT_SOURCE_DIR}/src/cpu_solver.cpp"
+    "${PROJECT_SOURCE_DIR}/src/cpu_solver.hpp"
+    "${PROJECT_SOURCE_DIR}/src/fluid_render_stage.cpp"
+    "${PROJECT_SOURCE_DIR}/src/fluid_render_stage.hpp"
+    "${PROJECT_SOURCE_DIR}/src/particle_pool.cpp"
+    "${PROJECT_SOURCE_DIR}/src/particle_pool.hpp"
+    "${PROJECT_SOURCE_DIR}/src/particle_staging.cpp"
+    "${PROJECT_SOURCE_DIR}/src/particle_staging.hpp"
     "${PROJECT_SOURCE_DIR}/src/plugin.cpp"
+    "${PROJECT_SOURCE_DIR}/src/snapshot.cpp"
+    "${PROJECT_SOURCE_DIR}/src/snapshot.hpp"
+    "${PROJECT_SOURCE_DIR}/src/solver_backend.cpp"
+    "${PROJECT_SOURCE_DIR}/src/solver_backend.hpp"
 )
 
 set(${PROJECT_NAME}_sources
@@ -29,10 +29,13 @@
 #include <NvFlex.h>
 #include <NvFlexExt.h>
 
+#include <rpflex/flex_vector.hpp>
+
 namespace rpflex {
 
 struct FlexBuffer
 {
+    /** If @p lib is nullptr, the buffers are stored in host memory without Flex. */
     FlexBuffer(NvFlexLibrary* lib);
 
     void destroy();
@@ -41,57 +44,76 @@ struct FlexBuffer
     void unmap();
 
     // buffers
-    NvFlexVector<LVecBase4f> positions;
-    NvFlexVector<LVecBase4f> rest_positions;
-    NvFlexVector<LVecBase3f> velocities;
-    NvFlexVector<int> phases;
-    NvFlexVector<float> densities;
-    NvFlexVector<LVecBase4f> anisotropy1;
-    NvFlexVector<LVecBase4f> anisotropy2;
-    NvFlexVector<LVecBase4f> anisotropy3;
-    NvFlexVector<LVecBase4f> normals;
-    NvFlexVector<LVecBase4f> smooth_positions;
-    NvFlexVector<LVecBase4f> diffuse_positions;
-    NvFlexVector<LVecBase4f> diffuse_velocities;
-    NvFlexVector<int> diffuse_indices;
-    NvFlexVector<int> active_indices;
+    FlexVector<LVecBase4f> positions;
+    FlexVector<LVecBase4f> rest_positions;
+    FlexVector<LVecBase3f> velocities;
+    FlexVector<int> phases;
+    FlexVector<float> densities;
+    FlexVector<LVecBase4f> anisotropy1;
+    FlexVector<LVecBase4f> anisotropy2;
+    FlexVector<LVecBase4f> anisotropy3;
+    FlexVector<LVecBase4f> normals;
+    FlexVector<LVecBase4f> smooth_positions;
+    FlexVector<LVecBase4f> diffuse_positions;
+    FlexVector<LVecBase4f> diffuse_velocities;
+    FlexVector<int> diffuse_indices;
+    FlexVector<int> active_indices;
 
     // convexes
-    NvFlexVector<NvFlexCollisionGeometry> shape_geometry;
-    NvFlexVector<LVecBase4f> shape_positions;
-    NvFlexVector<LQuaternionf> shape_rotations;
-    NvFlexVector<LVecBase4f> shape_prev_positions;
-    NvFlexVector<LQuaternionf> shape_prev_rotations;
-    NvFlexVector<int> shape_flags;
+    FlexVector<NvFlexCollisionGeometry> shape_geometry;
+    FlexVector<LVecBase4f> shape_positions;
+    FlexVector<LQuaternionf> shape_rotations;
+    FlexVector<LVecBase4f> shape_prev_positions;
+    FlexVector<LQuaternionf> shape_prev_rotations;
+    FlexVector<int> shape_flags;
 
     // rigids
-    NvFlexVector<int> rigid_offsets;
-    NvFlexVector<int> rigid_indices;
-    NvFlexVector<int> rigid_mesh_size;
-    NvFlexVector<float> rigid_coefficients;
-    NvFlexVector<LQuaternionf> rigid_rotations;
-    NvFlexVector<LVecBase3f> rigid_translations;
-    NvFlexVector<LVecBase3f> rigid_local_positions;
-    NvFlexVector<LVecBase4f> rigid_local_normals;
+    FlexVector<int> rigid_offsets;
+    FlexVector<int> rigid_indices;
+    FlexVector<int> rigid_mesh_size;
+    FlexVector<float> rigid_coefficients;
+    FlexVector<LQuaternionf> rigid_rotations;
+    FlexVector<LVecBase3f> rigid_translations;
+    FlexVector<LVecBase3f> rigid_local_positions;
+    FlexVector<LVecBase4f> rigid_local_normals;
 
     // inflatables
-    NvFlexVector<int> inflatable_tri_offsets;
-    NvFlexVector<int> inflatable_tri_counts;
-    NvFlexVector<float> inflatable_volumes;
-    NvFlexVector<float> inflatable_coefficients;
-    NvFlexVector<float> inflatable_pressures;
+    FlexVector<int> inflatable_tri_offsets;
+    FlexVector<int> inflatable_tri_counts;
+    FlexVector<float> inflatable_volumes;
+    FlexVector<float> inflatable_coefficients;
+    FlexVector<float> inflatable_pressures;
 
     // springs
-    NvFlexVector<int> spring_indices;
-    NvFlexVector<float> spring_lengths;
-    NvFlexVector<float> spring_stiffness;
+    FlexVector<int> spring_indices;
+    FlexVector<float> spring_lengths;
+    FlexVector<float> spring_stiffness;
 
-    NvFlexVector<int> triangles;
-    NvFlexVector<LVecBase3f> triangle_normals;
-    NvFlexVector<LVecBase3f> uvs;
+    FlexVector<int> triangles;
+    FlexVector<LVecBase3f> triangle_normals;
+    FlexVector<LVecBase3f> uvs;
 };
 
+/**
+ * Convert a quaternion of Panda3D (r, i, j, k) to the order of Flex (x, y, z, w).
+ * Rotations in FlexBuffer are read by Flex in this order.
+ */
+LQuaternionf to_flex_quat(const LQuaternionf& quat);
+
+/** Convert a quaternion in the order of Flex (x, y, z, w) to Panda3D (r, i, j, k). */
+LQuaternionf from_flex_quat(const LQuaternionf& quat);
+
 // ************************************************************************************************
+inline LQuaternionf to_flex_quat(const LQuaternionf& quat)
+{
+    return LQuaternionf(quat.get_i(), quat.get_j(), quat.get_k(), quat.get_r());
+}
+
+inline LQuaternionf from_flex_quat(const LQuaternionf& quat)
+{
+    return LQuaternionf(quat[3], quat[0], quat[1], quat[2]);
+}
+
 inline FlexBuffer::FlexBuffer(NvFlexLibrary* lib):
     positions(lib), rest_positions(lib), velocities(lib), phases(lib), densities(lib), anisotropy1(lib),
     anisotropy2(lib), anisotropy3(lib), normals(lib), smooth_positions(lib),
@@ -0,0 +1,247 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include <NvFlex.h>
+
+namespace rpflex {
+
+/**
+ * Vector which has the interface of NvFlexVector.
+ *
+ * If the library is nullptr (ex, CPU solver), elements are stored in host memory
+ * and Flex is not called. Then, map and unmap only set mappedPtr.
+ */
+template <typename T>
+struct FlexVector
+{
+    FlexVector(NvFlexLibrary* l, int size=0);
+    FlexVector(const FlexVector&) = delete;
+    FlexVector& operator=(const FlexVector&) = delete;
+    ~FlexVector();
+
+    /** Reinitialize the vector leaving it unmapped. */
+    void init(int size);
+
+    void destroy();
+
+    void resize(int newCount);
+    void resize(int newCount, const T& val);
+
+    /** Grow the storage. The vector is mapped after growing. */
+    void reserve(int minCapacity);
+
+    void assign(const T* srcPtr, int newCount);
+    void copyto(T* dest, int count);
+    void push_back(const T& t);
+
+    void map(int flags=eNvFlexMapWait);
+    void unmap();
+
+    /** Swap storages. Both vectors should have the same library. */
+    void swap(FlexVector& other);
+
+    /** Get host memory regardless of mapping, or nullptr if the elements are stored in Flex buffer. */
+    T* get_host_data() const;
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const T& back() const { assert(mappedPtr && count > 0); return mappedPtr[count-1]; }
+
+    const T& operator[](int index) const { assert(mappedPtr && index < count); return mappedPtr[index]; }
+    T& operator[](int index) { assert(mappedPtr && index < count); return mappedPtr[index]; }
+
+    NvFlexLibrary* lib;
+    NvFlexBuffer* buffer;
+    T* mappedPtr;
+    int count;
+    int capacity;
+
+private:
+    T* host_;
+};
+
+// ************************************************************************************************
+template <typename T>
+FlexVector<T>::FlexVector(NvFlexLibrary* l, int size): lib(l), buffer(nullptr), mappedPtr(nullptr), count(0), capacity(0),
+    host_(nullptr)
+{
+    if (size)
+        init(size);
+}
+
+template <typename T>
+FlexVector<T>::~FlexVector()
+{
+    destroy();
+}
+
+template <typename T>
+void FlexVector<T>::init(int size)
+{
+    destroy();
+    resize(size);
+    unmap();
+}
+
+template <typename T>
+void FlexVector<T>::destroy()
+{
+    if (buffer)
+    {
+        if (mappedPtr)
+            NvFlexUnmap(buffer);
+        NvFlexFreeBuffer(buffer);
+    }
+    ::operator delete(host_);
+
+    buffer = nullptr;
+    host_ = nullptr;
+    mappedPtr = nullptr;
+    count = 0;
+    capacity = 0;
+}
+
+template <typename T>
+void FlexVector<T>::resize(int newCount)
+{
+    assert(newCount >= 0);
+    reserve(newCount);
+    map();
+    count = newCount;
+}
+
+template <typename T>
+void FlexVector<T>::resize(int newCount, const T& val)
+{
+    const int startInit = count;
+    resize(newCount);
+    for (int i = startInit; i < newCount; ++i)
+        mappedPtr[i] = val;
+}
+
+template <typename T>
+void FlexVector<T>::reserve(int minCapacity)
+{
+    if (minCapacity <= capacity)
+        return;
+
+    const int newCapacity = minCapacity * 2;
+
+    if (lib)
+    {
+        NvFlexBuffer* newBuf = NvFlexAllocBuffer(lib, newCapacity, sizeof(T), eNvFlexBufferHost);
+        T* newPtr = static_cast<T*>(NvFlexMap(newBuf, eNvFlexMapWait));
+        if (buffer)
+        {
+            map();
+            std::memcpy(newPtr, mappedPtr, count * sizeof(T));
+            unmap();
+            NvFlexFreeBuffer(buffer);
+        }
+        buffer = newBuf;
+        mappedPtr = newPtr;
+    }
+    else
+    {
+        T* newPtr = static_cast<T*>(::operator new(newCapacity * sizeof(T)));
+        if (host_)
+            std::memcpy(newPtr, host_, count * sizeof(T));
+        ::operator delete(host_);
+        host_ = newPtr;
+        mappedPtr = newPtr;
+    }
+
+    capacity = newCapacity;
+}
+
+template <typename T>
+void FlexVector<T>::assign(const T* srcPtr, int newCount)
+{
+    resize(newCount);
+    std::memcpy(mappedPtr, srcPtr, newCount * sizeof(T));
+}
+
+template <typename T>
+void FlexVector<T>::copyto(T* dest, int count)
+{
+    map();
+    std::memcpy(dest, mappedPtr, sizeof(T) * count);
+    unmap();
+}
+
+template <typename T>
+void FlexVector<T>::push_back(const T& t)
+{
+    reserve(count + 1);
+    map();
+    mappedPtr[count++] = t;
+}
+
+template <typename T>
+void FlexVector<T>::map(int flags)
+{
+    if (mappedPtr)
+        return;
+
+    if (buffer)
+        mappedPtr = static_cast<T*>(NvFlexMap(buffer, flags));
+    else
+        mappedPtr = host_;
+}
+
+template <typename T>
+void FlexVector<T>::unmap()
+{
+    if (buffer && mappedPtr)
+        NvFlexUnmap(buffer);
+    mappedPtr = nullptr;
+}
+
+template <typename T>
+void FlexVector<T>::swap(FlexVector& other)
+{
+    assert(lib == other.lib);
+
+    std::swap(buffer, other.buffer);
+    std::swap(mappedPtr, other.mappedPtr);
+    std::swap(count, other.count);
+    std::swap(capacity, other.capacity);
+    std::swap(host_, other.host_);
+}
+
+template <typename T>
+T* FlexVector<T>::get_host_data() const
+{
+    return host_;
+}
+
+}
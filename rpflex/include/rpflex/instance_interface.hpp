@@ -30,12 +30,78 @@ class Plugin;
 
 class InstanceInterface
 {
+public:
+    enum AccessFlag : unsigned int
+    {
+        ACCESS_NONE = 0,
+        ACCESS_READ = 1 << 0,
+        ACCESS_WRITE = 1 << 1,
+        ACCESS_READ_WRITE = ACCESS_READ | ACCESS_WRITE,
+    };
+
+    /**
+     * Buffers accessed by sync_flex.
+     *
+     * Ranges are [begin, end) of particle buffers (positions, velocities, phases, ...)
+     * and shape buffers (shape_positions, shape_rotations, ...).
+     *
+     * If @a parallel is true, sync_flex may run in other threads concurrently with instances
+     * whose accesses do not conflict. Then, sync_flex should access only the declared ranges,
+     * call only const functions of Plugin (and Plugin::set_particles_changed),
+     * and not change other buffers or instances.
+     * Because Plugin is not const in sync_flex, overloads like Plugin::get_flex_params resolve
+     * to non-const versions, so read them through a const reference of Plugin.
+     * Scene graph (NodePath, Geom, GeomVertexData, Texture, ...) must NOT be changed in parallel sync_flex,
+     * because Panda3D does not allow it from other threads. Change it in post_sync_flex instead.
+     */
+    struct BufferAccess
+    {
+        bool parallel = false;
+
+        unsigned int particles = ACCESS_NONE;
+        int particle_begin = 0;
+        int particle_end = 0;
+
+        unsigned int shapes = ACCESS_NONE;
+        int shape_begin = 0;
+        int shape_end = 0;
+
+        /** Check if two accesses overlap and at least one of them writes. */
+        bool conflicts(const BufferAccess& other) const;
+    };
+
 public:
     virtual ~InstanceInterface() {}
 
     virtual void initialize(Plugin& rpflex_plugin) {}
     virtual void post_initialize(Plugin& rpflex_plugin) {}
     virtual void sync_flex(Plugin& rpflex_plugin) {}
+
+    /**
+     * Called in the main thread after sync_flex of this instance and of instances running with it.
+     *
+     * This is called before instances conflicting with this one are synchronized,
+     * so the declared ranges of buffers have the same data as in sync_flex.
+     */
+    virtual void post_sync_flex(Plugin& rpflex_plugin) {}
+
+    /**
+     * Get buffers accessed by the next sync_flex. This is called in every frame before sync_flex.
+     *
+     * By default, sync_flex runs serially in the order of instances.
+     */
+    virtual BufferAccess get_buffer_access(const Plugin& rpflex_plugin) const { return BufferAccess{}; }
 };
 
+// ************************************************************************************************
+inline bool InstanceInterface::BufferAccess::conflicts(const BufferAccess& other) const
+{
+    const auto overlaps = [](unsigned int a, int a_begin, int a_end, unsigned int b, int b_begin, int b_end) {
+        return ((a | b) & ACCESS_WRITE) && a && b && a_begin < b_end && b_begin < a_end;
+    };
+
+    return overlaps(particles, particle_begin, particle_end, other.particles, other.particle_begin, other.particle_end) ||
+        overlaps(shapes, shape_begin, shape_end, other.shapes, other.shape_begin, other.shape_end);
+}
+
 }
@@ -0,0 +1,484 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include <luse.h>
+
+#include "rpflex/flex_buffer.hpp"
+#include "rpflex/utils/parallel_for.hpp"
+
+namespace rpflex {
+
+/**
+ * Spatial index of active particles for radius, AABB and ray queries.
+ *
+ * The index is a uniform grid hashed into a table, and it is built from particle
+ * positions in one pass. Positions and phases are copied in the cell order,
+ * so queries do not need mapped buffers and are valid until the next build.
+ *
+ * Plugin builds its index after readback in every frame when it is enabled
+ * (see Plugin::set_particle_query_enabled).
+ */
+class ParticleQuery
+{
+public:
+    /** Filter of particles by phase. */
+    struct Filter
+    {
+        /**
+         * @param   group       Group of particles, or -1 for all groups.
+         * @param   flags_mask  Particles pass when (phase & flags_mask) == flags (ex, eNvFlexPhaseFluid).
+         */
+        Filter(int group=-1, int flags_mask=0, int flags=0);
+
+        bool test(int phase) const;
+
+        int group;
+        int flags_mask;
+        int flags;
+    };
+
+    /**
+     * Build the index from active particles of @p buffer.
+     *
+     * Buffers should be mapped.
+     * @param   cell_size   Size of grid cell. Query radius of a few cells is efficient.
+     */
+    void build(const FlexBuffer& buffer, float cell_size);
+
+    void clear();
+
+    float get_cell_size() const;
+
+    /** Get the number of indexed particles. */
+    int get_particles_count() const;
+
+    /** Get bounds of indexed particles. They are invalid if there is no particle. */
+    const LVecBase3f& get_lower_bound() const;
+    const LVecBase3f& get_upper_bound() const;
+
+    /**
+     * Find particles whose centers are within @p radius from @p center.
+     *
+     * @param   indices     Particle indices are stored in the cell order (not sorted).
+     * @return  The number of found particles.
+     */
+    int query_radius(const LVecBase3f& center, float radius, std::vector<int>& indices,
+        const Filter& filter=Filter()) const;
+
+    /** Find particles whose centers are in the box [@p lower, @p upper]. */
+    int query_aabb(const LVecBase3f& lower, const LVecBase3f& upper, std::vector<int>& indices,
+        const Filter& filter=Filter()) const;
+
+    /**
+     * Find the first particle hit by the ray.
+     *
+     * Particles are spheres of @p particle_radius.
+     *
+     * @param   direction   Normalized direction.
+     * @param   distance    Distance to the hit point, if not nullptr.
+     * @return  The index of hit particle, or -1 if nothing is hit.
+     */
+    int query_ray(const LVecBase3f& origin, const LVecBase3f& direction, float max_distance, float particle_radius,
+        const Filter& filter=Filter(), float* distance=nullptr) const;
+
+private:
+    static constexpr int GRAIN_SIZE = 4096;
+
+    int get_cell_coord(float x) const;
+    int hash_cell(int ix, int iy, int iz) const;
+
+    /** Call @p func(sorted_index) for particles in the cell. */
+    template <class Func>
+    void for_each_in_cell(int ix, int iy, int iz, const Func& func) const;
+
+    /** Check if the number of cells in the range is larger than the number of particles. */
+    bool is_cell_range_large(const int (&lower)[3], const int (&upper)[3]) const;
+
+    float cell_size_ = 1.0f;
+    float inv_cell_size_ = 1.0f;
+    int mask_ = 0;
+
+    LVecBase3f lower_ = LVecBase3f(FLT_MAX);
+    LVecBase3f upper_ = LVecBase3f(-FLT_MAX);
+
+    std::vector<int> cell_starts_;
+    std::vector<int> cell_hashes_;
+
+    // particles in the cell order
+    std::vector<LVecBase4f> positions_;
+    std::vector<int> phases_;
+    std::vector<int> indices_;
+};
+
+// ************************************************************************************************
+
+inline ParticleQuery::Filter::Filter(int group, int flags_mask, int flags):
+    group(group), flags_mask(flags_mask), flags(flags)
+{
+}
+
+inline bool ParticleQuery::Filter::test(int phase) const
+{
+    return (group < 0 || (phase & eNvFlexPhaseGroupMask) == group) && (phase & flags_mask) == flags;
+}
+
+inline void ParticleQuery::build(const FlexBuffer& buffer, float cell_size)
+{
+    const int count = buffer.active_indices.size();
+    const int* active = buffer.active_indices.mappedPtr;
+    const LVecBase4f* positions = buffer.positions.mappedPtr;
+    const int* phases = buffer.phases.mappedPtr;
+
+    int table_size = 1024;
+    while (table_size < count * 2)
+        table_size *= 2;
+    mask_ = table_size - 1;
+
+    cell_size_ = (std::max)(cell_size, 1e-4f);
+    inv_cell_size_ = 1.0f / cell_size_;
+
+    lower_ = LVecBase3f(FLT_MAX);
+    upper_ = LVecBase3f(-FLT_MAX);
+
+    std::mutex bounds_mutex;
+    cell_hashes_.resize(count);
+    parallel_for(0, count, GRAIN_SIZE, [&](int begin, int end) {
+        LVecBase3f lower(FLT_MAX);
+        LVecBase3f upper(-FLT_MAX);
+        for (int k = begin; k < end; ++k)
+        {
+            const LVecBase4f& pos = positions[active[k]];
+            cell_hashes_[k] = hash_cell(get_cell_coord(pos[0]), get_cell_coord(pos[1]), get_cell_coord(pos[2]));
+            for (int a = 0; a < 3; ++a)
+            {
+                lower[a] = (std::min)(lower[a], pos[a]);
+                upper[a] = (std::max)(upper[a], pos[a]);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(bounds_mutex);
+        for (int a = 0; a < 3; ++a)
+        {
+            lower_[a] = (std::min)(lower_[a], lower[a]);
+            upper_[a] = (std::max)(upper_[a], upper[a]);
+        }
+    });
+
+    // counting sort by cell hash
+    cell_starts_.assign(table_size + 1, 0);
+    for (int k = 0; k < count; ++k)
+        ++cell_starts_[cell_hashes_[k] + 1];
+    for (int k = 0; k < table_size; ++k)
+        cell_starts_[k + 1] += cell_starts_[k];
+
+    indices_.resize(count);
+    std::vector<int> cursors(cell_starts_.begin(), cell_starts_.end() - 1);
+    for (int k = 0; k < count; ++k)
+        indices_[cursors[cell_hashes_[k]]++] = active[k];
+
+    positions_.resize(count);
+    phases_.resize(count);
+    parallel_for(0, count, GRAIN_SIZE, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k)
+        {
+            positions_[k] = positions[indices_[k]];
+            phases_[k] = phases[indices_[k]];
+        }
+    });
+}
+
+inline void ParticleQuery::clear()
+{
+    mask_ = 0;
+    lower_ = LVecBase3f(FLT_MAX);
+    upper_ = LVecBase3f(-FLT_MAX);
+    cell_starts_.clear();
+    cell_hashes_.clear();
+    positions_.clear();
+    phases_.clear();
+    indices_.clear();
+}
+
+inline float ParticleQuery::get_cell_size() const
+{
+    return cell_size_;
+}
+
+inline int ParticleQuery::get_particles_count() const
+{
+    return static_cast<int>(indices_.size());
+}
+
+inline const LVecBase3f& ParticleQuery::get_lower_bound() const
+{
+    return lower_;
+}
+
+inline const LVecBase3f& ParticleQuery::get_upper_bound() const
+{
+    return upper_;
+}
+
+inline int ParticleQuery::query_radius(const LVecBase3f& center, float radius, std::vector<int>& indices,
+    const Filter& filter) const
+{
+    indices.clear();
+    if (indices_.empty() || radius < 0.0f)
+        return 0;
+
+    const float radius_sq = radius * radius;
+    const auto test = [&](int k) {
+        const LVecBase4f& pos = positions_[k];
+        const float dx = pos[0] - center[0];
+        const float dy = pos[1] - center[1];
+        const float dz = pos[2] - center[2];
+        if (dx * dx + dy * dy + dz * dz <= radius_sq && filter.test(phases_[k]))
+            indices.push_back(indices_[k]);
+    };
+
+    int lower[3];
+    int upper[3];
+    for (int a = 0; a < 3; ++a)
+    {
+        lower[a] = get_cell_coord((std::max)(center[a] - radius, lower_[a]));
+        upper[a] = get_cell_coord((std::min)(center[a] + radius, upper_[a]));
+        if (lower[a] > upper[a])
+            return 0;
+    }
+
+    if (is_cell_range_large(lower, upper))
+    {
+        for (int k = 0, k_end = get_particles_count(); k < k_end; ++k)
+            test(k);
+    }
+    else
+    {
+        for (int z = lower[2]; z <= upper[2]; ++z)
+            for (int y = lower[1]; y <= upper[1]; ++y)
+                for (int x = lower[0]; x <= upper[0]; ++x)
+                    for_each_in_cell(x, y, z, test);
+    }
+
+    return static_cast<int>(indices.size());
+}
+
+inline int ParticleQuery::query_aabb(const LVecBase3f& lower, const LVecBase3f& upper, std::vector<int>& indices,
+    const Filter& filter) const
+{
+    indices.clear();
+    if (indices_.empty())
+        return 0;
+
+    const auto test = [&](int k) {
+        const LVecBase4f& pos = positions_[k];
+        if (lower[0] <= pos[0] && pos[0] <= upper[0] &&
+            lower[1] <= pos[1] && pos[1] <= upper[1] &&
+            lower[2] <= pos[2] && pos[2] <= upper[2] &&
+            filter.test(phases_[k]))
+        {
+            indices.push_back(indices_[k]);
+        }
+    };
+
+    int cell_lower[3];
+    int cell_upper[3];
+    for (int a = 0; a < 3; ++a)
+    {
+        cell_lower[a] = get_cell_coord((std::max)(lower[a], lower_[a]));
+        cell_upper[a] = get_cell_coord((std::min)(upper[a], upper_[a]));
+        if (cell_lower[a] > cell_upper[a])
+            return 0;
+    }
+
+    if (is_cell_range_large(cell_lower, cell_upper))
+    {
+        for (int k = 0, k_end = get_particles_count(); k < k_end; ++k)
+            test(k);
+    }
+    else
+    {
+        for (int z = cell_lower[2]; z <= cell_upper[2]; ++z)
+            for (int y = cell_lower[1]; y <= cell_upper[1]; ++y)
+                for (int x = cell_lower[0]; x <= cell_upper[0]; ++x)
+                    for_each_in_cell(x, y, z, test);
+    }
+
+    return static_cast<int>(indices.size());
+}
+
+inline int ParticleQuery::query_ray(const LVecBase3f& origin, const LVecBase3f& direction, float max_distance,
+    float particle_radius, const Filter& filter, float* distance) const
+{
+    if (indices_.empty())
+        return -1;
+
+    // clip the ray by the bounds of particle spheres
+    float t_begin = 0.0f;
+    float t_end = max_distance;
+    for (int a = 0; a < 3; ++a)
+    {
+        const float lower = lower_[a] - particle_radius;
+        const float upper = upper_[a] + particle_radius;
+        if (std::abs(direction[a]) < 1e-12f)
+        {
+            if (origin[a] < lower || origin[a] > upper)
+                return -1;
+            continue;
+        }
+
+        const float inv_dir = 1.0f / direction[a];
+        float t0 = (lower - origin[a]) * inv_dir;
+        float t1 = (upper - origin[a]) * inv_dir;
+        if (t0 > t1)
+            std::swap(t0, t1);
+        t_begin = (std::max)(t_begin, t0);
+        t_end = (std::min)(t_end, t1);
+        if (t_begin > t_end)
+            return -1;
+    }
+
+    // particles intersecting the ray in a cell are in the neighborhood of the cell
+    const int neighborhood = (std::max)(1, int(std::ceil(particle_radius * inv_cell_size_)));
+    const float radius_sq = particle_radius * particle_radius;
+
+    int best_index = -1;
+    float best_t = t_end;
+    const auto test = [&](int k) {
+        if (!filter.test(phases_[k]))
+            return;
+
+        const LVecBase4f& pos = positions_[k];
+        const LVecBase3f oc(pos[0] - origin[0], pos[1] - origin[1], pos[2] - origin[2]);
+        const float tc = oc.dot(direction);
+        const float dist_sq = oc.dot(oc) - tc * tc;
+        if (dist_sq > radius_sq)
+            return;
+
+        const float half_chord = std::sqrt(radius_sq - dist_sq);
+        if (tc + half_chord < 0.0f)
+            return;
+
+        const float t = (std::max)(0.0f, tc - half_chord);
+        if (t < best_t || (t == best_t && best_index == -1))
+        {
+            best_t = t;
+            best_index = indices_[k];
+        }
+    };
+
+    // 3D-DDA over cells from the clipped entry
+    int cell[3];
+    int step[3];
+    float t_next[3];
+    float t_delta[3];
+    for (int a = 0; a < 3; ++a)
+    {
+        cell[a] = get_cell_coord(origin[a] + direction[a] * t_begin);
+        if (direction[a] > 0.0f)
+        {
+            step[a] = 1;
+            t_delta[a] = cell_size_ / direction[a];
+            t_next[a] = ((cell[a] + 1) * cell_size_ - origin[a]) / direction[a];
+        }
+        else if (direction[a] < 0.0f)
+        {
+            step[a] = -1;
+            t_delta[a] = -cell_size_ / direction[a];
+            t_next[a] = (cell[a] * cell_size_ - origin[a]) / direction[a];
+        }
+        else
+        {
+            step[a] = 0;
+            t_delta[a] = FLT_MAX;
+            t_next[a] = FLT_MAX;
+        }
+    }
+
+    float t_cell = t_begin;
+    while (t_cell <= t_end)
+    {
+        // the hit point of remaining particles is after the entry of the cell containing it.
+        if (best_index != -1 && t_cell > best_t)
+            break;
+
+        for (int z = cell[2] - neighborhood; z <= cell[2] + neighborhood; ++z)
+            for (int y = cell[1] - neighborhood; y <= cell[1] + neighborhood; ++y)
+                for (int x = cell[0] - neighborhood; x <= cell[0] + neighborhood; ++x)
+                    for_each_in_cell(x, y, z, test);
+
+        const int a = (t_next[0] < t_next[1]) ?
+            (t_next[0] < t_next[2] ? 0 : 2) :
+            (t_next[1] < t_next[2] ? 1 : 2);
+        t_cell = t_next[a];
+        t_next[a] += t_delta[a];
+        cell[a] += step[a];
+    }
+
+    if (best_index != -1 && distance)
+        *distance = best_t;
+
+    return best_index;
+}
+
+inline int ParticleQuery::get_cell_coord(float x) const
+{
+    return int(std::floor(x * inv_cell_size_));
+}
+
+inline int ParticleQuery::hash_cell(int ix, int iy, int iz) const
+{
+    return static_cast<int>((unsigned(ix) * 73856093u) ^ (unsigned(iy) * 19349663u) ^ (unsigned(iz) * 83492791u)) & mask_;
+}
+
+template <class Func>
+void ParticleQuery::for_each_in_cell(int ix, int iy, int iz, const Func& func) const
+{
+    const int hash = hash_cell(ix, iy, iz);
+
+    // different cells may share the same hash
+    for (int k = cell_starts_[hash], k_end = cell_starts_[hash + 1]; k < k_end; ++k)
+    {
+        const LVecBase4f& pos = positions_[k];
+        if (get_cell_coord(pos[0]) == ix && get_cell_coord(pos[1]) == iy && get_cell_coord(pos[2]) == iz)
+            func(k);
+    }
+}
+
+inline bool ParticleQuery::is_cell_range_large(const int (&lower)[3], const int (&upper)[3]) const
+{
+    double cells_count = 1.0;
+    for (int a = 0; a < 3; ++a)
+        cells_count *= double(upper[a] - lower[a] + 1);
+    return cells_count > double(indices_.size());
+}
+
+}
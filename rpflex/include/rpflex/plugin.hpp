@@ -29,15 +29,24 @@
 struct NvFlexLibrary;
 struct NvFlexSolver;
 struct NvFlexParams;
+class Filename;
 
 namespace rpflex {
 
 class InstanceInterface;
+class ParticleQuery;
+class Profiler;
+class RigidActivityTracker;
+class RigidBindingTable;
+class TriangleMeshRegistry;
 struct FlexBuffer;
 
 class Plugin : public rpcore::BasePlugin
 {
 public:
+    /** Name of the solver context which exists always. */
+    static const char* const DEFAULT_SOLVER_CONTEXT;
+
     struct Parameters
     {
         int substeps_count;
@@ -67,23 +76,198 @@ public:
     void on_post_render_update() final;
     void on_unload() final;
 
+    /**
+     * Add a solver context which has its own solver, buffers, parameters and instances.
+     *
+     * Unrelated effects can be placed in different contexts, so they do not share
+     * the neighbor grid, the parameters and the step size.
+     * Contexts are stepped in the order of addition within a frame.
+     *
+     * If the pipeline is created, the solver of the context is created in the next frame
+     * with the instances added to it until then.
+     *
+     * @param   update_interval     The context is stepped once every this number of frames
+     *                              with the time elapsed since its last step.
+     * @param   update_offset       Frame offset of the steps. Contexts with the same interval
+     *                              and different offsets are stepped in different frames.
+     * @return  false if the context of @p name exists.
+     */
+    virtual bool add_solver_context(const std::string& name, int update_interval=1, int update_offset=0);
+
+    /**
+     * Remove a solver context and its instances at the beginning of the next frame.
+     *
+     * The default context cannot be removed.
+     * If the context is selected, the default context is selected after removal.
+     */
+    virtual bool remove_solver_context(const std::string& name);
+
+    virtual bool has_solver_context(const std::string& name) const;
+    virtual std::vector<std::string> get_solver_context_names() const;
+
+    /** Change the schedule of a context. See add_solver_context. */
+    virtual bool set_solver_context_schedule(const std::string& name, int update_interval, int update_offset=0);
+
+    /**
+     * Select the context used by the other methods of Plugin (ex, add_instance, get_flex_buffer).
+     *
+     * While a context initializes or synchronizes instances, the context is selected temporarily,
+     * so instances use the context which they are added to.
+     *
+     * @return  false if the context does not exist.
+     */
+    virtual bool select_solver_context(const std::string& name);
+
+    /** Get the name of the selected context. */
+    virtual const std::string& get_solver_context() const;
+
     virtual void add_instance(const std::shared_ptr<InstanceInterface>& instance);
 
+    /**
+     * Add an instance to the running scene without recreating solver.
+     *
+     * The instance is initialized after InstanceInterface::sync_flex of the next frame,
+     * and its particles, rigids, springs and shapes are appended to the existing buffers.
+     * Its particles use free particles reserved by Parameters::num_extra_particles.
+     * Collision planes of scene are not changed.
+     *
+     * While initializing, particle buffers (positions, velocities and phases) are staging buffers
+     * having only the particles of the instance. If the particles are not free (ex, spawned),
+     * the instance is not added and the existing particles are not changed.
+     *
+     * If solver is not created yet, this is the same as add_instance.
+     */
+    virtual void add_instance_live(const std::shared_ptr<InstanceInterface>& instance);
+
+    /**
+     * Remove an instance from the running scene without recreating solver.
+     *
+     * Its particles are deactivated. Its rigids, springs and shapes are removed if they are
+     * at the end of buffers, otherwise they are disabled to keep indices of other instances.
+     */
+    virtual void remove_instance(const std::shared_ptr<InstanceInterface>& instance);
+
+    /**
+     * Spawn particles using free particles and activate them.
+     *
+     * Free particles are reserved by Parameters::num_extra_particles when resetting.
+     * This should be called while buffers are mapped (ex, in InstanceInterface::sync_flex).
+     *
+     * If readback is pipelined, only the spawned particles are written over the latest state of solver,
+     * which waits for solver in the frame.
+     *
+     * @param   velocities  Initial velocities. If nullptr, zero velocities are used.
+     * @param   indices     If not nullptr, indices of spawned particles are appended.
+     * @return  The number of spawned particles. It is less than @p count if free particles are not enough.
+     */
+    virtual int spawn_particles(int count, const LVecBase4f* positions, const LVecBase3f* velocities, int phase,
+        std::vector<int>* indices=nullptr);
+
+    /**
+     * Deactivate particles and return them to free particles.
+     * This should be called while buffers are mapped (ex, in InstanceInterface::sync_flex).
+     *
+     * @return  The number of killed particles. Inactive indices are ignored.
+     */
+    virtual int kill_particles(const int* indices, int count);
+
+    virtual int get_free_particles_count() const;
+
+    /**
+     * Save FlexBuffer, NvFlexParams and Parameters to a snapshot file.
+     * This should be called while buffers are mapped (ex, in InstanceInterface::sync_flex).
+     *
+     * @param   compress    Compress the data by LZ4 if the plugin is built with LZ4.
+     */
+    virtual bool save_snapshot(const Filename& path, bool compress=true) const;
+
+    /**
+     * Restore the snapshot saved by save_snapshot.
+     *
+     * Collision meshes are not saved, so the snapshot should be restored to the scene
+     * created by the same instances, and mesh shapes use the meshes of current shapes.
+     * The solver is re-created if the number of particles is changed.
+     * This should be called while buffers are mapped, outside of sync_flex or in sync_flex
+     * of a serial instance (InstanceInterface::BufferAccess::parallel is false),
+     * because all buffers are changed.
+     */
+    virtual bool load_snapshot(const Filename& path);
+
+    /** Get Flex library, or nullptr with CPU solver which does not initialize Flex. */
     virtual NvFlexLibrary* get_flex_library() const;
+    /** Get Flex solver. It is nullptr if the solver is not created or CPU solver is used. */
     virtual NvFlexSolver* get_flex_solver() const;
 
     /** Read NvFlexParams. */
     virtual const NvFlexParams& get_flex_params() const;
 
-    /** Modify NvFlexParams. */
+    /**
+     * Modify NvFlexParams. The params are sent to solver in the next update.
+     * Do not modify them in parallel InstanceInterface::sync_flex.
+     */
     virtual NvFlexParams& get_flex_params();
 
+    /**
+     * Notify that positions or velocities of particles are changed.
+     *
+     * If readback is pipelined (readback_latency > 0), the particles in FlexBuffer are
+     * older than those in solver. So, they are sent to solver only after this call.
+     */
+    virtual void set_particles_changed();
+
+    /**
+     * Read back smoothed positions and anisotropy of particles with the other particle data.
+     *
+     * They are used to render fluid (ex, ellipsoids) and are not read back by default.
+     */
+    virtual void set_fluid_readback(bool enable);
+    virtual bool get_fluid_readback() const;
+
+    /**
+     * Build the spatial index of active particles after readback in every frame.
+     *
+     * @param   cell_size   Cell size of the index. If 0, the diameter of particles is used.
+     */
+    virtual void set_particle_query_enabled(bool enable, float cell_size=0.0f);
+    virtual bool is_particle_query_enabled() const;
+
+    /**
+     * Get the spatial index of active particles in current frame.
+     *
+     * It is rebuilt before InstanceInterface::sync_flex in every frame.
+     */
+    virtual const ParticleQuery& get_particle_query() const;
+
+    /** Get the time (in seconds) which CPU waited for readback in the last frame. */
+    virtual double get_readback_wait_time() const;
+
     virtual const Parameters& get_plugin_params() const;
     virtual Parameters& get_plugin_params();
 
     virtual const FlexBuffer& get_flex_buffer() const;
     virtual FlexBuffer& get_flex_buffer();
 
+    /** Get the registry of triangle meshes shared by collision shapes. */
+    virtual TriangleMeshRegistry& get_triangle_mesh_registry();
+
+    /** Get the table of NodePaths updated by rigid transforms in every frame. */
+    virtual RigidBindingTable& get_rigid_binding_table();
+
+    /**
+     * Get the sleeping states of rigids.
+     *
+     * Use RigidActivityTracker::wake after moving rigids without changing particles.
+     */
+    virtual RigidActivityTracker& get_rigid_activity_tracker();
+
+    /**
+     * Get the rolling statistics of simulation phases.
+     *
+     * It is updated only when profiling is enabled (see "enable_profiling" setting).
+     */
+    virtual const Profiler& get_profiler() const;
+    virtual Profiler& get_profiler();
+
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
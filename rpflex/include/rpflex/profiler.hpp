@@ -0,0 +1,233 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <NvFlex.h>
+
+namespace rpflex {
+
+/**
+ * Rolling statistics of the phases in a simulation frame.
+ *
+ * Plugin records wall-clock times (in milliseconds) of each phase in every frame
+ * while profiling is enabled, and keeps the last N samples of each phase.
+ * With Flex backend, the GPU times of solver kernels (NvFlexTimers) are also
+ * collected, but it makes CPU wait for the solver. So, do not enable it in release runs.
+ */
+class Profiler
+{
+public:
+    enum Phase: int
+    {
+        PHASE_MAP = 0,          ///< Wait for readback and map buffers.
+        PHASE_SYNC,             ///< InstanceInterface::sync_flex of all instances.
+        PHASE_SEND,             ///< Send changed buffers to solver.
+        PHASE_UPDATE,           ///< Update solver.
+        PHASE_READBACK,         ///< Request readback from solver.
+
+        PHASE_COUNT
+    };
+
+    struct Statistics
+    {
+        double last = 0;
+        double average = 0;
+        double minimum = 0;
+        double maximum = 0;
+        size_t samples_count = 0;
+    };
+
+    static const char* get_phase_name(int phase);
+
+    Profiler(size_t history_size=120);
+
+    bool is_enabled() const;
+    void set_enabled(bool enable);
+
+    /** Set the number of samples used in statistics. It clears the history. */
+    void set_history_size(size_t size);
+    size_t get_history_size() const;
+
+    void clear();
+
+    /** Add a time (in milliseconds) of @p phase in current frame. */
+    void record(int phase, double milliseconds);
+
+    /** Push times of current frame to the history. Statistics include only finished frames. */
+    void end_frame();
+
+    Statistics get_statistics(int phase) const;
+
+    /** Copy samples of @p phase from the oldest to the latest (ex, to plot). */
+    void copy_history(int phase, std::vector<float>& history) const;
+
+    /**
+     * Set GPU times (in milliseconds) of the solver in the last update.
+     *
+     * @p valid is false if the backend does not provide the timers.
+     */
+    void set_solver_timers(const NvFlexTimers& timers, bool valid);
+    bool has_solver_timers() const;
+    const NvFlexTimers& get_solver_timers() const;
+
+private:
+    bool enabled_ = false;
+
+    std::array<double, PHASE_COUNT> current_ = {};
+
+    size_t history_size_;
+    size_t history_head_ = 0;          ///< next slot to be written
+    size_t samples_count_ = 0;
+    std::array<std::vector<double>, PHASE_COUNT> histories_;
+
+    NvFlexTimers solver_timers_ = {};
+    bool solver_timers_valid_ = false;
+};
+
+// ************************************************************************************************
+
+inline const char* Profiler::get_phase_name(int phase)
+{
+    static const char* names[] = { "Map", "Sync", "Send", "Update", "Readback" };
+    return (0 <= phase && phase < PHASE_COUNT) ? names[phase] : "";
+}
+
+inline Profiler::Profiler(size_t history_size)
+{
+    set_history_size(history_size);
+}
+
+inline bool Profiler::is_enabled() const
+{
+    return enabled_;
+}
+
+inline void Profiler::set_enabled(bool enable)
+{
+    if (enabled_ == enable)
+        return;
+
+    enabled_ = enable;
+    clear();
+}
+
+inline void Profiler::set_history_size(size_t size)
+{
+    history_size_ = (std::max)(size_t(1), size);
+    for (auto&& history: histories_)
+        history.assign(history_size_, 0.0);
+    clear();
+}
+
+inline size_t Profiler::get_history_size() const
+{
+    return history_size_;
+}
+
+inline void Profiler::clear()
+{
+    current_.fill(0.0);
+    history_head_ = 0;
+    samples_count_ = 0;
+    solver_timers_ = {};
+    solver_timers_valid_ = false;
+}
+
+inline void Profiler::record(int phase, double milliseconds)
+{
+    if (0 <= phase && phase < PHASE_COUNT)
+        current_[phase] += milliseconds;
+}
+
+inline void Profiler::end_frame()
+{
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+        histories_[phase][history_head_] = current_[phase];
+    current_.fill(0.0);
+
+    history_head_ = (history_head_ + 1) % history_size_;
+    samples_count_ = (std::min)(samples_count_ + 1, history_size_);
+}
+
+inline Profiler::Statistics Profiler::get_statistics(int phase) const
+{
+    Statistics stats;
+    if (phase < 0 || phase >= PHASE_COUNT || samples_count_ == 0)
+        return stats;
+
+    const auto& history = histories_[phase];
+    const size_t oldest = (history_head_ + history_size_ - samples_count_) % history_size_;
+    stats.last = history[(history_head_ + history_size_ - 1) % history_size_];
+    stats.minimum = stats.last;
+    stats.maximum = stats.last;
+    stats.samples_count = samples_count_;
+
+    double sum = 0;
+    for (size_t k = 0; k < samples_count_; ++k)
+    {
+        const double value = history[(oldest + k) % history_size_];
+        sum += value;
+        stats.minimum = (std::min)(stats.minimum, value);
+        stats.maximum = (std::max)(stats.maximum, value);
+    }
+    stats.average = sum / samples_count_;
+
+    return stats;
+}
+
+inline void Profiler::copy_history(int phase, std::vector<float>& history) const
+{
+    history.clear();
+    if (phase < 0 || phase >= PHASE_COUNT)
+        return;
+
+    const auto& src = histories_[phase];
+    const size_t oldest = (history_head_ + history_size_ - samples_count_) % history_size_;
+    history.reserve(samples_count_);
+    for (size_t k = 0; k < samples_count_; ++k)
+        history.push_back(float(src[(oldest + k) % history_size_]));
+}
+
+inline void Profiler::set_solver_timers(const NvFlexTimers& timers, bool valid)
+{
+    solver_timers_ = timers;
+    solver_timers_valid_ = valid;
+}
+
+inline bool Profiler::has_solver_timers() const
+{
+    return solver_timers_valid_;
+}
+
+inline const NvFlexTimers& Profiler::get_solver_timers() const
+{
+    return solver_timers_;
+}
+
+}
@@ -0,0 +1,264 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#include <luse.h>
+
+#include "rpflex/flex_buffer.hpp"
+#include "rpflex/utils/parallel_for.hpp"
+
+namespace rpflex {
+
+/**
+ * CPU-side sleeping state of Flex rigid bodies.
+ *
+ * In every frame, the maximum speed of the particles of each rigid is computed from
+ * the read back velocities. A rigid slower than the threshold for a number of frames
+ * becomes sleeping, and sleeping rigids are skipped by RigidBindingTable::sync.
+ *
+ * A sleeping rigid wakes up when the bounds of a moving rigid overlap it (contact)
+ * or when wake functions are called (ex, user changed particles).
+ * Plugin owns one tracker which is configured by "sleep_threshold" and "sleep_frames" settings.
+ */
+class RigidActivityTracker
+{
+public:
+    /** Set the speed below which rigids are quiet. 0 disables sleeping. */
+    void set_threshold(float speed);
+    float get_threshold() const;
+
+    /** Set the number of quiet frames until rigids sleep. */
+    void set_quiet_frames(int frames);
+    int get_quiet_frames() const;
+
+    bool is_enabled() const;
+
+    /**
+     * Update states from velocities and positions of rigid particles.
+     *
+     * Buffers should be mapped.
+     * @param   margin  Distance added to bounds of rigids to detect contacts (ex, particle radius).
+     */
+    void update(const FlexBuffer& buffer, float margin);
+
+    bool is_sleeping(int rigid_index) const;
+    int get_sleeping_count() const;
+
+    void wake(int rigid_index);
+    void wake_rigids(int begin, int end);
+    void wake_all();
+
+    void clear();
+
+private:
+    static constexpr int GRAIN_SIZE = 256;
+
+    void wake_touching(int rigids_count);
+
+    float threshold_ = 0.0f;
+    int quiet_frames_limit_ = 30;
+
+    // flat arrays indexed by rigid
+    std::vector<int> quiet_frames_;
+    std::vector<unsigned char> sleeping_;
+    std::vector<LVecBase3f> lower_;
+    std::vector<LVecBase3f> upper_;
+    std::vector<int> sorted_rigids_;
+    int sleeping_count_ = 0;
+};
+
+// ************************************************************************************************
+inline void RigidActivityTracker::set_threshold(float speed)
+{
+    threshold_ = (std::max)(0.0f, speed);
+    if (!is_enabled())
+        wake_all();
+}
+
+inline float RigidActivityTracker::get_threshold() const
+{
+    return threshold_;
+}
+
+inline void RigidActivityTracker::set_quiet_frames(int frames)
+{
+    quiet_frames_limit_ = (std::max)(1, frames);
+}
+
+inline int RigidActivityTracker::get_quiet_frames() const
+{
+    return quiet_frames_limit_;
+}
+
+inline bool RigidActivityTracker::is_enabled() const
+{
+    return threshold_ > 0.0f;
+}
+
+inline void RigidActivityTracker::update(const FlexBuffer& buffer, float margin)
+{
+    if (!is_enabled())
+        return;
+
+    const int rigids_count = (std::max)(0, buffer.rigid_offsets.size() - 1);
+
+    // new rigids are awake
+    quiet_frames_.resize(rigids_count, 0);
+    sleeping_.resize(rigids_count, 0);
+    lower_.resize(rigids_count);
+    upper_.resize(rigids_count);
+
+    const int* offsets = buffer.rigid_offsets.mappedPtr;
+    const int* indices = buffer.rigid_indices.mappedPtr;
+    const LVecBase4f* positions = buffer.positions.mappedPtr;
+    const LVecBase3f* velocities = buffer.velocities.mappedPtr;
+    const int particles_count = (std::min)(buffer.positions.size(), buffer.velocities.size());
+    const float threshold_sq = threshold_ * threshold_;
+
+    parallel_for(0, rigids_count, GRAIN_SIZE, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r)
+        {
+            float max_speed_sq = 0.0f;
+            LVecBase3f lower(FLT_MAX);
+            LVecBase3f upper(-FLT_MAX);
+            for (int k = offsets[r], k_end = offsets[r + 1]; k < k_end; ++k)
+            {
+                const int i = indices[k];
+                if (i >= particles_count)
+                    continue;
+
+                max_speed_sq = (std::max)(max_speed_sq, velocities[i].length_squared());
+                for (int a = 0; a < 3; ++a)
+                {
+                    lower[a] = (std::min)(lower[a], positions[i][a]);
+                    upper[a] = (std::max)(upper[a], positions[i][a]);
+                }
+            }
+
+            lower_[r] = lower - LVecBase3f(margin);
+            upper_[r] = upper + LVecBase3f(margin);
+            quiet_frames_[r] = max_speed_sq < threshold_sq ? quiet_frames_[r] + 1 : 0;
+        }
+    });
+
+    wake_touching(rigids_count);
+
+    sleeping_count_ = 0;
+    for (int r = 0; r < rigids_count; ++r)
+    {
+        sleeping_[r] = quiet_frames_[r] >= quiet_frames_limit_;
+        sleeping_count_ += sleeping_[r];
+    }
+}
+
+inline bool RigidActivityTracker::is_sleeping(int rigid_index) const
+{
+    return rigid_index < static_cast<int>(sleeping_.size()) && sleeping_[rigid_index];
+}
+
+inline int RigidActivityTracker::get_sleeping_count() const
+{
+    return sleeping_count_;
+}
+
+inline void RigidActivityTracker::wake(int rigid_index)
+{
+    wake_rigids(rigid_index, rigid_index + 1);
+}
+
+inline void RigidActivityTracker::wake_rigids(int begin, int end)
+{
+    begin = (std::max)(0, begin);
+    end = (std::min)(end, static_cast<int>(sleeping_.size()));
+    for (int r = begin; r < end; ++r)
+    {
+        sleeping_count_ -= sleeping_[r];
+        quiet_frames_[r] = 0;
+        sleeping_[r] = 0;
+    }
+}
+
+inline void RigidActivityTracker::wake_all()
+{
+    std::fill(quiet_frames_.begin(), quiet_frames_.end(), 0);
+    std::fill(sleeping_.begin(), sleeping_.end(), 0);
+    sleeping_count_ = 0;
+}
+
+inline void RigidActivityTracker::clear()
+{
+    quiet_frames_.clear();
+    sleeping_.clear();
+    lower_.clear();
+    upper_.clear();
+    sorted_rigids_.clear();
+    sleeping_count_ = 0;
+}
+
+inline void RigidActivityTracker::wake_touching(int rigids_count)
+{
+    // sweep and prune along x axis
+    sorted_rigids_.resize(rigids_count);
+    for (int r = 0; r < rigids_count; ++r)
+        sorted_rigids_[r] = r;
+    std::sort(sorted_rigids_.begin(), sorted_rigids_.end(), [this](int a, int b) {
+        return lower_[a][0] < lower_[b][0];
+    });
+
+    // moving rigids (not quiet in this frame) wake sleeping rigids touching them
+    std::vector<int> woken;
+    for (int s = 0; s < rigids_count; ++s)
+    {
+        const int a = sorted_rigids_[s];
+        for (int t = s + 1; t < rigids_count; ++t)
+        {
+            const int b = sorted_rigids_[t];
+            if (lower_[b][0] > upper_[a][0])
+                break;
+
+            const bool a_moving = quiet_frames_[a] == 0;
+            const bool b_moving = quiet_frames_[b] == 0;
+            if (a_moving == b_moving)
+                continue;
+
+            if (lower_[a][1] > upper_[b][1] || lower_[b][1] > upper_[a][1] ||
+                lower_[a][2] > upper_[b][2] || lower_[b][2] > upper_[a][2])
+                continue;
+
+            const int quiet = a_moving ? b : a;
+            if (sleeping_[quiet])
+                woken.push_back(quiet);
+        }
+    }
+
+    for (const int r: woken)
+        quiet_frames_[r] = 0;
+}
+
+}
@@ -0,0 +1,358 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <nodePath.h>
+
+#include <render_pipeline/rpcore/globals.hpp>
+
+#include "rpflex/flex_buffer.hpp"
+#include "rpflex/rigid_activity_tracker.hpp"
+#include "rpflex/utils/parallel_for.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RPFLEX_RIGID_BINDING_USE_SSE
+#endif
+
+namespace rpflex {
+
+/**
+ * Table mapping Flex rigid bodies to NodePaths.
+ *
+ * Rigid transforms of all bindings are converted to Panda3D matrices in one pass
+ * over flat arrays, and only NodePaths of rigids moved more than the epsilon are
+ * written to the scene graph. So, the cost of scene graph updates scales with
+ * the number of moving rigids.
+ *
+ * Plugin owns one table, synchronizes it after InstanceInterface::sync_flex
+ * and clears it when the solver is reset.
+ */
+class RigidBindingTable
+{
+public:
+    /**
+     * Calculate the center of rigid particles in the current positions.
+     *
+     * Flex uses this center as the origin of rigid local positions.
+     * Buffers should be mapped.
+     */
+    static LVecBase3f calc_rigid_center(const FlexBuffer& buffer, int rigid_index);
+
+    /**
+     * Calculate @p local_mat * (rigid transform) into @p world_mat.
+     *
+     * @param   rotation    Rigid rotation in Flex order (x, y, z, w).
+     */
+    static void calc_world_mat(const LMatrix4f& local_mat, const LQuaternionf& rotation,
+        const LVecBase3f& translation, LMatrix4f& world_mat);
+
+    /**
+     * Add a binding with the transform from the rigid space to the node space.
+     *
+     * The world matrix of the node becomes @p local_mat * (rigid transform).
+     */
+    void add_binding(int rigid_index, NodePath np, const LMatrix4f& local_mat);
+
+    /**
+     * Add a binding using the current world transform of the node as rest pose.
+     *
+     * Call this while the rigid is at rest pose (ex, in InstanceInterface::post_initialize).
+     * Buffers should be mapped.
+     */
+    void add_binding(const FlexBuffer& buffer, int rigid_index, NodePath np);
+
+    /** Remove all bindings of the node. */
+    void remove_binding(const NodePath& np);
+
+    /** Remove bindings of rigids in [begin, end). */
+    void remove_rigids(int begin, int end);
+
+    void clear();
+
+    size_t get_bindings_count() const;
+
+    /**
+     * Set thresholds to skip scene graph updates of rigids.
+     *
+     * @param   translation_epsilon     Squared distance from the last written translation.
+     * @param   rotation_epsilon        1 - |dot| of the last written and current quaternions.
+     */
+    void set_epsilon(float translation_epsilon, float rotation_epsilon);
+
+    float get_translation_epsilon() const;
+    float get_rotation_epsilon() const;
+
+    /** Force to update all NodePaths in next synchronization. */
+    void invalidate();
+
+    /**
+     * Update NodePaths from rigid transforms in @p buffer.
+     *
+     * Buffers should be mapped.
+     * @param   activity    If not nullptr, sleeping rigids are skipped.
+     * @return  The number of updated NodePaths.
+     */
+    int sync(const FlexBuffer& buffer, const RigidActivityTracker* activity=nullptr);
+
+private:
+    void remove_if_index(const std::vector<char>& removed);
+
+    // flat arrays indexed by binding
+    std::vector<int> rigid_indices_;
+    std::vector<NodePath> nodepaths_;
+    std::vector<LMatrix4f> local_mats_;
+    std::vector<LVecBase4f> last_rotations_;
+    std::vector<LVecBase3f> last_translations_;
+    std::vector<LMatrix4f> world_mats_;
+    std::vector<char> moved_;
+
+    float translation_epsilon_ = 1e-6f;
+    float rotation_epsilon_ = 1e-6f;
+};
+
+// ************************************************************************************************
+inline LVecBase3f RigidBindingTable::calc_rigid_center(const FlexBuffer& buffer, int rigid_index)
+{
+    const int begin = rigid_index > 0 ? buffer.rigid_offsets[rigid_index] : 0;
+    const int end = buffer.rigid_offsets[rigid_index + 1];
+    if (begin >= end)
+        return LVecBase3f::zero();
+
+    LVecBase3f center = LVecBase3f::zero();
+    for (int k = begin; k < end; ++k)
+        center += buffer.positions[buffer.rigid_indices[k]].get_xyz();
+    return center / float(end - begin);
+}
+
+inline void RigidBindingTable::calc_world_mat(const LMatrix4f& local_mat, const LQuaternionf& rotation,
+    const LVecBase3f& translation, LMatrix4f& world_mat)
+{
+    const LQuaternionf& q = rotation;
+    const LVecBase3f& t = translation;
+
+    const float xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+    const float xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+    const float wx = q[3] * q[0], wy = q[3] * q[1], wz = q[3] * q[2];
+
+#if defined(RPFLEX_RIGID_BINDING_USE_SSE)
+    // rows of the rigid matrix in the row vector convention of Panda3D
+    const __m128 r0 = _mm_setr_ps(1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy), 0);
+    const __m128 r1 = _mm_setr_ps(2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx), 0);
+    const __m128 r2 = _mm_setr_ps(2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy), 0);
+    const __m128 r3 = _mm_setr_ps(t[0], t[1], t[2], 1);
+
+    // each row of the product is a linear combination of the rigid rows
+    const float* local = local_mat.get_data();
+    float* world = &world_mat(0, 0);
+    for (int i = 0; i < 4; ++i)
+    {
+        const float* row = local + i * 4;
+        const __m128 a = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(row[0]), r0), _mm_mul_ps(_mm_set1_ps(row[1]), r1));
+        const __m128 b = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(row[2]), r2), _mm_mul_ps(_mm_set1_ps(row[3]), r3));
+        _mm_storeu_ps(world + i * 4, _mm_add_ps(a, b));
+    }
+#else
+    // row vector convention of Panda3D
+    const LMatrix4f rigid_mat(
+        1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy), 0,
+        2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx), 0,
+        2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy), 0,
+        t[0], t[1], t[2], 1);
+
+    world_mat.multiply(local_mat, rigid_mat);
+#endif
+}
+
+inline void RigidBindingTable::add_binding(int rigid_index, NodePath np, const LMatrix4f& local_mat)
+{
+    rigid_indices_.push_back(rigid_index);
+    nodepaths_.push_back(np);
+    local_mats_.push_back(local_mat);
+
+    // invalid quaternion forces the first update
+    last_rotations_.push_back(LVecBase4f::zero());
+    last_translations_.push_back(LVecBase3f::zero());
+    world_mats_.push_back(LMatrix4f::ident_mat());
+    moved_.push_back(0);
+}
+
+inline void RigidBindingTable::add_binding(const FlexBuffer& buffer, int rigid_index, NodePath np)
+{
+    add_binding(rigid_index, np,
+        np.get_mat(rpcore::Globals::render) * LMatrix4f::translate_mat(-calc_rigid_center(buffer, rigid_index)));
+}
+
+inline void RigidBindingTable::remove_binding(const NodePath& np)
+{
+    std::vector<char> removed(nodepaths_.size());
+    for (size_t k = 0, k_end = nodepaths_.size(); k < k_end; ++k)
+        removed[k] = nodepaths_[k] == np;
+    remove_if_index(removed);
+}
+
+inline void RigidBindingTable::remove_rigids(int begin, int end)
+{
+    std::vector<char> removed(rigid_indices_.size());
+    for (size_t k = 0, k_end = rigid_indices_.size(); k < k_end; ++k)
+        removed[k] = begin <= rigid_indices_[k] && rigid_indices_[k] < end;
+    remove_if_index(removed);
+}
+
+inline void RigidBindingTable::clear()
+{
+    rigid_indices_.clear();
+    nodepaths_.clear();
+    local_mats_.clear();
+    last_rotations_.clear();
+    last_translations_.clear();
+    world_mats_.clear();
+    moved_.clear();
+}
+
+inline size_t RigidBindingTable::get_bindings_count() const
+{
+    return rigid_indices_.size();
+}
+
+inline void RigidBindingTable::set_epsilon(float translation_epsilon, float rotation_epsilon)
+{
+    translation_epsilon_ = translation_epsilon;
+    rotation_epsilon_ = rotation_epsilon;
+}
+
+inline float RigidBindingTable::get_translation_epsilon() const
+{
+    return translation_epsilon_;
+}
+
+inline float RigidBindingTable::get_rotation_epsilon() const
+{
+    return rotation_epsilon_;
+}
+
+inline void RigidBindingTable::invalidate()
+{
+    std::fill(last_rotations_.begin(), last_rotations_.end(), LVecBase4f::zero());
+}
+
+inline int RigidBindingTable::sync(const FlexBuffer& buffer, const RigidActivityTracker* activity)
+{
+    const int bindings_count = static_cast<int>(rigid_indices_.size());
+    if (bindings_count == 0)
+        return 0;
+
+    const int rigids_count = (std::min)(buffer.rigid_rotations.size(), buffer.rigid_translations.size());
+    const LQuaternionf* rotations = buffer.rigid_rotations.mappedPtr;
+    const LVecBase3f* translations = buffer.rigid_translations.mappedPtr;
+    const float translation_epsilon = translation_epsilon_;
+    const float rotation_epsilon = rotation_epsilon_;
+
+    // convert transforms without touching the scene graph
+    parallel_for(0, bindings_count, 512, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k)
+        {
+            const int rigid_index = rigid_indices_[k];
+            if (rigid_index >= rigids_count || (activity && activity->is_sleeping(rigid_index)))
+            {
+                moved_[k] = 0;
+                continue;
+            }
+
+            // Flex order (x, y, z, w)
+            const LQuaternionf& q = rotations[rigid_index];
+            const LVecBase3f& t = translations[rigid_index];
+            const LVecBase4f& last_q = last_rotations_[k];
+
+            // q and -q are the same rotation
+            const float q_dot = q[0] * last_q[0] + q[1] * last_q[1] + q[2] * last_q[2] + q[3] * last_q[3];
+            if ((t - last_translations_[k]).length_squared() <= translation_epsilon &&
+                1.0f - std::abs(q_dot) <= rotation_epsilon)
+            {
+                moved_[k] = 0;
+                continue;
+            }
+
+            last_rotations_[k].set(q[0], q[1], q[2], q[3]);
+            last_translations_[k] = t;
+
+            calc_world_mat(local_mats_[k], q, t, world_mats_[k]);
+            moved_[k] = 1;
+        }
+    });
+
+    // scene graph is updated in the main thread
+    const NodePath& render = rpcore::Globals::render;
+    int moved_count = 0;
+    for (int k = 0; k < bindings_count; ++k)
+    {
+        if (!moved_[k])
+            continue;
+
+        NodePath& np = nodepaths_[k];
+        if (np.get_parent() == render)
+            np.set_mat(world_mats_[k]);
+        else
+            np.set_mat(render, world_mats_[k]);
+        ++moved_count;
+    }
+
+    return moved_count;
+}
+
+inline void RigidBindingTable::remove_if_index(const std::vector<char>& removed)
+{
+    size_t dst = 0;
+    for (size_t k = 0, k_end = removed.size(); k < k_end; ++k)
+    {
+        if (removed[k])
+            continue;
+
+        rigid_indices_[dst] = rigid_indices_[k];
+        nodepaths_[dst] = nodepaths_[k];
+        local_mats_[dst] = local_mats_[k];
+        last_rotations_[dst] = last_rotations_[k];
+        last_translations_[dst] = last_translations_[k];
+        world_mats_[dst] = world_mats_[k];
+        moved_[dst] = moved_[k];
+        ++dst;
+    }
+
+    rigid_indices_.resize(dst);
+    nodepaths_.resize(dst);
+    local_mats_.resize(dst);
+    last_rotations_.resize(dst);
+    last_translations_.resize(dst);
+    world_mats_.resize(dst);
+    moved_.resize(dst);
+}
+
+}
+
+#undef RPFLEX_RIGID_BINDING_USE_SSE
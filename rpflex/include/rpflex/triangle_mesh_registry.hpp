@@ -0,0 +1,257 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include <luse.h>
+
+#include <NvFlex.h>
+#include <NvFlexExt.h>
+
+namespace rpflex {
+
+/**
+ * Registry of Flex triangle meshes shared by the same vertex and index data.
+ *
+ * Meshes are keyed by hash of the data and reference counted.
+ * On hash match, a second independent hash of the data is compared instead of keeping a copy of the data,
+ * so meshes are shared only if both hashes are the same.
+ * Each collision shape in FlexBuffer holds one reference, and unused meshes are
+ * destroyed by Plugin after resetting or changing instances.
+ */
+class TriangleMeshRegistry
+{
+public:
+    TriangleMeshRegistry(NvFlexLibrary* lib);
+    ~TriangleMeshRegistry();
+
+    TriangleMeshRegistry(const TriangleMeshRegistry&) = delete;
+    TriangleMeshRegistry& operator=(const TriangleMeshRegistry&) = delete;
+
+    static uint64_t calc_hash(const LVecBase3f* positions, int vertices_count, const int* indices, int faces_count);
+
+    /** Hash of the data independent of calc_hash(), which is compared when calc_hash() matches. */
+    static uint64_t calc_check_hash(const LVecBase3f* positions, int vertices_count, const int* indices, int faces_count);
+
+    /**
+     * Find a mesh having the same data or create new one, and add a reference.
+     * @param   faces_count     The number of triangles (3 indices per triangle).
+     */
+    NvFlexTriangleMeshId acquire(const LPoint3f& lower, const LPoint3f& upper,
+        const LVecBase3f* positions, int vertices_count, const int* indices, int faces_count);
+
+    /** Add a reference to the mesh created by this registry. */
+    void add_reference(NvFlexTriangleMeshId mesh);
+
+    /**
+     * Remove a reference. The mesh is kept until collect_garbage() is called.
+     * Meshes not created by this registry are ignored.
+     */
+    void release(NvFlexTriangleMeshId mesh);
+
+    /** Destroy meshes having no reference. */
+    void collect_garbage();
+
+    /** Destroy all meshes. */
+    void clear();
+
+    bool has_mesh(NvFlexTriangleMeshId mesh) const;
+    int get_reference_count(NvFlexTriangleMeshId mesh) const;
+    size_t get_meshes_count() const;
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        uint64_t check_hash;
+        int reference_count;
+    };
+
+    NvFlexLibrary* lib_;
+    std::unordered_multimap<uint64_t, NvFlexTriangleMeshId> hash_to_mesh_;
+    std::unordered_map<NvFlexTriangleMeshId, Entry> meshes_;
+};
+
+// ************************************************************************************************
+inline TriangleMeshRegistry::TriangleMeshRegistry(NvFlexLibrary* lib): lib_(lib)
+{
+}
+
+inline TriangleMeshRegistry::~TriangleMeshRegistry()
+{
+    clear();
+}
+
+inline uint64_t TriangleMeshRegistry::calc_hash(const LVecBase3f* positions, int vertices_count, const int* indices, int faces_count)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    const auto hash_bytes = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t k = 0; k < size; ++k)
+        {
+            hash ^= bytes[k];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    hash_bytes(&vertices_count, sizeof(vertices_count));
+    hash_bytes(&faces_count, sizeof(faces_count));
+    hash_bytes(positions, sizeof(LVecBase3f) * vertices_count);
+    hash_bytes(indices, sizeof(int) * faces_count * 3);
+
+    return hash;
+}
+
+inline uint64_t TriangleMeshRegistry::calc_check_hash(const LVecBase3f* positions, int vertices_count, const int* indices, int faces_count)
+{
+    static_assert(sizeof(LVecBase3f) == sizeof(uint32_t) * 3, "LVecBase3f should be 3 packed floats.");
+
+    // word-wise multiply and xor-shift, which does not share steps with FNV-1a
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ ((uint64_t(uint32_t(vertices_count)) << 32) | uint32_t(faces_count));
+    const auto hash_words = [&hash](const void* data, size_t count) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t k = 0; k < count; ++k)
+        {
+            uint32_t word;
+            std::memcpy(&word, bytes + k * sizeof(word), sizeof(word));
+            hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+            hash ^= hash >> 29;
+        }
+    };
+
+    hash_words(positions, size_t(vertices_count) * 3);
+    hash_words(indices, size_t(faces_count) * 3);
+
+    return hash;
+}
+
+inline NvFlexTriangleMeshId TriangleMeshRegistry::acquire(const LPoint3f& lower, const LPoint3f& upper,
+    const LVecBase3f* positions, int vertices_count, const int* indices, int faces_count)
+{
+    const uint64_t hash = calc_hash(positions, vertices_count, indices, faces_count);
+    const uint64_t check_hash = calc_check_hash(positions, vertices_count, indices, faces_count);
+
+    auto range = hash_to_mesh_.equal_range(hash);
+    for (auto iter = range.first; iter != range.second; ++iter)
+    {
+        auto& entry = meshes_.at(iter->second);
+        if (entry.check_hash == check_hash)
+        {
+            ++entry.reference_count;
+            return iter->second;
+        }
+    }
+
+    // CPU solver does not collide with meshes
+    if (!lib_)
+        return 0;
+
+    NvFlexVector<LVecBase3f> flex_positions(lib_);
+    NvFlexVector<int> flex_indices(lib_);
+
+    flex_positions.assign(positions, vertices_count);
+    flex_indices.assign(indices, faces_count * 3);
+
+    flex_positions.unmap();
+    flex_indices.unmap();
+
+    NvFlexTriangleMeshId mesh = NvFlexCreateTriangleMesh(lib_);
+    NvFlexUpdateTriangleMesh(lib_, mesh, flex_positions.buffer, flex_indices.buffer,
+        vertices_count, faces_count, lower.get_data(), upper.get_data());
+
+    hash_to_mesh_.insert({ hash, mesh });
+    meshes_[mesh] = Entry{ hash, check_hash, 1 };
+
+    return mesh;
+}
+
+inline void TriangleMeshRegistry::add_reference(NvFlexTriangleMeshId mesh)
+{
+    auto found = meshes_.find(mesh);
+    if (found != meshes_.end())
+        ++found->second.reference_count;
+}
+
+inline void TriangleMeshRegistry::release(NvFlexTriangleMeshId mesh)
+{
+    auto found = meshes_.find(mesh);
+    if (found != meshes_.end() && found->second.reference_count > 0)
+        --found->second.reference_count;
+}
+
+inline void TriangleMeshRegistry::collect_garbage()
+{
+    for (auto iter = meshes_.begin(); iter != meshes_.end();)
+    {
+        if (iter->second.reference_count > 0)
+        {
+            ++iter;
+            continue;
+        }
+
+        auto range = hash_to_mesh_.equal_range(iter->second.hash);
+        for (auto hash_iter = range.first; hash_iter != range.second; ++hash_iter)
+        {
+            if (hash_iter->second == iter->first)
+            {
+                hash_to_mesh_.erase(hash_iter);
+                break;
+            }
+        }
+
+        NvFlexDestroyTriangleMesh(lib_, iter->first);
+        iter = meshes_.erase(iter);
+    }
+}
+
+inline void TriangleMeshRegistry::clear()
+{
+    for (const auto& mesh_entry: meshes_)
+        NvFlexDestroyTriangleMesh(lib_, mesh_entry.first);
+    meshes_.clear();
+    hash_to_mesh_.clear();
+}
+
+inline bool TriangleMeshRegistry::has_mesh(NvFlexTriangleMeshId mesh) const
+{
+    return meshes_.find(mesh) != meshes_.end();
+}
+
+inline int TriangleMeshRegistry::get_reference_count(NvFlexTriangleMeshId mesh) const
+{
+    auto found = meshes_.find(mesh);
+    return found == meshes_.end() ? 0 : found->second.reference_count;
+}
+
+inline size_t TriangleMeshRegistry::get_meshes_count() const
+{
+    return meshes_.size();
+}
+
+}
@@ -0,0 +1,365 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <nodePath.h>
+
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/globals.hpp>
+#include <render_pipeline/rpcore/rpobject.hpp>
+
+#include <rpflex/flex_buffer.hpp>
+#include <rpflex/instance_interface.hpp>
+#include <rpflex/plugin.hpp>
+#include <rpflex/utils/geom_extractor.hpp>
+#include <rpflex/utils/mesh_simplifier.hpp>
+#include <rpflex/utils/triangle_renderer.hpp>
+
+namespace rpflex {
+
+/** Options to create cloth from triangles. */
+struct ClothOptions
+{
+    float stretch_stiffness = 1.0f;     ///< Springs are not created if stiffness is 0.
+    float shear_stiffness = 0.8f;
+    float bend_stiffness = 0.5f;
+
+    /** Cosine of the angle between neighbors below which a bend spring is created. */
+    float bend_angle_cos = -0.8f;
+
+    /** Merge vertices closer than this distance. If 0, only the same positions are merged. */
+    float weld_distance = 0.0f;
+
+    float inv_mass = 1.0f;
+    int group = 0;
+    bool self_collide = true;
+
+    /**
+     * Create an inflatable constraint. The mesh should be closed, and its triangles
+     * should be counter-clockwise seen from outside (front faces of Panda3D).
+     */
+    bool inflatable = false;
+    float pressure = 1.0f;
+    float inflatable_stiffness = 1.0f;
+};
+
+/**
+ * Cloth (or inflatable) created from triangles of a Geom.
+ *
+ * Each welded vertex becomes a particle, and springs are generated from the topology:
+ *  - stretch springs on edges,
+ *  - shear springs between opposite vertices of two triangles sharing an edge,
+ *  - bend springs between two neighbors of a vertex in nearly opposite directions.
+ *
+ * Triangles are added as dynamic triangles, and they are rendered by RPFlexTriangleRenderer.
+ * Add this to the plugin as an instance (ex, Plugin::add_instance).
+ */
+class RPFlexCloth : public InstanceInterface
+{
+public:
+    /** Springs of cloth. Indices are 2 vertex indices per spring. */
+    struct Springs
+    {
+        std::vector<int> indices;
+        std::vector<float> lengths;
+        std::vector<float> stiffness;
+    };
+
+    /**
+     * @param   geom_nodepath   Triangles in the subtree are used in the render space.
+     * @param   parent          Parent of the render node. It should have the same space as render.
+     */
+    RPFlexCloth(NodePath geom_nodepath, NodePath parent, const ClothOptions& options=ClothOptions());
+
+    void initialize(Plugin& rpflex_plugin) override;
+    void sync_flex(Plugin& rpflex_plugin) override;
+    void post_sync_flex(Plugin& rpflex_plugin) override;
+
+    /** Particles are only read, so this runs in parallel with other instances. */
+    BufferAccess get_buffer_access(const Plugin& rpflex_plugin) const override;
+
+    NodePath get_nodepath() const;
+
+    const TriangleMeshData& get_mesh() const;
+    const Springs& get_springs() const;
+
+    int get_particle_begin() const;
+    int get_triangle_begin() const;
+
+    /** Generate springs from one hashed pass over edges of @p mesh. */
+    static void build_springs(const TriangleMeshData& mesh, const ClothOptions& options, Springs& springs);
+
+    /**
+     * Calculate the signed volume enclosed by the closed mesh.
+     *
+     * It is positive if triangles are counter-clockwise seen from outside, and negative
+     * if they are clockwise. The sign is kept because Flex calculates the volume of
+     * inflatables in the same way.
+     */
+    static float calc_volume(const TriangleMeshData& mesh);
+
+private:
+    static TriangleMeshData extract_cloth_mesh(NodePath geom_nodepath, const ClothOptions& options);
+    static uint64_t make_edge_key(int a, int b);
+
+    ClothOptions options_;
+    TriangleMeshData mesh_;
+    Springs springs_;
+
+    RPFlexTriangleRenderer renderer_;
+
+    int particle_begin_ = 0;
+    int triangle_begin_ = 0;
+};
+
+// ************************************************************************************************
+inline RPFlexCloth::RPFlexCloth(NodePath geom_nodepath, NodePath parent, const ClothOptions& options):
+    options_(options), mesh_(extract_cloth_mesh(geom_nodepath, options)),
+    renderer_(parent, mesh_.indices, mesh_.get_vertices_count())
+{
+    build_springs(mesh_, options_, springs_);
+}
+
+inline TriangleMeshData RPFlexCloth::extract_cloth_mesh(NodePath geom_nodepath, const ClothOptions& options)
+{
+    TriangleMeshData mesh;
+    extract_triangle_mesh(geom_nodepath, mesh, false);
+
+    // particles are in the render space
+    const LMatrix4f mat = geom_nodepath.get_mat(rpcore::Globals::render);
+    for (auto& position: mesh.positions)
+        position = mat.xform_point(position);
+
+    weld_vertices(mesh, options.weld_distance);
+    remove_degenerate_triangles(mesh);
+    mesh.update_bounds();
+
+    return mesh;
+}
+
+inline void RPFlexCloth::initialize(Plugin& rpflex_plugin)
+{
+    FlexBuffer& buffer = rpflex_plugin.get_flex_buffer();
+
+    particle_begin_ = buffer.positions.size();
+    triangle_begin_ = buffer.triangles.size() / 3;
+    renderer_.set_particle_begin(particle_begin_);
+
+    const int phase = NvFlexMakePhase(options_.group,
+        options_.self_collide ? (eNvFlexPhaseSelfCollide | eNvFlexPhaseSelfCollideFilter) : 0);
+    for (const auto& position: mesh_.positions)
+    {
+        buffer.positions.push_back(LVecBase4f(position, options_.inv_mass));
+        buffer.velocities.push_back(LVecBase3f(0.0f));
+        buffer.phases.push_back(phase);
+    }
+
+    for (size_t k = 0, k_end = springs_.lengths.size(); k < k_end; ++k)
+    {
+        buffer.spring_indices.push_back(particle_begin_ + springs_.indices[k * 2 + 0]);
+        buffer.spring_indices.push_back(particle_begin_ + springs_.indices[k * 2 + 1]);
+        buffer.spring_lengths.push_back(springs_.lengths[k]);
+        buffer.spring_stiffness.push_back(springs_.stiffness[k]);
+    }
+
+    for (const int index: mesh_.indices)
+        buffer.triangles.push_back(particle_begin_ + index);
+    for (int k = 0, k_end = mesh_.get_faces_count(); k < k_end; ++k)
+        buffer.triangle_normals.push_back(LVecBase3f(0.0f));
+
+    if (options_.inflatable)
+    {
+        buffer.inflatable_tri_offsets.push_back(triangle_begin_);
+        buffer.inflatable_tri_counts.push_back(mesh_.get_faces_count());
+        const float volume = calc_volume(mesh_);
+        if (volume <= 0.0f)
+        {
+            rpcore::RPObject::global_warn(RPPLUGINS_ID_STRING,
+                fmt::format("Volume of inflatable is not positive ({}). Triangles may be clockwise.", volume));
+        }
+
+        buffer.inflatable_volumes.push_back(volume);
+        buffer.inflatable_pressures.push_back(options_.pressure);
+        buffer.inflatable_coefficients.push_back(options_.inflatable_stiffness);
+    }
+}
+
+inline void RPFlexCloth::sync_flex(Plugin& rpflex_plugin)
+{
+    renderer_.sync_flex(rpflex_plugin);
+}
+
+inline void RPFlexCloth::post_sync_flex(Plugin& rpflex_plugin)
+{
+    renderer_.post_sync_flex(rpflex_plugin);
+}
+
+inline InstanceInterface::BufferAccess RPFlexCloth::get_buffer_access(const Plugin& rpflex_plugin) const
+{
+    return renderer_.get_buffer_access(rpflex_plugin);
+}
+
+inline NodePath RPFlexCloth::get_nodepath() const
+{
+    return renderer_.get_nodepath();
+}
+
+inline const TriangleMeshData& RPFlexCloth::get_mesh() const
+{
+    return mesh_;
+}
+
+inline const RPFlexCloth::Springs& RPFlexCloth::get_springs() const
+{
+    return springs_;
+}
+
+inline int RPFlexCloth::get_particle_begin() const
+{
+    return particle_begin_;
+}
+
+inline int RPFlexCloth::get_triangle_begin() const
+{
+    return triangle_begin_;
+}
+
+inline void RPFlexCloth::build_springs(const TriangleMeshData& mesh, const ClothOptions& options, Springs& springs)
+{
+    springs = Springs();
+
+    const int vertices_count = mesh.get_vertices_count();
+    const int faces_count = mesh.get_faces_count();
+
+    std::unordered_set<uint64_t> spring_keys;
+    const auto add_spring = [&](int a, int b, float stiffness) {
+        if (stiffness <= 0.0f || a == b || !spring_keys.insert(make_edge_key(a, b)).second)
+            return;
+        springs.indices.push_back(a);
+        springs.indices.push_back(b);
+        springs.lengths.push_back((mesh.positions[a] - mesh.positions[b]).length());
+        springs.stiffness.push_back(stiffness);
+    };
+
+    // edge -> the vertex opposite to the edge in the first triangle
+    std::unordered_map<uint64_t, int> edge_opposites;
+    edge_opposites.reserve(faces_count * 3);
+
+    std::vector<std::vector<int>> neighbors(vertices_count);
+    std::vector<std::pair<int, int>> shear_pairs;
+
+    // single pass over edges builds stretch springs, cross-edge pairs and vertex adjacency
+    for (int k = 0; k < faces_count; ++k)
+    {
+        const int* tri = &mesh.indices[k * 3];
+        for (int e = 0; e < 3; ++e)
+        {
+            const int a = tri[e];
+            const int b = tri[(e + 1) % 3];
+            const int opposite = tri[(e + 2) % 3];
+
+            auto result = edge_opposites.insert({ make_edge_key(a, b), opposite });
+            if (result.second)
+            {
+                neighbors[a].push_back(b);
+                neighbors[b].push_back(a);
+                add_spring(a, b, options.stretch_stiffness);
+            }
+            else
+            {
+                shear_pairs.push_back({ result.first->second, opposite });
+            }
+        }
+    }
+
+    for (const auto& pair: shear_pairs)
+    {
+        // skip if the pair is already an edge
+        if (edge_opposites.find(make_edge_key(pair.first, pair.second)) == edge_opposites.end())
+            add_spring(pair.first, pair.second, options.shear_stiffness);
+    }
+
+    // connect neighbors on the other sides of a vertex
+    if (options.bend_stiffness > 0.0f)
+    {
+        for (int v = 0; v < vertices_count; ++v)
+        {
+            const auto& adjacency = neighbors[v];
+            for (const int a: adjacency)
+            {
+                LVecBase3f da = mesh.positions[a] - mesh.positions[v];
+                da.normalize();
+
+                int best = -1;
+                float best_cos = options.bend_angle_cos;
+                for (const int b: adjacency)
+                {
+                    if (b == a)
+                        continue;
+                    LVecBase3f db = mesh.positions[b] - mesh.positions[v];
+                    db.normalize();
+                    const float cos_angle = da.dot(db);
+                    if (cos_angle < best_cos)
+                    {
+                        best_cos = cos_angle;
+                        best = b;
+                    }
+                }
+
+                if (best >= 0)
+                    add_spring(a, best, options.bend_stiffness);
+            }
+        }
+    }
+}
+
+inline float RPFlexCloth::calc_volume(const TriangleMeshData& mesh)
+{
+    float volume = 0.0f;
+    for (int k = 0, k_end = mesh.get_faces_count(); k < k_end; ++k)
+    {
+        const LVecBase3f& p0 = mesh.positions[mesh.indices[k * 3 + 0]];
+        const LVecBase3f& p1 = mesh.positions[mesh.indices[k * 3 + 1]];
+        const LVecBase3f& p2 = mesh.positions[mesh.indices[k * 3 + 2]];
+        volume += p0.dot(p1.cross(p2));
+    }
+    return volume / 6.0f;
+}
+
+inline uint64_t RPFlexCloth::make_edge_key(int a, int b)
+{
+    if (a > b)
+        std::swap(a, b);
+    return (uint64_t(uint32_t(a)) << 32) | uint64_t(uint32_t(b));
+}
+
+}
@@ -0,0 +1,301 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#include <rpflex/utils/convex_hull.hpp>
+#include <rpflex/utils/geom_extractor.hpp>
+#include <rpflex/utils/parallel_for.hpp>
+#include <rpflex/utils/sdf_builder.hpp>
+
+namespace rpflex {
+
+struct ConvexDecompositionOptions
+{
+    int resolution = 32;            ///< The number of voxels on the longest axis.
+    float max_concavity = 0.05f;    ///< Split a part if 1 - (part volume / hull volume) exceeds this.
+    int max_parts = 16;
+    int max_hull_vertices = 64;
+};
+
+/**
+ * Approximate convex decomposition of a closed mesh.
+ *
+ * The mesh is voxelized using signed distance field, and the most concave part is split
+ * by the axis-aligned plane minimizing the sum of hull volumes until parts are convex enough.
+ * Hulls of candidate splits and of final parts are built in parallel.
+ */
+bool decompose_convex(const TriangleMeshData& mesh, const ConvexDecompositionOptions& options, std::vector<ConvexHull>& hulls);
+
+// ************************************************************************************************
+namespace detail {
+
+struct VoxelPart
+{
+    std::vector<LVecBase3i> cells;
+    float hull_volume = 0.0f;
+    float concavity = 0.0f;
+    bool splittable = true;
+};
+
+/**
+ * Points of cells on the surface of the part.
+ * Corners cover the cells completely, and centers are closer to the surface of mesh.
+ */
+inline void collect_voxel_part_points(const std::vector<LVecBase3i>& cells, const LPoint3f& origin, float cell_size,
+    bool corners, std::vector<LVecBase3f>& points)
+{
+    points.clear();
+    if (cells.empty())
+        return;
+
+    LVecBase3i lower = cells[0];
+    LVecBase3i upper = cells[0];
+    for (const auto& cell: cells)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            lower[axis] = (std::min)(lower[axis], cell[axis]);
+            upper[axis] = (std::max)(upper[axis], cell[axis]);
+        }
+    }
+
+    // occupancy with one cell of margin
+    const int sx = upper[0] - lower[0] + 3;
+    const int sy = upper[1] - lower[1] + 3;
+    const int sz = upper[2] - lower[2] + 3;
+    std::vector<char> occupied(size_t(sx) * sy * sz, 0);
+    const auto index_of = [&](int x, int y, int z) {
+        return (size_t(z - lower[2] + 1) * sy + (y - lower[1] + 1)) * sx + (x - lower[0] + 1);
+    };
+    for (const auto& cell: cells)
+        occupied[index_of(cell[0], cell[1], cell[2])] = 1;
+
+    for (const auto& cell: cells)
+    {
+        const int x = cell[0];
+        const int y = cell[1];
+        const int z = cell[2];
+        if (occupied[index_of(x-1, y, z)] && occupied[index_of(x+1, y, z)] &&
+            occupied[index_of(x, y-1, z)] && occupied[index_of(x, y+1, z)] &&
+            occupied[index_of(x, y, z-1)] && occupied[index_of(x, y, z+1)])
+        {
+            continue;
+        }
+
+        if (!corners)
+        {
+            points.push_back(LVecBase3f(
+                origin[0] + (x + 0.5f) * cell_size,
+                origin[1] + (y + 0.5f) * cell_size,
+                origin[2] + (z + 0.5f) * cell_size));
+            continue;
+        }
+
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            points.push_back(LVecBase3f(
+                origin[0] + (x + (corner & 1)) * cell_size,
+                origin[1] + (y + ((corner >> 1) & 1)) * cell_size,
+                origin[2] + (z + ((corner >> 2) & 1)) * cell_size));
+        }
+    }
+}
+
+inline float calc_voxel_part_hull_volume(const std::vector<LVecBase3i>& cells, const LPoint3f& origin, float cell_size)
+{
+    std::vector<LVecBase3f> corners;
+    collect_voxel_part_points(cells, origin, cell_size, true, corners);
+
+    ConvexHull hull;
+    if (!build_convex_hull(corners.data(), int(corners.size()), hull, INT_MAX))
+        return 0.0f;
+
+    return hull.calc_volume();
+}
+
+}
+
+inline bool decompose_convex(const TriangleMeshData& mesh, const ConvexDecompositionOptions& options, std::vector<ConvexHull>& hulls)
+{
+    using detail::VoxelPart;
+
+    hulls.clear();
+
+    SignedDistanceField sdf;
+    if (!build_signed_distance_field(mesh, options.resolution + 2, sdf, 1))
+        return false;
+
+    const float cell_size = sdf.edge_length / sdf.dimension;
+    const float cell_volume = cell_size * cell_size * cell_size;
+
+    // cells inside of the mesh or on the surface
+    std::vector<VoxelPart> parts(1);
+    for (int z = 0; z < sdf.dimension; ++z)
+    {
+        for (int y = 0; y < sdf.dimension; ++y)
+        {
+            for (int x = 0; x < sdf.dimension; ++x)
+            {
+                if (sdf.distances[sdf.get_index(x, y, z)] <= 0.5f * cell_size)
+                    parts[0].cells.push_back(LVecBase3i(x, y, z));
+            }
+        }
+    }
+
+    if (parts[0].cells.empty())
+        return false;
+
+    const auto update_concavity = [&](VoxelPart& part) {
+        const float volume = part.cells.size() * cell_volume;
+        part.concavity = part.hull_volume > 0.0f ? (std::max)(0.0f, 1.0f - volume / part.hull_volume) : 0.0f;
+    };
+
+    parts[0].hull_volume = detail::calc_voxel_part_hull_volume(parts[0].cells, sdf.origin, cell_size);
+    update_concavity(parts[0]);
+
+    struct SplitCandidate
+    {
+        int axis;
+        int position;   ///< cells less than this go to the first part.
+        float cost;
+        float volumes[2];
+    };
+
+    while (int(parts.size()) < options.max_parts)
+    {
+        // the most concave part
+        auto target = std::max_element(parts.begin(), parts.end(), [](const VoxelPart& a, const VoxelPart& b) {
+            return (a.splittable ? a.concavity : -1.0f) < (b.splittable ? b.concavity : -1.0f);
+        });
+        if (!target->splittable || target->concavity <= options.max_concavity)
+            break;
+
+        LVecBase3i lower = target->cells[0];
+        LVecBase3i upper = target->cells[0];
+        for (const auto& cell: target->cells)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                lower[axis] = (std::min)(lower[axis], cell[axis]);
+                upper[axis] = (std::max)(upper[axis], cell[axis]);
+            }
+        }
+
+        std::vector<SplitCandidate> candidates;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const int extent = upper[axis] - lower[axis] + 1;
+            const int step = (std::max)(1, extent / 8);
+            for (int position = lower[axis] + step; position <= upper[axis]; position += step)
+                candidates.push_back(SplitCandidate{ axis, position, FLT_MAX, { 0.0f, 0.0f } });
+        }
+
+        if (candidates.empty())
+        {
+            target->splittable = false;
+            continue;
+        }
+
+        const std::vector<LVecBase3i>& cells = target->cells;
+        parallel_for(0, int(candidates.size()), 1, [&](int begin, int end) {
+            std::vector<LVecBase3i> sides[2];
+            for (int k = begin; k < end; ++k)
+            {
+                auto& candidate = candidates[k];
+                sides[0].clear();
+                sides[1].clear();
+                for (const auto& cell: cells)
+                    sides[cell[candidate.axis] < candidate.position ? 0 : 1].push_back(cell);
+
+                if (sides[0].empty() || sides[1].empty())
+                    continue;
+
+                candidate.volumes[0] = detail::calc_voxel_part_hull_volume(sides[0], sdf.origin, cell_size);
+                candidate.volumes[1] = detail::calc_voxel_part_hull_volume(sides[1], sdf.origin, cell_size);
+                candidate.cost = candidate.volumes[0] + candidate.volumes[1];
+            }
+        });
+
+        const auto best = std::min_element(candidates.begin(), candidates.end(), [](const SplitCandidate& a, const SplitCandidate& b) {
+            return a.cost < b.cost;
+        });
+        if (best->cost == FLT_MAX)
+        {
+            target->splittable = false;
+            continue;
+        }
+
+        VoxelPart first;
+        VoxelPart second;
+        for (const auto& cell: cells)
+            (cell[best->axis] < best->position ? first : second).cells.push_back(cell);
+        first.hull_volume = best->volumes[0];
+        second.hull_volume = best->volumes[1];
+        update_concavity(first);
+        update_concavity(second);
+
+        *target = std::move(first);
+        parts.push_back(std::move(second));
+    }
+
+    // final hulls with limited vertices.
+    // centers of surface cells are used because cells on the surface are half outside.
+    hulls.resize(parts.size());
+    std::vector<char> succeeded(parts.size(), 0);
+    parallel_for(0, int(parts.size()), 1, [&](int begin, int end) {
+        std::vector<LVecBase3f> points;
+        for (int k = begin; k < end; ++k)
+        {
+            detail::collect_voxel_part_points(parts[k].cells, sdf.origin, cell_size, false, points);
+            if (!build_convex_hull(points.data(), int(points.size()), hulls[k], options.max_hull_vertices))
+            {
+                // flat parts
+                detail::collect_voxel_part_points(parts[k].cells, sdf.origin, cell_size, true, points);
+                if (!build_convex_hull(points.data(), int(points.size()), hulls[k], options.max_hull_vertices))
+                    continue;
+            }
+            succeeded[k] = 1;
+        }
+    });
+
+    size_t hulls_end = 0;
+    for (size_t k = 0; k < hulls.size(); ++k)
+    {
+        if (!succeeded[k])
+            continue;
+        if (k != hulls_end)
+            hulls[hulls_end] = std::move(hulls[k]);
+        ++hulls_end;
+    }
+    hulls.resize(hulls_end);
+
+    return !hulls.empty();
+}
+
+}
@@ -0,0 +1,353 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include <luse.h>
+
+namespace rpflex {
+
+/** Convex hull with triangles and planes. */
+struct ConvexHull
+{
+    /** Calculate volume of the hull. */
+    float calc_volume() const;
+
+    std::vector<LVecBase3f> vertices;
+    std::vector<int> indices;           ///< 3 indices per triangle, counter-clockwise from outside.
+
+    /**
+     * Planes (nx, ny, nz, d) of faces where dot(n, p) + d <= 0 for inside points.
+     * Coplanar triangles share one plane.
+     */
+    std::vector<LVecBase4f> planes;
+
+    LPoint3f lower = LPoint3f(FLT_MAX);
+    LPoint3f upper = LPoint3f(-FLT_MAX);
+};
+
+/**
+ * Build convex hull of points using quickhull.
+ *
+ * @param   max_vertices    Stop adding vertices at this count. The hull may not contain all points then.
+ * @return  false if points are degenerate (ex, less than 4 points or coplanar).
+ */
+bool build_convex_hull(const LVecBase3f* points, int count, ConvexHull& hull, int max_vertices=64);
+
+// ************************************************************************************************
+inline float ConvexHull::calc_volume() const
+{
+    if (vertices.empty())
+        return 0.0f;
+
+    const LVecBase3f& origin = vertices[0];
+    float volume = 0.0f;
+    for (size_t k = 0, k_end = indices.size(); k + 2 < k_end; k += 3)
+    {
+        const LVecBase3f a = vertices[indices[k]] - origin;
+        const LVecBase3f b = vertices[indices[k+1]] - origin;
+        const LVecBase3f c = vertices[indices[k+2]] - origin;
+        volume += a.dot(b.cross(c));
+    }
+
+    return volume / 6.0f;
+}
+
+inline bool build_convex_hull(const LVecBase3f* points, int count, ConvexHull& hull, int max_vertices)
+{
+    hull = ConvexHull();
+
+    if (count < 4)
+        return false;
+
+    struct Face
+    {
+        std::array<int, 3> v;
+        LVecBase3f normal;
+        float offset;
+        std::vector<int> outside;
+        bool alive;
+    };
+
+    LVecBase3f lower = points[0];
+    LVecBase3f upper = points[0];
+    for (int k = 1; k < count; ++k)
+    {
+        lower = lower.fmin(points[k]);
+        upper = upper.fmax(points[k]);
+    }
+    const float epsilon = 1e-5f * (std::max)((upper - lower).length(), 1e-6f);
+
+    // initial simplex from extreme points
+    int extremes[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int k = 1; k < count; ++k)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (points[k][axis] < points[extremes[axis*2]][axis])
+                extremes[axis*2] = k;
+            if (points[k][axis] > points[extremes[axis*2+1]][axis])
+                extremes[axis*2+1] = k;
+        }
+    }
+
+    int i0 = extremes[0];
+    int i1 = extremes[1];
+    float max_distance = -1.0f;
+    for (int a = 0; a < 6; ++a)
+    {
+        for (int b = a + 1; b < 6; ++b)
+        {
+            const float distance = (points[extremes[a]] - points[extremes[b]]).length_squared();
+            if (distance > max_distance)
+            {
+                max_distance = distance;
+                i0 = extremes[a];
+                i1 = extremes[b];
+            }
+        }
+    }
+
+    const LVecBase3f line = (points[i1] - points[i0]).normalized();
+    int i2 = -1;
+    max_distance = epsilon;
+    for (int k = 0; k < count; ++k)
+    {
+        const LVecBase3f d = points[k] - points[i0];
+        const float distance = (d - line * d.dot(line)).length();
+        if (distance > max_distance)
+        {
+            max_distance = distance;
+            i2 = k;
+        }
+    }
+    if (i2 < 0)
+        return false;
+
+    LVecBase3f base_normal = (points[i1] - points[i0]).cross(points[i2] - points[i0]).normalized();
+    int i3 = -1;
+    max_distance = epsilon;
+    for (int k = 0; k < count; ++k)
+    {
+        const float distance = std::abs((points[k] - points[i0]).dot(base_normal));
+        if (distance > max_distance)
+        {
+            max_distance = distance;
+            i3 = k;
+        }
+    }
+    if (i3 < 0)
+        return false;
+
+    // make (i0, i1, i2) face outward
+    if ((points[i3] - points[i0]).dot(base_normal) > 0.0f)
+        std::swap(i1, i2);
+
+    std::vector<Face> faces;
+
+    // directed edge to the face having it
+    std::unordered_map<uint64_t, int> edge_faces;
+    const auto edge_key = [](int a, int b) { return (uint64_t(uint32_t(a)) << 32) | uint32_t(b); };
+
+    const auto add_face = [&](int a, int b, int c) {
+        Face face;
+        face.v = { a, b, c };
+        face.normal = (points[b] - points[a]).cross(points[c] - points[a]).normalized();
+        face.offset = -face.normal.dot(points[a]);
+        face.alive = true;
+
+        const int index = int(faces.size());
+        edge_faces[edge_key(a, b)] = index;
+        edge_faces[edge_key(b, c)] = index;
+        edge_faces[edge_key(c, a)] = index;
+
+        faces.push_back(std::move(face));
+    };
+    add_face(i0, i1, i2);
+    add_face(i0, i3, i1);
+    add_face(i1, i3, i2);
+    add_face(i2, i3, i0);
+
+    const auto distance_to = [&](const Face& face, int k) {
+        return face.normal.dot(points[k]) + face.offset;
+    };
+
+    // assign each point to the farthest face above it
+    const auto assign_points = [&](const std::vector<int>& candidates, size_t faces_begin) {
+        for (int k: candidates)
+        {
+            int best_face = -1;
+            float best_distance = epsilon;
+            for (size_t f = faces_begin, f_end = faces.size(); f < f_end; ++f)
+            {
+                if (!faces[f].alive)
+                    continue;
+                const float distance = distance_to(faces[f], k);
+                if (distance > best_distance)
+                {
+                    best_distance = distance;
+                    best_face = int(f);
+                }
+            }
+            if (best_face >= 0)
+                faces[best_face].outside.push_back(k);
+        }
+    };
+
+    {
+        std::vector<int> all_points;
+        all_points.reserve(count);
+        for (int k = 0; k < count; ++k)
+        {
+            if (k != i0 && k != i1 && k != i2 && k != i3)
+                all_points.push_back(k);
+        }
+        assign_points(all_points, 0);
+    }
+
+    int vertices_count = 4;
+    std::vector<int> visited(faces.size(), -1);     // the last eye visiting the face
+    std::vector<int> visible;
+    std::vector<std::pair<int, int>> horizon;
+    std::vector<int> orphans;
+    while (vertices_count < max_vertices)
+    {
+        // find the farthest outside point
+        int eye = -1;
+        float eye_distance = 0.0f;
+        int eye_face = -1;
+        for (int f = 0, f_end = int(faces.size()); f < f_end; ++f)
+        {
+            if (!faces[f].alive)
+                continue;
+            for (int k: faces[f].outside)
+            {
+                const float distance = distance_to(faces[f], k);
+                if (distance > eye_distance)
+                {
+                    eye_distance = distance;
+                    eye = k;
+                    eye_face = f;
+                }
+            }
+        }
+        if (eye < 0)
+            break;
+
+        // faces seen from the eye, connected to the face of the eye
+        visible.clear();
+        visible.push_back(eye_face);
+        visited[eye_face] = eye;
+        for (size_t k = 0; k < visible.size(); ++k)
+        {
+            const Face& face = faces[visible[k]];
+            for (int e = 0; e < 3; ++e)
+            {
+                const int neighbor = edge_faces.at(edge_key(face.v[(e+1)%3], face.v[e]));
+                if (visited[neighbor] != eye && distance_to(faces[neighbor], eye) > 0.0f)
+                {
+                    visited[neighbor] = eye;
+                    visible.push_back(neighbor);
+                }
+            }
+        }
+
+        // edges between visible and invisible faces
+        horizon.clear();
+        for (int f: visible)
+        {
+            for (int e = 0; e < 3; ++e)
+            {
+                const int a = faces[f].v[e];
+                const int b = faces[f].v[(e+1)%3];
+                const int neighbor = edge_faces.at(edge_key(b, a));
+                if (std::find(visible.begin(), visible.end(), neighbor) == visible.end())
+                    horizon.push_back({ a, b });
+            }
+        }
+
+        orphans.clear();
+        for (int f: visible)
+        {
+            for (int e = 0; e < 3; ++e)
+                edge_faces.erase(edge_key(faces[f].v[e], faces[f].v[(e+1)%3]));
+
+            faces[f].alive = false;
+            for (int k: faces[f].outside)
+            {
+                if (k != eye)
+                    orphans.push_back(k);
+            }
+            faces[f].outside.clear();
+            faces[f].outside.shrink_to_fit();
+        }
+
+        const size_t new_faces_begin = faces.size();
+        for (const auto& edge: horizon)
+            add_face(edge.first, edge.second, eye);
+        visited.resize(faces.size(), -1);
+        ++vertices_count;
+
+        assign_points(orphans, new_faces_begin);
+    }
+
+    // collect vertices used by faces
+    std::vector<int> remap(count, -1);
+    for (const auto& face: faces)
+    {
+        if (!face.alive)
+            continue;
+
+        for (int v: face.v)
+        {
+            if (remap[v] < 0)
+            {
+                remap[v] = int(hull.vertices.size());
+                hull.vertices.push_back(points[v]);
+                hull.lower = hull.lower.fmin(points[v]);
+                hull.upper = hull.upper.fmax(points[v]);
+            }
+            hull.indices.push_back(remap[v]);
+        }
+
+        // merge coplanar faces
+        const LVecBase4f plane(face.normal, face.offset);
+        const bool found = std::any_of(hull.planes.begin(), hull.planes.end(), [&](const LVecBase4f& other) {
+            return other.get_xyz().dot(face.normal) > 1.0f - 1e-5f && std::abs(other[3] - face.offset) <= epsilon;
+        });
+        if (!found)
+            hull.planes.push_back(plane);
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,281 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <nodePath.h>
+#include <nodePathCollection.h>
+#include <geomNode.h>
+#include <geomVertexReader.h>
+
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/rpobject.hpp>
+
+namespace rpflex {
+
+/** Triangle mesh extracted from Geoms. */
+struct TriangleMeshData
+{
+    int get_vertices_count() const;
+    int get_faces_count() const;
+
+    /** Calculate lower and upper from positions. */
+    void update_bounds();
+
+    std::vector<LVecBase3f> positions;
+    std::vector<int> indices;       ///< 3 indices per triangle.
+
+    LPoint3f lower = LPoint3f(FLT_MAX);
+    LPoint3f upper = LPoint3f(-FLT_MAX);
+};
+
+/**
+ * Extract triangles of all Geoms in the subtree of @p root_nodepath.
+ *
+ * Positions are in the coordinate space of @p root_nodepath.
+ * Vertex and index arrays are read directly from their handles when possible,
+ * and strips and fans are decomposed into triangles. Lines and points are ignored.
+ *
+ * Welding is a hash pass over all vertices, so it is disabled by default and the extraction
+ * stays a copy of the arrays. Seams between Geoms have the same positions without welding.
+ *
+ * @param   weld    Merge vertices having the same position.
+ * @return  false if there is no triangle.
+ */
+bool extract_triangle_mesh(NodePath root_nodepath, TriangleMeshData& mesh, bool weld=false);
+
+/** Append vertices of @p vdata transformed by @p mat. */
+void extract_vertices(const GeomVertexData* vdata, const LMatrix4f& mat, bool is_identity, std::vector<LVecBase3f>& positions);
+
+/** Append triangle indices of @p primitive, offsetting by @p base_index. */
+void extract_triangle_indices(const GeomPrimitive* primitive, int base_index, std::vector<int>& indices);
+
+/** Merge vertices having the same position and remap indices. */
+void weld_exact_vertices(TriangleMeshData& mesh);
+
+// ************************************************************************************************
+inline int TriangleMeshData::get_vertices_count() const
+{
+    return int(positions.size());
+}
+
+inline int TriangleMeshData::get_faces_count() const
+{
+    return int(indices.size() / 3);
+}
+
+inline void TriangleMeshData::update_bounds()
+{
+    lower = LPoint3f(FLT_MAX);
+    upper = LPoint3f(-FLT_MAX);
+    for (const auto& position: positions)
+    {
+        lower = lower.fmin(position);
+        upper = upper.fmax(position);
+    }
+}
+
+inline void extract_vertices(const GeomVertexData* vdata, const LMatrix4f& mat, bool is_identity, std::vector<LVecBase3f>& positions)
+{
+    const int rows_count = vdata->get_num_rows();
+    const size_t offset = positions.size();
+    positions.resize(offset + rows_count);
+    LVecBase3f* dest = positions.data() + offset;
+
+    const GeomVertexFormat* format = vdata->get_format();
+    const int array_index = format->get_array_with(InternalName::get_vertex());
+    const auto* column = format->get_column(InternalName::get_vertex());
+
+    if (array_index >= 0 && column &&
+        column->get_numeric_type() == GeomEnums::NT_float32 && column->get_num_components() >= 3)
+    {
+        // strided copy from the array
+        CPT(GeomVertexArrayDataHandle) handle = vdata->get_array_handle(array_index);
+        const unsigned char* src = handle->get_read_pointer(true) + column->get_start();
+        const int stride = format->get_array(array_index)->get_stride();
+
+        if (stride == sizeof(LVecBase3f))
+        {
+            std::memcpy(dest, src, sizeof(LVecBase3f) * rows_count);
+        }
+        else
+        {
+            for (int k = 0; k < rows_count; ++k, src += stride)
+                std::memcpy(&dest[k], src, sizeof(LVecBase3f));
+        }
+    }
+    else
+    {
+        GeomVertexReader vertex(vdata, InternalName::get_vertex());
+        for (int k = 0; k < rows_count; ++k)
+            dest[k] = vertex.get_data3f();
+    }
+
+    if (!is_identity)
+    {
+        for (int k = 0; k < rows_count; ++k)
+            dest[k] = mat.xform_point(dest[k]);
+    }
+}
+
+inline void extract_triangle_indices(const GeomPrimitive* primitive, int base_index, std::vector<int>& indices)
+{
+    if (primitive->get_primitive_type() != GeomEnums::PT_polygons)
+        return;
+
+    // strips and fans to triangles
+    CPT(GeomPrimitive) triangles = primitive->decompose();
+
+    const int vertices_count = triangles->get_num_vertices();
+    const size_t offset = indices.size();
+    indices.resize(offset + vertices_count);
+    int* dest = indices.data() + offset;
+
+    if (!triangles->is_indexed())
+    {
+        const int first_vertex = base_index + triangles->get_first_vertex();
+        for (int k = 0; k < vertices_count; ++k)
+            dest[k] = first_vertex + k;
+        return;
+    }
+
+    CPT(GeomVertexArrayDataHandle) handle = triangles->get_vertices()->get_handle();
+    const unsigned char* src = handle->get_read_pointer(true);
+
+    switch (triangles->get_index_type())
+    {
+        case GeomEnums::NT_uint8:
+        {
+            for (int k = 0; k < vertices_count; ++k)
+                dest[k] = base_index + src[k];
+            break;
+        }
+        case GeomEnums::NT_uint16:
+        {
+            const uint16_t* src16 = reinterpret_cast<const uint16_t*>(src);
+            for (int k = 0; k < vertices_count; ++k)
+                dest[k] = base_index + src16[k];
+            break;
+        }
+        default:
+        {
+            std::memcpy(dest, src, sizeof(int) * vertices_count);
+            if (base_index != 0)
+            {
+                for (int k = 0; k < vertices_count; ++k)
+                    dest[k] += base_index;
+            }
+            break;
+        }
+    }
+}
+
+inline void weld_exact_vertices(TriangleMeshData& mesh)
+{
+    struct PositionHash
+    {
+        size_t operator()(const LVecBase3f& v) const
+        {
+            // +0.0f to hash -0 and 0 equally
+            const float values[3] = { v[0] + 0.0f, v[1] + 0.0f, v[2] + 0.0f };
+            uint32_t bits[3];
+            std::memcpy(bits, values, sizeof(bits));
+            return (size_t(bits[0]) * 73856093u) ^ (size_t(bits[1]) * 19349663u) ^ (size_t(bits[2]) * 83492791u);
+        }
+    };
+
+    std::unordered_map<LVecBase3f, int, PositionHash> unique_indices;
+    unique_indices.reserve(mesh.positions.size());
+
+    std::vector<int> remap(mesh.positions.size());
+    int unique_count = 0;
+    for (int k = 0, k_end = mesh.get_vertices_count(); k < k_end; ++k)
+    {
+        auto result = unique_indices.insert({ mesh.positions[k], unique_count });
+        if (result.second)
+            mesh.positions[unique_count++] = mesh.positions[k];
+        remap[k] = result.first->second;
+    }
+    mesh.positions.resize(unique_count);
+
+    for (auto& index: mesh.indices)
+        index = remap[index];
+}
+
+inline bool extract_triangle_mesh(NodePath root_nodepath, TriangleMeshData& mesh, bool weld)
+{
+    mesh = TriangleMeshData();
+
+    if (root_nodepath.is_empty())
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING, "NodePath is empty.");
+        return false;
+    }
+
+    // "**" also matches the root
+    NodePathCollection geom_nodepaths = root_nodepath.find_all_matches("**/+GeomNode");
+    for (int node_index = 0, node_index_end = geom_nodepaths.get_num_paths(); node_index < node_index_end; ++node_index)
+    {
+        NodePath geom_nodepath = geom_nodepaths.get_path(node_index);
+        const GeomNode* geom_node = DCAST(GeomNode, geom_nodepath.node());
+
+        const LMatrix4f mat = geom_nodepath.get_mat(root_nodepath);
+        const bool is_identity = mat.almost_equal(LMatrix4f::ident_mat());
+
+        for (int geom_index = 0, geom_index_end = geom_node->get_num_geoms(); geom_index < geom_index_end; ++geom_index)
+        {
+            CPT(Geom) geom = geom_node->get_geom(geom_index);
+            if (geom->get_primitive_type() != GeomEnums::PT_polygons)
+                continue;
+
+            const int base_index = mesh.get_vertices_count();
+            extract_vertices(geom->get_vertex_data(), mat, is_identity, mesh.positions);
+
+            for (int index = 0, index_end = geom->get_num_primitives(); index < index_end; ++index)
+                extract_triangle_indices(geom->get_primitive(index), base_index, mesh.indices);
+        }
+    }
+
+    if (mesh.indices.empty())
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING,
+            fmt::format("NodePath ({}) has NO triangle.", root_nodepath.get_name()));
+        mesh = TriangleMeshData();
+        return false;
+    }
+
+    if (weld)
+        weld_exact_vertices(mesh);
+
+    mesh.update_bounds();
+
+    return true;
+}
+
+}
@@ -25,67 +25,258 @@
 //
 // Copyright (c) 2013-2017 NVIDIA Corporation. All rights reserved.
 
+#pragma once
+
+#include <map>
+#include <mutex>
+
 #include <luse.h>
 
 #include <rpflex/flex_buffer.hpp>
+#include <rpflex/utils/parallel_for.hpp>
 
-void GetParticleBounds(rpflex::FlexBuffer& buffer, LVecBase3f& lower, LVecBase3f& upper)
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RPFLEX_HELPERS_USE_SSE
+#endif
+
+// calculates bounds of [begin, end) particles using 4-wide float positions
+inline void GetParticleBounds(const LVecBase4f* positions, int begin, int end, LVecBase3f& lower, LVecBase3f& upper)
 {
+    static_assert(sizeof(LVecBase4f) == sizeof(float) * 4, "LVecBase4f should be 4 packed floats.");
+
+    const float* data = reinterpret_cast<const float*>(positions);
+    int i = begin;
+
+#if defined(__AVX__)
+    // two particles per register and four registers per iteration
+    __m256 lo = _mm256_set1_ps(FLT_MAX);
+    __m256 hi = _mm256_set1_ps(-FLT_MAX);
+    for (; i + 8 <= end; i += 8)
+    {
+        const __m256 a = _mm256_loadu_ps(data + i * 4);
+        const __m256 b = _mm256_loadu_ps(data + i * 4 + 8);
+        const __m256 c = _mm256_loadu_ps(data + i * 4 + 16);
+        const __m256 d = _mm256_loadu_ps(data + i * 4 + 24);
+        lo = _mm256_min_ps(lo, _mm256_min_ps(_mm256_min_ps(a, b), _mm256_min_ps(c, d)));
+        hi = _mm256_max_ps(hi, _mm256_max_ps(_mm256_max_ps(a, b), _mm256_max_ps(c, d)));
+    }
+    __m128 lo4 = _mm_min_ps(_mm256_castps256_ps128(lo), _mm256_extractf128_ps(lo, 1));
+    __m128 hi4 = _mm_max_ps(_mm256_castps256_ps128(hi), _mm256_extractf128_ps(hi, 1));
+#elif defined(RPFLEX_HELPERS_USE_SSE)
+    __m128 lo4 = _mm_set1_ps(FLT_MAX);
+    __m128 hi4 = _mm_set1_ps(-FLT_MAX);
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m128 a = _mm_loadu_ps(data + i * 4);
+        const __m128 b = _mm_loadu_ps(data + i * 4 + 4);
+        const __m128 c = _mm_loadu_ps(data + i * 4 + 8);
+        const __m128 d = _mm_loadu_ps(data + i * 4 + 12);
+        lo4 = _mm_min_ps(lo4, _mm_min_ps(_mm_min_ps(a, b), _mm_min_ps(c, d)));
+        hi4 = _mm_max_ps(hi4, _mm_max_ps(_mm_max_ps(a, b), _mm_max_ps(c, d)));
+    }
+#endif
+
+#if defined(__AVX__) || defined(RPFLEX_HELPERS_USE_SSE)
+    for (; i < end; ++i)
+    {
+        const __m128 a = _mm_loadu_ps(data + i * 4);
+        lo4 = _mm_min_ps(lo4, a);
+        hi4 = _mm_max_ps(hi4, a);
+    }
+
+    float lo_values[4];
+    float hi_values[4];
+    _mm_storeu_ps(lo_values, lo4);
+    _mm_storeu_ps(hi_values, hi4);
+
+    lower = LVecBase3f(lo_values[0], lo_values[1], lo_values[2]);
+    upper = LVecBase3f(hi_values[0], hi_values[1], hi_values[2]);
+#else
     lower = LVecBase3f(FLT_MAX);
     upper = LVecBase3f(-FLT_MAX);
 
-    for (int i=0, i_end=buffer.positions.size(); i < i_end; ++i)
+    for (; i < end; ++i)
     {
-        lower = buffer.positions[i].get_xyz().fmin(lower);
-        upper = buffer.positions[i].get_xyz().fmax(upper);
+        lower = positions[i].get_xyz().fmin(lower);
+        upper = positions[i].get_xyz().fmax(upper);
     }
+#endif
 }
 
-// calculates local space positions given a set of particles and rigid indices
-void CalculateRigidLocalPositions(const LVecBase4f* restPositions, int numRestPositions, const int* offsets, const int* indices, int numRigids, LVecBase3f* localPositions)
+inline void GetParticleBounds(rpflex::FlexBuffer& buffer, LVecBase3f& lower, LVecBase3f& upper)
 {
-    // To improve the accuracy of the result, first transform the restPositions to relative coordinates (by finding the mean and subtracting that from all points)
-    // Note: If this is not done, one might see ghost forces if the mean of the restPositions is far from the origin.
+    lower = LVecBase3f(FLT_MAX);
+    upper = LVecBase3f(-FLT_MAX);
 
-    // Calculate mean
-    LVecBase3f shapeOffset(0.0f);
+    if (buffer.positions.size() == 0)
+        return;
 
-    for (int i = 0; i < numRestPositions; i++)
-    {
-        shapeOffset += LVecBase3f(restPositions[i].get_xyz());
-    }
+    std::mutex bounds_mutex;
+    const LVecBase4f* positions = &buffer.positions[0];
+    rpflex::parallel_for(0, buffer.positions.size(), 1 << 16, [&](int begin, int end) {
+        LVecBase3f sub_lower;
+        LVecBase3f sub_upper;
+        GetParticleBounds(positions, begin, end, sub_lower, sub_upper);
 
-    shapeOffset /= float(numRestPositions);
+        std::lock_guard<std::mutex> lock(bounds_mutex);
+        lower = lower.fmin(sub_lower);
+        upper = upper.fmax(sub_upper);
+    });
+}
 
-    int count = 0;
+// local bounds of triangle and convex meshes, keyed by shape type and mesh id
+typedef std::map<std::pair<int, unsigned long long>, std::pair<LVecBase3f, LVecBase3f>> MeshBoundsCache;
 
-    for (int r=0; r < numRigids; ++r)
+inline void GetGeometryBounds(NvFlexLibrary* lib, const NvFlexCollisionGeometry& geo, int type, MeshBoundsCache& cache,
+    LVecBase3f& localLower, LVecBase3f& localUpper)
+{
+    switch (type)
     {
-        const int startIndex = offsets[r];
-        const int endIndex = offsets[r+1];
+        case eNvFlexShapeSphere:
+        {
+            localLower = LVecBase3f(-geo.sphere.radius);
+            localUpper = LVecBase3f(geo.sphere.radius);
+            break;
+        }
+        case eNvFlexShapeCapsule:
+        {
+            // capsule is aligned to x-axis
+            localLower = -LVecBase3f(geo.capsule.halfHeight, 0.0f, 0.0f) - LVecBase3f(geo.capsule.radius);
+            localUpper = LVecBase3f(geo.capsule.halfHeight, 0.0f, 0.0f) + LVecBase3f(geo.capsule.radius);
+            break;
+        }
+        case eNvFlexShapeBox:
+        {
+            localLower = -LVecBase3f(geo.box.halfExtents[0], geo.box.halfExtents[1], geo.box.halfExtents[2]);
+            localUpper = LVecBase3f(geo.box.halfExtents[0], geo.box.halfExtents[1], geo.box.halfExtents[2]);
+            break;
+        }
+        case eNvFlexShapeConvexMesh:
+        case eNvFlexShapeTriangleMesh:
+        {
+            const bool is_convex = type == eNvFlexShapeConvexMesh;
+            const unsigned long long mesh = is_convex ? geo.convexMesh.mesh : geo.triMesh.mesh;
+            const float* scale = is_convex ? geo.convexMesh.scale : geo.triMesh.scale;
 
-        const int n = endIndex-startIndex;
+            auto found = cache.find({ type, mesh });
+            if (found == cache.end())
+            {
+                // meshes are not created without Flex library (CPU solver)
+                LVecBase3f lower(0.0f);
+                LVecBase3f upper(0.0f);
+                if (lib && is_convex)
+                    NvFlexGetConvexMeshBounds(lib, geo.convexMesh.mesh, lower.get_data(), upper.get_data());
+                else if (lib)
+                    NvFlexGetTriangleMeshBounds(lib, geo.triMesh.mesh, lower.get_data(), upper.get_data());
+                found = cache.insert({ { type, mesh }, { lower, upper } }).first;
+            }
 
-        assert(n);
+            // apply instance scaling
+            const LVecBase3f s(scale[0], scale[1], scale[2]);
+            const LVecBase3f a = found->second.first.componentwise_mult(s);
+            const LVecBase3f b = found->second.second.componentwise_mult(s);
+            localLower = a.fmin(b);
+            localUpper = a.fmax(b);
+            break;
+        }
+        case eNvFlexShapeSDF:
+        {
+            localLower = LVecBase3f(0.0f);
+            localUpper = LVecBase3f(geo.sdf.scale);
+            break;
+        }
+        default:
+        {
+            localLower = LVecBase3f(FLT_MAX);
+            localUpper = LVecBase3f(-FLT_MAX);
+            break;
+        }
+    }
+}
 
-        LVecBase3f com;
+// calculates bounds of all collision shapes in world space
+inline void GetShapeBounds(NvFlexLibrary* lib, const rpflex::FlexBuffer& buffer, MeshBoundsCache& cache,
+    LVecBase3f& lower, LVecBase3f& upper)
+{
+    lower = LVecBase3f(FLT_MAX);
+    upper = LVecBase3f(-FLT_MAX);
+
+    for (int i=0, i_end=buffer.shape_flags.size(); i < i_end; ++i)
+    {
+        LVecBase3f localLower;
+        LVecBase3f localUpper;
+        GetGeometryBounds(lib, buffer.shape_geometry[i], buffer.shape_flags[i] & eNvFlexShapeFlagTypeMask, cache,
+            localLower, localUpper);
+
+        if (localLower[0] > localUpper[0])
+            continue;
 
-        for (int i=startIndex; i < endIndex; ++i)
+        const LQuaternionf rotation = rpflex::from_flex_quat(buffer.shape_rotations[i]);
+        const LVecBase3f position = buffer.shape_positions[i].get_xyz();
+
+        // transform corners of local bounds to world space
+        for (int corner = 0; corner < 8; ++corner)
         {
-            const int r = indices[i];
+            const LVecBase3f local_corner(
+                (corner & 1) ? localUpper[0] : localLower[0],
+                (corner & 2) ? localUpper[1] : localLower[1],
+                (corner & 4) ? localUpper[2] : localLower[2]);
 
-            // By substracting meshOffset the calculation is done in relative coordinates
-            com += LVecBase3f(restPositions[r].get_xyz()) - shapeOffset;
+            const LVecBase3f world_corner = rotation.xform(local_corner) + position;
+            lower = lower.fmin(world_corner);
+            upper = upper.fmax(world_corner);
         }
+    }
+}
 
-        com /= float(n);
+// calculates local space positions given a set of particles and rigid indices
+inline void CalculateRigidLocalPositions(const LVecBase4f* restPositions, int numRestPositions, const int* offsets, const int* indices, int numRigids, LVecBase3f* localPositions)
+{
+    // To improve the accuracy of the result, first transform the restPositions to relative coordinates
+    // (by subtracting the first particle of each rigid from all points of the rigid).
+    // Note: If this is not done, one might see ghost forces if the mean of the restPositions is far from the origin.
+    // Using a point of each rigid gives the same accuracy as the mean of all positions
+    // without a pass over all rest positions, and rigids are independent of each other.
 
-        for (int i=startIndex; i < endIndex; ++i)
+    rpflex::parallel_for(0, numRigids, 64, [&](int rigidBegin, int rigidEnd) {
+        for (int r=rigidBegin; r < rigidEnd; ++r)
         {
-            const int r = indices[i];
+            const int startIndex = offsets[r];
+            const int endIndex = offsets[r+1];
+
+            const int n = endIndex-startIndex;
+
+            assert(n);
+
+            const LVecBase3f shapeOffset = restPositions[indices[startIndex]].get_xyz();
+
+            LVecBase3f com(0.0f);
 
-            // By substracting meshOffset the calculation is done in relative coordinates
-            localPositions[count++] = (LVecBase3f(restPositions[r].get_xyz()) - shapeOffset) - com;
+            for (int i=startIndex; i < endIndex; ++i)
+            {
+                const int r = indices[i];
+
+                // By substracting meshOffset the calculation is done in relative coordinates
+                com += LVecBase3f(restPositions[r].get_xyz()) - shapeOffset;
+            }
+
+            com /= float(n);
+
+            // local positions are written from offsets[0]
+            int count = startIndex - offsets[0];
+
+            for (int i=startIndex; i < endIndex; ++i)
+            {
+                const int r = indices[i];
+
+                // By substracting meshOffset the calculation is done in relative coordinates
+                localPositions[count++] = (LVecBase3f(restPositions[r].get_xyz()) - shapeOffset) - com;
+            }
         }
-    }
+    });
 }
+
+#undef RPFLEX_HELPERS_USE_SSE
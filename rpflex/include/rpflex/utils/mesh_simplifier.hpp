@@ -0,0 +1,732 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <filename.h>
+
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/rpobject.hpp>
+
+#include <rpflex/triangle_mesh_registry.hpp>
+#include <rpflex/utils/geom_extractor.hpp>
+
+namespace rpflex {
+
+/** Options to simplify collision meshes. */
+struct MeshSimplifyOptions
+{
+    float weld_tolerance = 0.0f;            ///< Weld vertices within this distance. 0 welds the same positions only.
+    bool remove_degenerate = true;          ///< Remove triangles having no area.
+
+    /**
+     * Decimate until the number of triangles is this count.
+     * If this is 0 and max_error is FLT_MAX, decimation is disabled.
+     */
+    int target_faces_count = 0;
+    float max_error = FLT_MAX;              ///< Stop decimation if quadric error of next collapse exceeds this.
+
+    std::string cache_directory;            ///< Cache simplified meshes in this directory. Empty disables caching.
+};
+
+/**
+ * Weld, remove degenerate triangles and decimate the mesh.
+ * If @p options has cache directory, the result is loaded from or saved to the cache file.
+ */
+void simplify_triangle_mesh(TriangleMeshData& mesh, const MeshSimplifyOptions& options);
+
+/** Merge vertices within @p tolerance using uniform grid. */
+void weld_vertices(TriangleMeshData& mesh, float tolerance);
+
+/** Remove triangles having the same indices, no area or duplicated vertices, and vertices not used. */
+void remove_degenerate_triangles(TriangleMeshData& mesh);
+
+/** Collapse edges with the smallest quadric error until the target count or error. */
+void decimate_triangle_mesh(TriangleMeshData& mesh, int target_faces_count, float max_error);
+
+/** Remove vertices which are not used by triangles. */
+void remove_unused_vertices(TriangleMeshData& mesh);
+
+uint64_t calc_mesh_cache_key(const TriangleMeshData& mesh, const MeshSimplifyOptions& options);
+bool load_triangle_mesh_cache(const Filename& path, TriangleMeshData& mesh);
+bool save_triangle_mesh_cache(const Filename& path, const TriangleMeshData& mesh);
+
+// ************************************************************************************************
+
+/** Symmetric 4x4 matrix of quadric error. */
+struct MeshQuadric
+{
+    MeshQuadric();
+
+    /** Add the plane (n, d) where dot(n, p) + d = 0. */
+    void add_plane(const LVecBase3d& n, double d, double weight);
+
+    MeshQuadric& operator+=(const MeshQuadric& other);
+
+    double evaluate(const LVecBase3d& p) const;
+
+    /** Find the position minimizing error, or return false if the matrix is singular. */
+    bool find_optimal(LVecBase3d& p) const;
+
+    // aa, ab, ac, ad, bb, bc, bd, cc, cd, dd
+    double q[10];
+};
+
+inline MeshQuadric::MeshQuadric()
+{
+    std::fill(q, q + 10, 0.0);
+}
+
+inline void MeshQuadric::add_plane(const LVecBase3d& n, double d, double weight)
+{
+    const double a = n[0];
+    const double b = n[1];
+    const double c = n[2];
+    q[0] += weight * a * a; q[1] += weight * a * b; q[2] += weight * a * c; q[3] += weight * a * d;
+    q[4] += weight * b * b; q[5] += weight * b * c; q[6] += weight * b * d;
+    q[7] += weight * c * c; q[8] += weight * c * d;
+    q[9] += weight * d * d;
+}
+
+inline MeshQuadric& MeshQuadric::operator+=(const MeshQuadric& other)
+{
+    for (int k = 0; k < 10; ++k)
+        q[k] += other.q[k];
+    return *this;
+}
+
+inline double MeshQuadric::evaluate(const LVecBase3d& p) const
+{
+    const double x = p[0];
+    const double y = p[1];
+    const double z = p[2];
+    return q[0]*x*x + 2*q[1]*x*y + 2*q[2]*x*z + 2*q[3]*x
+        + q[4]*y*y + 2*q[5]*y*z + 2*q[6]*y
+        + q[7]*z*z + 2*q[8]*z
+        + q[9];
+}
+
+inline bool MeshQuadric::find_optimal(LVecBase3d& p) const
+{
+    // solve A p = -b using Cramer's rule
+    const double det =
+        q[0] * (q[4] * q[7] - q[5] * q[5]) -
+        q[1] * (q[1] * q[7] - q[5] * q[2]) +
+        q[2] * (q[1] * q[5] - q[4] * q[2]);
+
+    const double scale = q[0] + q[4] + q[7];
+    if (std::abs(det) <= 1e-12 * scale * scale * scale)
+        return false;
+
+    const double bx = -q[3];
+    const double by = -q[6];
+    const double bz = -q[8];
+
+    p[0] = (bx * (q[4] * q[7] - q[5] * q[5]) - q[1] * (by * q[7] - q[5] * bz) + q[2] * (by * q[5] - q[4] * bz)) / det;
+    p[1] = (q[0] * (by * q[7] - bz * q[5]) - bx * (q[1] * q[7] - q[5] * q[2]) + q[2] * (q[1] * bz - by * q[2])) / det;
+    p[2] = (q[0] * (q[4] * bz - q[5] * by) - q[1] * (q[1] * bz - by * q[2]) + bx * (q[1] * q[5] - q[4] * q[2])) / det;
+
+    return true;
+}
+
+// ************************************************************************************************
+inline void weld_vertices(TriangleMeshData& mesh, float tolerance)
+{
+    if (tolerance <= 0.0f)
+    {
+        weld_exact_vertices(mesh);
+        return;
+    }
+
+    struct CellHash
+    {
+        size_t operator()(const std::array<int64_t, 3>& c) const
+        {
+            return size_t(c[0] * 73856093) ^ size_t(c[1] * 19349663) ^ size_t(c[2] * 83492791);
+        }
+    };
+
+    const float tolerance_sq = tolerance * tolerance;
+    const float inv_cell_size = 1.0f / tolerance;
+
+    // cell -> indices of welded vertices
+    std::unordered_map<std::array<int64_t, 3>, std::vector<int>, CellHash> grid;
+    grid.reserve(mesh.positions.size());
+
+    std::vector<int> remap(mesh.positions.size());
+    int unique_count = 0;
+    for (int k = 0, k_end = mesh.get_vertices_count(); k < k_end; ++k)
+    {
+        const LVecBase3f position = mesh.positions[k];
+        const std::array<int64_t, 3> cell = {
+            int64_t(std::floor(position[0] * inv_cell_size)),
+            int64_t(std::floor(position[1] * inv_cell_size)),
+            int64_t(std::floor(position[2] * inv_cell_size)) };
+
+        int found = -1;
+        for (int dz = -1; dz <= 1 && found < 0; ++dz)
+        {
+            for (int dy = -1; dy <= 1 && found < 0; ++dy)
+            {
+                for (int dx = -1; dx <= 1 && found < 0; ++dx)
+                {
+                    auto iter = grid.find({ cell[0] + dx, cell[1] + dy, cell[2] + dz });
+                    if (iter == grid.end())
+                        continue;
+
+                    for (int index: iter->second)
+                    {
+                        if ((mesh.positions[index] - position).length_squared() <= tolerance_sq)
+                        {
+                            found = index;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (found < 0)
+        {
+            found = unique_count++;
+            mesh.positions[found] = position;
+            grid[cell].push_back(found);
+        }
+        remap[k] = found;
+    }
+    mesh.positions.resize(unique_count);
+
+    for (auto& index: mesh.indices)
+        index = remap[index];
+}
+
+inline void remove_unused_vertices(TriangleMeshData& mesh)
+{
+    std::vector<int> remap(mesh.positions.size(), -1);
+    std::vector<LVecBase3f> positions;
+    positions.reserve(mesh.positions.size());
+    for (auto& index: mesh.indices)
+    {
+        if (remap[index] < 0)
+        {
+            remap[index] = int(positions.size());
+            positions.push_back(mesh.positions[index]);
+        }
+        index = remap[index];
+    }
+    mesh.positions.swap(positions);
+}
+
+inline void remove_degenerate_triangles(TriangleMeshData& mesh)
+{
+    struct FaceHash
+    {
+        size_t operator()(const std::array<int, 3>& f) const
+        {
+            return size_t(f[0]) * 73856093u ^ size_t(f[1]) * 19349663u ^ size_t(f[2]) * 83492791u;
+        }
+    };
+    std::unordered_set<std::array<int, 3>, FaceHash> unique_faces;
+    unique_faces.reserve(mesh.indices.size() / 3);
+
+    size_t faces_end = 0;
+    for (size_t k = 0, k_end = mesh.indices.size(); k + 2 < k_end; k += 3)
+    {
+        const int i0 = mesh.indices[k];
+        const int i1 = mesh.indices[k+1];
+        const int i2 = mesh.indices[k+2];
+        if (i0 == i1 || i1 == i2 || i2 == i0)
+            continue;
+
+        std::array<int, 3> sorted_face = { i0, i1, i2 };
+        std::sort(sorted_face.begin(), sorted_face.end());
+        if (!unique_faces.insert(sorted_face).second)
+            continue;
+
+        const LVecBase3f e1 = mesh.positions[i1] - mesh.positions[i0];
+        const LVecBase3f e2 = mesh.positions[i2] - mesh.positions[i0];
+        const float max_length_sq = (std::max)((std::max)(e1.length_squared(), e2.length_squared()), (e2 - e1).length_squared());
+
+        // area relative to the longest edge
+        if (e1.cross(e2).length_squared() <= 1e-12f * max_length_sq * max_length_sq)
+            continue;
+
+        mesh.indices[faces_end++] = i0;
+        mesh.indices[faces_end++] = i1;
+        mesh.indices[faces_end++] = i2;
+    }
+    mesh.indices.resize(faces_end);
+
+    remove_unused_vertices(mesh);
+}
+
+inline void decimate_triangle_mesh(TriangleMeshData& mesh, int target_faces_count, float max_error)
+{
+    const int vertices_count = mesh.get_vertices_count();
+    int faces_count = mesh.get_faces_count();
+    if (faces_count <= target_faces_count)
+        return;
+
+    std::vector<LVecBase3d> positions(vertices_count);
+    for (int k = 0; k < vertices_count; ++k)
+        positions[k] = LVecBase3d(mesh.positions[k][0], mesh.positions[k][1], mesh.positions[k][2]);
+    std::vector<std::array<int, 3>> faces(faces_count);
+    for (int k = 0; k < faces_count; ++k)
+        faces[k] = { mesh.indices[k*3], mesh.indices[k*3+1], mesh.indices[k*3+2] };
+
+    std::vector<bool> face_removed(faces_count, false);
+    std::vector<std::vector<int>> vertex_faces(vertices_count);
+    std::vector<MeshQuadric> quadrics(vertices_count);
+    std::vector<int> versions(vertices_count, 0);
+    std::vector<bool> vertex_removed(vertices_count, false);
+
+    const auto face_normal = [&](const std::array<int, 3>& face) {
+        return (positions[face[1]] - positions[face[0]]).cross(positions[face[2]] - positions[face[0]]);
+    };
+
+    // plane quadrics weighted by area
+    std::unordered_map<uint64_t, int> edge_faces;
+    const auto edge_key = [](int a, int b) {
+        return (uint64_t((std::min)(a, b)) << 32) | uint64_t((std::max)(a, b));
+    };
+    for (int f = 0; f < faces_count; ++f)
+    {
+        const auto& face = faces[f];
+        const LVecBase3d normal = face_normal(face);
+        const double length = normal.length();
+        if (length > 0.0)
+        {
+            const LVecBase3d n = normal / length;
+            MeshQuadric quadric;
+            quadric.add_plane(n, -n.dot(positions[face[0]]), length * 0.5);
+            for (int v: face)
+                quadrics[v] += quadric;
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            vertex_faces[face[k]].push_back(f);
+            ++edge_faces[edge_key(face[k], face[(k+1)%3])];
+        }
+    }
+
+    // keep boundary using planes perpendicular to boundary edges
+    const double boundary_weight = 1000.0;
+    for (int f = 0; f < faces_count; ++f)
+    {
+        const auto& face = faces[f];
+        const LVecBase3d normal = face_normal(face);
+        for (int k = 0; k < 3; ++k)
+        {
+            const int a = face[k];
+            const int b = face[(k+1)%3];
+            if (edge_faces[edge_key(a, b)] != 1)
+                continue;
+
+            const LVecBase3d edge = positions[b] - positions[a];
+            LVecBase3d n = edge.cross(normal);
+            const double length = n.length();
+            if (length <= 0.0)
+                continue;
+            n /= length;
+
+            MeshQuadric quadric;
+            quadric.add_plane(n, -n.dot(positions[a]), boundary_weight * edge.length_squared());
+            quadrics[a] += quadric;
+            quadrics[b] += quadric;
+        }
+    }
+    edge_faces.clear();
+
+    struct Candidate
+    {
+        double cost;
+        int v0;
+        int v1;
+        int version0;
+        int version1;
+        LVecBase3d position;
+
+        bool operator>(const Candidate& other) const { return cost > other.cost; }
+    };
+
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+
+    const auto push_candidate = [&](int v0, int v1) {
+        MeshQuadric quadric = quadrics[v0];
+        quadric += quadrics[v1];
+
+        Candidate candidate;
+        candidate.v0 = v0;
+        candidate.v1 = v1;
+        candidate.version0 = versions[v0];
+        candidate.version1 = versions[v1];
+
+        if (quadric.find_optimal(candidate.position))
+        {
+            candidate.cost = quadric.evaluate(candidate.position);
+        }
+        else
+        {
+            const LVecBase3d choices[3] = { positions[v0], positions[v1], (positions[v0] + positions[v1]) * 0.5 };
+            candidate.cost = DBL_MAX;
+            for (const auto& choice: choices)
+            {
+                const double cost = quadric.evaluate(choice);
+                if (cost < candidate.cost)
+                {
+                    candidate.cost = cost;
+                    candidate.position = choice;
+                }
+            }
+        }
+        candidate.cost = (std::max)(0.0, candidate.cost);
+
+        candidates.push(candidate);
+    };
+
+    for (int f = 0; f < faces_count; ++f)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const int a = faces[f][k];
+            const int b = faces[f][(k+1)%3];
+
+            // interior edges are shared by two faces, so push once
+            if (a < b)
+                push_candidate(a, b);
+        }
+    }
+
+    const auto collect_neighbors = [&](int v, std::vector<int>& neighbors) {
+        neighbors.clear();
+        for (int f: vertex_faces[v])
+        {
+            if (face_removed[f])
+                continue;
+            for (int u: faces[f])
+            {
+                if (u != v)
+                    neighbors.push_back(u);
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    };
+
+    // check whether faces around v are flipped if v is moved to position
+    const auto is_flipped = [&](int v, int other, const LVecBase3d& position) {
+        for (int f: vertex_faces[v])
+        {
+            if (face_removed[f])
+                continue;
+
+            const auto& face = faces[f];
+            if (face[0] == other || face[1] == other || face[2] == other)
+                continue;
+
+            std::array<LVecBase3d, 3> moved = { positions[face[0]], positions[face[1]], positions[face[2]] };
+            for (int k = 0; k < 3; ++k)
+            {
+                if (face[k] == v)
+                    moved[k] = position;
+            }
+
+            const LVecBase3d before = face_normal(face);
+            const LVecBase3d after = (moved[1] - moved[0]).cross(moved[2] - moved[0]);
+            if (before.dot(after) <= 0.0)
+                return true;
+        }
+        return false;
+    };
+
+    std::vector<int> neighbors0;
+    std::vector<int> neighbors1;
+    std::vector<int> common;
+    while (faces_count > target_faces_count && !candidates.empty())
+    {
+        const Candidate candidate = candidates.top();
+        candidates.pop();
+
+        const int v0 = candidate.v0;
+        const int v1 = candidate.v1;
+        if (vertex_removed[v0] || vertex_removed[v1] ||
+            versions[v0] != candidate.version0 || versions[v1] != candidate.version1)
+        {
+            continue;
+        }
+
+        if (candidate.cost > max_error)
+            break;
+
+        // link condition to keep manifold
+        collect_neighbors(v0, neighbors0);
+        collect_neighbors(v1, neighbors1);
+        common.clear();
+        std::set_intersection(neighbors0.begin(), neighbors0.end(), neighbors1.begin(), neighbors1.end(), std::back_inserter(common));
+        if (common.size() > 2)
+            continue;
+
+        // if the optimal position flips faces, try the end points and the midpoint
+        LVecBase3d position = candidate.position;
+        if (is_flipped(v0, v1, position) || is_flipped(v1, v0, position))
+        {
+            MeshQuadric quadric = quadrics[v0];
+            quadric += quadrics[v1];
+
+            std::array<std::pair<double, LVecBase3d>, 3> choices = {
+                std::make_pair(quadric.evaluate(positions[v0]), positions[v0]),
+                std::make_pair(quadric.evaluate(positions[v1]), positions[v1]),
+                std::make_pair(quadric.evaluate((positions[v0] + positions[v1]) * 0.5), (positions[v0] + positions[v1]) * 0.5) };
+            std::sort(choices.begin(), choices.end(), [](const std::pair<double, LVecBase3d>& a, const std::pair<double, LVecBase3d>& b) {
+                return a.first < b.first;
+            });
+
+            bool found = false;
+            for (const auto& choice: choices)
+            {
+                if (choice.first > max_error)
+                    break;
+
+                if (!is_flipped(v0, v1, choice.second) && !is_flipped(v1, v0, choice.second))
+                {
+                    position = choice.second;
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found)
+                continue;
+        }
+
+        // collapse v1 to v0
+        positions[v0] = position;
+        quadrics[v0] += quadrics[v1];
+        for (int f: vertex_faces[v1])
+        {
+            if (face_removed[f])
+                continue;
+
+            auto& face = faces[f];
+            if (face[0] == v0 || face[1] == v0 || face[2] == v0)
+            {
+                face_removed[f] = true;
+                --faces_count;
+                continue;
+            }
+
+            for (auto& v: face)
+            {
+                if (v == v1)
+                    v = v0;
+            }
+            vertex_faces[v0].push_back(f);
+        }
+        vertex_removed[v1] = true;
+        vertex_faces[v1].clear();
+        vertex_faces[v0].erase(std::remove_if(vertex_faces[v0].begin(), vertex_faces[v0].end(), [&](int f) {
+            return face_removed[f];
+        }), vertex_faces[v0].end());
+
+        // faces around neighbors are changed, so edges rejected before may be valid now
+        ++versions[v0];
+        collect_neighbors(v0, neighbors0);
+        for (int neighbor: neighbors0)
+            ++versions[neighbor];
+
+        for (int neighbor: neighbors0)
+        {
+            collect_neighbors(neighbor, neighbors1);
+            for (int other: neighbors1)
+            {
+                // edges between neighbors are pushed once
+                if (other == v0 || !std::binary_search(neighbors0.begin(), neighbors0.end(), other) || neighbor < other)
+                    push_candidate(neighbor, other);
+            }
+        }
+    }
+
+    mesh.positions.resize(vertices_count);
+    for (int k = 0; k < vertices_count; ++k)
+        mesh.positions[k] = LVecBase3f(float(positions[k][0]), float(positions[k][1]), float(positions[k][2]));
+
+    mesh.indices.clear();
+    for (int f = 0, f_end = int(faces.size()); f < f_end; ++f)
+    {
+        if (!face_removed[f])
+            mesh.indices.insert(mesh.indices.end(), faces[f].begin(), faces[f].end());
+    }
+
+    remove_unused_vertices(mesh);
+}
+
+// ************************************************************************************************
+inline uint64_t calc_mesh_cache_key(const TriangleMeshData& mesh, const MeshSimplifyOptions& options)
+{
+    uint64_t hash = TriangleMeshRegistry::calc_hash(mesh.positions.data(), mesh.get_vertices_count(),
+        mesh.indices.data(), mesh.get_faces_count());
+
+    const auto combine = [&hash](uint64_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    };
+
+    uint32_t bits;
+    std::memcpy(&bits, &options.weld_tolerance, sizeof(bits));
+    combine(bits);
+    combine(options.remove_degenerate ? 1 : 0);
+    combine(uint64_t(options.target_faces_count));
+    std::memcpy(&bits, &options.max_error, sizeof(bits));
+    combine(bits);
+
+    return hash;
+}
+
+namespace detail {
+static const char MESH_CACHE_MAGIC[4] = { 'R', 'P', 'F', 'M' };
+static const uint32_t MESH_CACHE_VERSION = 1;
+}
+
+inline bool load_triangle_mesh_cache(const Filename& path, TriangleMeshData& mesh)
+{
+    Filename file_path = path;
+    file_path.set_binary();
+
+    std::ifstream file;
+    if (!file_path.open_read(file))
+        return false;
+
+    char magic[4];
+    uint32_t version = 0;
+    int32_t vertices_count = 0;
+    int32_t faces_count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&vertices_count), sizeof(vertices_count));
+    file.read(reinterpret_cast<char*>(&faces_count), sizeof(faces_count));
+
+    if (!file || !std::equal(magic, magic + 4, detail::MESH_CACHE_MAGIC) || version != detail::MESH_CACHE_VERSION ||
+        vertices_count < 0 || faces_count < 0)
+    {
+        return false;
+    }
+
+    // reject corrupted counts before allocating
+    const std::streamoff header_size = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streamoff file_size = file.tellg();
+    file.seekg(header_size);
+    if (!file || file_size - header_size !=
+        std::streamoff(sizeof(LVecBase3f)) * vertices_count + std::streamoff(sizeof(int)) * 3 * faces_count)
+    {
+        return false;
+    }
+
+    TriangleMeshData cached;
+    cached.positions.resize(vertices_count);
+    cached.indices.resize(faces_count * 3);
+    file.read(reinterpret_cast<char*>(cached.positions.data()), sizeof(LVecBase3f) * cached.positions.size());
+    file.read(reinterpret_cast<char*>(cached.indices.data()), sizeof(int) * cached.indices.size());
+    if (!file)
+        return false;
+
+    for (int index: cached.indices)
+    {
+        if (index < 0 || index >= vertices_count)
+            return false;
+    }
+
+    cached.update_bounds();
+    mesh = std::move(cached);
+
+    return true;
+}
+
+inline bool save_triangle_mesh_cache(const Filename& path, const TriangleMeshData& mesh)
+{
+    Filename file_path = path;
+    file_path.set_binary();
+    file_path.make_dir();
+
+    std::ofstream file;
+    if (!file_path.open_write(file))
+        return false;
+
+    const int32_t vertices_count = mesh.get_vertices_count();
+    const int32_t faces_count = mesh.get_faces_count();
+    file.write(detail::MESH_CACHE_MAGIC, sizeof(detail::MESH_CACHE_MAGIC));
+    file.write(reinterpret_cast<const char*>(&detail::MESH_CACHE_VERSION), sizeof(detail::MESH_CACHE_VERSION));
+    file.write(reinterpret_cast<const char*>(&vertices_count), sizeof(vertices_count));
+    file.write(reinterpret_cast<const char*>(&faces_count), sizeof(faces_count));
+    file.write(reinterpret_cast<const char*>(mesh.positions.data()), sizeof(LVecBase3f) * mesh.positions.size());
+    file.write(reinterpret_cast<const char*>(mesh.indices.data()), sizeof(int) * faces_count * 3);
+
+    return bool(file);
+}
+
+inline void simplify_triangle_mesh(TriangleMeshData& mesh, const MeshSimplifyOptions& options)
+{
+    Filename cache_path;
+    if (!options.cache_directory.empty())
+    {
+        cache_path = Filename(options.cache_directory) / fmt::format("{:016x}.rpflexmesh", calc_mesh_cache_key(mesh, options));
+        if (load_triangle_mesh_cache(cache_path, mesh))
+            return;
+    }
+
+    const int faces_count = mesh.get_faces_count();
+
+    weld_vertices(mesh, options.weld_tolerance);
+
+    if (options.remove_degenerate)
+        remove_degenerate_triangles(mesh);
+
+    if (options.target_faces_count > 0 || options.max_error < FLT_MAX)
+        decimate_triangle_mesh(mesh, options.target_faces_count, options.max_error);
+
+    mesh.update_bounds();
+
+    rpcore::RPObject::global_debug(RPPLUGINS_ID_STRING,
+        fmt::format("Collision mesh is simplified from {} to {} triangles.", faces_count, mesh.get_faces_count()));
+
+    if (!cache_path.empty() && !save_triangle_mesh_cache(cache_path, mesh))
+    {
+        rpcore::RPObject::global_warn(RPPLUGINS_ID_STRING,
+            fmt::format("Failed to write collision mesh cache ({}).", cache_path.to_os_specific()));
+    }
+}
+
+}
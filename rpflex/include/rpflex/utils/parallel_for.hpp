@@ -0,0 +1,225 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rpflex {
+
+/**
+ * Persistent threads which run the tasks of parallel_for.
+ *
+ * A batch of tasks runs on the workers and the calling thread together.
+ * Only one batch runs at once, so nested calls (from tasks) and concurrent calls
+ * (from other threads) are rejected and the caller should run the tasks serially.
+ */
+class WorkerPool
+{
+public:
+    /** Get the pool shared by parallel_for. It has the number of hardware threads (including caller). */
+    static WorkerPool& get_global();
+
+    /** @param  workers_count   The number of threads except the calling thread. */
+    WorkerPool(int workers_count);
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool();
+
+    /** Get the number of threads running a batch, including the calling thread. */
+    int get_threads_count() const { return static_cast<int>(workers_.size()) + 1; }
+
+    /**
+     * Run @p task(index) for each index in [0, tasks_count) and wait for them.
+     *
+     * @return  false if the pool is used by other batch. Then, no task is run.
+     */
+    template <class Task>
+    bool run(int tasks_count, const Task& task);
+
+private:
+    using Invoker = void (*)(const void*, int);
+
+    /** Flag of the threads running a batch. */
+    static bool& in_batch();
+
+    bool run(int tasks_count, Invoker invoker, const void* task);
+    void work();
+    void process_tasks();
+
+    std::vector<std::thread> workers_;
+
+    std::mutex batch_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable done_cv_;
+
+    Invoker invoker_ = nullptr;
+    const void* task_ = nullptr;
+    int tasks_count_ = 0;
+    std::atomic<int> next_task_{0};
+    int running_workers_ = 0;
+    unsigned int generation_ = 0;
+    bool stop_ = false;
+};
+
+/**
+ * Run @p func(sub_begin, sub_end) for sub-ranges of [begin, end) in parallel.
+ *
+ * The range is split into at most the number of hardware threads, and each sub-range
+ * has at least @p grain_size elements. The sub-ranges run on the threads of WorkerPool
+ * and the calling thread. Small ranges and nested calls run on the calling thread.
+ */
+template <class Func>
+void parallel_for(int begin, int end, int grain_size, const Func& func);
+
+// ************************************************************************************************
+inline WorkerPool& WorkerPool::get_global()
+{
+    static WorkerPool pool(static_cast<int>((std::max)(1u, std::thread::hardware_concurrency())) - 1);
+    return pool;
+}
+
+inline WorkerPool::WorkerPool(int workers_count)
+{
+    workers_.reserve(workers_count);
+    for (int k = 0; k < workers_count; ++k)
+        workers_.emplace_back([this]() { work(); });
+}
+
+inline WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_cv_.notify_all();
+
+    for (auto&& worker: workers_)
+        worker.join();
+}
+
+template <class Task>
+bool WorkerPool::run(int tasks_count, const Task& task)
+{
+    return run(tasks_count, [](const void* task, int index) { (*static_cast<const Task*>(task))(index); }, &task);
+}
+
+inline bool& WorkerPool::in_batch()
+{
+    static thread_local bool flag = false;
+    return flag;
+}
+
+inline bool WorkerPool::run(int tasks_count, Invoker invoker, const void* task)
+{
+    if (in_batch())
+        return false;
+
+    std::unique_lock<std::mutex> batch_lock(batch_mutex_, std::try_to_lock);
+    if (!batch_lock.owns_lock())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        invoker_ = invoker;
+        task_ = task;
+        tasks_count_ = tasks_count;
+        next_task_ = 0;
+        running_workers_ = static_cast<int>(workers_.size());
+        ++generation_;
+    }
+    wake_cv_.notify_all();
+
+    in_batch() = true;
+    process_tasks();
+    in_batch() = false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return running_workers_ == 0; });
+
+    return true;
+}
+
+inline void WorkerPool::work()
+{
+    in_batch() = true;
+
+    unsigned int generation = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        wake_cv_.wait(lock, [&]() { return stop_ || generation_ != generation; });
+        if (stop_)
+            return;
+        generation = generation_;
+
+        lock.unlock();
+        process_tasks();
+        lock.lock();
+
+        if (--running_workers_ == 0)
+            done_cv_.notify_one();
+    }
+}
+
+inline void WorkerPool::process_tasks()
+{
+    for (int index = next_task_++; index < tasks_count_; index = next_task_++)
+        invoker_(task_, index);
+}
+
+template <class Func>
+void parallel_for(int begin, int end, int grain_size, const Func& func)
+{
+    const int count = end - begin;
+    if (count <= 0)
+        return;
+
+    auto& pool = WorkerPool::get_global();
+    const int tasks_count = (std::min)(pool.get_threads_count(), (count + grain_size - 1) / (std::max)(1, grain_size));
+
+    if (tasks_count <= 1)
+    {
+        func(begin, end);
+        return;
+    }
+
+    const int chunk_size = (count + tasks_count - 1) / tasks_count;
+    const bool ran = pool.run((count + chunk_size - 1) / chunk_size, [&](int index) {
+        const int sub_begin = begin + index * chunk_size;
+        func(sub_begin, (std::min)(end, sub_begin + chunk_size));
+    });
+
+    // the pool is busy by other batch
+    if (!ran)
+        func(begin, end);
+}
+
+}
@@ -0,0 +1,348 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <geomNode.h>
+#include <geomTriangles.h>
+#include <geomVertexWriter.h>
+#include <nodePath.h>
+#include <omniBoundingVolume.h>
+#include <texture.h>
+
+#include <render_pipeline/rpcore/render_pipeline.hpp>
+
+#include <rpflex/flex_buffer.hpp>
+#include <rpflex/instance_interface.hpp>
+#include <rpflex/plugin.hpp>
+
+namespace rpflex {
+
+/**
+ * Render particles of FlexBuffer by hardware instancing.
+ *
+ * Ranges of particles are found in sync_flex, and positions (and anisotropy) are copied to buffer textures
+ * with one memcpy per buffer in post_sync_flex of the main thread.
+ * All particles are drawn by one instanced draw call of a sphere.
+ * Add this to the plugin as an instance (ex, Plugin::add_instance).
+ */
+class RPFlexParticleRenderer : public InstanceInterface
+{
+public:
+    /**
+     * @param   particle_begin, particle_count  Range of particles to render.
+     *          If @p particle_count is negative, all active particles are rendered.
+     */
+    RPFlexParticleRenderer(rpcore::RenderPipeline& pipeline, Plugin& rpflex_plugin, NodePath parent,
+        int particle_begin=0, int particle_count=-1, int sphere_subdivisions=1);
+
+    void sync_flex(Plugin& rpflex_plugin) override;
+    void post_sync_flex(Plugin& rpflex_plugin) override;
+
+    /** Particles are only read, so this runs in parallel with other instances. */
+    BufferAccess get_buffer_access(const Plugin& rpflex_plugin) const override;
+
+    NodePath get_nodepath() const;
+
+    /** Radius of sphere. If it is negative, the radius of NvFlexParams is used. */
+    void set_particle_radius(float radius);
+    float get_particle_radius() const;
+
+    /**
+     * Render ellipsoids using anisotropy of particles instead of spheres.
+     * It enables Plugin::set_fluid_readback.
+     */
+    void set_anisotropy_enabled(bool enable);
+    bool get_anisotropy_enabled() const;
+
+    /** Create icosphere of radius 1 with normals. */
+    static PT(Geom) create_sphere_geom(int subdivisions);
+
+private:
+    template <class T>
+    static void upload_buffer_texture(Texture* tex, const T* data, int count, Texture::ComponentType component_type,
+        Texture::Format format);
+
+    NodePath nodepath_;
+
+    PT(Texture) positions_tex_;
+    PT(Texture) indices_tex_;
+    PT(Texture) anisotropy_tex_[3];
+
+    int particle_begin_;
+    int particle_count_;
+    float particle_radius_ = -1.0f;
+    bool anisotropy_enabled_ = false;
+
+    // found in sync_flex and applied in post_sync_flex
+    int upload_begin_ = 0;
+    int upload_count_ = 0;
+    int instance_count_ = 0;
+    float radius_ = 0.0f;
+};
+
+// ************************************************************************************************
+inline RPFlexParticleRenderer::RPFlexParticleRenderer(rpcore::RenderPipeline& pipeline, Plugin& rpflex_plugin,
+    NodePath parent, int particle_begin, int particle_count, int sphere_subdivisions):
+    particle_begin_(particle_begin), particle_count_(particle_count)
+{
+    PT(GeomNode) geom_node = new GeomNode("FlexParticles");
+    geom_node->add_geom(create_sphere_geom(sphere_subdivisions));
+
+    // particles can be anywhere in the scene
+    geom_node->set_bounds(new OmniBoundingVolume);
+    geom_node->set_final(true);
+
+    nodepath_ = parent.attach_new_node(geom_node);
+
+    // instancing is used only in GBuffer pass
+    pipeline.set_effect(nodepath_, rpflex_plugin.get_resource("effects/flex_particles.yaml"),
+        {{"render_shadow", false}, {"render_voxelize", false}});
+
+    positions_tex_ = new Texture("FlexPositions");
+    indices_tex_ = new Texture("FlexIndices");
+    anisotropy_tex_[0] = new Texture("FlexAnisotropy1");
+    anisotropy_tex_[1] = new Texture("FlexAnisotropy2");
+    anisotropy_tex_[2] = new Texture("FlexAnisotropy3");
+
+    positions_tex_->setup_buffer_texture(1, Texture::T_float, Texture::F_rgba32, GeomEnums::UH_dynamic);
+    indices_tex_->setup_buffer_texture(1, Texture::T_int, Texture::F_r32i, GeomEnums::UH_dynamic);
+    for (auto&& tex: anisotropy_tex_)
+        tex->setup_buffer_texture(1, Texture::T_float, Texture::F_rgba32, GeomEnums::UH_dynamic);
+
+    nodepath_.set_shader_input(ShaderInput("flex_positions", positions_tex_));
+    nodepath_.set_shader_input(ShaderInput("flex_indices", indices_tex_));
+    nodepath_.set_shader_input(ShaderInput("flex_anisotropy1", anisotropy_tex_[0]));
+    nodepath_.set_shader_input(ShaderInput("flex_anisotropy2", anisotropy_tex_[1]));
+    nodepath_.set_shader_input(ShaderInput("flex_anisotropy3", anisotropy_tex_[2]));
+    nodepath_.set_shader_input(ShaderInput("flex_render_flags", LVecBase2i(particle_count_ < 0, 0)));
+    nodepath_.set_shader_input(ShaderInput("flex_particle_radius",
+        LVecBase4f(static_cast<const Plugin&>(rpflex_plugin).get_flex_params().radius, 0, 0, 0)));
+
+    // nothing to draw until the first sync
+    nodepath_.hide();
+}
+
+inline void RPFlexParticleRenderer::sync_flex(Plugin& rpflex_plugin)
+{
+    const FlexBuffer& buffer = rpflex_plugin.get_flex_buffer();
+
+    if (particle_count_ < 0)
+    {
+        // indices refer to any particles, so all positions are needed
+        upload_begin_ = 0;
+        upload_count_ = buffer.positions.size();
+        instance_count_ = buffer.active_indices.size();
+    }
+    else
+    {
+        upload_begin_ = (std::min)(particle_begin_, buffer.positions.size());
+        upload_count_ = (std::min)(particle_count_, buffer.positions.size() - upload_begin_);
+        instance_count_ = upload_count_;
+    }
+
+    // this is serial (see get_buffer_access)
+    if (anisotropy_enabled_ && !rpflex_plugin.get_fluid_readback())
+        rpflex_plugin.set_fluid_readback(true);
+
+    radius_ = particle_radius_ < 0 ?
+        static_cast<const Plugin&>(rpflex_plugin).get_flex_params().radius : particle_radius_;
+}
+
+inline void RPFlexParticleRenderer::post_sync_flex(Plugin& rpflex_plugin)
+{
+    const FlexBuffer& buffer = rpflex_plugin.get_flex_buffer();
+
+    if (particle_count_ < 0)
+    {
+        upload_buffer_texture(indices_tex_, buffer.active_indices.mappedPtr, instance_count_,
+            Texture::T_int, Texture::F_r32i);
+    }
+
+    upload_buffer_texture(positions_tex_, buffer.positions.mappedPtr + upload_begin_, upload_count_,
+        Texture::T_float, Texture::F_rgba32);
+
+    if (anisotropy_enabled_)
+    {
+        upload_buffer_texture(anisotropy_tex_[0], buffer.anisotropy1.mappedPtr + upload_begin_, upload_count_,
+            Texture::T_float, Texture::F_rgba32);
+        upload_buffer_texture(anisotropy_tex_[1], buffer.anisotropy2.mappedPtr + upload_begin_, upload_count_,
+            Texture::T_float, Texture::F_rgba32);
+        upload_buffer_texture(anisotropy_tex_[2], buffer.anisotropy3.mappedPtr + upload_begin_, upload_count_,
+            Texture::T_float, Texture::F_rgba32);
+    }
+
+    nodepath_.set_shader_input(ShaderInput("flex_particle_radius", LVecBase4f(radius_, 0, 0, 0)));
+
+    // zero instance count means non-instanced drawing
+    if (instance_count_ > 0)
+    {
+        nodepath_.set_instance_count(instance_count_);
+        nodepath_.show();
+    }
+    else
+    {
+        nodepath_.hide();
+    }
+}
+
+inline InstanceInterface::BufferAccess RPFlexParticleRenderer::get_buffer_access(const Plugin& rpflex_plugin) const
+{
+    BufferAccess access;
+
+    // enabling readback changes the plugin
+    access.parallel = !anisotropy_enabled_ || rpflex_plugin.get_fluid_readback();
+
+    access.particles = ACCESS_READ;
+    if (particle_count_ < 0)
+    {
+        access.particle_end = rpflex_plugin.get_flex_buffer().positions.size();
+    }
+    else
+    {
+        access.particle_begin = particle_begin_;
+        access.particle_end = particle_begin_ + particle_count_;
+    }
+
+    return access;
+}
+
+inline NodePath RPFlexParticleRenderer::get_nodepath() const
+{
+    return nodepath_;
+}
+
+inline void RPFlexParticleRenderer::set_particle_radius(float radius)
+{
+    particle_radius_ = radius;
+}
+
+inline float RPFlexParticleRenderer::get_particle_radius() const
+{
+    return particle_radius_;
+}
+
+inline void RPFlexParticleRenderer::set_anisotropy_enabled(bool enable)
+{
+    anisotropy_enabled_ = enable;
+    nodepath_.set_shader_input(ShaderInput("flex_render_flags", LVecBase2i(particle_count_ < 0, enable)));
+}
+
+inline bool RPFlexParticleRenderer::get_anisotropy_enabled() const
+{
+    return anisotropy_enabled_;
+}
+
+inline PT(Geom) RPFlexParticleRenderer::create_sphere_geom(int subdivisions)
+{
+    // icosahedron
+    const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+    std::vector<LVecBase3f> vertices = {
+        {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+        {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+        {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1},
+    };
+    std::vector<int> indices = {
+        0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+        1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+        3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+        4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1,
+    };
+    for (auto& v: vertices)
+        v.normalize();
+
+    for (int level = 0; level < subdivisions; ++level)
+    {
+        std::map<std::pair<int, int>, int> midpoints;
+        auto get_midpoint = [&](int a, int b) {
+            const auto key = std::make_pair((std::min)(a, b), (std::max)(a, b));
+            auto found = midpoints.find(key);
+            if (found != midpoints.end())
+                return found->second;
+
+            LVecBase3f v = vertices[a] + vertices[b];
+            v.normalize();
+            vertices.push_back(v);
+            return midpoints[key] = int(vertices.size()) - 1;
+        };
+
+        std::vector<int> new_indices;
+        new_indices.reserve(indices.size() * 4);
+        for (size_t k = 0, k_end = indices.size(); k < k_end; k += 3)
+        {
+            const int a = indices[k];
+            const int b = indices[k+1];
+            const int c = indices[k+2];
+            const int ab = get_midpoint(a, b);
+            const int bc = get_midpoint(b, c);
+            const int ca = get_midpoint(c, a);
+            new_indices.insert(new_indices.end(), {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca});
+        }
+        indices.swap(new_indices);
+    }
+
+    PT(GeomVertexData) vdata = new GeomVertexData("FlexParticleSphere", GeomVertexFormat::get_v3n3(), GeomEnums::UH_static);
+    vdata->unclean_set_num_rows(int(vertices.size()));
+
+    GeomVertexWriter vertex_writer(vdata, InternalName::get_vertex());
+    GeomVertexWriter normal_writer(vdata, InternalName::get_normal());
+    for (const auto& v: vertices)
+    {
+        vertex_writer.add_data3f(v);
+        normal_writer.add_data3f(v);
+    }
+
+    // triangles are counter-clockwise when seen from outside
+    PT(GeomTriangles) prim = new GeomTriangles(GeomEnums::UH_static);
+    prim->reserve_num_vertices(int(indices.size()));
+    for (size_t k = 0, k_end = indices.size(); k < k_end; k += 3)
+        prim->add_vertices(indices[k], indices[k+1], indices[k+2]);
+
+    PT(Geom) geom = new Geom(vdata);
+    geom->add_primitive(prim);
+
+    return geom;
+}
+
+template <class T>
+inline void RPFlexParticleRenderer::upload_buffer_texture(Texture* tex, const T* data, int count,
+    Texture::ComponentType component_type, Texture::Format format)
+{
+    if (count <= 0)
+        return;
+
+    // reallocate only when the size is changed
+    if (tex->get_x_size() != count)
+        tex->setup_buffer_texture(count, component_type, format, GeomEnums::UH_dynamic);
+
+    std::memcpy(tex->modify_ram_image().p(), data, sizeof(T) * count);
+}
+
+}
@@ -0,0 +1,364 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include <luse.h>
+
+#include <rpflex/utils/geom_extractor.hpp>
+#include <rpflex/utils/parallel_for.hpp>
+
+namespace rpflex {
+
+/**
+ * Signed distance field in a cubic grid.
+ *
+ * Distances are sampled at the centers of cells, and are negative inside of the mesh.
+ * Cells are stored in x, y and z order (x is the fastest).
+ */
+struct SignedDistanceField
+{
+    int get_index(int x, int y, int z) const;
+
+    /** Get the distance at @p position using trilinear interpolation. */
+    float sample(const LPoint3f& position) const;
+
+    int dimension = 0;                  ///< The number of cells on each axis.
+    float edge_length = 0.0f;           ///< The length of the cube.
+    LPoint3f origin = LPoint3f(0.0f);   ///< The lower corner of the cube.
+    std::vector<float> distances;
+};
+
+/**
+ * Build signed distance field of the mesh.
+ *
+ * Exact distances are calculated near triangles, and propagated to other cells by jump flooding
+ * of the closest surface points. Signs are found by ray parity along x-axis, so the mesh should be closed.
+ * Slices of the grid are processed in parallel.
+ *
+ * @param   dimension   The number of cells on each axis.
+ * @param   padding     The number of cells between the bounds of mesh and the cube.
+ */
+bool build_signed_distance_field(const TriangleMeshData& mesh, int dimension, SignedDistanceField& sdf, int padding=2);
+
+/** Find the closest point on the triangle (a, b, c) from @p p. */
+LVecBase3f closest_point_on_triangle(const LVecBase3f& p, const LVecBase3f& a, const LVecBase3f& b, const LVecBase3f& c);
+
+// ************************************************************************************************
+inline int SignedDistanceField::get_index(int x, int y, int z) const
+{
+    return (z * dimension + y) * dimension + x;
+}
+
+inline float SignedDistanceField::sample(const LPoint3f& position) const
+{
+    const float cell_size = edge_length / dimension;
+
+    float coords[3];
+    int cells[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float coord = (std::max)(0.0f, (std::min)(float(dimension - 1), (position[axis] - origin[axis]) / cell_size - 0.5f));
+        cells[axis] = (std::min)(dimension - 2, int(coord));
+        coords[axis] = coord - cells[axis];
+    }
+
+    float result = 0.0f;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const int dx = corner & 1;
+        const int dy = (corner >> 1) & 1;
+        const int dz = (corner >> 2) & 1;
+        const float weight =
+            (dx ? coords[0] : 1.0f - coords[0]) *
+            (dy ? coords[1] : 1.0f - coords[1]) *
+            (dz ? coords[2] : 1.0f - coords[2]);
+        result += weight * distances[get_index(cells[0] + dx, cells[1] + dy, cells[2] + dz)];
+    }
+
+    return result;
+}
+
+inline LVecBase3f closest_point_on_triangle(const LVecBase3f& p, const LVecBase3f& a, const LVecBase3f& b, const LVecBase3f& c)
+{
+    // Real-Time Collision Detection (Ericson), 5.1.5
+    const LVecBase3f ab = b - a;
+    const LVecBase3f ac = c - a;
+    const LVecBase3f ap = p - a;
+    const float d1 = ab.dot(ap);
+    const float d2 = ac.dot(ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return a;
+
+    const LVecBase3f bp = p - b;
+    const float d3 = ab.dot(bp);
+    const float d4 = ac.dot(bp);
+    if (d3 >= 0.0f && d4 <= d3)
+        return b;
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return a + ab * (d1 / (d1 - d3));
+
+    const LVecBase3f cp = p - c;
+    const float d5 = ab.dot(cp);
+    const float d6 = ac.dot(cp);
+    if (d6 >= 0.0f && d5 <= d6)
+        return c;
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return a + ac * (d2 / (d2 - d6));
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    const float denom = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+inline bool build_signed_distance_field(const TriangleMeshData& mesh, int dimension, SignedDistanceField& sdf, int padding)
+{
+    sdf = SignedDistanceField();
+
+    if (mesh.indices.empty() || dimension <= 2 * padding + 1)
+        return false;
+
+    const LVecBase3f extent = mesh.upper - mesh.lower;
+    const float max_extent = (std::max)((std::max)(extent[0], extent[1]), (std::max)(extent[2], 1e-6f));
+    const float cell_size = max_extent / (dimension - 2 * padding);
+
+    sdf.dimension = dimension;
+    sdf.edge_length = cell_size * dimension;
+    sdf.origin = (mesh.lower + mesh.upper) * 0.5f - LVecBase3f(sdf.edge_length * 0.5f);
+
+    const int faces_count = mesh.get_faces_count();
+    const int cells_count = dimension * dimension * dimension;
+    const float inv_cell_size = 1.0f / cell_size;
+    const LPoint3f origin = sdf.origin;
+
+    const auto cell_center = [&](int x, int y, int z) {
+        return LVecBase3f(origin[0] + (x + 0.5f) * cell_size, origin[1] + (y + 0.5f) * cell_size, origin[2] + (z + 0.5f) * cell_size);
+    };
+
+    const auto to_cell = [&](float value, int axis) {
+        return (value - origin[axis]) * inv_cell_size - 0.5f;
+    };
+
+    // cell ranges of triangles expanded by one cell
+    std::vector<LVecBase3i> range_lower(faces_count);
+    std::vector<LVecBase3i> range_upper(faces_count);
+    std::vector<std::vector<int>> slice_faces(dimension);
+    for (int f = 0; f < faces_count; ++f)
+    {
+        const LVecBase3f& a = mesh.positions[mesh.indices[f*3]];
+        const LVecBase3f& b = mesh.positions[mesh.indices[f*3+1]];
+        const LVecBase3f& c = mesh.positions[mesh.indices[f*3+2]];
+        const LVecBase3f lower = a.fmin(b).fmin(c);
+        const LVecBase3f upper = a.fmax(b).fmax(c);
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            range_lower[f][axis] = (std::max)(0, int(std::floor(to_cell(lower[axis], axis))) - 1);
+            range_upper[f][axis] = (std::min)(dimension - 1, int(std::ceil(to_cell(upper[axis], axis))) + 1);
+        }
+
+        for (int z = range_lower[f][2]; z <= range_upper[f][2]; ++z)
+            slice_faces[z].push_back(f);
+    }
+
+    // exact closest points near triangles
+    std::vector<LVecBase3f> closest_points(cells_count, LVecBase3f(FLT_MAX));
+    std::vector<float> closest_distances(cells_count, FLT_MAX);
+    parallel_for(0, dimension, 1, [&](int z_begin, int z_end) {
+        for (int z = z_begin; z < z_end; ++z)
+        {
+            for (int f: slice_faces[z])
+            {
+                const LVecBase3f& a = mesh.positions[mesh.indices[f*3]];
+                const LVecBase3f& b = mesh.positions[mesh.indices[f*3+1]];
+                const LVecBase3f& c = mesh.positions[mesh.indices[f*3+2]];
+
+                for (int y = range_lower[f][1]; y <= range_upper[f][1]; ++y)
+                {
+                    for (int x = range_lower[f][0]; x <= range_upper[f][0]; ++x)
+                    {
+                        const LVecBase3f center = cell_center(x, y, z);
+                        const LVecBase3f point = closest_point_on_triangle(center, a, b, c);
+                        const float distance_sq = (point - center).length_squared();
+
+                        const int index = sdf.get_index(x, y, z);
+                        if (distance_sq < closest_distances[index])
+                        {
+                            closest_distances[index] = distance_sq;
+                            closest_points[index] = point;
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    // propagate closest points by jump flooding with additional pass of step 1
+    std::vector<int> steps;
+    for (int step = dimension / 2; step >= 1; step /= 2)
+        steps.push_back(step);
+    steps.push_back(1);
+
+    std::vector<LVecBase3f> next_points(cells_count);
+    std::vector<float> next_distances(cells_count);
+    for (int step: steps)
+    {
+        parallel_for(0, dimension, 1, [&](int z_begin, int z_end) {
+            for (int z = z_begin; z < z_end; ++z)
+            {
+                for (int y = 0; y < dimension; ++y)
+                {
+                    for (int x = 0; x < dimension; ++x)
+                    {
+                        const int index = sdf.get_index(x, y, z);
+                        const LVecBase3f center = cell_center(x, y, z);
+
+                        LVecBase3f best_point = closest_points[index];
+                        float best_distance = closest_distances[index];
+
+                        for (int dz = -step; dz <= step; dz += step)
+                        {
+                            const int nz = z + dz;
+                            if (nz < 0 || nz >= dimension)
+                                continue;
+                            for (int dy = -step; dy <= step; dy += step)
+                            {
+                                const int ny = y + dy;
+                                if (ny < 0 || ny >= dimension)
+                                    continue;
+                                for (int dx = -step; dx <= step; dx += step)
+                                {
+                                    const int nx = x + dx;
+                                    if (nx < 0 || nx >= dimension)
+                                        continue;
+
+                                    const int neighbor = sdf.get_index(nx, ny, nz);
+                                    if (closest_distances[neighbor] == FLT_MAX)
+                                        continue;
+
+                                    const float distance_sq = (closest_points[neighbor] - center).length_squared();
+                                    if (distance_sq < best_distance)
+                                    {
+                                        best_distance = distance_sq;
+                                        best_point = closest_points[neighbor];
+                                    }
+                                }
+                            }
+                        }
+
+                        next_points[index] = best_point;
+                        next_distances[index] = best_distance;
+                    }
+                }
+            }
+        });
+
+        closest_points.swap(next_points);
+        closest_distances.swap(next_distances);
+    }
+
+    // signs by parity of intersections along +x
+    sdf.distances.resize(cells_count);
+    parallel_for(0, dimension, 1, [&](int z_begin, int z_end) {
+        // x and facing direction of intersections
+        std::vector<std::pair<float, bool>> intersections;
+        std::vector<float> crossings;
+        for (int z = z_begin; z < z_end; ++z)
+        {
+            const float pz = origin[2] + (z + 0.5f) * cell_size;
+            for (int y = 0; y < dimension; ++y)
+            {
+                const float py = origin[1] + (y + 0.5f) * cell_size;
+
+                intersections.clear();
+                for (int f: slice_faces[z])
+                {
+                    if (y < range_lower[f][1] || y > range_upper[f][1])
+                        continue;
+
+                    const LVecBase3f& a = mesh.positions[mesh.indices[f*3]];
+                    const LVecBase3f& b = mesh.positions[mesh.indices[f*3+1]];
+                    const LVecBase3f& c = mesh.positions[mesh.indices[f*3+2]];
+
+                    // barycentric coordinates in yz-plane
+                    const float det = (b[1] - a[1]) * (c[2] - a[2]) - (c[1] - a[1]) * (b[2] - a[2]);
+                    if (det == 0.0f)
+                        continue;
+
+                    const float u = ((py - a[1]) * (c[2] - a[2]) - (c[1] - a[1]) * (pz - a[2])) / det;
+                    const float v = ((b[1] - a[1]) * (pz - a[2]) - (py - a[1]) * (b[2] - a[2])) / det;
+                    if (u < 0.0f || v < 0.0f || u + v > 1.0f)
+                        continue;
+
+                    intersections.push_back({ a[0] + u * (b[0] - a[0]) + v * (c[0] - a[0]), det > 0.0f });
+                }
+                std::sort(intersections.begin(), intersections.end());
+
+                // a ray through a shared edge hits both triangles.
+                // it crosses the surface once if they face the same direction, otherwise it grazes.
+                crossings.clear();
+                for (size_t k = 0; k < intersections.size(); ++k)
+                {
+                    if (k + 1 < intersections.size() &&
+                        intersections[k+1].first - intersections[k].first <= 1e-5f * sdf.edge_length)
+                    {
+                        if (intersections[k].second == intersections[k+1].second)
+                            crossings.push_back(intersections[k].first);
+                        ++k;
+                        continue;
+                    }
+                    crossings.push_back(intersections[k].first);
+                }
+
+                size_t crossed = 0;
+                for (int x = 0; x < dimension; ++x)
+                {
+                    const float px = origin[0] + (x + 0.5f) * cell_size;
+                    while (crossed < crossings.size() && crossings[crossed] < px)
+                        ++crossed;
+
+                    const int index = sdf.get_index(x, y, z);
+                    const float distance = std::sqrt(closest_distances[index]);
+                    sdf.distances[index] = (crossed % 2) ? -distance : distance;
+                }
+            }
+        }
+    });
+
+    return true;
+}
+
+}
@@ -37,7 +37,8 @@ public:
     int get_shape_flag(const FlexBuffer& buffer) const;
 
     NvFlexCollisionShapeType get_collision_shape_type(const FlexBuffer& buffer) const;
-    const LQuaternionf& get_prev_rotation(const FlexBuffer& buffer) const;
+    /** Get the previous rotation in Panda3D order. */
+    LQuaternionf get_prev_rotation(const FlexBuffer& buffer) const;
     const LVecBase4f& get_prev_position(const FlexBuffer& buffer) const;
     const NvFlexCollisionGeometry& get_collision_geometry(const FlexBuffer& buffer) const;
 
@@ -63,9 +64,9 @@ inline NvFlexCollisionShapeType RPFlexShape::get_collision_shape_type(const Flex
     return NvFlexCollisionShapeType(get_shape_flag(buffer) & eNvFlexShapeFlagTypeMask);
 }
 
-inline const LQuaternionf& RPFlexShape::get_prev_rotation(const FlexBuffer& buffer) const
+inline LQuaternionf RPFlexShape::get_prev_rotation(const FlexBuffer& buffer) const
 {
-    return buffer.shape_prev_rotations[shape_buffer_index_];
+    return from_flex_quat(buffer.shape_prev_rotations[shape_buffer_index_]);
 }
 
 inline const LVecBase4f& RPFlexShape::get_prev_position(const FlexBuffer& buffer) const
@@ -82,7 +83,7 @@ inline LMatrix4f RPFlexShape::get_transform(const FlexBuffer& buffer) const
 {
     // render with prev positions to match particle update order
     // can also think of this as current/next
-    const LQuaternionf& rotation = get_prev_rotation(buffer);
+    const LQuaternionf rotation = get_prev_rotation(buffer);
     const LVecBase3f& position = get_prev_position(buffer).get_xyz();
 
     const NvFlexCollisionGeometry& geo = get_collision_geometry(buffer);
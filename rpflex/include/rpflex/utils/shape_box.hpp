@@ -32,6 +32,7 @@ namespace rpflex {
 class RPFlexShapeBox : public RPFlexShape
 {
 public:
+    /** @param   quat    Rotation in Panda3D order. */
     RPFlexShapeBox(Plugin& rpflex_plugin, const LVecBase3f& half_edge=LVecBase3f(2.0f), const LVecBase3f& center=LVecBase3f(0.0f),
         const LQuaternionf& quat=LQuaternionf::ident_quat(), bool dynamic=false);
 };
@@ -44,7 +45,7 @@ inline RPFlexShapeBox::RPFlexShapeBox(Plugin& rpflex_plugin, const LVecBase3f& h
     shape_buffer_index_ = buffer.shape_positions.size();
 
     buffer.shape_positions.push_back(LVecBase4f(center, 0.0f));
-    buffer.shape_rotations.push_back(quat);
+    buffer.shape_rotations.push_back(to_flex_quat(quat));
 
     buffer.shape_prev_positions.push_back(buffer.shape_positions.back());
     buffer.shape_prev_rotations.push_back(buffer.shape_rotations.back());
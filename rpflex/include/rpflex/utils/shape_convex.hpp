@@ -0,0 +1,135 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <nodePath.h>
+
+#include <render_pipeline/rpcore/globals.hpp>
+
+#include <rpflex/plugin.hpp>
+#include <rpflex/utils/convex_decomposition.hpp>
+#include <rpflex/utils/convex_hull.hpp>
+#include <rpflex/utils/shape.hpp>
+
+namespace rpflex {
+
+class RPFlexShapeConvex : public RPFlexShape
+{
+public:
+    static NvFlexConvexMeshId create_flex_convex_mesh(Plugin& rpflex_plugin, const ConvexHull& hull);
+
+    /**
+     * Decompose all Geoms in the subtree of @p nodepath into convex parts,
+     * and add a convex shape for each part.
+     */
+    static std::vector<RPFlexShapeConvex> create_convex_shapes(Plugin& rpflex_plugin, NodePath nodepath,
+        const ConvexDecompositionOptions& options=ConvexDecompositionOptions(), bool dynamic=false);
+
+    /** @param   rotation    Rotation in Panda3D order. */
+    RPFlexShapeConvex(Plugin& rpflex_plugin, const ConvexHull& hull, const LPoint3f& translation,
+        const LQuaternionf& rotation, const LVecBase3f& scale=LVecBase3f(1.0f), bool dynamic=false);
+
+    NvFlexConvexMeshId get_convex_mesh_id(const FlexBuffer& buffer) const;
+};
+
+// ************************************************************************************************
+inline NvFlexConvexMeshId RPFlexShapeConvex::create_flex_convex_mesh(Plugin& rpflex_plugin, const ConvexHull& hull)
+{
+    auto flex_library = rpflex_plugin.get_flex_library();
+
+    // CPU solver does not collide with convex meshes
+    if (!flex_library)
+        return 0;
+
+    NvFlexVector<LVecBase4f> planes(flex_library);
+    planes.assign(hull.planes.data(), hull.planes.size());
+    planes.unmap();
+
+    NvFlexConvexMeshId flex_convex = NvFlexCreateConvexMesh(flex_library);
+    NvFlexUpdateConvexMesh(flex_library, flex_convex, planes.buffer, int(hull.planes.size()),
+        hull.lower.get_data(), hull.upper.get_data());
+
+    return flex_convex;
+}
+
+inline std::vector<RPFlexShapeConvex> RPFlexShapeConvex::create_convex_shapes(Plugin& rpflex_plugin, NodePath nodepath,
+    const ConvexDecompositionOptions& options, bool dynamic)
+{
+    std::vector<RPFlexShapeConvex> shapes;
+
+    TriangleMeshData mesh;
+    if (!extract_triangle_mesh(nodepath, mesh))
+        return shapes;
+
+    std::vector<ConvexHull> hulls;
+    if (!decompose_convex(mesh, options, hulls))
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING,
+            fmt::format("Failed to decompose NodePath ({}) into convex parts.", nodepath.get_name()));
+        return shapes;
+    }
+
+    const LPoint3f translation = nodepath.get_pos(rpcore::Globals::render);
+    const LQuaternionf rotation = nodepath.get_quat(rpcore::Globals::render);
+    const LVecBase3f scale = nodepath.get_scale(rpcore::Globals::render);
+
+    shapes.reserve(hulls.size());
+    for (const auto& hull: hulls)
+        shapes.emplace_back(rpflex_plugin, hull, translation, rotation, scale, dynamic);
+
+    return shapes;
+}
+
+inline RPFlexShapeConvex::RPFlexShapeConvex(Plugin& rpflex_plugin, const ConvexHull& hull, const LPoint3f& translation,
+    const LQuaternionf& rotation, const LVecBase3f& scale, bool dynamic)
+{
+    auto& buffer = rpflex_plugin.get_flex_buffer();
+
+    NvFlexCollisionGeometry geo;
+    geo.convexMesh.mesh = create_flex_convex_mesh(rpflex_plugin, hull);
+    geo.convexMesh.scale[0] = scale[0];
+    geo.convexMesh.scale[1] = scale[1];
+    geo.convexMesh.scale[2] = scale[2];
+
+    const LQuaternionf flex_rotation = to_flex_quat(rotation);
+
+    shape_buffer_index_ = buffer.shape_positions.size();
+
+    buffer.shape_positions.push_back(LVecBase4f(translation, 0.0f));
+    buffer.shape_rotations.push_back(flex_rotation);
+    buffer.shape_prev_positions.push_back(LVecBase4f(translation, 0.0f));
+    buffer.shape_prev_rotations.push_back(flex_rotation);
+    buffer.shape_geometry.push_back(geo);
+    buffer.shape_flags.push_back(NvFlexMakeShapeFlags(eNvFlexShapeConvexMesh, dynamic));
+}
+
+inline NvFlexConvexMeshId RPFlexShapeConvex::get_convex_mesh_id(const FlexBuffer& buffer) const
+{
+    return buffer.shape_geometry[shape_buffer_index_].convexMesh.mesh;
+}
+
+}
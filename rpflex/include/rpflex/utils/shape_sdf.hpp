@@ -0,0 +1,147 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <nodePath.h>
+
+#include <render_pipeline/rpcore/globals.hpp>
+
+#include <rpflex/plugin.hpp>
+#include <rpflex/utils/geom_extractor.hpp>
+#include <rpflex/utils/sdf_builder.hpp>
+#include <rpflex/utils/shape.hpp>
+
+namespace rpflex {
+
+class RPFlexShapeSDF : public RPFlexShape
+{
+public:
+    /** Upload the field normalized by the edge length, because Flex samples it in [0, 1]. */
+    static NvFlexDistanceFieldId create_flex_distance_field(Plugin& rpflex_plugin, const SignedDistanceField& sdf);
+
+    /**
+     * @param   translation     Position of the space where @p sdf is built.
+     * @param   rotation        Rotation (Panda3D order) of the space where @p sdf is built.
+     */
+    RPFlexShapeSDF(Plugin& rpflex_plugin, const SignedDistanceField& sdf,
+        const LPoint3f& translation, const LQuaternionf& rotation, bool dynamic=false);
+
+    /**
+     * Build SDF from all Geoms in the subtree of @p nodepath.
+     * The scale of @p nodepath is applied to the field because Flex supports only uniform scale of SDF.
+     */
+    RPFlexShapeSDF(Plugin& rpflex_plugin, NodePath nodepath, int dimension=64, bool dynamic=false);
+
+    NvFlexDistanceFieldId get_distance_field_id(const FlexBuffer& buffer) const;
+
+private:
+    void initialize(Plugin& rpflex_plugin, const SignedDistanceField& sdf,
+        const LPoint3f& translation, const LQuaternionf& rotation, bool dynamic);
+};
+
+// ************************************************************************************************
+inline NvFlexDistanceFieldId RPFlexShapeSDF::create_flex_distance_field(Plugin& rpflex_plugin, const SignedDistanceField& sdf)
+{
+    auto flex_library = rpflex_plugin.get_flex_library();
+
+    // CPU solver does not collide with SDF
+    if (!flex_library)
+        return 0;
+
+    NvFlexVector<float> field(flex_library);
+    field.resize(sdf.distances.size());
+
+    const float inv_edge_length = 1.0f / sdf.edge_length;
+    for (size_t k = 0, k_end = sdf.distances.size(); k < k_end; ++k)
+        field[k] = sdf.distances[k] * inv_edge_length;
+
+    field.unmap();
+
+    NvFlexDistanceFieldId flex_sdf = NvFlexCreateDistanceField(flex_library);
+    NvFlexUpdateDistanceField(flex_library, flex_sdf, sdf.dimension, sdf.dimension, sdf.dimension, field.buffer);
+
+    return flex_sdf;
+}
+
+inline RPFlexShapeSDF::RPFlexShapeSDF(Plugin& rpflex_plugin, const SignedDistanceField& sdf,
+    const LPoint3f& translation, const LQuaternionf& rotation, bool dynamic)
+{
+    initialize(rpflex_plugin, sdf, translation, rotation, dynamic);
+}
+
+inline RPFlexShapeSDF::RPFlexShapeSDF(Plugin& rpflex_plugin, NodePath nodepath, int dimension, bool dynamic)
+{
+    TriangleMeshData mesh;
+    if (!extract_triangle_mesh(nodepath, mesh))
+        return;
+
+    const LVecBase3f scale = nodepath.get_scale(rpcore::Globals::render);
+    for (auto& position: mesh.positions)
+        position = position.componentwise_mult(scale);
+    mesh.update_bounds();
+
+    SignedDistanceField sdf;
+    if (!build_signed_distance_field(mesh, dimension, sdf))
+    {
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING,
+            fmt::format("Failed to build SDF of NodePath ({}).", nodepath.get_name()));
+        return;
+    }
+
+    initialize(rpflex_plugin, sdf,
+        nodepath.get_pos(rpcore::Globals::render),
+        nodepath.get_quat(rpcore::Globals::render),
+        dynamic);
+}
+
+inline NvFlexDistanceFieldId RPFlexShapeSDF::get_distance_field_id(const FlexBuffer& buffer) const
+{
+    return buffer.shape_geometry[shape_buffer_index_].sdf.field;
+}
+
+inline void RPFlexShapeSDF::initialize(Plugin& rpflex_plugin, const SignedDistanceField& sdf,
+    const LPoint3f& translation, const LQuaternionf& rotation, bool dynamic)
+{
+    auto& buffer = rpflex_plugin.get_flex_buffer();
+
+    NvFlexCollisionGeometry geo;
+    geo.sdf.field = create_flex_distance_field(rpflex_plugin, sdf);
+    geo.sdf.scale = sdf.edge_length;
+
+    // origin of SDF is the lower corner of the cube
+    const LVecBase3f position = translation + rotation.xform(sdf.origin);
+    const LQuaternionf flex_rotation = to_flex_quat(rotation);
+
+    shape_buffer_index_ = buffer.shape_positions.size();
+
+    buffer.shape_positions.push_back(LVecBase4f(position, 0.0f));
+    buffer.shape_rotations.push_back(flex_rotation);
+    buffer.shape_prev_positions.push_back(LVecBase4f(position, 0.0f));
+    buffer.shape_prev_rotations.push_back(flex_rotation);
+    buffer.shape_geometry.push_back(geo);
+    buffer.shape_flags.push_back(NvFlexMakeShapeFlags(eNvFlexShapeSDF, dynamic));
+}
+
+}
@@ -25,15 +25,13 @@
 #pragma once
 
 #include <nodePath.h>
-#include <geomNode.h>
-#include <geomVertexReader.h>
 
-#include <fmt/format.h>
-
-#include <render_pipeline/rpcore/rpobject.hpp>
 #include <render_pipeline/rpcore/globals.hpp>
 
 #include <rpflex/plugin.hpp>
+#include <rpflex/triangle_mesh_registry.hpp>
+#include <rpflex/utils/geom_extractor.hpp>
+#include <rpflex/utils/mesh_simplifier.hpp>
 #include <rpflex/utils/shape.hpp>
 
 namespace rpflex {
@@ -41,16 +39,20 @@ namespace rpflex {
 class RPFlexTriangleMesh : public RPFlexShape
 {
 public:
-    static NvFlexTriangleMeshId create_flex_triangle_mesh(Plugin& rpflex_plugin, const LPoint3f& lower, const LPoint3f& upper,
-        const std::vector<LVecBase3f>& positions, const std::vector<int>& indices,
-        int vertices_count, int faces_count);
-
+    /** @param   rotation    Rotation in Panda3D order. */
     RPFlexTriangleMesh(Plugin& rpflex_plugin, const LPoint3f& lower, const LPoint3f& upper,
         const std::vector<LVecBase3f>& positions, const std::vector<int>& indices,
         int vertices_count, int faces_count, const LPoint3f& translation, const LQuaternionf& rotation, const LVecBase3f& scale);
 
+    /** Create a triangle mesh from all Geoms in the subtree of @p geom_nodepath. */
     RPFlexTriangleMesh(Plugin& rpflex_plugin, NodePath geom_nodepath);
 
+    /**
+     * Create a triangle mesh from all Geoms in the subtree of @p geom_nodepath,
+     * and simplify it by @p options. The simplified mesh is used for collision only.
+     */
+    RPFlexTriangleMesh(Plugin& rpflex_plugin, NodePath geom_nodepath, const MeshSimplifyOptions& options);
+
     NvFlexTriangleMeshId get_triangle_mesh_id(const FlexBuffer& buffer) const;
 
 private:
@@ -60,28 +62,6 @@ private:
 };
 
 // ************************************************************************************************
-inline NvFlexTriangleMeshId RPFlexTriangleMesh::create_flex_triangle_mesh(Plugin& rpflex_plugin, const LPoint3f& lower, const LPoint3f& upper,
-    const std::vector<LVecBase3f>& positions, const std::vector<int>& indices,
-    int vertices_count, int faces_count)
-{
-    auto flex_library = rpflex_plugin.get_flex_library();
-
-    NvFlexVector<LVecBase3f> flex_positions(flex_library);
-    NvFlexVector<int> flex_indices(flex_library);
-
-    flex_positions.assign(positions.data(), positions.size());
-    flex_indices.assign(indices.data(), indices.size());
-
-    flex_positions.unmap();
-    flex_indices.unmap();
-
-    NvFlexTriangleMeshId flex_mesh = NvFlexCreateTriangleMesh(flex_library);
-    NvFlexUpdateTriangleMesh(flex_library, flex_mesh, flex_positions.buffer, flex_indices.buffer,
-        vertices_count, faces_count, lower.get_data(), upper.get_data());
-
-    return flex_mesh;
-}
-
 inline RPFlexTriangleMesh::RPFlexTriangleMesh(Plugin& rpflex_plugin, const LPoint3f& lower, const LPoint3f& upper,
     const std::vector<LVecBase3f>& positions, const std::vector<int>& indices, int vertices_count, int faces_count,
     const LPoint3f& translation, const LQuaternionf& rotation, const LVecBase3f& scale)
@@ -92,58 +72,34 @@ inline RPFlexTriangleMesh::RPFlexTriangleMesh(Plugin& rpflex_plugin, const LPoin
 
 inline RPFlexTriangleMesh::RPFlexTriangleMesh(Plugin& rpflex_plugin, NodePath geom_nodepath)
 {
-    if (geom_nodepath.is_empty() || !geom_nodepath.node()->is_geom_node())
-    {
-        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING,
-            fmt::format("NodePath ({}) is empty OR is NOT GeomNode.", geom_nodepath.get_name()));
+    TriangleMeshData mesh;
+    if (!extract_triangle_mesh(geom_nodepath, mesh))
         return;
-    }
 
-    PT(GeomNode) geom_node = DCAST(GeomNode, geom_nodepath.node());
+    initilize(rpflex_plugin, mesh.lower, mesh.upper, mesh.positions, mesh.indices,
+        mesh.get_vertices_count(), mesh.get_faces_count(),
+        geom_nodepath.get_pos(rpcore::Globals::render),
+        geom_nodepath.get_quat(rpcore::Globals::render),
+        geom_nodepath.get_scale(rpcore::Globals::render));
+}
 
-    if (geom_node->get_num_geoms() != 1)
-    {
-        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING,
-            fmt::format("GeomNode ({}) has NOT only 1 geom.", geom_nodepath.get_name()));
+inline RPFlexTriangleMesh::RPFlexTriangleMesh(Plugin& rpflex_plugin, NodePath geom_nodepath, const MeshSimplifyOptions& options)
+{
+    TriangleMeshData mesh;
+    if (!extract_triangle_mesh(geom_nodepath, mesh, false))
         return;
-    }
-
-    CPT(Geom) geom = geom_node->get_geom(0);
-
-    LPoint3f lower;
-    LPoint3f upper;
-    bool found = false;
-    geom->calc_tight_bounds(lower, upper, found, Thread::get_current_thread());
-
-    CPT(GeomVertexData) vdata = geom->get_vertex_data();
 
-    GeomVertexReader vertex(vdata, "vertex");
+    simplify_triangle_mesh(mesh, options);
 
-    const int vertices_count = vdata->get_num_rows();
-    std::vector<LVecBase3f> positions;
-    positions.reserve(vertices_count);
-    for (int k = 0; k < vertices_count; ++k)
-        positions.push_back(vertex.get_data3f());
-
-    std::vector<int> indices;
-    indices.reserve(geom->get_num_primitives());
-    for (int index=0, index_end=geom->get_num_primitives(); index < index_end; ++index)
+    if (mesh.indices.empty())
     {
-        const auto& primitive = geom->get_primitive(index);
-
-        if (primitive->get_num_vertices_per_primitive() != 3)
-        {
-            rpcore::RPObject::global_error(RPPLUGINS_ID_STRING,
-                fmt::format("Geom (in {}) has non-triangle primitive.", geom_nodepath.get_name()));
-            return;
-        }
-
-        indices.reserve(indices.size() + primitive->get_num_vertices());
-        for (int k=0, k_end=primitive->get_num_vertices(); k < k_end; ++k)
-            indices.push_back(primitive->get_vertex(k));
+        rpcore::RPObject::global_error(RPPLUGINS_ID_STRING,
+            fmt::format("Simplified mesh of NodePath ({}) has NO triangle.", geom_nodepath.get_name()));
+        return;
     }
 
-    initilize(rpflex_plugin, lower, upper, positions, indices, vertices_count, int(indices.size()),
+    initilize(rpflex_plugin, mesh.lower, mesh.upper, mesh.positions, mesh.indices,
+        mesh.get_vertices_count(), mesh.get_faces_count(),
         geom_nodepath.get_pos(rpcore::Globals::render),
         geom_nodepath.get_quat(rpcore::Globals::render),
         geom_nodepath.get_scale(rpcore::Globals::render));
@@ -158,11 +114,13 @@ inline void RPFlexTriangleMesh::initilize(Plugin& rpflex_plugin, const LPoint3f&
     const std::vector<LVecBase3f>& positions, const std::vector<int>& indices, int vertices_count, int faces_count,
     const LPoint3f& translation, const LQuaternionf& rotation, const LVecBase3f& scale)
 {
-    auto flex_library = rpflex_plugin.get_flex_library();
     auto& buffer = rpflex_plugin.get_flex_buffer();
+    const LQuaternionf flex_rotation = to_flex_quat(rotation);
 
     NvFlexCollisionGeometry geo;
-    geo.triMesh.mesh = create_flex_triangle_mesh(rpflex_plugin, lower, upper, positions, indices, vertices_count, faces_count);
+    // share the mesh with other shapes having the same data
+    geo.triMesh.mesh = rpflex_plugin.get_triangle_mesh_registry().acquire(lower, upper,
+        positions.data(), vertices_count, indices.data(), faces_count);
     geo.triMesh.scale[0] = scale[0];
     geo.triMesh.scale[1] = scale[1];
     geo.triMesh.scale[2] = scale[2];
@@ -170,9 +128,9 @@ inline void RPFlexTriangleMesh::initilize(Plugin& rpflex_plugin, const LPoint3f&
     shape_buffer_index_ = buffer.shape_positions.size();
 
     buffer.shape_positions.push_back(LVecBase4f(translation, 0.0f));
-    buffer.shape_rotations.push_back(rotation);
+    buffer.shape_rotations.push_back(flex_rotation);
     buffer.shape_prev_positions.push_back(LVecBase4f(translation, 0.0f));
-    buffer.shape_prev_rotations.push_back(rotation);
+    buffer.shape_prev_rotations.push_back(flex_rotation);
     buffer.shape_geometry.push_back((NvFlexCollisionGeometry&)geo);
     buffer.shape_flags.push_back(NvFlexMakeShapeFlags(eNvFlexShapeTriangleMesh, false));
 }
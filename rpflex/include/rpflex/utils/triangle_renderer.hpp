@@ -0,0 +1,200 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <geom.h>
+#include <geomNode.h>
+#include <geomTriangles.h>
+#include <geomVertexArrayFormat.h>
+#include <geomVertexData.h>
+#include <geomVertexFormat.h>
+#include <internalName.h>
+#include <nodePath.h>
+#include <omniBoundingVolume.h>
+
+#include <rpflex/flex_buffer.hpp>
+#include <rpflex/instance_interface.hpp>
+#include <rpflex/plugin.hpp>
+
+namespace rpflex {
+
+/**
+ * Render dynamic triangles of a contiguous range of particles.
+ *
+ * Vertex arrays have the same layout as FlexBuffer::positions and FlexBuffer::normals
+ * (float3 with the stride of float4), so each array is refreshed by one contiguous copy
+ * per frame without per-vertex writes. The copy is done in post_sync_flex of the main
+ * thread. Normals are read back from solver when the plugin has dynamic triangles.
+ *
+ * Add this to the plugin as an instance, or call sync_flex and post_sync_flex from
+ * the instance owning the particles.
+ */
+class RPFlexTriangleRenderer : public InstanceInterface
+{
+public:
+    /**
+     * @param   indices     3 indices per triangle relative to @p particle_begin.
+     */
+    RPFlexTriangleRenderer(NodePath parent, const std::vector<int>& indices, int particles_count, int particle_begin=0);
+
+    void sync_flex(Plugin& rpflex_plugin) override;
+    void post_sync_flex(Plugin& rpflex_plugin) override;
+
+    /** Particles are only read, so this runs in parallel with other instances. */
+    BufferAccess get_buffer_access(const Plugin& rpflex_plugin) const override;
+
+    NodePath get_nodepath() const;
+
+    void set_particle_begin(int particle_begin);
+    int get_particle_begin() const;
+
+    int get_particles_count() const;
+
+    /** Get the format whose arrays match LVecBase4f positions and normals of Flex. */
+    static CPT(GeomVertexFormat) get_vertex_format();
+
+private:
+    NodePath nodepath_;
+    PT(GeomVertexData) vdata_;
+
+    int particle_begin_;
+    int particles_count_;
+
+    bool visible_ = false;      ///< Found in sync_flex and applied in post_sync_flex.
+};
+
+// ************************************************************************************************
+inline RPFlexTriangleRenderer::RPFlexTriangleRenderer(NodePath parent, const std::vector<int>& indices,
+    int particles_count, int particle_begin): particle_begin_(particle_begin), particles_count_(particles_count)
+{
+    // vertices are overwritten in every frame
+    vdata_ = new GeomVertexData("FlexTriangles", get_vertex_format(), GeomEnums::UH_stream);
+    vdata_->unclean_set_num_rows(particles_count_);
+
+    PT(GeomTriangles) prim = new GeomTriangles(GeomEnums::UH_static);
+    for (const int index: indices)
+        prim->add_vertex(index);
+    prim->close_primitive();
+
+    PT(Geom) geom = new Geom(vdata_);
+    geom->add_primitive(prim);
+
+    PT(GeomNode) geom_node = new GeomNode("FlexTriangles");
+    geom_node->add_geom(geom);
+
+    // particles can be anywhere in the scene
+    geom_node->set_bounds(new OmniBoundingVolume);
+    geom_node->set_final(true);
+
+    nodepath_ = parent.attach_new_node(geom_node);
+    nodepath_.set_two_sided(true);
+
+    // nothing to draw until the first sync
+    nodepath_.hide();
+}
+
+inline void RPFlexTriangleRenderer::sync_flex(Plugin& rpflex_plugin)
+{
+    const FlexBuffer& buffer = rpflex_plugin.get_flex_buffer();
+
+    const int available = (std::min)(buffer.positions.size(), buffer.normals.size()) - particle_begin_;
+    visible_ = available >= particles_count_;
+}
+
+inline void RPFlexTriangleRenderer::post_sync_flex(Plugin& rpflex_plugin)
+{
+    if (!visible_)
+    {
+        nodepath_.hide();
+        return;
+    }
+
+    const FlexBuffer& buffer = rpflex_plugin.get_flex_buffer();
+
+    const size_t size = particles_count_ * sizeof(LVecBase4f);
+    vdata_->modify_array_handle(0)->copy_data_from(
+        reinterpret_cast<const unsigned char*>(buffer.positions.mappedPtr + particle_begin_), size);
+    vdata_->modify_array_handle(1)->copy_data_from(
+        reinterpret_cast<const unsigned char*>(buffer.normals.mappedPtr + particle_begin_), size);
+
+    nodepath_.show();
+}
+
+inline InstanceInterface::BufferAccess RPFlexTriangleRenderer::get_buffer_access(const Plugin& rpflex_plugin) const
+{
+    BufferAccess access;
+    access.parallel = true;
+    access.particles = ACCESS_READ;
+    access.particle_begin = particle_begin_;
+    access.particle_end = particle_begin_ + particles_count_;
+    return access;
+}
+
+inline NodePath RPFlexTriangleRenderer::get_nodepath() const
+{
+    return nodepath_;
+}
+
+inline void RPFlexTriangleRenderer::set_particle_begin(int particle_begin)
+{
+    particle_begin_ = particle_begin;
+}
+
+inline int RPFlexTriangleRenderer::get_particle_begin() const
+{
+    return particle_begin_;
+}
+
+inline int RPFlexTriangleRenderer::get_particles_count() const
+{
+    return particles_count_;
+}
+
+inline CPT(GeomVertexFormat) RPFlexTriangleRenderer::get_vertex_format()
+{
+    static CPT(GeomVertexFormat) format;
+    if (format)
+        return format;
+
+    PT(GeomVertexArrayFormat) position_array = new GeomVertexArrayFormat;
+    position_array->add_column(InternalName::get_vertex(), 3, GeomEnums::NT_float32, GeomEnums::C_point);
+    position_array->set_stride(sizeof(LVecBase4f));
+
+    PT(GeomVertexArrayFormat) normal_array = new GeomVertexArrayFormat;
+    normal_array->add_column(InternalName::get_normal(), 3, GeomEnums::NT_float32, GeomEnums::C_normal);
+    normal_array->set_stride(sizeof(LVecBase4f));
+
+    PT(GeomVertexFormat) new_format = new GeomVertexFormat;
+    new_format->add_array(position_array);
+    new_format->add_array(normal_array);
+    format = GeomVertexFormat::register_format(new_format);
+
+    return format;
+}
+
+}
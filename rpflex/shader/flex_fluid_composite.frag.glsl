@@ -0,0 +1,192 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#version 430
+
+// Shade fluid surface from smoothed depth and composite it into the scene.
+
+#define USE_GBUFFER_EXTENSIONS
+#pragma include "render_pipeline_base.inc.glsl"
+#pragma include "includes/gbuffer.inc.glsl"
+
+#define FLUID_ABSORPTION GET_SETTING(rpflex, fluid_absorption)
+#define FLUID_REFRACTION GET_SETTING(rpflex, fluid_refraction)
+
+// absorption per unit thickness (water absorbs red light more)
+const vec3 FLUID_ABSORPTION_COLOR = vec3(0.45, 0.12, 0.05);
+const vec3 FLUID_REFLECTION_COLOR = vec3(0.5, 0.6, 0.7);
+const vec3 FLUID_LIGHT_DIRECTION = vec3(0.3, -0.4, 0.866);
+
+#if STEREO_MODE
+uniform sampler2DArray ShadedScene;
+uniform sampler2DArray FluidDepth;
+uniform sampler2DArray FluidSmoothDepth;
+#else
+uniform sampler2D ShadedScene;
+uniform sampler2D FluidDepth;
+uniform sampler2D FluidSmoothDepth;
+#endif
+
+uniform mat4 flex_view_mat;
+uniform mat4 flex_inv_proj_mats[2];
+
+out vec4 result;
+
+#if STEREO_MODE
+#define FETCH_LAYER(tex, coord) texelFetch(tex, ivec3(coord, gl_Layer), 0)
+#define SAMPLE_LAYER(tex, texcoord) textureLod(tex, vec3(texcoord, gl_Layer), 0)
+#define EYE gl_Layer
+#else
+#define FETCH_LAYER(tex, coord) texelFetch(tex, coord, 0)
+#define SAMPLE_LAYER(tex, texcoord) textureLod(tex, texcoord, 0)
+#define EYE 0
+#endif
+
+/**
+ * Get smoothed depth at full resolution.
+ * When smoothed depth is in lower resolution, the nearest texel to the splatted depth is used.
+ */
+float get_smooth_depth(ivec2 coord)
+{
+    const float raw_depth = FETCH_LAYER(FluidDepth, coord).x;
+    if (raw_depth <= 0)
+        return 0;
+
+    const ivec2 smooth_size = textureSize(FluidSmoothDepth, 0).xy;
+    const ivec2 scale = textureSize(FluidDepth, 0).xy / smooth_size;
+    if (scale.x <= 1)
+        return FETCH_LAYER(FluidSmoothDepth, coord).x;
+
+    const ivec2 base_coord = coord / scale;
+    float best_depth = raw_depth;
+    float best_diff = 1e20;
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            const float depth = FETCH_LAYER(FluidSmoothDepth, clamp(base_coord + ivec2(x, y), ivec2(0), smooth_size - 1)).x;
+            const float diff = abs(depth - raw_depth);
+            if (depth > 0 && diff < best_diff)
+            {
+                best_depth = depth;
+                best_diff = diff;
+            }
+        }
+    }
+    return best_depth;
+}
+
+/** Get view position on the ray of @p ndc whose linear depth (+Y) is @p depth. */
+vec3 get_view_position(vec2 ndc, float depth)
+{
+    vec4 ray_begin = flex_inv_proj_mats[EYE] * vec4(ndc, -1, 1);
+    vec4 ray_end = flex_inv_proj_mats[EYE] * vec4(ndc, 1, 1);
+    ray_begin.xyz /= ray_begin.w;
+    ray_end.xyz /= ray_end.w;
+    const vec3 ray_dir = ray_end.xyz - ray_begin.xyz;
+    return ray_begin.xyz + ray_dir * ((depth - ray_begin.y) / ray_dir.y);
+}
+
+vec3 get_neighbor_view_position(ivec2 coord, vec2 pixel_size)
+{
+    const float depth = get_smooth_depth(coord);
+    if (depth <= 0)
+        return vec3(0);
+    return get_view_position(fma((vec2(coord) + 0.5) * pixel_size, vec2(2), vec2(-1)), depth);
+}
+
+/** Choose smaller difference to avoid artifacts at discontinuities. */
+vec3 get_position_derivative(vec3 center, vec3 forward, vec3 backward)
+{
+    const vec3 forward_diff = forward - center;
+    const vec3 backward_diff = center - backward;
+    if (forward.y <= 0)
+        return backward_diff;
+    if (backward.y <= 0)
+        return forward_diff;
+    return abs(forward_diff.y) < abs(backward_diff.y) ? forward_diff : backward_diff;
+}
+
+void main()
+{
+    const vec2 texcoord = get_texcoord();
+    const ivec2 coord = ivec2(gl_FragCoord.xy);
+    const vec3 scene_color = SAMPLE_LAYER(ShadedScene, texcoord).xyz;
+
+    const float depth = get_smooth_depth(coord);
+    if (depth <= 0)
+    {
+        result = vec4(scene_color, 1);
+        return;
+    }
+
+#if STEREO_MODE
+    const vec3 scene_position = calculate_surface_pos(get_depth_at(texcoord, gl_Layer), texcoord, gl_Layer);
+#else
+    const vec3 scene_position = calculate_surface_pos(get_depth_at(texcoord), texcoord);
+#endif
+    const float scene_depth = (flex_view_mat * vec4(scene_position, 1)).y;
+
+    // fluid is occluded by the scene
+    if (depth >= scene_depth)
+    {
+        result = vec4(scene_color, 1);
+        return;
+    }
+
+    const vec2 pixel_size = 1.0 / vec2(textureSize(FluidDepth, 0).xy);
+    const vec2 ndc = fma(texcoord, vec2(2), vec2(-1));
+    const vec3 position = get_view_position(ndc, depth);
+
+    const vec3 dx = get_position_derivative(position,
+        get_neighbor_view_position(coord + ivec2(1, 0), pixel_size),
+        get_neighbor_view_position(coord - ivec2(1, 0), pixel_size));
+    const vec3 dy = get_position_derivative(position,
+        get_neighbor_view_position(coord + ivec2(0, 1), pixel_size),
+        get_neighbor_view_position(coord - ivec2(0, 1), pixel_size));
+
+    // screen x and y are +X and +Z in view space
+    const vec3 normal = normalize(cross(dx, dy));
+    const vec3 view_dir = -normalize(position - get_view_position(ndc, 0));
+
+    // refraction and absorption by thickness
+    const float thickness = scene_depth - depth;
+    const vec2 refracted_texcoord = clamp(texcoord + normal.xz * FLUID_REFRACTION, vec2(0), vec2(1));
+    const vec3 refracted_color = SAMPLE_LAYER(ShadedScene, refracted_texcoord).xyz;
+    const vec3 transmittance = exp(-FLUID_ABSORPTION_COLOR * FLUID_ABSORPTION * thickness);
+
+    // Schlick approximation with F0 of water
+    const float n_dot_v = clamp(dot(normal, view_dir), 0, 1);
+    const float fresnel = 0.02 + 0.98 * pow(1 - n_dot_v, 5);
+
+    const vec3 light_dir = normalize(mat3(flex_view_mat) * FLUID_LIGHT_DIRECTION);
+    const float specular = pow(clamp(dot(normal, normalize(light_dir + view_dir)), 0, 1), 256);
+
+    // no environment is available here, so reflection follows the brightness of the scene
+    const float scene_luminance = dot(scene_color, vec3(0.2126, 0.7152, 0.0722));
+    const vec3 reflection = FLUID_REFLECTION_COLOR * (scene_luminance + 0.1);
+
+    const vec3 color = mix(refracted_color * transmittance, reflection, fresnel) + specular;
+    result = vec4(color, 1);
+}
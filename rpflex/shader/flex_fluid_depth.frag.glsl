@@ -0,0 +1,74 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#version 430
+
+#pragma include "render_pipeline_base.inc.glsl"
+
+// Intersect the ray of fragment with particle ellipsoid and write its linear depth.
+
+in vec3 view_position;
+flat in vec3 ellipsoid_center;
+flat in mat3 ellipsoid_inv_axes;
+flat in int eye;
+
+uniform mat4 flex_proj_mats[2];
+uniform mat4 flex_inv_proj_mats[2];
+
+out vec4 result;
+
+void main()
+{
+    // ray from near plane to far plane in view space
+    const vec2 ndc = fma(gl_FragCoord.xy / SCREEN_SIZE, vec2(2), vec2(-1));
+    vec4 ray_begin = flex_inv_proj_mats[eye] * vec4(ndc, -1, 1);
+    vec4 ray_end = flex_inv_proj_mats[eye] * vec4(ndc, 1, 1);
+    ray_begin.xyz /= ray_begin.w;
+    ray_end.xyz /= ray_end.w;
+    const vec3 ray_dir = ray_end.xyz - ray_begin.xyz;
+
+    // in the space of unit sphere: |o + t * d| = 1
+    const vec3 o = ellipsoid_inv_axes * (ray_begin.xyz - ellipsoid_center);
+    const vec3 d = ellipsoid_inv_axes * ray_dir;
+    const float a = dot(d, d);
+    const float b = dot(o, d);
+    const float c = dot(o, o) - 1;
+    const float discriminant = b * b - a * c;
+    if (discriminant < 0)
+        discard;
+
+    const float sqrt_discriminant = sqrt(discriminant);
+    if (-b + sqrt_discriminant < 0)
+        discard;
+
+    // near plane can be in the ellipsoid
+    const float t = max((-b - sqrt_discriminant) / a, 0);
+    const vec3 hit = ray_begin.xyz + ray_dir * t;
+
+    const vec4 hit_clip = flex_proj_mats[eye] * vec4(hit, 1);
+    gl_FragDepth = fma(hit_clip.z / hit_clip.w, 0.5, 0.5);
+
+    // view space of Panda3D looks at +Y
+    result = vec4(hit.y, 0, 0, 1);
+}
@@ -0,0 +1,96 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#version 430
+
+#pragma include "render_pipeline_base.inc.glsl"
+
+#if STEREO_MODE
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+
+// Draw the box of a particle ellipsoid. The ellipsoid is intersected in fragment shader.
+
+in vec4 p3d_Vertex;
+
+uniform samplerBuffer flex_positions;
+uniform samplerBuffer flex_anisotropy1;
+uniform samplerBuffer flex_anisotropy2;
+uniform samplerBuffer flex_anisotropy3;
+uniform isamplerBuffer flex_phases;
+uniform isamplerBuffer flex_indices;
+
+// x: phase flag of fluid, y: use anisotropy
+uniform ivec4 flex_splat_flags;
+uniform float flex_particle_radius;
+
+uniform mat4 flex_view_mat;
+uniform mat4 flex_proj_mats[2];
+
+out vec3 view_position;
+flat out vec3 ellipsoid_center;
+flat out mat3 ellipsoid_inv_axes;
+flat out int eye;
+
+void main()
+{
+#if STEREO_MODE
+    eye = gl_InstanceID & 1;
+    const int instance = gl_InstanceID >> 1;
+    gl_Layer = eye;
+#else
+    eye = 0;
+    const int instance = gl_InstanceID;
+#endif
+
+    const int index = texelFetch(flex_indices, instance).x;
+    if ((texelFetch(flex_phases, index).x & flex_splat_flags.x) == 0)
+    {
+        // degenerate triangles are not rasterized
+        gl_Position = vec4(0, 0, 0, 1);
+        return;
+    }
+
+    mat3 axes;
+    if (flex_splat_flags.y != 0)
+    {
+        // anisotropy has axes (xyz) and scales (w) of ellipsoid
+        const vec4 q1 = texelFetch(flex_anisotropy1, index);
+        const vec4 q2 = texelFetch(flex_anisotropy2, index);
+        const vec4 q3 = texelFetch(flex_anisotropy3, index);
+        axes = mat3(q1.xyz * max(q1.w, 1e-5), q2.xyz * max(q2.w, 1e-5), q3.xyz * max(q3.w, 1e-5));
+    }
+    else
+    {
+        axes = mat3(flex_particle_radius);
+    }
+
+    const mat3 view_axes = mat3(flex_view_mat) * axes;
+
+    ellipsoid_center = (flex_view_mat * vec4(texelFetch(flex_positions, index).xyz, 1)).xyz;
+    ellipsoid_inv_axes = inverse(view_axes);
+    view_position = ellipsoid_center + view_axes * p3d_Vertex.xyz;
+
+    gl_Position = flex_proj_mats[eye] * vec4(view_position, 1);
+}
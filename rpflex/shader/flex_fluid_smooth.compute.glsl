@@ -0,0 +1,101 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#version 430
+
+#pragma include "render_pipeline_base.inc.glsl"
+#pragma include "flex_fluid_smooth.inc.glsl"
+
+// One direction of separable bilateral filter.
+// A work group caches a part of one row (or column) with its borders in shared memory.
+
+#define GROUP_SIZE 128
+#define MAX_RADIUS 32
+
+layout(local_size_x = GROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+#if STEREO_MODE
+uniform sampler2DArray SourceDepth;
+layout(r32f) uniform writeonly image2DArray DestDepth;
+#else
+uniform sampler2D SourceDepth;
+layout(r32f) uniform writeonly image2D DestDepth;
+#endif
+
+// xy: direction
+uniform ivec4 smooth_params;
+
+shared float line_cache[GROUP_SIZE + 2 * MAX_RADIUS];
+
+float fetch_depth(ivec2 coord, int layer)
+{
+    coord = clamp(coord, ivec2(0), textureSize(SourceDepth, 0).xy - 1);
+#if STEREO_MODE
+    return texelFetch(SourceDepth, ivec3(coord, layer), 0).x;
+#else
+    return texelFetch(SourceDepth, coord, 0).x;
+#endif
+}
+
+void main()
+{
+    const int radius = min(FLUID_SMOOTHING_RADIUS, MAX_RADIUS);
+    const ivec2 direction = smooth_params.xy;
+    const ivec2 line_direction = direction.yx;
+    const int line = int(gl_WorkGroupID.y);
+    const int layer = int(gl_WorkGroupID.z);
+    const int group_begin = int(gl_WorkGroupID.x) * GROUP_SIZE;
+    const int local_index = int(gl_LocalInvocationID.x);
+
+    for (int k = local_index; k < GROUP_SIZE + 2 * radius; k += GROUP_SIZE)
+        line_cache[k] = fetch_depth(direction * (group_begin + k - radius) + line_direction * line, layer);
+
+    barrier();
+
+    const ivec2 coord = direction * (group_begin + local_index) + line_direction * line;
+    if (any(greaterThanEqual(coord, textureSize(SourceDepth, 0).xy)))
+        return;
+
+    const float center_depth = line_cache[local_index + radius];
+    float result = 0;
+    if (center_depth > 0)
+    {
+        float depth_sum = 0;
+        float weight_sum = 0;
+        for (int k = -radius; k <= radius; ++k)
+        {
+            const float sample_depth = line_cache[local_index + radius + k];
+            const float weight = get_fluid_smoothing_weight(center_depth, sample_depth, k);
+            depth_sum += sample_depth * weight;
+            weight_sum += weight;
+        }
+        result = depth_sum / weight_sum;
+    }
+
+#if STEREO_MODE
+    imageStore(DestDepth, ivec3(coord, layer), vec4(result));
+#else
+    imageStore(DestDepth, coord, vec4(result));
+#endif
+}
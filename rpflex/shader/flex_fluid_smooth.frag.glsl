@@ -0,0 +1,76 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#version 430
+
+#pragma include "render_pipeline_base.inc.glsl"
+#pragma include "flex_fluid_smooth.inc.glsl"
+
+// One direction of separable bilateral filter.
+
+#if STEREO_MODE
+uniform sampler2DArray SourceDepth;
+#else
+uniform sampler2D SourceDepth;
+#endif
+
+// xy: direction, z: scale from this target to source
+uniform ivec4 smooth_params;
+
+out vec4 result;
+
+float fetch_depth(ivec2 coord)
+{
+    coord = clamp(coord, ivec2(0), textureSize(SourceDepth, 0).xy - 1);
+#if STEREO_MODE
+    return texelFetch(SourceDepth, ivec3(coord, gl_Layer), 0).x;
+#else
+    return texelFetch(SourceDepth, coord, 0).x;
+#endif
+}
+
+void main()
+{
+    const ivec2 coord = ivec2(gl_FragCoord.xy) * smooth_params.z;
+    const ivec2 sample_step = smooth_params.xy * smooth_params.z;
+
+    const float center_depth = fetch_depth(coord);
+    if (center_depth <= 0)
+    {
+        result = vec4(0);
+        return;
+    }
+
+    float depth_sum = 0;
+    float weight_sum = 0;
+    for (int k = -FLUID_SMOOTHING_RADIUS; k <= FLUID_SMOOTHING_RADIUS; ++k)
+    {
+        const float sample_depth = fetch_depth(coord + sample_step * k);
+        const float weight = get_fluid_smoothing_weight(center_depth, sample_depth, k);
+        depth_sum += sample_depth * weight;
+        weight_sum += weight;
+    }
+
+    result = vec4(depth_sum / weight_sum, 0, 0, 1);
+}
@@ -0,0 +1,39 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Bilateral weights for smoothing of fluid depth
+
+#define FLUID_SMOOTHING_RADIUS GET_SETTING(rpflex, fluid_smoothing_radius)
+#define FLUID_DEPTH_FALLOFF GET_SETTING(rpflex, fluid_depth_falloff)
+
+/** Zero depth is empty and does not contribute. */
+float get_fluid_smoothing_weight(float center_depth, float sample_depth, int offset)
+{
+    if (sample_depth <= 0)
+        return 0;
+
+    const float sigma = max(FLUID_SMOOTHING_RADIUS * 0.5, 1.0);
+    const float dz = (sample_depth - center_depth) / FLUID_DEPTH_FALLOFF;
+    return exp(-float(offset * offset) / (2 * sigma * sigma) - dz * dz);
+}
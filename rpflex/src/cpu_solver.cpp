@@ -0,0 +1,709 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cpu_solver.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "rpflex/utils/parallel_for.hpp"
+
+namespace rpflex {
+
+static const int GRAIN_SIZE = 1024;
+
+/** Rotate @p v by quaternion @p q in Flex order. */
+static LVecBase3f rotate(const LQuaternionf& q, const LVecBase3f& v)
+{
+    const LVecBase3f u(q[0], q[1], q[2]);
+    const float s = q[3];
+    return u * (2.0f * u.dot(v)) + v * (s * s - u.dot(u)) + u.cross(v) * (2.0f * s);
+}
+
+static LVecBase3f inverse_rotate(const LQuaternionf& q, const LVecBase3f& v)
+{
+    return rotate(LQuaternionf(-q[0], -q[1], -q[2], q[3]), v);
+}
+
+/** Multiply quaternions in Flex order. */
+static LQuaternionf multiply(const LQuaternionf& a, const LQuaternionf& b)
+{
+    return LQuaternionf(
+        a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1],
+        a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0],
+        a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3],
+        a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2]);
+}
+
+static int hash_cell(int ix, int iy, int iz, int mask)
+{
+    return static_cast<int>((unsigned(ix) * 73856093u) ^ (unsigned(iy) * 19349663u) ^ (unsigned(iz) * 83492791u)) & mask;
+}
+
+// ************************************************************************************************
+
+CpuSolver::CpuSolver(int max_particles): max_particles_(max_particles)
+{
+    std::memset(&params_, 0, sizeof(params_));
+    params_.numIterations = 3;
+    params_.relaxationFactor = 1.0f;
+    params_.maxSpeed = FLT_MAX;
+
+    for (auto* vec: { &x_, &y_, &z_, &inv_mass_, &vx_, &vy_, &vz_, &px_, &py_, &pz_, &dx_, &dy_, &dz_ })
+        vec->resize(max_particles, 0.0f);
+    delta_counts_.resize(max_particles, 0);
+    phases_.resize(max_particles, 0);
+    spring_offsets_.resize(max_particles + 1, 0);
+}
+
+int CpuSolver::get_max_particles() const
+{
+    return max_particles_;
+}
+
+void CpuSolver::set_params(const NvFlexParams& params)
+{
+    params_ = params;
+}
+
+void CpuSolver::set_particles(const LVecBase4f* positions, int count)
+{
+    count = (std::min)(count, max_particles_);
+    for (int k = 0; k < count; ++k)
+    {
+        x_[k] = positions[k][0];
+        y_[k] = positions[k][1];
+        z_[k] = positions[k][2];
+        inv_mass_[k] = positions[k][3];
+    }
+}
+
+void CpuSolver::get_particles(LVecBase4f* positions, int count) const
+{
+    count = (std::min)(count, max_particles_);
+    for (int k = 0; k < count; ++k)
+        positions[k] = LVecBase4f(x_[k], y_[k], z_[k], inv_mass_[k]);
+}
+
+void CpuSolver::set_velocities(const LVecBase3f* velocities, int count)
+{
+    count = (std::min)(count, max_particles_);
+    for (int k = 0; k < count; ++k)
+    {
+        vx_[k] = velocities[k][0];
+        vy_[k] = velocities[k][1];
+        vz_[k] = velocities[k][2];
+    }
+}
+
+void CpuSolver::get_velocities(LVecBase3f* velocities, int count) const
+{
+    count = (std::min)(count, max_particles_);
+    for (int k = 0; k < count; ++k)
+        velocities[k] = LVecBase3f(vx_[k], vy_[k], vz_[k]);
+}
+
+void CpuSolver::set_phases(const int* phases, int count)
+{
+    std::copy(phases, phases + (std::min)(count, max_particles_), phases_.begin());
+}
+
+void CpuSolver::set_active(const int* indices, int count)
+{
+    active_.clear();
+    active_.reserve(count);
+    for (int k = 0; k < count; ++k)
+    {
+        if (0 <= indices[k] && indices[k] < max_particles_)
+            active_.push_back(indices[k]);
+    }
+}
+
+void CpuSolver::set_springs(const int* indices, const float* lengths, const float* stiffness, int count)
+{
+    // store each spring in both particles to project springs per particle
+    std::fill(spring_offsets_.begin(), spring_offsets_.end(), 0);
+    for (int k = 0; k < count; ++k)
+    {
+        if (stiffness[k] <= 0.0f)
+            continue;
+        ++spring_offsets_[indices[k * 2] + 1];
+        ++spring_offsets_[indices[k * 2 + 1] + 1];
+    }
+
+    for (int k = 0; k < max_particles_; ++k)
+        spring_offsets_[k + 1] += spring_offsets_[k];
+
+    const int entries_count = spring_offsets_[max_particles_];
+    spring_others_.resize(entries_count);
+    spring_lengths_.resize(entries_count);
+    spring_stiffness_.resize(entries_count);
+
+    std::vector<int> cursors(spring_offsets_.begin(), spring_offsets_.end() - 1);
+    for (int k = 0; k < count; ++k)
+    {
+        if (stiffness[k] <= 0.0f)
+            continue;
+
+        const int a = indices[k * 2];
+        const int b = indices[k * 2 + 1];
+        for (const auto& pair: { std::make_pair(a, b), std::make_pair(b, a) })
+        {
+            const int entry = cursors[pair.first]++;
+            spring_others_[entry] = pair.second;
+            spring_lengths_[entry] = lengths[k];
+            spring_stiffness_[entry] = stiffness[k];
+        }
+    }
+}
+
+void CpuSolver::set_rigids(const int* offsets, const int* indices, const LVecBase3f* local_positions,
+    const float* coefficients, const LQuaternionf* rotations, const LVecBase3f* translations, int rigids_count)
+{
+    if (rigids_count <= 0)
+    {
+        rigid_offsets_.clear();
+        rigid_indices_.clear();
+        rigid_local_positions_.clear();
+        rigid_coefficients_.clear();
+        rigid_rotations_.clear();
+        rigid_translations_.clear();
+        return;
+    }
+
+    const int indices_count = offsets[rigids_count];
+    rigid_offsets_.assign(offsets, offsets + rigids_count + 1);
+    rigid_indices_.assign(indices, indices + indices_count);
+    rigid_local_positions_.assign(local_positions, local_positions + indices_count);
+    rigid_coefficients_.assign(coefficients, coefficients + rigids_count);
+    rigid_rotations_.assign(rotations, rotations + rigids_count);
+    rigid_translations_.assign(translations, translations + rigids_count);
+}
+
+void CpuSolver::get_rigid_transforms(LQuaternionf* rotations, LVecBase3f* translations) const
+{
+    std::copy(rigid_rotations_.begin(), rigid_rotations_.end(), rotations);
+    std::copy(rigid_translations_.begin(), rigid_translations_.end(), translations);
+}
+
+void CpuSolver::set_shapes(const NvFlexCollisionGeometry* geometry, const LVecBase4f* positions,
+    const LQuaternionf* rotations, const int* flags, int count)
+{
+    shapes_.clear();
+    shapes_.reserve(count);
+    for (int k = 0; k < count; ++k)
+    {
+        // mesh shapes and triggers do not collide
+        const int type = flags[k] & eNvFlexShapeFlagTypeMask;
+        if (type > eNvFlexShapeBox || (flags[k] & eNvFlexShapeFlagTrigger))
+            continue;
+
+        shapes_.push_back(Shape{ type, geometry[k], positions[k].get_xyz(), rotations[k] });
+    }
+}
+
+void CpuSolver::set_dynamic_triangles(const int* indices, int triangles_count)
+{
+    triangles_.assign(indices, indices + triangles_count * 3);
+}
+
+void CpuSolver::get_dynamic_triangle_normals(LVecBase3f* normals, int triangles_count) const
+{
+    triangles_count = (std::min)(triangles_count, static_cast<int>(triangles_.size() / 3));
+    for (int k = 0; k < triangles_count; ++k)
+    {
+        const int a = triangles_[k * 3];
+        const int b = triangles_[k * 3 + 1];
+        const int c = triangles_[k * 3 + 2];
+        const LVecBase3f p0(x_[a], y_[a], z_[a]);
+        const LVecBase3f n = (LVecBase3f(x_[b], y_[b], z_[b]) - p0).cross(LVecBase3f(x_[c], y_[c], z_[c]) - p0);
+        const float length = n.length();
+        normals[k] = length > 0.0f ? n / length : LVecBase3f(0, 0, 1);
+    }
+}
+
+void CpuSolver::get_normals(LVecBase4f* normals, int count) const
+{
+    std::fill(normals, normals + count, LVecBase4f(0.0f));
+    for (size_t k = 0, k_end = triangles_.size(); k + 2 < k_end; k += 3)
+    {
+        const int a = triangles_[k];
+        const int b = triangles_[k + 1];
+        const int c = triangles_[k + 2];
+        if (a >= count || b >= count || c >= count)
+            continue;
+
+        // area weighted
+        const LVecBase3f p0(x_[a], y_[a], z_[a]);
+        const LVecBase3f n = (LVecBase3f(x_[b], y_[b], z_[b]) - p0).cross(LVecBase3f(x_[c], y_[c], z_[c]) - p0);
+        for (const int i: { a, b, c })
+        {
+            normals[i][0] += n[0];
+            normals[i][1] += n[1];
+            normals[i][2] += n[2];
+        }
+    }
+
+    for (int k = 0; k < count; ++k)
+    {
+        const float length = normals[k].get_xyz().length();
+        if (length > 0.0f)
+            normals[k] /= length;
+    }
+}
+
+void CpuSolver::update(float dt, int substeps)
+{
+    if (dt <= 0.0f || substeps <= 0 || active_.empty())
+        return;
+
+    const float substep_dt = dt / substeps;
+    for (int substep = 0; substep < substeps; ++substep)
+    {
+        integrate(substep_dt);
+        build_grid();
+
+        for (int iteration = 0, iterations = (std::max)(1, params_.numIterations); iteration < iterations; ++iteration)
+        {
+            solve_particle_contacts();
+            solve_springs();
+            solve_rigids();
+            solve_collisions();
+        }
+
+        finalize(substep_dt);
+    }
+}
+
+void CpuSolver::integrate(float dt)
+{
+    const float damping = (std::max)(0.0f, 1.0f - params_.damping * dt);
+    parallel_for(0, static_cast<int>(active_.size()), GRAIN_SIZE, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k)
+        {
+            const int i = active_[k];
+            if (inv_mass_[i] > 0.0f)
+            {
+                vx_[i] = (vx_[i] + params_.gravity[0] * dt) * damping;
+                vy_[i] = (vy_[i] + params_.gravity[1] * dt) * damping;
+                vz_[i] = (vz_[i] + params_.gravity[2] * dt) * damping;
+            }
+            else
+            {
+                vx_[i] = vy_[i] = vz_[i] = 0.0f;
+            }
+
+            px_[i] = x_[i] + vx_[i] * dt;
+            py_[i] = y_[i] + vy_[i] * dt;
+            pz_[i] = z_[i] + vz_[i] * dt;
+        }
+    });
+}
+
+void CpuSolver::build_grid()
+{
+    const int active_count = static_cast<int>(active_.size());
+
+    int table_size = 1024;
+    while (table_size < active_count * 2)
+        table_size *= 2;
+    const int mask = table_size - 1;
+
+    cell_size_ = (std::max)(params_.radius, 1e-4f);
+    const float inv_cell_size = 1.0f / cell_size_;
+
+    cell_hashes_.resize(active_count);
+    parallel_for(0, active_count, GRAIN_SIZE, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k)
+        {
+            const int i = active_[k];
+            cell_hashes_[k] = hash_cell(
+                int(std::floor(px_[i] * inv_cell_size)),
+                int(std::floor(py_[i] * inv_cell_size)),
+                int(std::floor(pz_[i] * inv_cell_size)), mask);
+        }
+    });
+
+    // counting sort by cell hash
+    cell_starts_.assign(table_size + 1, 0);
+    for (int k = 0; k < active_count; ++k)
+        ++cell_starts_[cell_hashes_[k] + 1];
+    for (int k = 0; k < table_size; ++k)
+        cell_starts_[k + 1] += cell_starts_[k];
+
+    sorted_particles_.resize(active_count);
+    std::vector<int> cursors(cell_starts_.begin(), cell_starts_.end() - 1);
+    for (int k = 0; k < active_count; ++k)
+        sorted_particles_[cursors[cell_hashes_[k]]++] = active_[k];
+}
+
+void CpuSolver::solve_particle_contacts()
+{
+    const float rest_distance = params_.solidRestDistance > 0.0f ? params_.solidRestDistance : params_.radius;
+    const float rest_distance_sq = rest_distance * rest_distance;
+    const float inv_cell_size = 1.0f / cell_size_;
+    const int mask = static_cast<int>(cell_starts_.size()) - 2;
+    const int active_count = static_cast<int>(active_.size());
+
+    parallel_for(0, active_count, GRAIN_SIZE, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k)
+        {
+            const int i = active_[k];
+            const float wi = inv_mass_[i];
+            if (wi <= 0.0f)
+                continue;
+
+            const int phase_i = phases_[i];
+            const int group_i = phase_i & eNvFlexPhaseGroupMask;
+            const int cx = int(std::floor(px_[i] * inv_cell_size));
+            const int cy = int(std::floor(py_[i] * inv_cell_size));
+            const int cz = int(std::floor(pz_[i] * inv_cell_size));
+
+            // neighbor cells may share the same hash
+            int visited[27];
+            int visited_count = 0;
+            for (int oz = -1; oz <= 1; ++oz)
+            {
+                for (int oy = -1; oy <= 1; ++oy)
+                {
+                    for (int ox = -1; ox <= 1; ++ox)
+                    {
+                        const int hash = hash_cell(cx + ox, cy + oy, cz + oz, mask);
+                        if (std::find(visited, visited + visited_count, hash) != visited + visited_count)
+                            continue;
+                        visited[visited_count++] = hash;
+
+                        for (int s = cell_starts_[hash], s_end = cell_starts_[hash + 1]; s < s_end; ++s)
+                        {
+                            const int j = sorted_particles_[s];
+                            if (j == i)
+                                continue;
+
+                            // particles in the same group collide only with self collision
+                            if ((phases_[j] & eNvFlexPhaseGroupMask) == group_i && !(phase_i & eNvFlexPhaseSelfCollide))
+                                continue;
+
+                            const float ex = px_[i] - px_[j];
+                            const float ey = py_[i] - py_[j];
+                            const float ez = pz_[i] - pz_[j];
+                            const float distance_sq = ex * ex + ey * ey + ez * ez;
+                            if (distance_sq >= rest_distance_sq || distance_sq < 1e-12f)
+                                continue;
+
+                            const float distance = std::sqrt(distance_sq);
+                            const float scale = wi / (wi + inv_mass_[j]) * (rest_distance - distance) / distance;
+                            dx_[i] += ex * scale;
+                            dy_[i] += ey * scale;
+                            dz_[i] += ez * scale;
+                            ++delta_counts_[i];
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    parallel_for(0, active_count, GRAIN_SIZE, [&](int begin, int end) {
+        apply_deltas(begin, end);
+    });
+}
+
+void CpuSolver::solve_springs()
+{
+    if (spring_others_.empty())
+        return;
+
+    parallel_for(0, static_cast<int>(active_.size()), GRAIN_SIZE, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k)
+        {
+            const int i = active_[k];
+            const float wi = inv_mass_[i];
+            if (wi <= 0.0f)
+                continue;
+
+            for (int s = spring_offsets_[i], s_end = spring_offsets_[i + 1]; s < s_end; ++s)
+            {
+                const int j = spring_others_[s];
+                const float ex = px_[i] - px_[j];
+                const float ey = py_[i] - py_[j];
+                const float ez = pz_[i] - pz_[j];
+                const float distance = std::sqrt(ex * ex + ey * ey + ez * ez);
+                if (distance < 1e-6f)
+                    continue;
+
+                const float scale = -spring_stiffness_[s] * wi / (wi + inv_mass_[j]) * (distance - spring_lengths_[s]) / distance;
+                dx_[i] += ex * scale;
+                dy_[i] += ey * scale;
+                dz_[i] += ez * scale;
+                ++delta_counts_[i];
+            }
+        }
+    });
+
+    // corrections are applied after all particles read the predicted positions
+    parallel_for(0, static_cast<int>(active_.size()), GRAIN_SIZE, [&](int begin, int end) {
+        apply_deltas(begin, end);
+    });
+}
+
+void CpuSolver::solve_rigids()
+{
+    const int rigids_count = static_cast<int>(rigid_coefficients_.size());
+
+    // particles belong to one rigid, so rigids are solved independently
+    parallel_for(0, rigids_count, 16, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r)
+        {
+            const int offset_begin = rigid_offsets_[r];
+            const int offset_end = rigid_offsets_[r + 1];
+            const float stiffness = rigid_coefficients_[r];
+            if (offset_begin >= offset_end || stiffness <= 0.0f)
+                continue;
+
+            LVecBase3f center(0.0f);
+            for (int k = offset_begin; k < offset_end; ++k)
+            {
+                const int i = rigid_indices_[k];
+                center += LVecBase3f(px_[i], py_[i], pz_[i]);
+            }
+            center /= float(offset_end - offset_begin);
+
+            // covariance of current and local positions (column k is A * e_k)
+            LVecBase3f columns[3] = { LVecBase3f(0.0f), LVecBase3f(0.0f), LVecBase3f(0.0f) };
+            for (int k = offset_begin; k < offset_end; ++k)
+            {
+                const int i = rigid_indices_[k];
+                const LVecBase3f d = LVecBase3f(px_[i], py_[i], pz_[i]) - center;
+                const LVecBase3f& q = rigid_local_positions_[k];
+                columns[0] += d * q[0];
+                columns[1] += d * q[1];
+                columns[2] += d * q[2];
+            }
+
+            // extract rotation from the last rotation (Mueller et al. 2016)
+            LQuaternionf rotation = rigid_rotations_[r];
+            for (int iteration = 0; iteration < 8; ++iteration)
+            {
+                const LVecBase3f r0 = rotate(rotation, LVecBase3f(1, 0, 0));
+                const LVecBase3f r1 = rotate(rotation, LVecBase3f(0, 1, 0));
+                const LVecBase3f r2 = rotate(rotation, LVecBase3f(0, 0, 1));
+                const LVecBase3f omega = (r0.cross(columns[0]) + r1.cross(columns[1]) + r2.cross(columns[2])) /
+                    (std::abs(r0.dot(columns[0]) + r1.dot(columns[1]) + r2.dot(columns[2])) + 1e-9f);
+
+                const float angle = omega.length();
+                if (angle < 1e-9f)
+                    break;
+
+                const LVecBase3f axis = omega / angle * std::sin(angle * 0.5f);
+                rotation = multiply(LQuaternionf(axis[0], axis[1], axis[2], std::cos(angle * 0.5f)), rotation);
+
+                const float length = std::sqrt(rotation.dot(rotation));
+                rotation = LQuaternionf(rotation[0] / length, rotation[1] / length, rotation[2] / length, rotation[3] / length);
+            }
+
+            rigid_rotations_[r] = rotation;
+            rigid_translations_[r] = center;
+
+            for (int k = offset_begin; k < offset_end; ++k)
+            {
+                const int i = rigid_indices_[k];
+                if (inv_mass_[i] <= 0.0f)
+                    continue;
+
+                const LVecBase3f goal = center + rotate(rotation, rigid_local_positions_[k]);
+                px_[i] += (goal[0] - px_[i]) * stiffness;
+                py_[i] += (goal[1] - py_[i]) * stiffness;
+                pz_[i] += (goal[2] - pz_[i]) * stiffness;
+            }
+        }
+    });
+}
+
+void CpuSolver::solve_collisions()
+{
+    const float margin = params_.collisionDistance > 0.0f ? params_.collisionDistance : params_.radius * 0.5f;
+
+    // push out of contact and reduce tangential motion of the substep by friction
+    const auto resolve = [&](int i, const LVecBase3f& normal, float penetration) {
+        px_[i] += normal[0] * penetration;
+        py_[i] += normal[1] * penetration;
+        pz_[i] += normal[2] * penetration;
+
+        const LVecBase3f motion(px_[i] - x_[i], py_[i] - y_[i], pz_[i] - z_[i]);
+        const LVecBase3f tangent = motion - normal * motion.dot(normal);
+        const float tangent_length = tangent.length();
+        if (tangent_length <= 0.0f)
+            return;
+
+        float scale = 1.0f;
+        if (tangent_length >= params_.staticFriction * penetration)
+            scale = (std::min)(params_.dynamicFriction * penetration / tangent_length, 1.0f);
+
+        px_[i] -= tangent[0] * scale;
+        py_[i] -= tangent[1] * scale;
+        pz_[i] -= tangent[2] * scale;
+    };
+
+    parallel_for(0, static_cast<int>(active_.size()), GRAIN_SIZE, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k)
+        {
+            const int i = active_[k];
+            if (inv_mass_[i] <= 0.0f)
+                continue;
+
+            for (int p = 0; p < params_.numPlanes; ++p)
+            {
+                const float* plane = params_.planes[p];
+                const LVecBase3f normal(plane[0], plane[1], plane[2]);
+                const float distance = normal.dot(LVecBase3f(px_[i], py_[i], pz_[i])) + plane[3];
+                if (distance < margin)
+                    resolve(i, normal, margin - distance);
+            }
+
+            for (const auto& shape: shapes_)
+            {
+                const LVecBase3f local = inverse_rotate(shape.rotation, LVecBase3f(px_[i], py_[i], pz_[i]) - shape.position);
+
+                float distance = FLT_MAX;
+                LVecBase3f normal(0, 0, 1);
+                if (shape.type == eNvFlexShapeSphere)
+                {
+                    const float length = local.length();
+                    distance = length - shape.geometry.sphere.radius;
+                    if (length > 0.0f)
+                        normal = local / length;
+                }
+                else if (shape.type == eNvFlexShapeCapsule)
+                {
+                    // capsule is aligned to x-axis
+                    const float half_height = shape.geometry.capsule.halfHeight;
+                    const LVecBase3f v = local - LVecBase3f((std::max)(-half_height, (std::min)(local[0], half_height)), 0, 0);
+                    const float length = v.length();
+                    distance = length - shape.geometry.capsule.radius;
+                    if (length > 0.0f)
+                        normal = v / length;
+                }
+                else if (shape.type == eNvFlexShapeBox)
+                {
+                    const float* half_extents = shape.geometry.box.halfExtents;
+                    LVecBase3f outside(0.0f);
+                    int max_axis = 0;
+                    float max_q = -FLT_MAX;
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        const float q = std::abs(local[axis]) - half_extents[axis];
+                        outside[axis] = local[axis] < 0.0f ? -(std::max)(q, 0.0f) : (std::max)(q, 0.0f);
+                        if (q > max_q)
+                        {
+                            max_q = q;
+                            max_axis = axis;
+                        }
+                    }
+
+                    const float outside_length = outside.length();
+                    if (outside_length > 0.0f)
+                    {
+                        distance = outside_length;
+                        normal = outside / outside_length;
+                    }
+                    else
+                    {
+                        distance = max_q;
+                        normal = LVecBase3f(0.0f);
+                        normal[max_axis] = local[max_axis] < 0.0f ? -1.0f : 1.0f;
+                    }
+                }
+
+                if (distance < margin)
+                    resolve(i, rotate(shape.rotation, normal), margin - distance);
+            }
+        }
+    });
+}
+
+void CpuSolver::apply_deltas(int begin, int end)
+{
+    const float relaxation = params_.relaxationFactor > 0.0f ? params_.relaxationFactor : 1.0f;
+    for (int k = begin; k < end; ++k)
+    {
+        const int i = active_[k];
+        const int count = delta_counts_[i];
+        if (count == 0)
+            continue;
+
+        const float scale = relaxation / count;
+        px_[i] += dx_[i] * scale;
+        py_[i] += dy_[i] * scale;
+        pz_[i] += dz_[i] * scale;
+        dx_[i] = dy_[i] = dz_[i] = 0.0f;
+        delta_counts_[i] = 0;
+    }
+}
+
+void CpuSolver::finalize(float dt)
+{
+    const float inv_dt = 1.0f / dt;
+    const float max_speed_sq = params_.maxSpeed < FLT_MAX ? params_.maxSpeed * params_.maxSpeed : FLT_MAX;
+    const float sleep_sq = params_.sleepThreshold * params_.sleepThreshold;
+
+    parallel_for(0, static_cast<int>(active_.size()), GRAIN_SIZE, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k)
+        {
+            const int i = active_[k];
+            if (inv_mass_[i] <= 0.0f)
+                continue;
+
+            float vx = (px_[i] - x_[i]) * inv_dt;
+            float vy = (py_[i] - y_[i]) * inv_dt;
+            float vz = (pz_[i] - z_[i]) * inv_dt;
+            const float speed_sq = vx * vx + vy * vy + vz * vz;
+
+            // slow particles are kept fixed
+            if (speed_sq < sleep_sq)
+            {
+                vx_[i] = vy_[i] = vz_[i] = 0.0f;
+                continue;
+            }
+
+            if (speed_sq > max_speed_sq)
+            {
+                const float scale = params_.maxSpeed / std::sqrt(speed_sq);
+                vx *= scale;
+                vy *= scale;
+                vz *= scale;
+            }
+
+            vx_[i] = vx;
+            vy_[i] = vy;
+            vz_[i] = vz;
+            x_[i] = px_[i];
+            y_[i] = py_[i];
+            z_[i] = pz_[i];
+        }
+    });
+}
+
+}
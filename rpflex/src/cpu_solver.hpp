@@ -0,0 +1,138 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <luse.h>
+
+#include <NvFlex.h>
+
+namespace rpflex {
+
+/**
+ * Position based dynamics solver on CPU.
+ *
+ * This solves a subset of Flex: particles and their collisions, collision planes and shapes
+ * (sphere, capsule and box), springs and shape matching rigids.
+ * Fluids, inflatables and mesh shapes are ignored.
+ *
+ * Particles are stored as structure of arrays, neighbors are found by a spatial hash grid,
+ * and constraints are projected in parallel by Jacobi iterations.
+ * Data in the interface use the layout of FlexBuffer (ex, quaternions in Flex order).
+ */
+class CpuSolver
+{
+public:
+    CpuSolver(int max_particles);
+
+    int get_max_particles() const;
+
+    void set_params(const NvFlexParams& params);
+
+    void set_particles(const LVecBase4f* positions, int count);
+    void get_particles(LVecBase4f* positions, int count) const;
+
+    void set_velocities(const LVecBase3f* velocities, int count);
+    void get_velocities(LVecBase3f* velocities, int count) const;
+
+    void set_phases(const int* phases, int count);
+    void set_active(const int* indices, int count);
+
+    void set_springs(const int* indices, const float* lengths, const float* stiffness, int count);
+
+    /** @param   offsets     Offsets of rigid indices (rigids_count + 1 elements). */
+    void set_rigids(const int* offsets, const int* indices, const LVecBase3f* local_positions,
+        const float* coefficients, const LQuaternionf* rotations, const LVecBase3f* translations, int rigids_count);
+    void get_rigid_transforms(LQuaternionf* rotations, LVecBase3f* translations) const;
+
+    void set_shapes(const NvFlexCollisionGeometry* geometry, const LVecBase4f* positions,
+        const LQuaternionf* rotations, const int* flags, int count);
+
+    void set_dynamic_triangles(const int* indices, int triangles_count);
+
+    /** Get normal of each triangle. */
+    void get_dynamic_triangle_normals(LVecBase3f* normals, int triangles_count) const;
+
+    /** Get normals of particles averaged from dynamic triangles. */
+    void get_normals(LVecBase4f* normals, int count) const;
+
+    void update(float dt, int substeps);
+
+private:
+    struct Shape
+    {
+        int type;
+        NvFlexCollisionGeometry geometry;
+        LVecBase3f position;
+        LQuaternionf rotation;      ///< Flex order (x, y, z, w)
+    };
+
+    void integrate(float dt);
+    void build_grid();
+    void solve_particle_contacts();
+    void solve_springs();
+    void solve_rigids();
+    void solve_collisions();
+    void apply_deltas(int begin, int end);
+    void finalize(float dt);
+
+    NvFlexParams params_;
+    int max_particles_;
+
+    // particles
+    std::vector<float> x_, y_, z_, inv_mass_;
+    std::vector<float> vx_, vy_, vz_;
+    std::vector<float> px_, py_, pz_;       ///< predicted positions
+    std::vector<float> dx_, dy_, dz_;       ///< accumulated corrections
+    std::vector<int> delta_counts_;
+    std::vector<int> phases_;
+    std::vector<int> active_;
+
+    // hash grid of active particles
+    float cell_size_ = 0;
+    std::vector<int> cell_hashes_;
+    std::vector<int> cell_starts_;
+    std::vector<int> sorted_particles_;
+
+    // springs in both directions for each particle
+    std::vector<int> spring_offsets_;
+    std::vector<int> spring_others_;
+    std::vector<float> spring_lengths_;
+    std::vector<float> spring_stiffness_;
+
+    // rigids
+    std::vector<int> rigid_offsets_;
+    std::vector<int> rigid_indices_;
+    std::vector<LVecBase3f> rigid_local_positions_;
+    std::vector<float> rigid_coefficients_;
+    std::vector<LQuaternionf> rigid_rotations_;
+    std::vector<LVecBase3f> rigid_translations_;
+
+    std::vector<Shape> shapes_;
+    std::vector<int> triangles_;
+};
+
+}
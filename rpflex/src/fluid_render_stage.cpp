@@ -0,0 +1,380 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "fluid_render_stage.hpp"
+
+#include <cstring>
+
+#include <cullFaceAttrib.h>
+#include <geomNode.h>
+#include <geomTriangles.h>
+#include <geomVertexWriter.h>
+#include <omniBoundingVolume.h>
+
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/globals.hpp>
+#include <render_pipeline/rpcore/loader.hpp>
+#include <render_pipeline/rpcore/render_pipeline.hpp>
+#include <render_pipeline/rpcore/render_target.hpp>
+#include <render_pipeline/rpcore/util/post_process_region.hpp>
+#include <render_pipeline/rppanda/showbase/showbase.hpp>
+
+#include "rpflex/flex_buffer.hpp"
+
+namespace rpflex {
+
+static const int COMPUTE_GROUP_SIZE = 128;
+
+template <class T>
+static void upload_buffer_texture(Texture* tex, const T* data, int count, Texture::ComponentType component_type,
+    Texture::Format format)
+{
+    if (count <= 0)
+        return;
+
+    // reallocate only when the size is changed
+    if (tex->get_x_size() != count)
+        tex->setup_buffer_texture(count, component_type, format, GeomEnums::UH_dynamic);
+
+    std::memcpy(tex->modify_ram_image().p(), data, sizeof(T) * count);
+}
+
+/** Create unit cube which bounds unit sphere. */
+static PT(Geom) create_bounding_cube_geom()
+{
+    PT(GeomVertexData) vdata = new GeomVertexData("FluidParticleBox", GeomVertexFormat::get_v3(), GeomEnums::UH_static);
+    vdata->unclean_set_num_rows(8);
+
+    GeomVertexWriter vertex_writer(vdata, InternalName::get_vertex());
+    for (int k = 0; k < 8; ++k)
+        vertex_writer.add_data3f((k & 1) ? 1.0f : -1.0f, (k & 2) ? 1.0f : -1.0f, (k & 4) ? 1.0f : -1.0f);
+
+    // counter-clockwise when seen from outside
+    static const int indices[] = {
+        0, 2, 3,    0, 3, 1,    // -z
+        4, 5, 7,    4, 7, 6,    // +z
+        0, 1, 5,    0, 5, 4,    // -y
+        2, 6, 7,    2, 7, 3,    // +y
+        0, 4, 6,    0, 6, 2,    // -x
+        1, 3, 7,    1, 7, 5,    // +x
+    };
+
+    PT(GeomTriangles) prim = new GeomTriangles(GeomEnums::UH_static);
+    for (int k = 0; k < 36; k += 3)
+        prim->add_vertices(indices[k], indices[k+1], indices[k+2]);
+
+    PT(Geom) geom = new Geom(vdata);
+    geom->add_primitive(prim);
+
+    return geom;
+}
+
+// ************************************************************************************************
+
+FluidRenderStage::RequireType FluidRenderStage::required_inputs_;
+FluidRenderStage::RequireType FluidRenderStage::required_pipes_ = { "GBuffer", "ShadedScene" };
+
+FluidRenderStage::FluidRenderStage(rpcore::RenderPipeline& pipeline, SmoothingMode smoothing_mode, int smoothing_iterations):
+    RenderStage(pipeline, "FluidRenderStage"), smoothing_mode_(smoothing_mode), smoothing_iterations_(smoothing_iterations)
+{
+}
+
+FluidRenderStage::~FluidRenderStage()
+{
+    for (auto&& np: compute_nps_)
+        np.remove_node();
+    splat_cam_np_.remove_node();
+    splat_root_.remove_node();
+}
+
+FluidRenderStage::RequireType& FluidRenderStage::get_required_inputs() const
+{
+    return required_inputs_;
+}
+
+FluidRenderStage::RequireType& FluidRenderStage::get_required_pipes() const
+{
+    return required_pipes_;
+}
+
+FluidRenderStage::ProduceType FluidRenderStage::get_produced_pipes() const
+{
+    return {
+        ShaderInput("ShadedScene", composite_target_->get_color_tex()),
+    };
+}
+
+void FluidRenderStage::create()
+{
+    stereo_mode_ = pipeline_.is_stereo_mode();
+
+    view_mat_ = PTA_LMatrix4f::empty_array(1);
+    proj_mats_ = PTA_LMatrix4f::empty_array(2);
+    inv_proj_mats_ = PTA_LMatrix4f::empty_array(2);
+
+    create_splat_scene();
+
+    // linear depth of ellipsoids
+    splat_target_ = create_target("FluidDepth");
+    splat_target_->add_color_attachment(LVecBase3i(32, 0, 0));
+    splat_target_->add_depth_attachment(32);
+    if (stereo_mode_)
+        splat_target_->set_layers(2);
+    splat_target_->prepare_render(splat_cam_np_);
+    splat_target_->set_clear_color(LColor(0));
+
+    Texture* smoothed_depth = splat_target_->get_color_tex();
+    if (smoothing_mode_ != SmoothingMode::compute)
+    {
+        for (int k = 0; k < smoothing_iterations_; ++k)
+        {
+            for (int direction = 0; direction < 2; ++direction)
+            {
+                auto target = create_target(fmt::format("FluidSmooth{}{}", k, direction == 0 ? "H" : "V"));
+                target->add_color_attachment(LVecBase3i(32, 0, 0));
+                if (smoothing_mode_ == SmoothingMode::half_resolution)
+                    target->set_size(-2, -2);
+                if (stereo_mode_)
+                    target->set_layers(2);
+                target->prepare_buffer();
+
+                // the first pass of half resolution reads full resolution
+                const int source_scale = (smoothing_mode_ == SmoothingMode::half_resolution && smooth_targets_.empty()) ? 2 : 1;
+
+                target->set_shader_input(ShaderInput("SourceDepth", smoothed_depth));
+                target->set_shader_input(ShaderInput("smooth_params", LVecBase4i(direction == 0, direction == 1, source_scale, 0)));
+
+                smoothed_depth = target->get_color_tex();
+                smooth_targets_.push_back(target);
+            }
+        }
+    }
+
+    composite_target_ = create_target("FluidComposite");
+    composite_target_->add_color_attachment(16);
+    if (stereo_mode_)
+        composite_target_->set_layers(2);
+    composite_target_->prepare_buffer();
+
+    if (smoothing_mode_ == SmoothingMode::compute)
+    {
+        create_compute_smoothing();
+        if (smoothing_iterations_ > 0)
+            smoothed_depth = compute_textures_[1];
+    }
+
+    composite_target_->set_shader_input(ShaderInput("FluidDepth", splat_target_->get_color_tex()));
+    composite_target_->set_shader_input(ShaderInput("FluidSmoothDepth", smoothed_depth));
+    composite_target_->set_shader_input(ShaderInput("flex_view_mat", view_mat_));
+    composite_target_->set_shader_input(ShaderInput("flex_inv_proj_mats", inv_proj_mats_));
+}
+
+void FluidRenderStage::update()
+{
+    const auto layers_count = stereo_mode_ ? 2 : 1;
+
+    Lens* lens = rpcore::Globals::base->get_cam_lens();
+    view_mat_[0] = rpcore::Globals::render.get_transform(rpcore::Globals::base->get_cam())->get_mat();
+    for (int k = 0; k < layers_count; ++k)
+    {
+        proj_mats_[k] = lens->get_projection_mat(stereo_mode_ ? (k == 0 ? Lens::SC_left : Lens::SC_right) : Lens::SC_mono);
+        inv_proj_mats_[k].invert_from(proj_mats_[k]);
+    }
+}
+
+void FluidRenderStage::reload_shaders()
+{
+    splat_np_.set_shader(load_plugin_shader({"flex_fluid_depth.vert.glsl", "flex_fluid_depth.frag.glsl"}));
+
+    for (auto&& target: smooth_targets_)
+        target->set_shader(load_plugin_shader({"flex_fluid_smooth.frag.glsl"}, stereo_mode_));
+
+    if (!compute_nps_.empty())
+    {
+        PT(Shader) compute_shader = rpcore::RPLoader::load_shader({
+            Filename("/$$rp/rpplugins") / get_plugin_id() / "shader" / "flex_fluid_smooth.compute.glsl"});
+        for (auto&& np: compute_nps_)
+            np.set_shader(compute_shader);
+    }
+
+    composite_target_->set_shader(load_plugin_shader({"flex_fluid_composite.frag.glsl"}, stereo_mode_));
+}
+
+void FluidRenderStage::set_dimensions()
+{
+    if (smoothing_mode_ != SmoothingMode::compute)
+        return;
+
+    const auto& resolution = rpcore::Globals::resolution;
+    for (auto&& tex: compute_textures_)
+    {
+        if (stereo_mode_)
+            tex->setup_2d_texture_array(resolution[0], resolution[1], 2, Texture::T_float, Texture::F_r32);
+        else
+            tex->setup_2d_texture(resolution[0], resolution[1], Texture::T_float, Texture::F_r32);
+    }
+
+    update_compute_dispatches();
+}
+
+void FluidRenderStage::update_particles(const FlexBuffer& buffer, const NvFlexParams& params)
+{
+    const int active_count = buffer.active_indices.size();
+    if (active_count == 0)
+    {
+        splat_np_.hide();
+        return;
+    }
+
+    // Flex smooths positions only if smoothing is enabled
+    const auto& positions = params.smoothing > 0.0f ? buffer.smooth_positions : buffer.positions;
+    const bool use_anisotropy = params.anisotropyScale > 0.0f;
+
+    upload_buffer_texture(indices_tex_, buffer.active_indices.mappedPtr, active_count, Texture::T_int, Texture::F_r32i);
+    upload_buffer_texture(phases_tex_, buffer.phases.mappedPtr, buffer.phases.size(), Texture::T_int, Texture::F_r32i);
+    upload_buffer_texture(positions_tex_, positions.mappedPtr, positions.size(), Texture::T_float, Texture::F_rgba32);
+    if (use_anisotropy)
+    {
+        upload_buffer_texture(anisotropy_tex_[0], buffer.anisotropy1.mappedPtr, buffer.anisotropy1.size(), Texture::T_float, Texture::F_rgba32);
+        upload_buffer_texture(anisotropy_tex_[1], buffer.anisotropy2.mappedPtr, buffer.anisotropy2.size(), Texture::T_float, Texture::F_rgba32);
+        upload_buffer_texture(anisotropy_tex_[2], buffer.anisotropy3.mappedPtr, buffer.anisotropy3.size(), Texture::T_float, Texture::F_rgba32);
+    }
+
+    splat_np_.set_shader_input(ShaderInput("flex_splat_flags", LVecBase4i(eNvFlexPhaseFluid, use_anisotropy, 0, 0)));
+    splat_np_.set_shader_input(ShaderInput("flex_particle_radius", LVecBase4f(params.radius, 0, 0, 0)));
+
+    // each instance is drawn for each eye in stereo mode
+    splat_np_.set_instance_count(active_count * (stereo_mode_ ? 2 : 1));
+    splat_np_.show();
+}
+
+std::string FluidRenderStage::get_plugin_id() const
+{
+    return RPPLUGINS_ID_STRING;
+}
+
+void FluidRenderStage::create_splat_scene()
+{
+    splat_root_ = NodePath("FluidSplatRoot");
+
+    splat_cam_ = new Camera("FluidSplatCamera");
+    splat_cam_->set_lens(rpcore::Globals::base->get_cam_lens());
+    splat_cam_->set_scene(splat_root_);
+    splat_cam_np_ = rpcore::Globals::base->get_cam().attach_new_node(splat_cam_);
+
+    PT(GeomNode) geom_node = new GeomNode("FluidParticles");
+    geom_node->add_geom(create_bounding_cube_geom());
+
+    // particles can be anywhere in the scene
+    geom_node->set_bounds(new OmniBoundingVolume);
+    geom_node->set_final(true);
+
+    splat_np_ = splat_root_.attach_new_node(geom_node);
+
+    // back faces are drawn, so ellipsoids are rendered even if camera is in their boxes
+    splat_np_.set_attrib(CullFaceAttrib::make_reverse());
+
+    positions_tex_ = new Texture("FluidPositions");
+    phases_tex_ = new Texture("FluidPhases");
+    indices_tex_ = new Texture("FluidIndices");
+    anisotropy_tex_[0] = new Texture("FluidAnisotropy1");
+    anisotropy_tex_[1] = new Texture("FluidAnisotropy2");
+    anisotropy_tex_[2] = new Texture("FluidAnisotropy3");
+
+    positions_tex_->setup_buffer_texture(1, Texture::T_float, Texture::F_rgba32, GeomEnums::UH_dynamic);
+    phases_tex_->setup_buffer_texture(1, Texture::T_int, Texture::F_r32i, GeomEnums::UH_dynamic);
+    indices_tex_->setup_buffer_texture(1, Texture::T_int, Texture::F_r32i, GeomEnums::UH_dynamic);
+    for (auto&& tex: anisotropy_tex_)
+        tex->setup_buffer_texture(1, Texture::T_float, Texture::F_rgba32, GeomEnums::UH_dynamic);
+
+    splat_np_.set_shader_input(ShaderInput("flex_positions", positions_tex_));
+    splat_np_.set_shader_input(ShaderInput("flex_phases", phases_tex_));
+    splat_np_.set_shader_input(ShaderInput("flex_indices", indices_tex_));
+    splat_np_.set_shader_input(ShaderInput("flex_anisotropy1", anisotropy_tex_[0]));
+    splat_np_.set_shader_input(ShaderInput("flex_anisotropy2", anisotropy_tex_[1]));
+    splat_np_.set_shader_input(ShaderInput("flex_anisotropy3", anisotropy_tex_[2]));
+    splat_np_.set_shader_input(ShaderInput("flex_splat_flags", LVecBase4i(eNvFlexPhaseFluid, 0, 0, 0)));
+    splat_np_.set_shader_input(ShaderInput("flex_particle_radius", LVecBase4f(0)));
+    splat_np_.set_shader_input(ShaderInput("flex_view_mat", view_mat_));
+    splat_np_.set_shader_input(ShaderInput("flex_proj_mats", proj_mats_));
+    splat_np_.set_shader_input(ShaderInput("flex_inv_proj_mats", inv_proj_mats_));
+
+    // nothing to draw until particles are updated
+    splat_np_.hide();
+}
+
+void FluidRenderStage::create_compute_smoothing()
+{
+    compute_textures_[0] = new Texture("FluidSmoothDepth0");
+    compute_textures_[1] = new Texture("FluidSmoothDepth1");
+    for (auto&& tex: compute_textures_)
+    {
+        tex->set_minfilter(SamplerState::FT_nearest);
+        tex->set_magfilter(SamplerState::FT_nearest);
+    }
+
+    // Dispatches are placed in the region of composite, so they run after splatting
+    // and before the composite in the same pass.
+    NodePath region_np = composite_target_->get_postprocess_region()->get_node();
+    Texture* source = splat_target_->get_color_tex();
+    for (int k = 0; k < smoothing_iterations_; ++k)
+    {
+        for (int direction = 0; direction < 2; ++direction)
+        {
+            PT(ComputeNode) compute_node = new ComputeNode(fmt::format("FluidSmooth{}{}", k, direction == 0 ? "H" : "V"));
+            NodePath np = region_np.attach_new_node(compute_node);
+            np.set_bin("background", int(compute_nps_.size()));
+
+            Texture* dest = compute_textures_[direction];
+            np.set_shader_input(ShaderInput("SourceDepth", source));
+            np.set_shader_input(ShaderInput("DestDepth", dest, false, true, -1, 0));
+            np.set_shader_input(ShaderInput("smooth_params", LVecBase4i(direction == 0, direction == 1, 1, 0)));
+            source = dest;
+
+            compute_nodes_.push_back(compute_node);
+            compute_nps_.push_back(np);
+        }
+    }
+
+    set_dimensions();
+}
+
+void FluidRenderStage::update_compute_dispatches()
+{
+    const auto& resolution = rpcore::Globals::resolution;
+    const int layers_count = stereo_mode_ ? 2 : 1;
+    for (size_t k = 0, k_end = compute_nodes_.size(); k < k_end; ++k)
+    {
+        // a work group filters a part of one row (or column)
+        const bool horizontal = (k % 2) == 0;
+        const int length = horizontal ? resolution[0] : resolution[1];
+        const int lines = horizontal ? resolution[1] : resolution[0];
+
+        compute_nodes_[k]->clear_dispatches();
+        compute_nodes_[k]->add_dispatch((length + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE, lines, layers_count);
+    }
+}
+
+}
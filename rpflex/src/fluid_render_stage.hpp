@@ -0,0 +1,111 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <camera.h>
+#include <computeNode.h>
+#include <nodePath.h>
+#include <pta_LMatrix4.h>
+
+#include <render_pipeline/rpcore/render_stage.hpp>
+
+struct NvFlexParams;
+
+namespace rpflex {
+
+struct FlexBuffer;
+
+/**
+ * Screen-space rendering of fluid particles.
+ *
+ * Particles are splatted as ellipsoids into linear depth, the depth is smoothed
+ * by separable bilateral filter, and the surface is shaded into ShadedScene.
+ */
+class FluidRenderStage : public rpcore::RenderStage
+{
+public:
+    enum class SmoothingMode
+    {
+        separable,          ///< separable filter in full resolution
+        half_resolution,    ///< separable filter in half resolution
+        compute,            ///< separable filter with compute shaders
+    };
+
+    FluidRenderStage(rpcore::RenderPipeline& pipeline, SmoothingMode smoothing_mode, int smoothing_iterations);
+    ~FluidRenderStage() override;
+
+    RequireType& get_required_inputs() const override;
+    RequireType& get_required_pipes() const override;
+    ProduceType get_produced_pipes() const override;
+
+    RENDER_PIPELINE_STAGE_DOWNCAST();
+
+    void create() override;
+    void update() override;
+    void reload_shaders() override;
+    void set_dimensions() override;
+
+    /** Copy fluid particles to buffer textures. The buffers should be mapped. */
+    void update_particles(const FlexBuffer& buffer, const NvFlexParams& params);
+
+private:
+    std::string get_plugin_id() const override;
+
+    void create_splat_scene();
+    void create_compute_smoothing();
+    void update_compute_dispatches();
+
+    static RequireType required_inputs_;
+    static RequireType required_pipes_;
+
+    bool stereo_mode_ = false;
+    SmoothingMode smoothing_mode_;
+    int smoothing_iterations_;
+
+    PT(Camera) splat_cam_;
+    NodePath splat_cam_np_;
+    NodePath splat_root_;
+    NodePath splat_np_;
+
+    PT(Texture) positions_tex_;
+    PT(Texture) anisotropy_tex_[3];
+    PT(Texture) phases_tex_;
+    PT(Texture) indices_tex_;
+
+    PTA_LMatrix4f view_mat_;
+    PTA_LMatrix4f proj_mats_;
+    PTA_LMatrix4f inv_proj_mats_;
+
+    rpcore::RenderTarget* splat_target_ = nullptr;
+    std::vector<rpcore::RenderTarget*> smooth_targets_;
+    rpcore::RenderTarget* composite_target_ = nullptr;
+
+    // compute smoothing
+    PT(Texture) compute_textures_[2];
+    std::vector<PT(ComputeNode)> compute_nodes_;
+    std::vector<NodePath> compute_nps_;
+};
+
+}
@@ -0,0 +1,130 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "particle_pool.hpp"
+
+#include <algorithm>
+
+namespace rpflex {
+
+void ParticlePool::reset(int capacity, int active_count)
+{
+    active_slots_.resize(capacity);
+    for (int k = 0; k < capacity; ++k)
+        active_slots_[k] = k < active_count ? k : -1;
+
+    // higher index is allocated first
+    // so that the indices after instance particles are kept for new instances.
+    free_indices_.clear();
+    free_indices_.reserve(capacity);
+    for (int k = active_count; k < capacity; ++k)
+        free_indices_.push_back(k);
+}
+
+bool ParticlePool::reset(int capacity, const int* active_indices, int active_count)
+{
+    if (capacity < 0 || active_count < 0 || active_count > capacity)
+        return false;
+
+    std::vector<int> active_slots(capacity, -1);
+    for (int k = 0; k < active_count; ++k)
+    {
+        const int index = active_indices[k];
+        if (index < 0 || index >= capacity || active_slots[index] != -1)
+            return false;
+        active_slots[index] = k;
+    }
+
+    active_slots_.swap(active_slots);
+
+    free_indices_.clear();
+    free_indices_.reserve(capacity - active_count);
+    for (int k = 0; k < capacity; ++k)
+    {
+        if (active_slots_[k] == -1)
+            free_indices_.push_back(k);
+    }
+
+    return true;
+}
+
+int ParticlePool::allocate(FlexVector<int>& active_indices)
+{
+    if (free_indices_.empty())
+        return -1;
+
+    const int index = free_indices_.back();
+    free_indices_.pop_back();
+
+    active_slots_[index] = active_indices.size();
+    active_indices.push_back(index);
+
+    return index;
+}
+
+bool ParticlePool::allocate_range(int begin, int end, FlexVector<int>& active_indices)
+{
+    if (begin < 0 || end > get_capacity())
+        return false;
+
+    for (int index = begin; index < end; ++index)
+    {
+        if (active_slots_[index] != -1)
+            return false;
+    }
+
+    free_indices_.erase(std::remove_if(free_indices_.begin(), free_indices_.end(), [&](int index) {
+        return begin <= index && index < end;
+    }), free_indices_.end());
+
+    for (int index = begin; index < end; ++index)
+    {
+        active_slots_[index] = active_indices.size();
+        active_indices.push_back(index);
+    }
+
+    return true;
+}
+
+bool ParticlePool::free(int index, FlexVector<int>& active_indices)
+{
+    if (!is_active(index))
+        return false;
+
+    const int slot = active_slots_[index];
+    const int last_slot = active_indices.size() - 1;
+
+    // move the last active index to the removed slot
+    const int last_index = active_indices[last_slot];
+    active_indices[slot] = last_index;
+    active_slots_[last_index] = slot;
+    active_indices.resize(last_slot);
+
+    active_slots_[index] = -1;
+    free_indices_.push_back(index);
+
+    return true;
+}
+
+}
@@ -0,0 +1,103 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "rpflex/flex_vector.hpp"
+
+namespace rpflex {
+
+/**
+ * Free-list allocator of particle indices.
+ *
+ * Free indices are kept in a stack and active indices are kept densely packed,
+ * so allocating or freeing one particle takes constant time.
+ */
+class ParticlePool
+{
+public:
+    /** Reset pool so that [0, active_count) is active and [active_count, capacity) is free. */
+    void reset(int capacity, int active_count);
+
+    /**
+     * Reset pool so that only @p active_indices are active in the order of them.
+     *
+     * @return  false if an index is out of [0, capacity) or duplicated, or there are more indices than capacity.
+     *          Then, the pool is not changed.
+     */
+    bool reset(int capacity, const int* active_indices, int active_count);
+
+    int get_capacity() const;
+    int get_free_count() const;
+    bool is_active(int index) const;
+
+    /**
+     * Allocate a free index and append it to @p active_indices.
+     *
+     * @return  The allocated index, or -1 if there is no free index.
+     */
+    int allocate(FlexVector<int>& active_indices);
+
+    /**
+     * Allocate all indices in [begin, end) and append them to @p active_indices.
+     * This takes linear time for the capacity, so it is used for adding instances.
+     *
+     * @return  false if some indices in the range are not free.
+     */
+    bool allocate_range(int begin, int end, FlexVector<int>& active_indices);
+
+    /**
+     * Free the index and remove it from @p active_indices.
+     * The last active index is moved to the removed slot to keep active indices compact.
+     *
+     * @return  false if the index is not active.
+     */
+    bool free(int index, FlexVector<int>& active_indices);
+
+private:
+    std::vector<int> free_indices_;
+
+    /** Position in active indices for each particle, or -1 for free particle. */
+    std::vector<int> active_slots_;
+};
+
+// ************************************************************************************************
+inline int ParticlePool::get_capacity() const
+{
+    return static_cast<int>(active_slots_.size());
+}
+
+inline int ParticlePool::get_free_count() const
+{
+    return static_cast<int>(free_indices_.size());
+}
+
+inline bool ParticlePool::is_active(int index) const
+{
+    return 0 <= index && index < get_capacity() && active_slots_[index] != -1;
+}
+
+}
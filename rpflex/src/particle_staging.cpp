@@ -0,0 +1,83 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "particle_staging.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "particle_pool.hpp"
+
+namespace rpflex {
+
+ParticleStaging::ParticleStaging(NvFlexLibrary* lib): positions_(lib), velocities_(lib), phases_(lib)
+{
+}
+
+void ParticleStaging::begin(FlexBuffer& buffer, int begin)
+{
+    begin_ = begin;
+    end_ = begin;
+
+    positions_.resize(begin);
+    velocities_.resize(begin);
+    phases_.resize(begin);
+
+    positions_.swap(buffer.positions);
+    velocities_.swap(buffer.velocities);
+    phases_.swap(buffer.phases);
+}
+
+void ParticleStaging::end(FlexBuffer& buffer)
+{
+    positions_.swap(buffer.positions);
+    velocities_.swap(buffer.velocities);
+    phases_.swap(buffer.phases);
+
+    end_ = (std::max)(begin_, positions_.size());
+
+    velocities_.resize(end_, LVecBase3f(0.0f));
+    phases_.resize(end_, 0);
+}
+
+bool ParticleStaging::commit(FlexBuffer& buffer, ParticlePool& pool, int max_particles)
+{
+    if (end_ > max_particles || end_ > buffer.positions.size() ||
+        !pool.allocate_range(begin_, end_, buffer.active_indices))
+    {
+        return false;
+    }
+
+    const int count = end_ - begin_;
+    if (count > 0)
+    {
+        std::memcpy(&buffer.positions[begin_], &positions_[begin_], sizeof(LVecBase4f) * count);
+        std::memcpy(&buffer.velocities[begin_], &velocities_[begin_], sizeof(LVecBase3f) * count);
+        std::memcpy(&buffer.phases[begin_], &phases_[begin_], sizeof(int) * count);
+    }
+
+    return true;
+}
+
+}
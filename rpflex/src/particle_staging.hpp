@@ -0,0 +1,90 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <luse.h>
+
+#include "rpflex/flex_buffer.hpp"
+
+namespace rpflex {
+
+class ParticlePool;
+
+/**
+ * Staging buffers of particles for instances added while simulating.
+ *
+ * The particle buffers of FlexBuffer are swapped with the staging buffers while an instance
+ * appends its particles, and the particles are copied to FlexBuffer after their range is allocated
+ * in ParticlePool. So, the live particles (ex, spawned particles) are never overwritten.
+ *
+ * Note that the particles before the range are not copied to the staging buffers,
+ * so instances see only their own particles.
+ */
+class ParticleStaging
+{
+public:
+    ParticleStaging(NvFlexLibrary* lib);
+
+    /** Swap the staging buffers into @p buffer. They have @p begin particles having undefined values. */
+    void begin(FlexBuffer& buffer, int begin);
+
+    /**
+     * Swap the staging buffers out of @p buffer.
+     * Missing velocities and phases of staged particles are filled with zero.
+     */
+    void end(FlexBuffer& buffer);
+
+    /**
+     * Allocate the staged range in @p pool and copy the staged particles to @p buffer.
+     *
+     * @return  false if the range exceeds @p max_particles or some particles in the range are not free.
+     *          Then, @p buffer and @p pool are not changed.
+     */
+    bool commit(FlexBuffer& buffer, ParticlePool& pool, int max_particles);
+
+    int get_begin() const;
+    int get_end() const;
+
+private:
+    FlexVector<LVecBase4f> positions_;
+    FlexVector<LVecBase3f> velocities_;
+    FlexVector<int> phases_;
+
+    int begin_ = 0;
+    int end_ = 0;
+};
+
+// ************************************************************************************************
+inline int ParticleStaging::get_begin() const
+{
+    return begin_;
+}
+
+inline int ParticleStaging::get_end() const
+{
+    return end_;
+}
+
+}
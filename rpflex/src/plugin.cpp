@@ -24,35 +24,295 @@
 
 #include "rpflex/plugin.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <deque>
+
 #include <clockObject.h>
+#include <filename.h>
+#include <pStatCollector.h>
+#include <pStatTimer.h>
 
 #include <boost/dll/alias.hpp>
 
+#include <fmt/format.h>
+
 #include <NvFlex.h>
 #include <NvFlexDevice.h>
 
 #include <render_pipeline/rpcore/globals.hpp>
+#include <render_pipeline/rpcore/pluginbase/setting_types.hpp>
 #include <render_pipeline/rppanda/showbase/showbase.hpp>
 
 #include "rpflex/flex_buffer.hpp"
 #include "rpflex/instance_interface.hpp"
+#include "rpflex/particle_query.hpp"
+#include "rpflex/profiler.hpp"
+#include "rpflex/rigid_activity_tracker.hpp"
+#include "rpflex/rigid_binding_table.hpp"
+#include "rpflex/triangle_mesh_registry.hpp"
 #include "rpflex/utils/helpers.hpp"
+#include "rpflex/utils/parallel_for.hpp"
+
+#include "fluid_render_stage.hpp"
+#include "particle_pool.hpp"
+#include "particle_staging.hpp"
+#include "snapshot.hpp"
+#include "solver_backend.hpp"
 
 RENDER_PIPELINE_PLUGIN_CREATOR(rpflex::Plugin)
 
 namespace rpflex {
 
+const char* const Plugin::DEFAULT_SOLVER_CONTEXT = "default";
+
+static PStatCollector flex_pcollector("App:RPFlex");
+static PStatCollector flex_phase_pcollectors[Profiler::PHASE_COUNT] = {
+    PStatCollector(flex_pcollector, "Map"),
+    PStatCollector(flex_pcollector, "Sync"),
+    PStatCollector(flex_pcollector, "Send"),
+    PStatCollector(flex_pcollector, "Update"),
+    PStatCollector(flex_pcollector, "Readback"),
+};
+
+/** Measure a phase with PStats and Profiler. */
+class ScopedProfile
+{
+public:
+    ScopedProfile(Profiler& profiler, Profiler::Phase phase): profiler_(profiler), phase_(phase),
+        pstat_timer_(flex_phase_pcollectors[phase]), begin_time_(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedProfile()
+    {
+        if (profiler_.is_enabled())
+            profiler_.record(phase_, get_elapsed_time());
+    }
+
+    /** Get elapsed time in milliseconds. */
+    double get_elapsed_time() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time_).count();
+    }
+
+private:
+    Profiler& profiler_;
+    Profiler::Phase phase_;
+    PStatTimer pstat_timer_;
+    std::chrono::steady_clock::time_point begin_time_;
+};
+
+template <class T>
+static void resize_unmapped(FlexVector<T>& vec, int count)
+{
+    vec.resize(count);
+    vec.unmap();
+}
+
+/** Add the times of @p other to @p timers. */
+static void add_solver_timers(NvFlexTimers& timers, const NvFlexTimers& other)
+{
+    // NvFlexTimers has only float members
+    static_assert(sizeof(NvFlexTimers) % sizeof(float) == 0, "NvFlexTimers should consist of floats.");
+
+    float* dst = reinterpret_cast<float*>(&timers);
+    const float* src = reinterpret_cast<const float*>(&other);
+    for (size_t k = 0; k < sizeof(NvFlexTimers) / sizeof(float); ++k)
+        dst[k] += src[k];
+}
+
+// ************************************************************************************************
+
+/** Particle placed by host (ex, spawning), which is written over the state of solver. */
+struct PlacedParticle
+{
+    int index;
+    LVecBase4f position;
+    LVecBase3f velocity;
+};
+
+/**
+ * Host buffers which receive the data read back from solver.
+ * These are swapped with FlexBuffer when readback is pipelined.
+ */
+struct ReadbackSlot
+{
+    ReadbackSlot(NvFlexLibrary* lib);
+
+    void destroy();
+    void wait();
+    void resize(const FlexBuffer& buffer);
+    void swap(FlexBuffer& buffer);
+
+    /** Write the particles placed after this readback to @p buffer. */
+    void apply_placed_particles(FlexBuffer& buffer);
+
+    FlexVector<LVecBase4f> positions;
+    FlexVector<LVecBase3f> velocities;
+    FlexVector<LVecBase4f> normals;
+    FlexVector<int> triangles;
+    FlexVector<LVecBase3f> triangle_normals;
+    FlexVector<LQuaternionf> rigid_rotations;
+    FlexVector<LVecBase3f> rigid_translations;
+    FlexVector<LVecBase4f> smooth_positions;
+    FlexVector<LVecBase4f> anisotropy1;
+    FlexVector<LVecBase4f> anisotropy2;
+    FlexVector<LVecBase4f> anisotropy3;
+
+    std::vector<PlacedParticle> placed_particles;
+};
+
+ReadbackSlot::ReadbackSlot(NvFlexLibrary* lib):
+    positions(lib), velocities(lib), normals(lib), triangles(lib), triangle_normals(lib), rigid_rotations(lib), rigid_translations(lib),
+    smooth_positions(lib), anisotropy1(lib), anisotropy2(lib), anisotropy3(lib)
+{
+}
+
+void ReadbackSlot::destroy()
+{
+    positions.destroy();
+    velocities.destroy();
+    normals.destroy();
+    triangles.destroy();
+    triangle_normals.destroy();
+    rigid_rotations.destroy();
+    rigid_translations.destroy();
+    smooth_positions.destroy();
+    anisotropy1.destroy();
+    anisotropy2.destroy();
+    anisotropy3.destroy();
+
+    placed_particles.clear();
+}
+
+void ReadbackSlot::wait()
+{
+    positions.map();
+    positions.unmap();
+    velocities.map();
+    velocities.unmap();
+    normals.map();
+    normals.unmap();
+    triangles.map();
+    triangles.unmap();
+    triangle_normals.map();
+    triangle_normals.unmap();
+    rigid_rotations.map();
+    rigid_rotations.unmap();
+    rigid_translations.map();
+    rigid_translations.unmap();
+    smooth_positions.map();
+    smooth_positions.unmap();
+    anisotropy1.map();
+    anisotropy1.unmap();
+    anisotropy2.map();
+    anisotropy2.unmap();
+    anisotropy3.map();
+    anisotropy3.unmap();
+}
+
+void ReadbackSlot::resize(const FlexBuffer& buffer)
+{
+    resize_unmapped(positions, buffer.positions.size());
+    resize_unmapped(velocities, buffer.velocities.size());
+    resize_unmapped(normals, buffer.normals.size());
+    resize_unmapped(triangles, buffer.triangles.size());
+    resize_unmapped(triangle_normals, buffer.triangle_normals.size());
+    resize_unmapped(rigid_rotations, buffer.rigid_rotations.size());
+    resize_unmapped(rigid_translations, buffer.rigid_translations.size());
+    resize_unmapped(smooth_positions, buffer.smooth_positions.size());
+    resize_unmapped(anisotropy1, buffer.anisotropy1.size());
+    resize_unmapped(anisotropy2, buffer.anisotropy2.size());
+    resize_unmapped(anisotropy3, buffer.anisotropy3.size());
+}
+
+void ReadbackSlot::swap(FlexBuffer& buffer)
+{
+    positions.swap(buffer.positions);
+    velocities.swap(buffer.velocities);
+    normals.swap(buffer.normals);
+    triangles.swap(buffer.triangles);
+    triangle_normals.swap(buffer.triangle_normals);
+    rigid_rotations.swap(buffer.rigid_rotations);
+    rigid_translations.swap(buffer.rigid_translations);
+    smooth_positions.swap(buffer.smooth_positions);
+    anisotropy1.swap(buffer.anisotropy1);
+    anisotropy2.swap(buffer.anisotropy2);
+    anisotropy3.swap(buffer.anisotropy3);
+}
+
+void ReadbackSlot::apply_placed_particles(FlexBuffer& buffer)
+{
+    for (const auto& particle: placed_particles)
+    {
+        buffer.positions[particle.index] = particle.position;
+        buffer.velocities[particle.index] = particle.velocity;
+    }
+    placed_particles.clear();
+}
+
+// ************************************************************************************************
+
+/** Sizes of FlexBuffer which are changed by InstanceInterface::initialize. */
+struct BufferSizes
+{
+    BufferSizes() = default;
+    BufferSizes(const FlexBuffer& buffer);
+
+    int particles = 0;
+    int rigid_offsets = 0;
+    int rigid_indices = 0;
+    int springs = 0;
+    int shapes = 0;
+    int triangles = 0;
+    int inflatables = 0;
+};
+
+BufferSizes::BufferSizes(const FlexBuffer& buffer):
+    particles(buffer.positions.size()),
+    rigid_offsets(buffer.rigid_offsets.size()),
+    rigid_indices(buffer.rigid_indices.size()),
+    springs(buffer.spring_lengths.size()),
+    shapes(buffer.shape_flags.size()),
+    triangles(buffer.triangles.size()),
+    inflatables(buffer.inflatable_tri_offsets.size())
+{
+}
+
+/** Instance with the ranges of buffers which it created. */
+struct InstanceRecord
+{
+    std::shared_ptr<InstanceInterface> instance;
+    BufferSizes begin;
+    BufferSizes end;
+};
+
+// ************************************************************************************************
+
 class Plugin::Impl
 {
 public:
+    class SolverContext;
+
     Impl(Plugin& self);
 
-    void destroy();
-    void reset();
+    SolverContext* find_context(const std::string& name) const;
+    SolverContext& add_context(const std::string& name);
+    void remove_pending_contexts();
 
     void on_pipeline_created();
     void on_pre_render_update();
     void on_post_render_update();
+
+    /** Create CUDA context and initialize Flex library. */
+    bool init_flex_library();
+
+    /** Destroy triangle meshes having no reference, and SDF and convex meshes released by shapes. */
+    void destroy_unused_meshes();
+
     void on_unload();
 
     static RequrieType require_plugins_;
@@ -61,20 +321,206 @@ public:
     Plugin& self_;
 
     NvFlexLibrary* library_ = nullptr;
+    std::unique_ptr<TriangleMeshRegistry> triangle_mesh_registry_;
+
+    /** SDF and convex meshes are not shared, so they are destroyed after their shapes are removed. */
+    std::vector<NvFlexDistanceFieldId> released_distance_fields_;
+    std::vector<NvFlexConvexMeshId> released_convex_meshes_;
+
+    FluidRenderStage* fluid_render_stage_ = nullptr;
+    bool cpu_solver_ = false;
+
+    /** The first context is the default context and is not removed. */
+    std::vector<std::unique_ptr<SolverContext>> contexts_;
+
+    /** Context used by the API of Plugin. It is changed while a context calls instances. */
+    SolverContext* current_ = nullptr;
+
+    bool pipeline_created_ = false;
+    unsigned int frame_ = 0;
+
+    Profiler profiler_;
+};
+
+/**
+ * Solver with its own buffers, parameters and instances.
+ *
+ * A context is stepped once every update_interval_ frames with the time accumulated
+ * since the last step, and it is mapped and synchronized only in the frames of the steps.
+ */
+class Plugin::Impl::SolverContext
+{
+public:
+    SolverContext(Impl& impl, const std::string& name);
+
+    void destroy();
+    void reset();
+
+    /** Buffers to send to solver. */
+    enum BufferFlag : unsigned int
+    {
+        BUFFER_REST_PARTICLES = 1 << 0,
+        BUFFER_SPRINGS = 1 << 1,
+        BUFFER_RIGIDS = 1 << 2,
+        BUFFER_INFLATABLES = 1 << 3,
+        BUFFER_TRIANGLES = 1 << 4,
+        BUFFER_SHAPES = 1 << 5,
+    };
+
+    void send_buffers(unsigned int flags);
+
+    void sync_instances();
+    void process_instance_changes();
+    bool initialize_instance_live(InstanceRecord& record);
+    void truncate_buffers(const BufferSizes& sizes);
+    void remove_instance_now(size_t record_index);
+    void release_shape_meshes(int begin, int end);
+
+    std::unique_ptr<SolverBackend> create_solver(int max_particles) const;
+
+    void create_readback_slots();
+    void destroy_readback_slots();
+    void send_placed_particles();
+    int spawn_particles(int count, const LVecBase4f* positions, const LVecBase3f* velocities, int phase, std::vector<int>* indices);
+    int kill_particles(const int* indices, int count);
+
+    bool save_snapshot(const Filename& path, bool compress) const;
+    bool load_snapshot(const Filename& path);
+
+    /** Set the speed of sleeping for both CPU tracker and solver. */
+    void set_sleep_threshold(float speed);
+
+    void read_back(FlexBuffer& buffer);
+    void read_back(ReadbackSlot& slot);
+    void read_back(FlexVector<LVecBase4f>& positions, FlexVector<LVecBase3f>& velocities, FlexVector<LVecBase4f>& normals,
+        FlexVector<int>& triangles, FlexVector<LVecBase3f>& triangle_normals, FlexVector<LQuaternionf>& rigid_rotations,
+        FlexVector<LVecBase3f>& rigid_translations);
+    void read_back_fluid(FlexVector<LVecBase4f>& smooth_positions, FlexVector<LVecBase4f>& anisotropy1,
+        FlexVector<LVecBase4f>& anisotropy2, FlexVector<LVecBase4f>& anisotropy3);
+
+    /** Check if this context is stepped in the frame. */
+    bool is_scheduled(unsigned int frame) const;
+
+    void on_pre_render_update();
+    void on_post_render_update(float dt);
+
+public:
+    Impl& impl_;
+    Plugin& self_;
+
+    const std::string name_;
+    int update_interval_ = 1;
+    int update_offset_ = 0;
+    float accumulated_dt_ = 0.0f;
+    bool removed_ = false;
+
+    RigidBindingTable rigid_binding_table_;
+    RigidActivityTracker rigid_activity_tracker_;
     FlexBuffer* buffer_ = nullptr;
-    NvFlexSolver* solver_ = nullptr;
+    std::unique_ptr<SolverBackend> solver_;
 
     NvFlexParams flex_params_;
-    bool flex_params_changed_ = false;
+    std::atomic<bool> flex_params_changed_{false};
+    std::atomic<bool> particles_changed_{false};
+    bool fluid_readback_ = false;
+    bool parallel_syncing_ = false;
 
     Plugin::Parameters params_;
 
-    std::vector<std::shared_ptr<InstanceInterface>> instances_;
+    std::vector<InstanceRecord> instances_;
+    std::vector<std::shared_ptr<InstanceInterface>> added_instances_;
+    std::vector<std::shared_ptr<InstanceInterface>> removed_instances_;
+
+    ParticlePool particle_pool_;
+    std::unique_ptr<ParticleStaging> particle_staging_;
+    int max_particles_ = 0;
+
+    MeshBoundsCache mesh_bounds_cache_;
+
+    /** End of particles created by instances. New instances are placed from here. */
+    int particles_end_ = 0;
+
+    unsigned int changed_buffers_ = 0;
+
+    // pipelined readback
+    int readback_latency_ = 0;
+    std::vector<std::unique_ptr<ReadbackSlot>> readback_slots_;
+    std::deque<ReadbackSlot*> free_readbacks_;
+    std::deque<ReadbackSlot*> pending_readbacks_;
+    double readback_wait_time_ = 0;
+
+    /**
+     * Particles placed while readback is pipelined. Only these are written over the state of solver
+     * because the other particles in FlexBuffer are older than solver.
+     */
+    std::vector<PlacedParticle> placed_particles_;
+    ReadbackSlot* placement_slot_ = nullptr;
+
+    bool particle_query_enabled_ = false;
+    float particle_query_cell_size_ = 0.0f;
+    ParticleQuery particle_query_;
 };
 
 Plugin::RequrieType Plugin::Impl::require_plugins_;
 
 Plugin::Impl::Impl(Plugin& self): self_(self)
+{
+    current_ = &add_context(Plugin::DEFAULT_SOLVER_CONTEXT);
+}
+
+Plugin::Impl::SolverContext* Plugin::Impl::find_context(const std::string& name) const
+{
+    for (auto&& context: contexts_)
+    {
+        if (context->name_ == name && !context->removed_)
+            return context.get();
+    }
+    return nullptr;
+}
+
+Plugin::Impl::SolverContext& Plugin::Impl::add_context(const std::string& name)
+{
+    contexts_.push_back(std::make_unique<SolverContext>(*this, name));
+    auto& context = *contexts_.back();
+
+    // sleeping is configured by settings for all contexts
+    if (contexts_.size() > 1)
+    {
+        const auto& tracker = contexts_.front()->rigid_activity_tracker_;
+        context.rigid_activity_tracker_.set_threshold(tracker.get_threshold());
+        context.rigid_activity_tracker_.set_quiet_frames(tracker.get_quiet_frames());
+    }
+
+    return context;
+}
+
+void Plugin::Impl::remove_pending_contexts()
+{
+    if (current_->removed_)
+        current_ = contexts_.front().get();
+
+    bool removed = false;
+    for (auto&& context: contexts_)
+    {
+        if (context->removed_)
+        {
+            context->destroy();
+            removed = true;
+        }
+    }
+
+    if (!removed)
+        return;
+
+    contexts_.erase(std::remove_if(contexts_.begin(), contexts_.end(), [](const std::unique_ptr<SolverContext>& context) {
+        return context->removed_;
+    }), contexts_.end());
+
+    // other contexts do not re-create instances of removed contexts
+    destroy_unused_meshes();
+}
+
+Plugin::Impl::SolverContext::SolverContext(Impl& impl, const std::string& name): impl_(impl), self_(impl.self_), name_(name)
 {
     params_.substeps_count = 2;
 
@@ -83,25 +529,38 @@ Plugin::Impl::Impl(Plugin& self): self_(self)
     params_.wave_floor_tilt = 0.0f;
 }
 
-void Plugin::Impl::destroy()
+void Plugin::Impl::SolverContext::destroy()
 {
     self_.trace("Destroy flex.");
 
+    destroy_readback_slots();
+    placed_particles_.clear();
+
+    mesh_bounds_cache_.clear();
+
+    // instances bind rigids again after reset
+    rigid_binding_table_.clear();
+    rigid_activity_tracker_.clear();
+    particle_query_.clear();
+
     if (buffer_)
     {
+        // meshes are destroyed after instances are re-created if they are not used
+        buffer_->shape_flags.map();
+        buffer_->shape_geometry.map();
+        release_shape_meshes(0, buffer_->shape_flags.size());
+
         buffer_->destroy();
         delete buffer_;
         buffer_ = nullptr;
     }
 
-    if (solver_)
-    {
-        NvFlexDestroySolver(solver_);
-        solver_ = nullptr;
-    }
+    particle_staging_.reset();
+
+    solver_.reset();
 }
 
-void Plugin::Impl::reset()
+void Plugin::Impl::SolverContext::reset()
 {
     self_.trace("Reset flex.");
 
@@ -111,7 +570,8 @@ void Plugin::Impl::reset()
     self_.trace("Creating flex buffer.");
 
     // alloc buffers
-    buffer_ = new FlexBuffer(library_);
+    buffer_ = new FlexBuffer(impl_.library_);
+    particle_staging_ = std::make_unique<ParticleStaging>(impl_.library_);
 
     // map during initialization
     buffer_->map();
@@ -172,7 +632,7 @@ void Plugin::Impl::reset()
     flex_params_.plasticThreshold = 0.0f;
     flex_params_.plasticCreep = 0.0f;
     flex_params_.fluid = false;
-    flex_params_.sleepThreshold = 0.0f;
+    flex_params_.sleepThreshold = rigid_activity_tracker_.get_threshold();
     flex_params_.shockPropagation = 0.0f;
     flex_params_.restitution = 0.0f;
 
@@ -208,9 +668,15 @@ void Plugin::Impl::reset()
     params_.scene_lower = FLT_MAX;
     params_.scene_upper = -FLT_MAX;
 
+    readback_latency_ = (std::max)(0, self_.get_setting<rpcore::IntType>("readback_latency"));
+
     // create scene
-    for (auto&& instance: instances_)
-        instance->initialize(self_);
+    for (auto&& record: instances_)
+    {
+        record.begin = BufferSizes(*buffer_);
+        record.instance->initialize(self_);
+        record.end = BufferSizes(*buffer_);
+    }
 
     uint32_t num_particles = buffer_->positions.size();
     uint32_t max_particles = num_particles + params_.num_extra_particles * params_.num_extra_multiplier;
@@ -243,17 +709,14 @@ void Plugin::Impl::reset()
     LVecBase3f particle_upper;
     GetParticleBounds(*buffer_, particle_lower, particle_upper);
 
-    // TODO: implement
     // accommodate shapes
-    //LVecBase3f shape_lower;
-    //LVecBase3f shape_upper;
-    //GetShapeBounds(shape_lower, shape_upper);
+    LVecBase3f shape_lower;
+    LVecBase3f shape_upper;
+    GetShapeBounds(impl_.library_, *buffer_, mesh_bounds_cache_, shape_lower, shape_upper);
 
     // update bounds
-    //params_.scene_lower = (std::min)((std::min)(params_.scene_lower, particle_lower), shape_lower);
-    //params_.scene_upper = (std::max)((std::max)(params_.scene_upper, particle_upper), shape_upper);
-    params_.scene_lower = params_.scene_lower.fmin(particle_lower);
-    params_.scene_upper = params_.scene_upper.fmax(particle_upper);
+    params_.scene_lower = params_.scene_lower.fmin(particle_lower).fmin(shape_lower);
+    params_.scene_upper = params_.scene_upper.fmax(particle_upper).fmax(shape_upper);
 
     params_.scene_lower -= flex_params_.collisionDistance;
     params_.scene_upper += flex_params_.collisionDistance;
@@ -283,13 +746,17 @@ void Plugin::Impl::reset()
     self_.trace("Creating solver.");
 
     // main create method for the Flex solver
-    solver_ = NvFlexCreateSolver(library_, max_particles, params_.max_diffuse_particles, params_.max_neighbors_per_particle);
+    solver_ = create_solver(max_particles);
 
-    // create active indices (just a contiguous block for the demo)
+    // create active indices as a contiguous block
+    // and the remaining particles are used for spawning.
+    buffer_->active_indices.reserve(max_particles);
     buffer_->active_indices.resize(buffer_->positions.size());
     for (int i = 0; i < buffer_->active_indices.size(); ++i)
         buffer_->active_indices[i] = i;
 
+    particle_pool_.reset(max_particles, num_particles);
+
     // resize particle buffers to fit
     buffer_->positions.resize(max_particles);
     buffer_->velocities.resize(max_particles);
@@ -321,8 +788,12 @@ void Plugin::Impl::reset()
         buffer_->rigid_translations.resize(buffer_->rigid_offsets.size() - 1, LVecBase3());
     }
 
-    for (auto&& instance: instances_)
-        instance->post_initialize(self_);
+    for (auto&& record: instances_)
+        record.instance->post_initialize(self_);
+
+    max_particles_ = max_particles;
+    particles_end_ = num_particles;
+    changed_buffers_ = 0;
 
     // unmap so we can start transferring data to GPU
     buffer_->unmap();
@@ -330,195 +801,1110 @@ void Plugin::Impl::reset()
     self_.trace("Sending data.");
 
     // Send data to Flex
-    NvFlexSetParams(solver_, &flex_params_);
-    NvFlexSetParticles(solver_, buffer_->positions.buffer, num_particles);
-    NvFlexSetVelocities(solver_, buffer_->velocities.buffer, num_particles);
-    NvFlexSetNormals(solver_, buffer_->normals.buffer, num_particles);
-    NvFlexSetPhases(solver_, buffer_->phases.buffer, buffer_->phases.size());
-    NvFlexSetRestParticles(solver_, buffer_->rest_positions.buffer, buffer_->rest_positions.size());
+    solver_->set_params(flex_params_);
+    solver_->set_particles(buffer_->positions, num_particles);
+    solver_->set_velocities(buffer_->velocities, num_particles);
+    solver_->set_normals(buffer_->normals, num_particles);
+    solver_->set_phases(buffer_->phases, buffer_->phases.size());
+    solver_->set_rest_particles(buffer_->rest_positions, buffer_->rest_positions.size());
 
-    NvFlexSetActive(solver_, buffer_->active_indices.buffer, num_particles);
+    solver_->set_active(buffer_->active_indices, num_particles);
 
-    // springs
+    unsigned int flags = 0;
     if (buffer_->spring_indices.size())
+        flags |= BUFFER_SPRINGS;
+    if (buffer_->rigid_offsets.size())
+        flags |= BUFFER_RIGIDS;
+    if (buffer_->inflatable_tri_offsets.size())
+        flags |= BUFFER_INFLATABLES;
+    if (buffer_->triangles.size())
+        flags |= BUFFER_TRIANGLES;
+    if (buffer_->shape_flags.size())
+        flags |= BUFFER_SHAPES;
+    send_buffers(flags);
+
+    // destroy meshes which are not used after re-creating instances
+    impl_.destroy_unused_meshes();
+
+    create_readback_slots();
+}
+
+int Plugin::Impl::SolverContext::spawn_particles(int count, const LVecBase4f* positions, const LVecBase3f* velocities, int phase,
+    std::vector<int>* indices)
+{
+    int spawned_count = 0;
+    for (; spawned_count < count; ++spawned_count)
+    {
+        const int index = particle_pool_.allocate(buffer_->active_indices);
+        if (index == -1)
+            break;
+
+        buffer_->positions[index] = positions[spawned_count];
+        buffer_->velocities[index] = velocities ? velocities[spawned_count] : LVecBase3f(0.0f);
+        buffer_->phases[index] = phase;
+
+        if (readback_latency_ > 0)
+            placed_particles_.push_back({ index, buffer_->positions[index], buffer_->velocities[index] });
+
+        if (indices)
+            indices->push_back(index);
+    }
+
+    if (spawned_count < count)
+        self_.warn(fmt::format("Not enough free particles: {} of {} particles are spawned.", spawned_count, count));
+
+    return spawned_count;
+}
+
+int Plugin::Impl::SolverContext::kill_particles(const int* indices, int count)
+{
+    int killed_count = 0;
+    for (int k = 0; k < count; ++k)
+    {
+        if (particle_pool_.free(indices[k], buffer_->active_indices))
+            ++killed_count;
+    }
+    return killed_count;
+}
+
+void Plugin::Impl::SolverContext::send_buffers(unsigned int flags)
+{
+    if (flags & BUFFER_REST_PARTICLES)
+        solver_->set_rest_particles(buffer_->rest_positions, buffer_->rest_positions.size());
+
+    // springs
+    if (flags & BUFFER_SPRINGS)
     {
         assert((buffer_->spring_indices.size() & 1) == 0);
         assert((buffer_->spring_indices.size() / 2) == buffer_->spring_lengths.size());
 
-        NvFlexSetSprings(solver_,
-            buffer_->spring_indices.buffer,
-            buffer_->spring_lengths.buffer,
-            buffer_->spring_stiffness.buffer,
+        solver_->set_springs(
+            buffer_->spring_indices,
+            buffer_->spring_lengths,
+            buffer_->spring_stiffness,
             buffer_->spring_lengths.size());
     }
 
     // rigids
-    if (buffer_->rigid_offsets.size())
+    if (flags & BUFFER_RIGIDS)
     {
-        NvFlexSetRigids(solver_,
-            buffer_->rigid_offsets.buffer,
-            buffer_->rigid_indices.buffer,
-            buffer_->rigid_local_positions.buffer,
-            buffer_->rigid_local_normals.buffer,
-            buffer_->rigid_coefficients.buffer,
-            buffer_->rigid_rotations.buffer,
-            buffer_->rigid_translations.buffer,
-            buffer_->rigid_offsets.size() - 1,
+        solver_->set_rigids(
+            buffer_->rigid_offsets,
+            buffer_->rigid_indices,
+            buffer_->rigid_local_positions,
+            buffer_->rigid_local_normals,
+            buffer_->rigid_coefficients,
+            buffer_->rigid_rotations,
+            buffer_->rigid_translations,
+            (std::max)(0, buffer_->rigid_offsets.size() - 1),
             buffer_->rigid_indices.size());
     }
 
     // inflatables
-    if (buffer_->inflatable_tri_offsets.size())
+    if (flags & BUFFER_INFLATABLES)
     {
-        NvFlexSetInflatables(solver_,
-            buffer_->inflatable_tri_offsets.buffer,
-            buffer_->inflatable_tri_counts.buffer,
-            buffer_->inflatable_volumes.buffer,
-            buffer_->inflatable_pressures.buffer,
-            buffer_->inflatable_coefficients.buffer,
+        solver_->set_inflatables(
+            buffer_->inflatable_tri_offsets,
+            buffer_->inflatable_tri_counts,
+            buffer_->inflatable_volumes,
+            buffer_->inflatable_pressures,
+            buffer_->inflatable_coefficients,
             buffer_->inflatable_tri_offsets.size());
     }
 
     // dynamic triangles
-    if (buffer_->triangles.size())
+    if (flags & BUFFER_TRIANGLES)
     {
-        NvFlexSetDynamicTriangles(solver_,
-            buffer_->triangles.buffer,
-            buffer_->triangle_normals.buffer,
+        solver_->set_dynamic_triangles(
+            buffer_->triangles,
+            buffer_->triangle_normals,
             buffer_->triangles.size() / 3);
     }
 
     // collision shapes
-    if (buffer_->shape_flags.size())
+    if (flags & BUFFER_SHAPES)
     {
-        NvFlexSetShapes(
-            solver_,
-            buffer_->shape_geometry.buffer,
-            buffer_->shape_positions.buffer,
-            buffer_->shape_rotations.buffer,
-            buffer_->shape_prev_positions.buffer,
-            buffer_->shape_prev_rotations.buffer,
-            buffer_->shape_flags.buffer,
+        solver_->set_shapes(
+            buffer_->shape_geometry,
+            buffer_->shape_positions,
+            buffer_->shape_rotations,
+            buffer_->shape_prev_positions,
+            buffer_->shape_prev_rotations,
+            buffer_->shape_flags,
             int(buffer_->shape_flags.size()));
     }
 }
 
-void Plugin::Impl::on_pipeline_created()
+void Plugin::Impl::SolverContext::process_instance_changes()
 {
-    rpcore::Globals::base->add_task([this](rppanda::FunctionalTask* task) {
-        reset();
-        return AsyncTask::DS_done;
-    }, "Plugin::reset");
-}
+    if (added_instances_.empty() && removed_instances_.empty())
+        return;
 
-void Plugin::Impl::on_pre_render_update()
-{
-    // Scene Update
-    buffer_->map();
+    const int rigids_count = buffer_->rigid_rotations.size();
+    const int triangles_count = buffer_->triangles.size();
 
-    for (auto&& instance: instances_)
-        instance->sync_flex(self_);
+    for (auto&& instance: removed_instances_)
+    {
+        auto found = std::find_if(instances_.begin(), instances_.end(), [&](const InstanceRecord& record) {
+            return record.instance == instance;
+        });
 
-    // unmap buffers
-    buffer_->unmap();
-}
+        if (found == instances_.end())
+        {
+            self_.warn("The instance to remove is not added.");
+            continue;
+        }
 
-void Plugin::Impl::on_post_render_update()
-{
-    // send any particle updates to the solver
-    NvFlexSetParticles(solver_, buffer_->positions.buffer, buffer_->positions.size());
-    NvFlexSetVelocities(solver_, buffer_->velocities.buffer, buffer_->velocities.size());
-    NvFlexSetPhases(solver_, buffer_->phases.buffer, buffer_->phases.size());
-    NvFlexSetActive(solver_, buffer_->active_indices.buffer, buffer_->active_indices.size());
+        remove_instance_now(std::distance(instances_.begin(), found));
+    }
+    removed_instances_.clear();
 
-    // tick solver
-    if (flex_params_changed_)
+    for (auto&& instance: added_instances_)
     {
-        NvFlexSetParams(solver_, &flex_params_);
-        flex_params_changed_ = false;
-    }
-    NvFlexUpdateSolver(solver_, float(ClockObject::get_global_clock()->get_dt()), params_.substeps_count, false);
+        const auto begin_time = std::chrono::steady_clock::now();
 
-    // read back base particle data
-    // Note that flexGet calls don't wait for the GPU, they just queue a GPU copy
-    // to be executed later.
-    // When we're ready to read the fetched buffers we'll Map them, and that's when
-    // the CPU will wait for the GPU flex update and GPU copy to finish.
-    NvFlexGetParticles(solver_, buffer_->positions.buffer, buffer_->positions.size());
-    NvFlexGetVelocities(solver_, buffer_->velocities.buffer, buffer_->velocities.size());
+        InstanceRecord record;
+        record.instance = instance;
+        if (!initialize_instance_live(record))
+            continue;
 
-    // readback triangle normals
-    if (buffer_->triangles.size())
-        NvFlexGetDynamicTriangles(solver_, buffer_->triangles.buffer, buffer_->triangle_normals.buffer, buffer_->triangles.size() / 3);
+        instances_.push_back(std::move(record));
 
-    // readback rigid transforms
-    if (buffer_->rigid_offsets.size())
-        NvFlexGetRigidTransforms(solver_, buffer_->rigid_rotations.buffer, buffer_->rigid_translations.buffer);
-}
+        self_.debug(fmt::format("Instance is added in {} ms ({} instances, {} particles).",
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count(),
+            instances_.size(), buffer_->active_indices.size()));
+    }
+    added_instances_.clear();
 
-void Plugin::Impl::on_unload()
-{
-    destroy();
+    impl_.destroy_unused_meshes();
 
-    if (library_)
-        NvFlexShutdown(library_);
+    // readback buffers should have the same size
+    if (readback_latency_ > 0 &&
+        (rigids_count != buffer_->rigid_rotations.size() || triangles_count != buffer_->triangles.size()))
+    {
+        create_readback_slots();
+    }
 }
 
-// ************************************************************************************************
-
-Plugin::Plugin(rpcore::RenderPipeline& pipeline): BasePlugin(pipeline, RPPLUGINS_ID_STRING), impl_(std::make_unique<Impl>(*this))
+bool Plugin::Impl::SolverContext::initialize_instance_live(InstanceRecord& record)
 {
-}
-
-Plugin::~Plugin() = default;
+    // New particles are appended after particles of other instances.
+    // They are staged until the range is allocated, so live particles are not changed on failure.
+    particle_staging_->begin(*buffer_, particles_end_);
+    record.begin = BufferSizes(*buffer_);
+    record.instance->initialize(self_);
+    record.end = BufferSizes(*buffer_);
+    particle_staging_->end(*buffer_);
+
+    const int particles_begin = record.begin.particles;
+    const int particles_end = record.end.particles;
+
+    if (!particle_staging_->commit(*buffer_, particle_pool_, max_particles_))
+    {
+        self_.error(fmt::format("Not enough free particles to add instance ({} particles).", particles_end - particles_begin));
+        truncate_buffers(record.begin);
+        return false;
+    }
 
-Plugin::RequrieType& Plugin::get_required_plugins() const
-{
-    return impl_->require_plugins_;
-}
+    particles_end_ = (std::max)(particles_end_, particles_end);
 
-void Plugin::on_load()
-{
-    // use the PhysX GPU selected from the NVIDIA control panel
-    int device_index = NvFlexDeviceGetSuggestedOrdinal();
+    auto& positions = buffer_->positions;
+    for (int k = particles_begin; k < particles_end; ++k)
+    {
+        buffer_->rest_positions[k] = positions[k];
 
-    // Create an optimized CUDA context for Flex and set it on the
-    // calling thread. This is an optional call, it is fine to use
-    // a regular CUDA context, although creating one through this API
-    // is recommended for best performance.
-    bool success = NvFlexDeviceCreateCudaContext(device_index);
+        // the other particles in FlexBuffer are older than solver with pipelined readback
+        if (readback_latency_ > 0)
+            placed_particles_.push_back({ k, positions[k], buffer_->velocities[k] });
+    }
 
-    if (!success)
+    if (particles_begin != particles_end)
     {
-        error("Error creating CUDA context.");
-        return;
+        if (readback_latency_ == 0)
+            particles_changed_ = true;
+        changed_buffers_ |= BUFFER_REST_PARTICLES;
     }
 
-    NvFlexInitDesc desc;
-    desc.deviceIndex = device_index;
-    desc.enableExtensions = true;
-    desc.renderDevice = 0;
-    desc.renderContext = 0;
-    desc.computeType = eNvFlexCUDA;
+    // builds constraints of new rigids
+    if (record.begin.rigid_offsets != record.end.rigid_offsets)
+    {
+        const int rigids_begin = (std::max)(0, record.begin.rigid_offsets - 1);
+        const int num_rigids = buffer_->rigid_offsets.size() - 1;
 
-    // Init Flex library, note that no CUDA methods should be called before this
-    // point to ensure we get the device context we want
-    impl_->library_ = NvFlexInit(NV_FLEX_VERSION, [](NvFlexErrorSeverity, const char* msg, const char* file, int line) {
-        RPObject::global_error(RPPLUGINS_ID_STRING, std::string(msg) + " - " + std::string(file) + ":" + std::to_string(line));
-    }, &desc);
+        buffer_->rigid_local_positions.resize(buffer_->rigid_offsets.back());
+        CalculateRigidLocalPositions(&positions[0], positions.size(), &buffer_->rigid_offsets[rigids_begin],
+            &buffer_->rigid_indices[0], num_rigids - rigids_begin,
+            &buffer_->rigid_local_positions[buffer_->rigid_offsets[rigids_begin]]);
 
-    if (!impl_->library_)
-    {
-        error("Could not initialize Flex, exiting.\n");
-        return;
+        // identity in (x, y, z, w) order of Flex
+        buffer_->rigid_rotations.resize(num_rigids, LQuaternionf(0.0f, 0.0f, 0.0f, 1.0f));
+        buffer_->rigid_translations.resize(num_rigids, LVecBase3f(0.0f));
+
+        changed_buffers_ |= BUFFER_RIGIDS;
     }
 
-    // store device name
-    info(std::string("Compute Device: ") + NvFlexGetDeviceName(impl_->library_));
-}
+    if (record.begin.springs != record.end.springs)
+        changed_buffers_ |= BUFFER_SPRINGS;
+    if (record.begin.shapes != record.end.shapes)
+        changed_buffers_ |= BUFFER_SHAPES;
+    if (record.begin.triangles != record.end.triangles)
+        changed_buffers_ |= BUFFER_TRIANGLES;
+    if (record.begin.inflatables != record.end.inflatables)
+        changed_buffers_ |= BUFFER_INFLATABLES;
+
+    record.instance->post_initialize(self_);
+
+    return true;
+}
+
+void Plugin::Impl::SolverContext::truncate_buffers(const BufferSizes& sizes)
+{
+    if (buffer_->rigid_offsets.size() != sizes.rigid_offsets)
+    {
+        const int num_rigids = (std::max)(0, sizes.rigid_offsets - 1);
+
+        buffer_->rigid_offsets.resize(sizes.rigid_offsets);
+        buffer_->rigid_indices.resize(sizes.rigid_indices);
+        buffer_->rigid_coefficients.resize(num_rigids);
+        buffer_->rigid_local_positions.resize((std::min)(buffer_->rigid_local_positions.size(), sizes.rigid_indices));
+        buffer_->rigid_local_normals.resize((std::min)(buffer_->rigid_local_normals.size(), sizes.rigid_indices));
+        buffer_->rigid_rotations.resize((std::min)(buffer_->rigid_rotations.size(), num_rigids));
+        buffer_->rigid_translations.resize((std::min)(buffer_->rigid_translations.size(), num_rigids));
+        changed_buffers_ |= BUFFER_RIGIDS;
+    }
+
+    if (buffer_->spring_lengths.size() != sizes.springs)
+    {
+        buffer_->spring_indices.resize(sizes.springs * 2);
+        buffer_->spring_lengths.resize(sizes.springs);
+        buffer_->spring_stiffness.resize(sizes.springs);
+        changed_buffers_ |= BUFFER_SPRINGS;
+    }
+
+    if (buffer_->shape_flags.size() != sizes.shapes)
+    {
+        release_shape_meshes(sizes.shapes, buffer_->shape_flags.size());
+
+        buffer_->shape_geometry.resize(sizes.shapes);
+        buffer_->shape_positions.resize(sizes.shapes);
+        buffer_->shape_rotations.resize(sizes.shapes);
+        buffer_->shape_prev_positions.resize(sizes.shapes);
+        buffer_->shape_prev_rotations.resize(sizes.shapes);
+        buffer_->shape_flags.resize(sizes.shapes);
+        changed_buffers_ |= BUFFER_SHAPES;
+    }
+
+    if (buffer_->triangles.size() != sizes.triangles)
+    {
+        buffer_->triangles.resize(sizes.triangles);
+        buffer_->triangle_normals.resize((std::min)(buffer_->triangle_normals.size(), sizes.triangles / 3));
+        changed_buffers_ |= BUFFER_TRIANGLES;
+    }
+
+    if (buffer_->inflatable_tri_offsets.size() != sizes.inflatables)
+    {
+        buffer_->inflatable_tri_offsets.resize(sizes.inflatables);
+        buffer_->inflatable_tri_counts.resize(sizes.inflatables);
+        buffer_->inflatable_volumes.resize(sizes.inflatables);
+        buffer_->inflatable_coefficients.resize(sizes.inflatables);
+        buffer_->inflatable_pressures.resize(sizes.inflatables);
+        changed_buffers_ |= BUFFER_INFLATABLES;
+    }
+}
+
+void Plugin::Impl::SolverContext::sync_instances()
+{
+    const size_t instances_count = instances_.size();
+
+    std::vector<InstanceInterface::BufferAccess> accesses;
+    accesses.reserve(instances_count);
+    for (const auto& record: instances_)
+        accesses.push_back(record.instance->get_buffer_access(self_));
+
+    std::vector<std::vector<size_t>> waves;
+    std::vector<size_t> wave_indices;
+
+    size_t run_begin = 0;
+    while (run_begin < instances_count)
+    {
+        // serial instances keep the order with others
+        if (!accesses[run_begin].parallel)
+        {
+            instances_[run_begin].instance->sync_flex(self_);
+            instances_[run_begin].instance->post_sync_flex(self_);
+            ++run_begin;
+            continue;
+        }
+
+        size_t run_end = run_begin + 1;
+        while (run_end < instances_count && accesses[run_end].parallel)
+            ++run_end;
+
+        // Each instance is placed after the last wave having a conflicting instance,
+        // so conflicting instances still run in the order of instances.
+        waves.clear();
+        wave_indices.resize(run_end - run_begin);
+        for (size_t k = run_begin; k < run_end; ++k)
+        {
+            size_t wave = 0;
+            for (size_t j = run_begin; j < k; ++j)
+            {
+                if (accesses[k].conflicts(accesses[j]))
+                    wave = (std::max)(wave, wave_indices[j - run_begin] + 1);
+            }
+
+            wave_indices[k - run_begin] = wave;
+            if (wave >= waves.size())
+                waves.resize(wave + 1);
+            waves[wave].push_back(k);
+        }
+
+        for (const auto& wave: waves)
+        {
+            parallel_syncing_ = true;
+            parallel_for(0, static_cast<int>(wave.size()), 1, [&](int begin, int end) {
+                for (int k = begin; k < end; ++k)
+                    instances_[wave[k]].instance->sync_flex(self_);
+            });
+            parallel_syncing_ = false;
+
+            // scene graph is changed only in the main thread
+            for (size_t index: wave)
+                instances_[index].instance->post_sync_flex(self_);
+        }
+
+        run_begin = run_end;
+    }
+}
+
+void Plugin::Impl::SolverContext::set_sleep_threshold(float speed)
+{
+    rigid_activity_tracker_.set_threshold(speed);
+    flex_params_.sleepThreshold = rigid_activity_tracker_.get_threshold();
+    flex_params_changed_ = true;
+}
+
+void Plugin::Impl::SolverContext::remove_instance_now(size_t record_index)
+{
+    const InstanceRecord record = instances_[record_index];
+    instances_.erase(instances_.begin() + record_index);
+
+    const auto& begin = record.begin;
+    const auto& end = record.end;
+
+    for (int k = begin.particles; k < end.particles; ++k)
+        particle_pool_.free(k, buffer_->active_indices);
+
+    particles_end_ = 0;
+    for (const auto& other: instances_)
+        particles_end_ = (std::max)(particles_end_, other.end.particles);
+
+    // buffers at the end are removed, and others are disabled
+    // because other instances use the indices of them.
+    BufferSizes sizes(*buffer_);
+
+    if (begin.rigid_offsets != end.rigid_offsets)
+    {
+        rigid_binding_table_.remove_rigids((std::max)(0, begin.rigid_offsets - 1), end.rigid_offsets - 1);
+        rigid_activity_tracker_.wake_rigids((std::max)(0, begin.rigid_offsets - 1), end.rigid_offsets - 1);
+    }
+
+    if (end.rigid_offsets == sizes.rigid_offsets)
+    {
+        sizes.rigid_offsets = begin.rigid_offsets;
+        sizes.rigid_indices = begin.rigid_indices;
+    }
+    else if (begin.rigid_offsets != end.rigid_offsets)
+    {
+        for (int k = (std::max)(0, begin.rigid_offsets - 1), k_end = end.rigid_offsets - 1; k < k_end; ++k)
+            buffer_->rigid_coefficients[k] = 0.0f;
+        changed_buffers_ |= BUFFER_RIGIDS;
+    }
+
+    if (end.springs == sizes.springs)
+    {
+        sizes.springs = begin.springs;
+    }
+    else if (begin.springs != end.springs)
+    {
+        for (int k = begin.springs; k < end.springs; ++k)
+            buffer_->spring_stiffness[k] = 0.0f;
+        changed_buffers_ |= BUFFER_SPRINGS;
+    }
+
+    if (end.shapes == sizes.shapes)
+    {
+        sizes.shapes = begin.shapes;
+    }
+    else if (begin.shapes != end.shapes)
+    {
+        // replace to a point sphere outside of scene
+        const LVecBase3f outside = params_.scene_lower -
+            LVecBase3f(1.0f + 2.0f * (flex_params_.collisionDistance + flex_params_.shapeCollisionMargin));
+
+        release_shape_meshes(begin.shapes, end.shapes);
+
+        for (int k = begin.shapes; k < end.shapes; ++k)
+        {
+            buffer_->shape_geometry[k].sphere.radius = 0.0f;
+            buffer_->shape_positions[k] = LVecBase4f(outside, 0.0f);
+            buffer_->shape_prev_positions[k] = buffer_->shape_positions[k];
+            buffer_->shape_flags[k] = NvFlexMakeShapeFlags(eNvFlexShapeSphere, false);
+        }
+        changed_buffers_ |= BUFFER_SHAPES;
+    }
+
+    if (end.triangles == sizes.triangles)
+    {
+        sizes.triangles = begin.triangles;
+    }
+    else if (begin.triangles != end.triangles)
+    {
+        // degenerate triangles
+        for (int k = begin.triangles; k < end.triangles; ++k)
+            buffer_->triangles[k] = buffer_->triangles[begin.triangles];
+        changed_buffers_ |= BUFFER_TRIANGLES;
+    }
+
+    if (end.inflatables == sizes.inflatables)
+    {
+        sizes.inflatables = begin.inflatables;
+    }
+    else if (begin.inflatables != end.inflatables)
+    {
+        for (int k = begin.inflatables; k < end.inflatables; ++k)
+            buffer_->inflatable_coefficients[k] = 0.0f;
+        changed_buffers_ |= BUFFER_INFLATABLES;
+    }
+
+    truncate_buffers(sizes);
+}
+
+void Plugin::Impl::SolverContext::release_shape_meshes(int begin, int end)
+{
+    for (int k = begin; k < end; ++k)
+    {
+        const auto& geometry = buffer_->shape_geometry[k];
+        switch (buffer_->shape_flags[k] & eNvFlexShapeFlagTypeMask)
+        {
+            case eNvFlexShapeTriangleMesh:
+                if (impl_.triangle_mesh_registry_)
+                    impl_.triangle_mesh_registry_->release(geometry.triMesh.mesh);
+                break;
+
+            case eNvFlexShapeSDF:
+                if (geometry.sdf.field)
+                    impl_.released_distance_fields_.push_back(geometry.sdf.field);
+                break;
+
+            case eNvFlexShapeConvexMesh:
+                if (geometry.convexMesh.mesh)
+                    impl_.released_convex_meshes_.push_back(geometry.convexMesh.mesh);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+std::unique_ptr<SolverBackend> Plugin::Impl::SolverContext::create_solver(int max_particles) const
+{
+    if (impl_.cpu_solver_)
+        return create_cpu_backend(max_particles);
+    else
+        return create_flex_backend(impl_.library_, max_particles, params_.max_diffuse_particles, params_.max_neighbors_per_particle);
+}
+
+void Plugin::Impl::SolverContext::create_readback_slots()
+{
+    destroy_readback_slots();
+
+    if (readback_latency_ == 0)
+        return;
+
+    self_.trace(fmt::format("Creating {} readback slots.", readback_latency_ + 1));
+
+    // N pending slots for latency N and one slot for the current readback
+    for (int k = 0; k <= readback_latency_; ++k)
+    {
+        readback_slots_.push_back(std::make_unique<ReadbackSlot>(impl_.library_));
+        readback_slots_.back()->resize(*buffer_);
+        free_readbacks_.push_back(readback_slots_.back().get());
+    }
+
+    // receives the latest state of solver to place particles
+    readback_slots_.push_back(std::make_unique<ReadbackSlot>(impl_.library_));
+    placement_slot_ = readback_slots_.back().get();
+}
+
+void Plugin::Impl::SolverContext::destroy_readback_slots()
+{
+    // wait for queued copies before freeing buffers
+    for (auto slot: pending_readbacks_)
+        slot->wait();
+
+    free_readbacks_.clear();
+    pending_readbacks_.clear();
+
+    for (auto&& slot: readback_slots_)
+        slot->destroy();
+    readback_slots_.clear();
+
+    placement_slot_ = nullptr;
+}
+
+void Plugin::Impl::SolverContext::send_placed_particles()
+{
+    // The pending readbacks are queued before placing, so they are placed again after swapping.
+    for (auto slot: pending_readbacks_)
+        slot->placed_particles.insert(slot->placed_particles.end(), placed_particles_.begin(), placed_particles_.end());
+
+    if (particles_changed_)
+    {
+        placed_particles_.clear();
+        return;
+    }
+
+    // Flex sets all particles at once, so the latest state is read back and the placed particles
+    // are written over it. CPU waits for solver only in this case.
+    auto& positions = placement_slot_->positions;
+    auto& velocities = placement_slot_->velocities;
+    resize_unmapped(positions, buffer_->positions.size());
+    resize_unmapped(velocities, buffer_->velocities.size());
+
+    solver_->get_particles(positions, positions.size());
+    solver_->get_velocities(velocities, velocities.size());
+
+    positions.map();
+    velocities.map();
+    for (const auto& particle: placed_particles_)
+    {
+        positions[particle.index] = particle.position;
+        velocities[particle.index] = particle.velocity;
+    }
+    positions.unmap();
+    velocities.unmap();
+
+    solver_->set_particles(positions, positions.size());
+    solver_->set_velocities(velocities, velocities.size());
+
+    placed_particles_.clear();
+}
+
+bool Plugin::Impl::SolverContext::save_snapshot(const Filename& path, bool compress) const
+{
+    const std::string err = snapshot::write(path.to_os_specific(), *buffer_, flex_params_, params_, compress);
+    if (!err.empty())
+    {
+        self_.error(err);
+        return false;
+    }
+
+    self_.debug(fmt::format("Snapshot is saved: {}", path.to_os_specific()));
+    return true;
+}
+
+bool Plugin::Impl::SolverContext::load_snapshot(const Filename& path)
+{
+    // restoring changes all buffers and may re-create solver
+    assert(!parallel_syncing_ && "load_snapshot is called in parallel sync_flex.");
+
+    const snapshot::Reader reader(path.to_os_specific());
+    if (!reader.get_error().empty())
+    {
+        self_.error(reader.get_error());
+        return false;
+    }
+
+    NvFlexParams flex_params;
+    Plugin::Parameters params;
+    std::vector<int> shape_flags;
+    if (!reader.read("flex_params", flex_params) || !reader.read("plugin_params", params) ||
+        !reader.read("shape_flags", shape_flags))
+    {
+        self_.error(fmt::format("Snapshot has no parameters or is saved by other build: {}", path.to_os_specific()));
+        return false;
+    }
+
+    // check active indices before changing buffers
+    const int snapshot_max_particles = reader.get_count("positions", sizeof(LVecBase4f));
+    std::vector<int> active_indices;
+    ParticlePool particle_pool;
+    if (snapshot_max_particles < 0 || !reader.read("active_indices", active_indices) ||
+        !particle_pool.reset(snapshot_max_particles, active_indices.data(), static_cast<int>(active_indices.size())))
+    {
+        self_.error(fmt::format("Snapshot has invalid active indices: {}", path.to_os_specific()));
+        return false;
+    }
+
+    // meshes are not saved, so mesh shapes should have the same types as current shapes
+    const int shapes_count = static_cast<int>(shape_flags.size());
+    const int current_shapes_count = buffer_->shape_flags.size();
+    for (int k = 0; k < shapes_count; ++k)
+    {
+        const int type = shape_flags[k] & eNvFlexShapeFlagTypeMask;
+        if (type != eNvFlexShapeTriangleMesh && type != eNvFlexShapeConvexMesh && type != eNvFlexShapeSDF)
+            continue;
+
+        if (k >= current_shapes_count || int(buffer_->shape_flags[k] & eNvFlexShapeFlagTypeMask) != type)
+        {
+            self_.error(fmt::format("Mesh shape {} of snapshot does not exist in current scene: {}", k, path.to_os_specific()));
+            return false;
+        }
+    }
+
+    const std::vector<NvFlexCollisionGeometry> current_geometry(buffer_->shape_geometry.mappedPtr,
+        buffer_->shape_geometry.mappedPtr + current_shapes_count);
+
+    // current mesh shapes replaced by primitives of snapshot
+    for (int k = 0, k_end = (std::min)(shapes_count, current_shapes_count); k < k_end; ++k)
+    {
+        if ((shape_flags[k] & eNvFlexShapeFlagTypeMask) != (buffer_->shape_flags[k] & eNvFlexShapeFlagTypeMask))
+            release_shape_meshes(k, k + 1);
+    }
+    if (shapes_count < current_shapes_count)
+        release_shape_meshes(shapes_count, current_shapes_count);
+
+    if (!reader.read(*buffer_))
+    {
+        self_.error(fmt::format("Failed to read snapshot. Buffers may be partially restored: {}", path.to_os_specific()));
+        return false;
+    }
+
+    for (int k = 0; k < shapes_count; ++k)
+    {
+        auto& geometry = buffer_->shape_geometry[k];
+        switch (shape_flags[k] & eNvFlexShapeFlagTypeMask)
+        {
+        case eNvFlexShapeTriangleMesh:
+            geometry.triMesh.mesh = current_geometry[k].triMesh.mesh;
+            break;
+        case eNvFlexShapeConvexMesh:
+            geometry.convexMesh.mesh = current_geometry[k].convexMesh.mesh;
+            break;
+        case eNvFlexShapeSDF:
+            geometry.sdf.field = current_geometry[k].sdf.field;
+            break;
+        default:
+            break;
+        }
+    }
+
+    const int max_particles = buffer_->positions.size();
+    const bool recreate_solver = max_particles != max_particles_ ||
+        params.max_diffuse_particles != params_.max_diffuse_particles ||
+        params.max_neighbors_per_particle != params_.max_neighbors_per_particle;
+
+    flex_params_ = flex_params;
+    params_ = params;
+
+    // pending readbacks have the state before restoring
+    destroy_readback_slots();
+
+    if (recreate_solver)
+    {
+        self_.trace("Re-creating solver for snapshot.");
+        solver_.reset();
+        solver_ = create_solver(max_particles);
+        max_particles_ = max_particles;
+    }
+
+    particle_pool_ = std::move(particle_pool);
+
+    create_readback_slots();
+
+    rigid_binding_table_.invalidate();
+    rigid_activity_tracker_.wake_all();
+
+    flex_params_changed_ = true;
+    particles_changed_ = true;
+    changed_buffers_ = BUFFER_REST_PARTICLES | BUFFER_SPRINGS | BUFFER_RIGIDS | BUFFER_INFLATABLES |
+        BUFFER_TRIANGLES | BUFFER_SHAPES;
+
+    self_.debug(fmt::format("Snapshot is loaded: {}", path.to_os_specific()));
+    return true;
+}
+
+void Plugin::Impl::SolverContext::read_back(FlexBuffer& buffer)
+{
+    read_back(buffer.positions, buffer.velocities, buffer.normals, buffer.triangles,
+        buffer.triangle_normals, buffer.rigid_rotations, buffer.rigid_translations);
+
+    if (fluid_readback_)
+        read_back_fluid(buffer.smooth_positions, buffer.anisotropy1, buffer.anisotropy2, buffer.anisotropy3);
+}
+
+void Plugin::Impl::SolverContext::read_back(ReadbackSlot& slot)
+{
+    read_back(slot.positions, slot.velocities, slot.normals, slot.triangles,
+        slot.triangle_normals, slot.rigid_rotations, slot.rigid_translations);
+
+    if (fluid_readback_)
+        read_back_fluid(slot.smooth_positions, slot.anisotropy1, slot.anisotropy2, slot.anisotropy3);
+}
+
+void Plugin::Impl::SolverContext::read_back(FlexVector<LVecBase4f>& positions, FlexVector<LVecBase3f>& velocities,
+    FlexVector<LVecBase4f>& normals, FlexVector<int>& triangles, FlexVector<LVecBase3f>& triangle_normals,
+    FlexVector<LQuaternionf>& rigid_rotations, FlexVector<LVecBase3f>& rigid_translations)
+{
+    // read back base particle data
+    // Note that flexGet calls don't wait for the GPU, they just queue a GPU copy
+    // to be executed later.
+    // When we're ready to read the fetched buffers we'll Map them, and that's when
+    // the CPU will wait for the GPU flex update and GPU copy to finish.
+    solver_->get_particles(positions, buffer_->positions.size());
+    solver_->get_velocities(velocities, buffer_->velocities.size());
+
+    // readback triangle normals and particle normals which solver computes from dynamic triangles
+    if (buffer_->triangles.size())
+    {
+        solver_->get_dynamic_triangles(triangles, triangle_normals, buffer_->triangles.size() / 3);
+        solver_->get_normals(normals, buffer_->normals.size());
+    }
+
+    // readback rigid transforms
+    if (buffer_->rigid_offsets.size())
+        solver_->get_rigid_transforms(rigid_rotations, rigid_translations);
+}
+
+void Plugin::Impl::SolverContext::read_back_fluid(FlexVector<LVecBase4f>& smooth_positions,
+    FlexVector<LVecBase4f>& anisotropy1, FlexVector<LVecBase4f>& anisotropy2, FlexVector<LVecBase4f>& anisotropy3)
+{
+    // smoothed positions and anisotropy are used for rendering of fluid
+    solver_->get_smooth_particles(smooth_positions, buffer_->smooth_positions.size());
+    solver_->get_anisotropy(anisotropy1, anisotropy2, anisotropy3);
+}
+
+bool Plugin::Impl::SolverContext::is_scheduled(unsigned int frame) const
+{
+    return (frame + update_offset_) % update_interval_ == 0;
+}
+
+void Plugin::Impl::SolverContext::on_pre_render_update()
+{
+    // use the oldest readback when it is delayed enough
+    ReadbackSlot* swapped_slot = nullptr;
+    if (readback_latency_ > 0 && int(pending_readbacks_.size()) > readback_latency_)
+    {
+        swapped_slot = pending_readbacks_.front();
+        pending_readbacks_.pop_front();
+
+        // the buffers of FlexBuffer is used for next readback
+        swapped_slot->swap(*buffer_);
+        free_readbacks_.push_back(swapped_slot);
+    }
+
+    // Scene Update
+    // CPU waits here until the readback is finished.
+    {
+        ScopedProfile profile(impl_.profiler_, Profiler::PHASE_MAP);
+        buffer_->map();
+        readback_wait_time_ = profile.get_elapsed_time() / 1000.0;
+    }
+
+    // the swapped readback does not have particles placed after it
+    if (swapped_slot)
+        swapped_slot->apply_placed_particles(*buffer_);
+
+    {
+        ScopedProfile profile(impl_.profiler_, Profiler::PHASE_SYNC);
+
+        // index the read back positions, so instances can use queries in sync_flex
+        if (particle_query_enabled_)
+        {
+            particle_query_.build(*buffer_, particle_query_cell_size_ > 0.0f ?
+                particle_query_cell_size_ : 2.0f * flex_params_.radius);
+        }
+
+        sync_instances();
+
+        process_instance_changes();
+
+        // changes of particles by users or new instances wake all rigids
+        if (particles_changed_ || !placed_particles_.empty())
+            rigid_activity_tracker_.wake_all();
+        rigid_activity_tracker_.update(*buffer_, flex_params_.radius);
+
+        rigid_binding_table_.sync(*buffer_, &rigid_activity_tracker_);
+    }
+
+    // fluid stage renders the particles of the default context
+    if (impl_.fluid_render_stage_ && this == impl_.contexts_.front().get())
+        impl_.fluid_render_stage_->update_particles(*buffer_, flex_params_);
+
+    // unmap buffers
+    buffer_->unmap();
+}
+
+void Plugin::Impl::SolverContext::on_post_render_update(float dt)
+{
+    {
+        ScopedProfile profile(impl_.profiler_, Profiler::PHASE_SEND);
+
+        // send any particle updates to the solver
+        // With pipelined readback, the host particles are older than the solver state.
+        // So, they are sent only when users changed them, and spawned particles are placed on the solver state.
+        if (readback_latency_ > 0 && !placed_particles_.empty())
+            send_placed_particles();
+
+        if (readback_latency_ == 0 || particles_changed_)
+        {
+            solver_->set_particles(buffer_->positions, buffer_->positions.size());
+            solver_->set_velocities(buffer_->velocities, buffer_->velocities.size());
+            particles_changed_ = false;
+        }
+        solver_->set_phases(buffer_->phases, buffer_->phases.size());
+        solver_->set_active(buffer_->active_indices, buffer_->active_indices.size());
+
+        if (changed_buffers_)
+        {
+            send_buffers(changed_buffers_);
+            changed_buffers_ = 0;
+        }
+
+        if (flex_params_changed_)
+        {
+            solver_->set_params(flex_params_);
+            flex_params_changed_ = false;
+        }
+    }
+
+    // tick solver
+    {
+        ScopedProfile profile(impl_.profiler_, Profiler::PHASE_UPDATE);
+        solver_->update(dt, params_.substeps_count, impl_.profiler_.is_enabled());
+    }
+
+    {
+        ScopedProfile profile(impl_.profiler_, Profiler::PHASE_READBACK);
+
+        if (readback_latency_ == 0)
+        {
+            read_back(*buffer_);
+        }
+        else
+        {
+            auto slot = free_readbacks_.front();
+            free_readbacks_.pop_front();
+
+            read_back(*slot);
+
+            pending_readbacks_.push_back(slot);
+        }
+    }
+}
+
+// ************************************************************************************************
+
+void Plugin::Impl::on_pipeline_created()
+{
+    rpcore::Globals::base->add_task([this](rppanda::FunctionalTask* task) {
+        pipeline_created_ = true;
+
+        SolverContext* selected = current_;
+        for (auto&& context: contexts_)
+        {
+            current_ = context.get();
+            context->reset();
+        }
+        current_ = selected;
+
+        return AsyncTask::DS_done;
+    }, "Plugin::reset");
+}
+
+void Plugin::Impl::on_pre_render_update()
+{
+    remove_pending_contexts();
+
+    const float dt = float(ClockObject::get_global_clock()->get_dt());
+
+    // instances use the API of Plugin for the context which calls them
+    SolverContext* selected = current_;
+    for (auto&& context: contexts_)
+    {
+        current_ = context.get();
+
+        // contexts added after the pipeline is created
+        if (!context->solver_ && pipeline_created_)
+            context->reset();
+
+        if (!context->solver_)
+            continue;
+
+        context->accumulated_dt_ += dt;
+        if (context->is_scheduled(frame_))
+            context->on_pre_render_update();
+    }
+    current_ = selected;
+}
+
+void Plugin::Impl::on_post_render_update()
+{
+    for (auto&& context: contexts_)
+    {
+        if (!context->solver_ || !context->is_scheduled(frame_))
+            continue;
+
+        // skipped frames are simulated in one step
+        context->on_post_render_update(context->accumulated_dt_);
+        context->accumulated_dt_ = 0.0f;
+    }
+
+    if (profiler_.is_enabled())
+    {
+        // NvFlexGetTimers waits for the solver, so it is called after all readbacks are requested.
+        NvFlexTimers timers = {};
+        bool valid = false;
+        for (auto&& context: contexts_)
+        {
+            NvFlexTimers context_timers = {};
+            if (context->solver_ && context->is_scheduled(frame_) && context->solver_->get_timers(context_timers))
+            {
+                add_solver_timers(timers, context_timers);
+                valid = true;
+            }
+        }
+        profiler_.set_solver_timers(timers, valid);
+        profiler_.end_frame();
+    }
+
+    ++frame_;
+}
+
+bool Plugin::Impl::init_flex_library()
+{
+    // use the PhysX GPU selected from the NVIDIA control panel
+    int device_index = NvFlexDeviceGetSuggestedOrdinal();
+
+    // Create an optimized CUDA context for Flex and set it on the
+    // calling thread. This is an optional call, it is fine to use
+    // a regular CUDA context, although creating one through this API
+    // is recommended for best performance.
+    bool success = NvFlexDeviceCreateCudaContext(device_index);
+
+    if (!success)
+    {
+        self_.error("Error creating CUDA context.");
+        return false;
+    }
+
+    NvFlexInitDesc desc;
+    desc.deviceIndex = device_index;
+    desc.enableExtensions = true;
+    desc.renderDevice = 0;
+    desc.renderContext = 0;
+    desc.computeType = eNvFlexCUDA;
+
+    // Init Flex library, note that no CUDA methods should be called before this
+    // point to ensure we get the device context we want
+    library_ = NvFlexInit(NV_FLEX_VERSION, [](NvFlexErrorSeverity, const char* msg, const char* file, int line) {
+        RPObject::global_error(RPPLUGINS_ID_STRING, std::string(msg) + " - " + std::string(file) + ":" + std::to_string(line));
+    }, &desc);
+
+    if (!library_)
+    {
+        self_.error("Could not initialize Flex, exiting.\n");
+        return false;
+    }
+
+    // store device name
+    self_.info(std::string("Compute Device: ") + NvFlexGetDeviceName(library_));
+
+    return true;
+}
+
+void Plugin::Impl::destroy_unused_meshes()
+{
+    if (triangle_mesh_registry_)
+        triangle_mesh_registry_->collect_garbage();
+
+    for (auto sdf: released_distance_fields_)
+        NvFlexDestroyDistanceField(library_, sdf);
+    released_distance_fields_.clear();
+
+    for (auto convex: released_convex_meshes_)
+        NvFlexDestroyConvexMesh(library_, convex);
+    released_convex_meshes_.clear();
+}
+
+void Plugin::Impl::on_unload()
+{
+    for (auto&& context: contexts_)
+        context->destroy();
+
+    destroy_unused_meshes();
+    triangle_mesh_registry_.reset();
+
+    if (library_)
+        NvFlexShutdown(library_);
+}
+
+// ************************************************************************************************
+
+Plugin::Plugin(rpcore::RenderPipeline& pipeline): BasePlugin(pipeline, RPPLUGINS_ID_STRING), impl_(std::make_unique<Impl>(*this))
+{
+}
+
+Plugin::~Plugin() = default;
+
+Plugin::RequrieType& Plugin::get_required_plugins() const
+{
+    return impl_->require_plugins_;
+}
+
+void Plugin::on_load()
+{
+    // CPU solver uses host buffers, so Flex and CUDA are not initialized.
+    impl_->cpu_solver_ = get_setting<rpcore::EnumType>("solver_backend") == "cpu";
+    if (impl_->cpu_solver_)
+        info("Simulation runs on CPU solver.");
+    else if (!impl_->init_flex_library())
+        return;
+
+    impl_->profiler_.set_history_size(get_setting<rpcore::IntType>("profiling_history"));
+    impl_->profiler_.set_enabled(get_setting<rpcore::BoolType>("enable_profiling"));
+    for (auto&& context: impl_->contexts_)
+    {
+        context->rigid_activity_tracker_.set_threshold(get_setting<rpcore::FloatType>("sleep_threshold"));
+        context->rigid_activity_tracker_.set_quiet_frames(get_setting<rpcore::IntType>("sleep_frames"));
+    }
+
+    setting_changed_callbacks_.insert({
+        { "enable_profiling", [this]() { impl_->profiler_.set_enabled(get_setting<rpcore::BoolType>("enable_profiling")); } },
+        { "sleep_threshold", [this]() {
+            for (auto&& context: impl_->contexts_)
+                context->set_sleep_threshold(get_setting<rpcore::FloatType>("sleep_threshold"));
+        } },
+        { "sleep_frames", [this]() {
+            for (auto&& context: impl_->contexts_)
+                context->rigid_activity_tracker_.set_quiet_frames(get_setting<rpcore::IntType>("sleep_frames"));
+        } },
+    });
+
+    impl_->triangle_mesh_registry_ = std::make_unique<TriangleMeshRegistry>(impl_->library_);
+}
 
 void Plugin::on_stage_setup()
 {
+    if (!get_setting<rpcore::BoolType>("fluid_rendering"))
+        return;
+
+    const std::string smoothing_mode = get_setting<rpcore::EnumType>("fluid_smoothing_mode");
+    FluidRenderStage::SmoothingMode mode = FluidRenderStage::SmoothingMode::separable;
+    if (smoothing_mode == "half_resolution")
+        mode = FluidRenderStage::SmoothingMode::half_resolution;
+    else if (smoothing_mode == "compute")
+        mode = FluidRenderStage::SmoothingMode::compute;
+
+    auto fluid_render_stage = std::make_unique<FluidRenderStage>(pipeline_, mode,
+        get_setting<rpcore::IntType>("fluid_smoothing_iterations"));
+    impl_->fluid_render_stage_ = fluid_render_stage.get();
+    add_stage(std::move(fluid_render_stage));
+
+    // smoothed positions and anisotropy of the default context are used for splatting
+    impl_->contexts_.front()->fluid_readback_ = true;
 }
 
 void Plugin::on_pipeline_created()
@@ -541,9 +1927,113 @@ void Plugin::on_unload()
     impl_->on_unload();
 }
 
+bool Plugin::add_solver_context(const std::string& name, int update_interval, int update_offset)
+{
+    if (impl_->find_context(name))
+    {
+        error(fmt::format("Solver context ({}) already exists.", name));
+        return false;
+    }
+
+    impl_->add_context(name);
+    return set_solver_context_schedule(name, update_interval, update_offset);
+}
+
+bool Plugin::remove_solver_context(const std::string& name)
+{
+    auto context = impl_->find_context(name);
+    if (!context)
+    {
+        error(fmt::format("Solver context ({}) does not exist.", name));
+        return false;
+    }
+
+    if (context == impl_->contexts_.front().get())
+    {
+        error("Default solver context cannot be removed.");
+        return false;
+    }
+
+    context->removed_ = true;
+    return true;
+}
+
+bool Plugin::has_solver_context(const std::string& name) const
+{
+    return impl_->find_context(name) != nullptr;
+}
+
+std::vector<std::string> Plugin::get_solver_context_names() const
+{
+    std::vector<std::string> names;
+    for (auto&& context: impl_->contexts_)
+    {
+        if (!context->removed_)
+            names.push_back(context->name_);
+    }
+    return names;
+}
+
+bool Plugin::set_solver_context_schedule(const std::string& name, int update_interval, int update_offset)
+{
+    auto context = impl_->find_context(name);
+    if (!context)
+    {
+        error(fmt::format("Solver context ({}) does not exist.", name));
+        return false;
+    }
+
+    context->update_interval_ = (std::max)(1, update_interval);
+    context->update_offset_ = (update_offset % context->update_interval_ + context->update_interval_) % context->update_interval_;
+    return true;
+}
+
+bool Plugin::select_solver_context(const std::string& name)
+{
+    auto context = impl_->find_context(name);
+    if (!context)
+    {
+        error(fmt::format("Solver context ({}) does not exist.", name));
+        return false;
+    }
+
+    impl_->current_ = context;
+    return true;
+}
+
+const std::string& Plugin::get_solver_context() const
+{
+    return impl_->current_->name_;
+}
+
 void Plugin::add_instance(const std::shared_ptr<InstanceInterface>& instance)
 {
-    impl_->instances_.push_back(instance);
+    InstanceRecord record;
+    record.instance = instance;
+    impl_->current_->instances_.push_back(std::move(record));
+}
+
+void Plugin::add_instance_live(const std::shared_ptr<InstanceInterface>& instance)
+{
+    if (impl_->current_->solver_)
+        impl_->current_->added_instances_.push_back(instance);
+    else
+        add_instance(instance);
+}
+
+void Plugin::remove_instance(const std::shared_ptr<InstanceInterface>& instance)
+{
+    if (impl_->current_->solver_)
+    {
+        impl_->current_->removed_instances_.push_back(instance);
+    }
+    else
+    {
+        auto& instances = impl_->current_->instances_;
+        instances.erase(std::remove_if(instances.begin(), instances.end(), [&](const InstanceRecord& record) {
+            return record.instance == instance;
+        }), instances.end());
+    }
 }
 
 NvFlexLibrary* Plugin::get_flex_library() const
@@ -553,38 +2043,127 @@ NvFlexLibrary* Plugin::get_flex_library() const
 
 NvFlexSolver* Plugin::get_flex_solver() const
 {
-    return impl_->solver_;
+    return impl_->current_->solver_ ? impl_->current_->solver_->get_flex_solver() : nullptr;
 }
 
 const NvFlexParams& Plugin::get_flex_params() const
 {
-    return impl_->flex_params_;
+    return impl_->current_->flex_params_;
 }
 
 NvFlexParams& Plugin::get_flex_params()
 {
-    impl_->flex_params_changed_ = true;
-    return impl_->flex_params_;
+    impl_->current_->flex_params_changed_ = true;
+    return impl_->current_->flex_params_;
+}
+
+int Plugin::spawn_particles(int count, const LVecBase4f* positions, const LVecBase3f* velocities, int phase,
+    std::vector<int>* indices)
+{
+    return impl_->current_->spawn_particles(count, positions, velocities, phase, indices);
+}
+
+int Plugin::kill_particles(const int* indices, int count)
+{
+    return impl_->current_->kill_particles(indices, count);
+}
+
+bool Plugin::save_snapshot(const Filename& path, bool compress) const
+{
+    return impl_->current_->save_snapshot(path, compress);
+}
+
+bool Plugin::load_snapshot(const Filename& path)
+{
+    return impl_->current_->load_snapshot(path);
+}
+
+int Plugin::get_free_particles_count() const
+{
+    return impl_->current_->particle_pool_.get_free_count();
+}
+
+void Plugin::set_particles_changed()
+{
+    impl_->current_->particles_changed_ = true;
+}
+
+void Plugin::set_fluid_readback(bool enable)
+{
+    impl_->current_->fluid_readback_ = enable;
+}
+
+bool Plugin::get_fluid_readback() const
+{
+    return impl_->current_->fluid_readback_;
+}
+
+void Plugin::set_particle_query_enabled(bool enable, float cell_size)
+{
+    impl_->current_->particle_query_enabled_ = enable;
+    impl_->current_->particle_query_cell_size_ = cell_size;
+    if (!enable)
+        impl_->current_->particle_query_.clear();
+}
+
+bool Plugin::is_particle_query_enabled() const
+{
+    return impl_->current_->particle_query_enabled_;
+}
+
+const ParticleQuery& Plugin::get_particle_query() const
+{
+    return impl_->current_->particle_query_;
+}
+
+double Plugin::get_readback_wait_time() const
+{
+    return impl_->current_->readback_wait_time_;
 }
 
 const Plugin::Parameters& Plugin::get_plugin_params() const
 {
-    return impl_->params_;
+    return impl_->current_->params_;
 }
 
 Plugin::Parameters& Plugin::get_plugin_params()
 {
-    return impl_->params_;
+    return impl_->current_->params_;
 }
 
 const FlexBuffer& Plugin::get_flex_buffer() const
 {
-    return *impl_->buffer_;
+    return *impl_->current_->buffer_;
 }
 
 FlexBuffer& Plugin::get_flex_buffer()
 {
-    return *impl_->buffer_;
+    return *impl_->current_->buffer_;
+}
+
+TriangleMeshRegistry& Plugin::get_triangle_mesh_registry()
+{
+    return *impl_->triangle_mesh_registry_;
+}
+
+RigidBindingTable& Plugin::get_rigid_binding_table()
+{
+    return impl_->current_->rigid_binding_table_;
+}
+
+RigidActivityTracker& Plugin::get_rigid_activity_tracker()
+{
+    return impl_->current_->rigid_activity_tracker_;
+}
+
+const Profiler& Plugin::get_profiler() const
+{
+    return impl_->profiler_;
+}
+
+Profiler& Plugin::get_profiler()
+{
+    return impl_->profiler_;
 }
 
 }
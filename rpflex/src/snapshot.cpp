@@ -0,0 +1,298 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "snapshot.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <fmt/format.h>
+
+#if defined(RPFLEX_WITH_LZ4)
+#include <lz4.h>
+#endif
+
+namespace rpflex {
+namespace snapshot {
+
+static const char MAGIC[8] = { 'R', 'P', 'F', 'L', 'E', 'X', 'S', 'S' };
+static const uint32_t CHUNK_FLAG_LZ4 = 1 << 0;
+
+/** Payload of chunks are aligned for direct access of mapped memory. */
+static const size_t CHUNK_ALIGNMENT = 8;
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t chunks_count;
+};
+
+struct ChunkHeader
+{
+    char name[32];
+    uint32_t flags;
+    uint32_t element_size;
+    uint64_t raw_size;
+    uint64_t stored_size;
+};
+
+static size_t align_size(size_t size)
+{
+    return (size + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
+}
+
+class Writer
+{
+public:
+    Writer(const std::string& path, bool compress): file_(path, std::ios::binary), compress_(compress)
+    {
+    }
+
+    bool is_open() const { return file_.is_open(); }
+    bool good() const { return file_.good(); }
+
+    void write_header(uint32_t chunks_count)
+    {
+        FileHeader header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.chunks_count = chunks_count;
+        file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    void write_chunk(const char* name, const void* data, size_t element_size, size_t count)
+    {
+        ChunkHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::strncpy(header.name, name, sizeof(header.name) - 1);
+        header.element_size = static_cast<uint32_t>(element_size);
+        header.raw_size = element_size * count;
+        header.stored_size = header.raw_size;
+
+        const char* payload = static_cast<const char*>(data);
+
+#if defined(RPFLEX_WITH_LZ4)
+        if (compress_ && header.raw_size > 0 && header.raw_size <= LZ4_MAX_INPUT_SIZE)
+        {
+            const int raw_size = static_cast<int>(header.raw_size);
+            compressed_.resize(LZ4_compressBound(raw_size));
+            const int compressed_size = LZ4_compress_default(payload, compressed_.data(), raw_size,
+                static_cast<int>(compressed_.size()));
+
+            // store raw data when compression does not help
+            if (compressed_size > 0 && static_cast<uint64_t>(compressed_size) < header.raw_size)
+            {
+                header.flags |= CHUNK_FLAG_LZ4;
+                header.stored_size = compressed_size;
+                payload = compressed_.data();
+            }
+        }
+#endif
+
+        file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (header.stored_size > 0)
+            file_.write(payload, header.stored_size);
+
+        static const char padding[CHUNK_ALIGNMENT] = {};
+        file_.write(padding, align_size(header.stored_size) - header.stored_size);
+    }
+
+private:
+    std::ofstream file_;
+    bool compress_;
+    std::vector<char> compressed_;
+};
+
+std::string write(const std::string& path, const FlexBuffer& buffer, const NvFlexParams& flex_params,
+    const Plugin::Parameters& plugin_params, bool compress)
+{
+    Writer writer(path, compress);
+    if (!writer.is_open())
+        return fmt::format("Failed to open snapshot file: {}", path);
+
+    uint32_t chunks_count = 2;
+    visit_flex_vectors(buffer, [&](const char*, const auto&) { ++chunks_count; });
+
+    writer.write_header(chunks_count);
+    writer.write_chunk("flex_params", &flex_params, sizeof(flex_params), 1);
+    writer.write_chunk("plugin_params", &plugin_params, sizeof(plugin_params), 1);
+    visit_flex_vectors(buffer, [&](const char* name, const auto& vec) {
+        writer.write_chunk(name, vec.mappedPtr, sizeof(*vec.mappedPtr), vec.size());
+    });
+
+    if (!writer.good())
+        return fmt::format("Failed to write snapshot file: {}", path);
+
+    return {};
+}
+
+// ************************************************************************************************
+
+struct Reader::Mapping
+{
+    boost::interprocess::file_mapping file;
+    boost::interprocess::mapped_region region;
+};
+
+Reader::Reader(const std::string& path)
+{
+    try
+    {
+        mapping_ = std::make_unique<Mapping>();
+        mapping_->file = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only);
+        mapping_->region = boost::interprocess::mapped_region(mapping_->file, boost::interprocess::read_only);
+    }
+    catch (const boost::interprocess::interprocess_exception& err)
+    {
+        error_ = fmt::format("Failed to map snapshot file ({}): {}", path, err.what());
+        return;
+    }
+
+    const char* data = static_cast<const char*>(mapping_->region.get_address());
+    const size_t size = mapping_->region.get_size();
+
+    FileHeader header;
+    if (size < sizeof(header))
+    {
+        error_ = fmt::format("Invalid snapshot file: {}", path);
+        return;
+    }
+
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        error_ = fmt::format("Invalid snapshot file: {}", path);
+        return;
+    }
+
+    if (header.version > VERSION)
+    {
+        error_ = fmt::format("Snapshot version {} is not supported (current: {}): {}", header.version, VERSION, path);
+        return;
+    }
+
+    size_t offset = sizeof(header);
+    for (uint32_t k = 0; k < header.chunks_count; ++k)
+    {
+        ChunkHeader chunk_header;
+        if (size - offset < sizeof(chunk_header))
+        {
+            error_ = fmt::format("Snapshot file is truncated: {}", path);
+            return;
+        }
+
+        std::memcpy(&chunk_header, data + offset, sizeof(chunk_header));
+        offset += sizeof(chunk_header);
+
+        if (size - offset < chunk_header.stored_size)
+        {
+            error_ = fmt::format("Snapshot file is truncated: {}", path);
+            return;
+        }
+
+        chunk_header.name[sizeof(chunk_header.name) - 1] = '\0';
+
+        Chunk chunk;
+        chunk.flags = chunk_header.flags;
+        chunk.element_size = chunk_header.element_size;
+        chunk.raw_size = chunk_header.raw_size;
+        chunk.stored_size = chunk_header.stored_size;
+        chunk.data = data + offset;
+        chunks_[chunk_header.name] = chunk;
+
+        offset += (std::min)(size - offset, align_size(chunk_header.stored_size));
+    }
+}
+
+Reader::~Reader() = default;
+
+const std::string& Reader::get_error() const
+{
+    return error_;
+}
+
+bool Reader::has_chunk(const std::string& name) const
+{
+    return chunks_.find(name) != chunks_.end();
+}
+
+bool Reader::read(FlexBuffer& buffer) const
+{
+    bool result = true;
+    visit_flex_vectors(buffer, [&](const char* name, auto& vec) {
+        if (!has_chunk(name))
+            vec.resize(0);
+        else if (!read(name, vec))
+            result = false;
+    });
+    return result;
+}
+
+int Reader::get_count(const std::string& name, size_t element_size) const
+{
+    auto found = chunks_.find(name);
+    if (found == chunks_.end())
+        return -1;
+
+    const auto& chunk = found->second;
+    if (chunk.element_size != element_size || chunk.raw_size % element_size != 0)
+        return -1;
+
+    return static_cast<int>(chunk.raw_size / element_size);
+}
+
+bool Reader::read_chunk(const std::string& name, void* dst, size_t size) const
+{
+    const auto& chunk = chunks_.at(name);
+    if (chunk.raw_size != size)
+        return false;
+
+    if (size == 0)
+        return true;
+
+    if (chunk.flags & CHUNK_FLAG_LZ4)
+    {
+#if defined(RPFLEX_WITH_LZ4)
+        const int decompressed_size = LZ4_decompress_safe(chunk.data, static_cast<char*>(dst),
+            static_cast<int>(chunk.stored_size), static_cast<int>(size));
+        return decompressed_size == static_cast<int>(size);
+#else
+        // plugin is built without LZ4
+        return false;
+#endif
+    }
+
+    if (chunk.stored_size != size)
+        return false;
+
+    std::memcpy(dst, chunk.data, size);
+    return true;
+}
+
+}
+}
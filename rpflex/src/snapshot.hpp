@@ -0,0 +1,190 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rpflex/flex_buffer.hpp"
+#include "rpflex/plugin.hpp"
+
+namespace rpflex {
+
+/**
+ * Snapshot file of FlexBuffer, NvFlexParams and Plugin::Parameters.
+ *
+ * The file is a header followed by named chunks. Each chunk stores elements of one buffer
+ * and is compressed by LZ4 if the plugin is built with LZ4 and it reduces the size.
+ * Unknown chunks are skipped, so new chunks can be added without changing the version.
+ */
+namespace snapshot {
+
+constexpr uint32_t VERSION = 1;
+
+/** Call @p func(name, vector) for every vector in FlexBuffer. */
+template <class Buffer, class Func>
+void visit_flex_vectors(Buffer& buffer, const Func& func);
+
+/**
+ * Write a snapshot. Buffers should be mapped.
+ *
+ * @return  Empty string if succeeded, otherwise error message.
+ */
+std::string write(const std::string& path, const FlexBuffer& buffer, const NvFlexParams& flex_params,
+    const Plugin::Parameters& plugin_params, bool compress);
+
+/**
+ * Reader of a snapshot file which is mapped to memory.
+ * Chunks are decompressed or copied directly into the destination.
+ */
+class Reader
+{
+public:
+    Reader(const std::string& path);
+    ~Reader();
+
+    /** Get error message of opening file. Empty if the file is valid. */
+    const std::string& get_error() const;
+
+    bool has_chunk(const std::string& name) const;
+
+    /** Get the number of elements in the chunk, or -1 if the chunk does not exist or has other type. */
+    int get_count(const std::string& name, size_t element_size) const;
+
+    /** Read one value. */
+    template <class T>
+    bool read(const std::string& name, T& value) const;
+
+    template <class T>
+    bool read(const std::string& name, std::vector<T>& vec) const;
+
+    /** Resize and read the vector. The vector should be mapped. */
+    template <class T>
+    bool read(const std::string& name, FlexVector<T>& vec) const;
+
+    /** Read all vectors of FlexBuffer. Vectors without chunk are resized to zero. */
+    bool read(FlexBuffer& buffer) const;
+
+private:
+    struct Chunk
+    {
+        uint32_t flags;
+        uint32_t element_size;
+        uint64_t raw_size;
+        uint64_t stored_size;
+        const char* data;
+    };
+
+    bool read_chunk(const std::string& name, void* dst, size_t size) const;
+
+    struct Mapping;
+    std::unique_ptr<Mapping> mapping_;
+    std::unordered_map<std::string, Chunk> chunks_;
+    std::string error_;
+};
+
+// ************************************************************************************************
+template <class Buffer, class Func>
+void visit_flex_vectors(Buffer& buffer, const Func& func)
+{
+    func("positions", buffer.positions);
+    func("rest_positions", buffer.rest_positions);
+    func("velocities", buffer.velocities);
+    func("phases", buffer.phases);
+    func("densities", buffer.densities);
+    func("anisotropy1", buffer.anisotropy1);
+    func("anisotropy2", buffer.anisotropy2);
+    func("anisotropy3", buffer.anisotropy3);
+    func("normals", buffer.normals);
+    func("smooth_positions", buffer.smooth_positions);
+    func("diffuse_positions", buffer.diffuse_positions);
+    func("diffuse_velocities", buffer.diffuse_velocities);
+    func("diffuse_indices", buffer.diffuse_indices);
+    func("active_indices", buffer.active_indices);
+
+    func("shape_geometry", buffer.shape_geometry);
+    func("shape_positions", buffer.shape_positions);
+    func("shape_rotations", buffer.shape_rotations);
+    func("shape_prev_positions", buffer.shape_prev_positions);
+    func("shape_prev_rotations", buffer.shape_prev_rotations);
+    func("shape_flags", buffer.shape_flags);
+
+    func("rigid_offsets", buffer.rigid_offsets);
+    func("rigid_indices", buffer.rigid_indices);
+    func("rigid_mesh_size", buffer.rigid_mesh_size);
+    func("rigid_coefficients", buffer.rigid_coefficients);
+    func("rigid_rotations", buffer.rigid_rotations);
+    func("rigid_translations", buffer.rigid_translations);
+    func("rigid_local_positions", buffer.rigid_local_positions);
+    func("rigid_local_normals", buffer.rigid_local_normals);
+
+    func("inflatable_tri_offsets", buffer.inflatable_tri_offsets);
+    func("inflatable_tri_counts", buffer.inflatable_tri_counts);
+    func("inflatable_volumes", buffer.inflatable_volumes);
+    func("inflatable_coefficients", buffer.inflatable_coefficients);
+    func("inflatable_pressures", buffer.inflatable_pressures);
+
+    func("spring_indices", buffer.spring_indices);
+    func("spring_lengths", buffer.spring_lengths);
+    func("spring_stiffness", buffer.spring_stiffness);
+
+    func("triangles", buffer.triangles);
+    func("triangle_normals", buffer.triangle_normals);
+    func("uvs", buffer.uvs);
+}
+
+template <class T>
+bool Reader::read(const std::string& name, T& value) const
+{
+    if (get_count(name, sizeof(T)) != 1)
+        return false;
+    return read_chunk(name, &value, sizeof(T));
+}
+
+template <class T>
+bool Reader::read(const std::string& name, std::vector<T>& vec) const
+{
+    const int count = get_count(name, sizeof(T));
+    if (count < 0)
+        return false;
+    vec.resize(count);
+    return read_chunk(name, vec.data(), count * sizeof(T));
+}
+
+template <class T>
+bool Reader::read(const std::string& name, FlexVector<T>& vec) const
+{
+    const int count = get_count(name, sizeof(T));
+    if (count < 0)
+        return false;
+    vec.resize(count);
+    return read_chunk(name, vec.mappedPtr, count * sizeof(T));
+}
+
+}
+}
@@ -0,0 +1,351 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "solver_backend.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include <luse.h>
+
+#include "cpu_solver.hpp"
+
+namespace rpflex {
+
+class FlexSolverBackend : public SolverBackend
+{
+public:
+    FlexSolverBackend(NvFlexLibrary* lib, int max_particles, int max_diffuse_particles, int max_neighbors_per_particle):
+        solver_(NvFlexCreateSolver(lib, max_particles, max_diffuse_particles, max_neighbors_per_particle))
+    {
+    }
+
+    ~FlexSolverBackend() override
+    {
+        NvFlexDestroySolver(solver_);
+    }
+
+    NvFlexSolver* get_flex_solver() const override { return solver_; }
+
+    void set_params(const NvFlexParams& params) override { NvFlexSetParams(solver_, &params); }
+
+    void set_particles(FlexVector<LVecBase4f>& positions, int count) override { NvFlexSetParticles(solver_, positions.buffer, count); }
+    void set_velocities(FlexVector<LVecBase3f>& velocities, int count) override { NvFlexSetVelocities(solver_, velocities.buffer, count); }
+    void set_normals(FlexVector<LVecBase4f>& normals, int count) override { NvFlexSetNormals(solver_, normals.buffer, count); }
+    void set_phases(FlexVector<int>& phases, int count) override { NvFlexSetPhases(solver_, phases.buffer, count); }
+    void set_rest_particles(FlexVector<LVecBase4f>& positions, int count) override { NvFlexSetRestParticles(solver_, positions.buffer, count); }
+    void set_active(FlexVector<int>& indices, int count) override { NvFlexSetActive(solver_, indices.buffer, count); }
+
+    void set_springs(FlexVector<int>& indices, FlexVector<float>& lengths, FlexVector<float>& stiffness, int count) override
+    {
+        NvFlexSetSprings(solver_, indices.buffer, lengths.buffer, stiffness.buffer, count);
+    }
+
+    void set_rigids(FlexVector<int>& offsets, FlexVector<int>& indices, FlexVector<LVecBase3f>& local_positions,
+        FlexVector<LVecBase4f>& local_normals, FlexVector<float>& coefficients, FlexVector<LQuaternionf>& rotations,
+        FlexVector<LVecBase3f>& translations, int rigids_count, int indices_count) override
+    {
+        NvFlexSetRigids(solver_, offsets.buffer, indices.buffer, local_positions.buffer, local_normals.buffer,
+            coefficients.buffer, rotations.buffer, translations.buffer, rigids_count, indices_count);
+    }
+
+    void set_inflatables(FlexVector<int>& tri_offsets, FlexVector<int>& tri_counts, FlexVector<float>& volumes,
+        FlexVector<float>& pressures, FlexVector<float>& coefficients, int count) override
+    {
+        NvFlexSetInflatables(solver_, tri_offsets.buffer, tri_counts.buffer, volumes.buffer, pressures.buffer,
+            coefficients.buffer, count);
+    }
+
+    void set_dynamic_triangles(FlexVector<int>& indices, FlexVector<LVecBase3f>& normals, int count) override
+    {
+        NvFlexSetDynamicTriangles(solver_, indices.buffer, normals.buffer, count);
+    }
+
+    void set_shapes(FlexVector<NvFlexCollisionGeometry>& geometry, FlexVector<LVecBase4f>& positions,
+        FlexVector<LQuaternionf>& rotations, FlexVector<LVecBase4f>& prev_positions, FlexVector<LQuaternionf>& prev_rotations,
+        FlexVector<int>& flags, int count) override
+    {
+        NvFlexSetShapes(solver_, geometry.buffer, positions.buffer, rotations.buffer, prev_positions.buffer,
+            prev_rotations.buffer, flags.buffer, count);
+    }
+
+    void update(float dt, int substeps, bool enable_timers) override
+    {
+        NvFlexUpdateSolver(solver_, dt, substeps, enable_timers);
+    }
+
+    bool get_timers(NvFlexTimers& timers) override
+    {
+        NvFlexGetTimers(solver_, &timers);
+        return true;
+    }
+
+    void get_particles(FlexVector<LVecBase4f>& positions, int count) override { NvFlexGetParticles(solver_, positions.buffer, count); }
+    void get_velocities(FlexVector<LVecBase3f>& velocities, int count) override { NvFlexGetVelocities(solver_, velocities.buffer, count); }
+    void get_normals(FlexVector<LVecBase4f>& normals, int count) override { NvFlexGetNormals(solver_, normals.buffer, count); }
+
+    void get_dynamic_triangles(FlexVector<int>& indices, FlexVector<LVecBase3f>& normals, int count) override
+    {
+        NvFlexGetDynamicTriangles(solver_, indices.buffer, normals.buffer, count);
+    }
+
+    void get_rigid_transforms(FlexVector<LQuaternionf>& rotations, FlexVector<LVecBase3f>& translations) override
+    {
+        NvFlexGetRigidTransforms(solver_, rotations.buffer, translations.buffer);
+    }
+
+    void get_smooth_particles(FlexVector<LVecBase4f>& positions, int count) override
+    {
+        NvFlexGetSmoothParticles(solver_, positions.buffer, count);
+    }
+
+    void get_anisotropy(FlexVector<LVecBase4f>& q1, FlexVector<LVecBase4f>& q2, FlexVector<LVecBase4f>& q3) override
+    {
+        NvFlexGetAnisotropy(solver_, q1.buffer, q2.buffer, q3.buffer);
+    }
+
+private:
+    NvFlexSolver* solver_;
+};
+
+// ************************************************************************************************
+
+/**
+ * Elements of FlexVector in the scope.
+ * Host vector is accessed directly and Flex buffer is mapped. Empty vector gives nullptr.
+ */
+template <class T>
+class ScopedMap
+{
+public:
+    ScopedMap(FlexVector<T>& vec): buffer_(vec.mappedPtr ? nullptr : vec.buffer),
+        ptr_(vec.count == 0 ? nullptr :
+            vec.mappedPtr ? vec.mappedPtr :
+            buffer_ ? static_cast<T*>(NvFlexMap(buffer_, eNvFlexMapWait)) : vec.get_host_data())
+    {
+    }
+
+    ~ScopedMap()
+    {
+        if (buffer_ && ptr_)
+            NvFlexUnmap(buffer_);
+    }
+
+    ScopedMap(const ScopedMap&) = delete;
+    ScopedMap& operator=(const ScopedMap&) = delete;
+
+    T* get() const { return ptr_; }
+
+private:
+    NvFlexBuffer* buffer_;
+    T* ptr_;
+};
+
+class CpuSolverBackend : public SolverBackend
+{
+public:
+    CpuSolverBackend(int max_particles): solver_(max_particles)
+    {
+    }
+
+    void set_params(const NvFlexParams& params) override
+    {
+        radius_ = params.radius;
+        solver_.set_params(params);
+    }
+
+    void set_particles(FlexVector<LVecBase4f>& positions, int count) override
+    {
+        ScopedMap<LVecBase4f> data(positions);
+        if (data.get())
+            solver_.set_particles(data.get(), count);
+    }
+
+    void set_velocities(FlexVector<LVecBase3f>& velocities, int count) override
+    {
+        ScopedMap<LVecBase3f> data(velocities);
+        if (data.get())
+            solver_.set_velocities(data.get(), count);
+    }
+
+    // normals are used only for fluid
+    void set_normals(FlexVector<LVecBase4f>& normals, int count) override {}
+
+    void set_phases(FlexVector<int>& phases, int count) override
+    {
+        ScopedMap<int> data(phases);
+        if (data.get())
+            solver_.set_phases(data.get(), count);
+    }
+
+    // rest positions are used only for self collision filtering
+    void set_rest_particles(FlexVector<LVecBase4f>& positions, int count) override {}
+
+    void set_active(FlexVector<int>& indices, int count) override
+    {
+        ScopedMap<int> data(indices);
+        solver_.set_active(data.get(), data.get() ? count : 0);
+    }
+
+    void set_springs(FlexVector<int>& indices, FlexVector<float>& lengths, FlexVector<float>& stiffness, int count) override
+    {
+        ScopedMap<int> indices_data(indices);
+        ScopedMap<float> lengths_data(lengths);
+        ScopedMap<float> stiffness_data(stiffness);
+        solver_.set_springs(indices_data.get(), lengths_data.get(), stiffness_data.get(),
+            indices_data.get() ? count : 0);
+    }
+
+    void set_rigids(FlexVector<int>& offsets, FlexVector<int>& indices, FlexVector<LVecBase3f>& local_positions,
+        FlexVector<LVecBase4f>& local_normals, FlexVector<float>& coefficients, FlexVector<LQuaternionf>& rotations,
+        FlexVector<LVecBase3f>& translations, int rigids_count, int indices_count) override
+    {
+        ScopedMap<int> offsets_data(offsets);
+        ScopedMap<int> indices_data(indices);
+        ScopedMap<LVecBase3f> local_positions_data(local_positions);
+        ScopedMap<float> coefficients_data(coefficients);
+        ScopedMap<LQuaternionf> rotations_data(rotations);
+        ScopedMap<LVecBase3f> translations_data(translations);
+        solver_.set_rigids(offsets_data.get(), indices_data.get(), local_positions_data.get(), coefficients_data.get(),
+            rotations_data.get(), translations_data.get(), offsets_data.get() ? rigids_count : 0);
+    }
+
+    // inflatables are not supported
+    void set_inflatables(FlexVector<int>& tri_offsets, FlexVector<int>& tri_counts, FlexVector<float>& volumes,
+        FlexVector<float>& pressures, FlexVector<float>& coefficients, int count) override {}
+
+    void set_dynamic_triangles(FlexVector<int>& indices, FlexVector<LVecBase3f>& normals, int count) override
+    {
+        ScopedMap<int> data(indices);
+        solver_.set_dynamic_triangles(data.get(), data.get() ? count : 0);
+    }
+
+    void set_shapes(FlexVector<NvFlexCollisionGeometry>& geometry, FlexVector<LVecBase4f>& positions,
+        FlexVector<LQuaternionf>& rotations, FlexVector<LVecBase4f>& prev_positions, FlexVector<LQuaternionf>& prev_rotations,
+        FlexVector<int>& flags, int count) override
+    {
+        ScopedMap<NvFlexCollisionGeometry> geometry_data(geometry);
+        ScopedMap<LVecBase4f> positions_data(positions);
+        ScopedMap<LQuaternionf> rotations_data(rotations);
+        ScopedMap<int> flags_data(flags);
+        solver_.set_shapes(geometry_data.get(), positions_data.get(), rotations_data.get(), flags_data.get(),
+            flags_data.get() ? count : 0);
+    }
+
+    void update(float dt, int substeps, bool enable_timers) override
+    {
+        if (!enable_timers)
+            return solver_.update(dt, substeps);
+
+        const auto begin_time = std::chrono::steady_clock::now();
+        solver_.update(dt, substeps);
+        update_time_ = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - begin_time).count();
+    }
+
+    // CPU solver has no stage timers, so only the total time is given.
+    bool get_timers(NvFlexTimers& timers) override
+    {
+        timers = {};
+        timers.total = update_time_;
+        return true;
+    }
+
+    void get_particles(FlexVector<LVecBase4f>& positions, int count) override
+    {
+        ScopedMap<LVecBase4f> data(positions);
+        if (data.get())
+            solver_.get_particles(data.get(), count);
+    }
+
+    void get_velocities(FlexVector<LVecBase3f>& velocities, int count) override
+    {
+        ScopedMap<LVecBase3f> data(velocities);
+        if (data.get())
+            solver_.get_velocities(data.get(), count);
+    }
+
+    void get_normals(FlexVector<LVecBase4f>& normals, int count) override
+    {
+        ScopedMap<LVecBase4f> data(normals);
+        if (data.get())
+            solver_.get_normals(data.get(), count);
+    }
+
+    void get_dynamic_triangles(FlexVector<int>& indices, FlexVector<LVecBase3f>& normals, int count) override
+    {
+        ScopedMap<LVecBase3f> data(normals);
+        if (data.get())
+            solver_.get_dynamic_triangle_normals(data.get(), count);
+    }
+
+    void get_rigid_transforms(FlexVector<LQuaternionf>& rotations, FlexVector<LVecBase3f>& translations) override
+    {
+        ScopedMap<LQuaternionf> rotations_data(rotations);
+        ScopedMap<LVecBase3f> translations_data(translations);
+        if (rotations_data.get() && translations_data.get())
+            solver_.get_rigid_transforms(rotations_data.get(), translations_data.get());
+    }
+
+    // particles are not smoothed
+    void get_smooth_particles(FlexVector<LVecBase4f>& positions, int count) override
+    {
+        get_particles(positions, count);
+    }
+
+    // particles are spheres
+    void get_anisotropy(FlexVector<LVecBase4f>& q1, FlexVector<LVecBase4f>& q2, FlexVector<LVecBase4f>& q3) override
+    {
+        FlexVector<LVecBase4f>* vectors[3] = { &q1, &q2, &q3 };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            ScopedMap<LVecBase4f> data(*vectors[axis]);
+            if (!data.get())
+                continue;
+
+            LVecBase4f value(0.0f, 0.0f, 0.0f, radius_);
+            value[axis] = 1.0f;
+            std::fill(data.get(), data.get() + (std::min)(vectors[axis]->size(), solver_.get_max_particles()), value);
+        }
+    }
+
+private:
+    CpuSolver solver_;
+    float radius_ = 0.0f;
+    float update_time_ = 0.0f;
+};
+
+// ************************************************************************************************
+
+std::unique_ptr<SolverBackend> create_flex_backend(NvFlexLibrary* lib, int max_particles, int max_diffuse_particles,
+    int max_neighbors_per_particle)
+{
+    return std::make_unique<FlexSolverBackend>(lib, max_particles, max_diffuse_particles, max_neighbors_per_particle);
+}
+
+std::unique_ptr<SolverBackend> create_cpu_backend(int max_particles)
+{
+    return std::make_unique<CpuSolverBackend>(max_particles);
+}
+
+}
@@ -0,0 +1,103 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <luse.h>
+
+#include <NvFlex.h>
+
+#include "rpflex/flex_vector.hpp"
+
+namespace rpflex {
+
+/**
+ * Solver used by Plugin.
+ *
+ * Functions follow NvFlexSet* and NvFlexGet* of Flex, and buffers are vectors of FlexBuffer
+ * which are not mapped.
+ */
+class SolverBackend
+{
+public:
+    virtual ~SolverBackend() = default;
+
+    /** Get Flex solver, or nullptr if the backend does not use Flex. */
+    virtual NvFlexSolver* get_flex_solver() const { return nullptr; }
+
+    virtual void set_params(const NvFlexParams& params) = 0;
+
+    virtual void set_particles(FlexVector<LVecBase4f>& positions, int count) = 0;
+    virtual void set_velocities(FlexVector<LVecBase3f>& velocities, int count) = 0;
+    virtual void set_normals(FlexVector<LVecBase4f>& normals, int count) = 0;
+    virtual void set_phases(FlexVector<int>& phases, int count) = 0;
+    virtual void set_rest_particles(FlexVector<LVecBase4f>& positions, int count) = 0;
+    virtual void set_active(FlexVector<int>& indices, int count) = 0;
+
+    virtual void set_springs(FlexVector<int>& indices, FlexVector<float>& lengths, FlexVector<float>& stiffness,
+        int count) = 0;
+    virtual void set_rigids(FlexVector<int>& offsets, FlexVector<int>& indices, FlexVector<LVecBase3f>& local_positions,
+        FlexVector<LVecBase4f>& local_normals, FlexVector<float>& coefficients, FlexVector<LQuaternionf>& rotations,
+        FlexVector<LVecBase3f>& translations, int rigids_count, int indices_count) = 0;
+    virtual void set_inflatables(FlexVector<int>& tri_offsets, FlexVector<int>& tri_counts, FlexVector<float>& volumes,
+        FlexVector<float>& pressures, FlexVector<float>& coefficients, int count) = 0;
+    virtual void set_dynamic_triangles(FlexVector<int>& indices, FlexVector<LVecBase3f>& normals, int count) = 0;
+    virtual void set_shapes(FlexVector<NvFlexCollisionGeometry>& geometry, FlexVector<LVecBase4f>& positions,
+        FlexVector<LQuaternionf>& rotations, FlexVector<LVecBase4f>& prev_positions,
+        FlexVector<LQuaternionf>& prev_rotations, FlexVector<int>& flags, int count) = 0;
+
+    /** @param  enable_timers   Measure times of solver stages which are returned by get_timers. */
+    virtual void update(float dt, int substeps, bool enable_timers) = 0;
+
+    /**
+     * Get times (in milliseconds) measured in the last update with timers.
+     *
+     * With Flex, this blocks CPU until the solver is finished.
+     * @return  false if the backend does not support the timers.
+     */
+    virtual bool get_timers(NvFlexTimers& timers) { return false; }
+
+    virtual void get_particles(FlexVector<LVecBase4f>& positions, int count) = 0;
+    virtual void get_velocities(FlexVector<LVecBase3f>& velocities, int count) = 0;
+    virtual void get_normals(FlexVector<LVecBase4f>& normals, int count) = 0;
+    virtual void get_dynamic_triangles(FlexVector<int>& indices, FlexVector<LVecBase3f>& normals, int count) = 0;
+    virtual void get_rigid_transforms(FlexVector<LQuaternionf>& rotations, FlexVector<LVecBase3f>& translations) = 0;
+    virtual void get_smooth_particles(FlexVector<LVecBase4f>& positions, int count) = 0;
+    virtual void get_anisotropy(FlexVector<LVecBase4f>& q1, FlexVector<LVecBase4f>& q2, FlexVector<LVecBase4f>& q3) = 0;
+};
+
+/** Create the backend using Flex solver. */
+std::unique_ptr<SolverBackend> create_flex_backend(NvFlexLibrary* lib, int max_particles, int max_diffuse_particles,
+    int max_neighbors_per_particle);
+
+/**
+ * Create the backend using CpuSolver.
+ *
+ * Vectors without Flex library are used directly, so the backend works without Flex and CUDA.
+ */
+std::unique_ptr<SolverBackend> create_cpu_backend(int max_particles);
+
+}
@@ -0,0 +1,138 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <rpflex/utils/cloth.hpp>
+
+#include "test_common.hpp"
+
+namespace {
+
+/**
+ * Grid of 3 x 3 vertices (v = y * 3 + x) with unit spacing.
+ * Each quad (a, b, c, d) is split into (a, b, c) and (a, c, d).
+ */
+rpflex::TriangleMeshData make_grid_mesh()
+{
+    rpflex::TriangleMeshData mesh;
+    for (int y = 0; y < 3; ++y)
+        for (int x = 0; x < 3; ++x)
+            mesh.positions.emplace_back(float(x), float(y), 0.0f);
+
+    for (int y = 0; y < 2; ++y)
+    {
+        for (int x = 0; x < 2; ++x)
+        {
+            const int a = y * 3 + x;
+            const int b = a + 1;
+            const int c = a + 4;
+            const int d = a + 3;
+            mesh.indices.insert(mesh.indices.end(), { a, b, c, a, c, d });
+        }
+    }
+    mesh.update_bounds();
+
+    return mesh;
+}
+
+/** Get sorted vertex pairs of springs whose stiffness is @p stiffness. */
+std::vector<std::pair<int, int>> get_pairs(const rpflex::RPFlexCloth::Springs& springs, float stiffness)
+{
+    std::vector<std::pair<int, int>> pairs;
+    for (size_t k = 0, k_end = springs.stiffness.size(); k < k_end; ++k)
+    {
+        if (springs.stiffness[k] != stiffness)
+            continue;
+
+        const int a = springs.indices[k * 2 + 0];
+        const int b = springs.indices[k * 2 + 1];
+        pairs.push_back({ (std::min)(a, b), (std::max)(a, b) });
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+}
+
+RPFLEX_TEST(cloth_springs_of_grid)
+{
+    const auto mesh = make_grid_mesh();
+
+    rpflex::ClothOptions options;
+    options.stretch_stiffness = 1.0f;
+    options.shear_stiffness = 0.8f;
+    options.bend_stiffness = 0.5f;
+
+    rpflex::RPFlexCloth::Springs springs;
+    rpflex::RPFlexCloth::build_springs(mesh, options, springs);
+    RPFLEX_CHECK(springs.indices.size() == springs.lengths.size() * 2);
+    RPFLEX_CHECK(springs.stiffness.size() == springs.lengths.size());
+
+    // 6 horizontal, 6 vertical and 4 diagonal edges
+    RPFLEX_CHECK(get_pairs(springs, 1.0f).size() == 16);
+
+    // the other diagonal of each quad, and pairs across the inner edges between quads
+    const std::vector<std::pair<int, int>> shear = { { 0, 5 }, { 0, 7 }, { 1, 3 }, { 1, 8 }, { 2, 4 }, { 3, 8 }, { 4, 6 }, { 5, 7 } };
+    RPFLEX_CHECK(get_pairs(springs, 0.8f) == shear);
+
+    // straight lines through the middle vertices, and the diagonal through the center
+    const std::vector<std::pair<int, int>> bend = { { 0, 2 }, { 0, 6 }, { 0, 8 }, { 1, 7 }, { 2, 8 }, { 3, 5 }, { 6, 8 } };
+    RPFLEX_CHECK(get_pairs(springs, 0.5f) == bend);
+
+    for (size_t k = 0, k_end = springs.lengths.size(); k < k_end; ++k)
+    {
+        const LVecBase3f& a = mesh.positions[springs.indices[k * 2 + 0]];
+        const LVecBase3f& b = mesh.positions[springs.indices[k * 2 + 1]];
+        RPFLEX_CHECK_NEAR(springs.lengths[k], (a - b).length(), 1e-6f);
+    }
+
+    // springs of zero stiffness are not created
+    options.shear_stiffness = 0.0f;
+    options.bend_stiffness = 0.0f;
+    rpflex::RPFlexCloth::build_springs(mesh, options, springs);
+    RPFLEX_CHECK(springs.lengths.size() == 16);
+}
+
+RPFLEX_TEST(cloth_volume_of_tetrahedron)
+{
+    // counter-clockwise seen from outside
+    rpflex::TriangleMeshData mesh;
+    mesh.positions = { LVecBase3f(0, 0, 0), LVecBase3f(1, 0, 0), LVecBase3f(0, 1, 0), LVecBase3f(0, 0, 1) };
+    mesh.indices = { 0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3 };
+    RPFLEX_CHECK_NEAR(rpflex::RPFlexCloth::calc_volume(mesh), 1.0f / 6.0f, 1e-6f);
+
+    // the volume does not depend on the origin
+    for (auto& position: mesh.positions)
+        position += LVecBase3f(5.0f, -3.0f, 2.0f);
+    RPFLEX_CHECK_NEAR(rpflex::RPFlexCloth::calc_volume(mesh), 1.0f / 6.0f, 1e-5f);
+
+    // clockwise triangles give the negative volume
+    for (int k = 0; k < 4; ++k)
+        std::swap(mesh.indices[k * 3 + 1], mesh.indices[k * 3 + 2]);
+    RPFLEX_CHECK_NEAR(rpflex::RPFlexCloth::calc_volume(mesh), -1.0f / 6.0f, 1e-5f);
+}
@@ -0,0 +1,321 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include <rpflex/flex_buffer.hpp>
+
+#include "solver_backend.hpp"
+#include "test_common.hpp"
+
+namespace {
+
+NvFlexParams make_params()
+{
+    NvFlexParams params;
+    std::memset(&params, 0, sizeof(params));
+    params.numIterations = 3;
+    params.gravity[2] = -9.8f;
+    params.radius = 0.1f;
+    params.solidRestDistance = 0.1f;
+    params.collisionDistance = 0.05f;
+    params.relaxationFactor = 1.0f;
+    params.maxSpeed = 100.0f;
+
+    // ground plane (z = 0)
+    params.planes[0][2] = 1.0f;
+    params.numPlanes = 1;
+
+    return params;
+}
+
+/** Fill FlexBuffer (without Flex) with a column of particles above the ground. */
+void fill_column(rpflex::FlexBuffer& buffer, int count)
+{
+    for (int k = 0; k < count; ++k)
+    {
+        buffer.positions.push_back(LVecBase4f(0.0f, 0.0f, 0.5f + k * 0.1f, 1.0f));
+        buffer.velocities.push_back(LVecBase3f(0.0f));
+        buffer.phases.push_back(NvFlexMakePhase(0, eNvFlexPhaseSelfCollide));
+        buffer.active_indices.push_back(k);
+    }
+}
+
+/** Create CPU backend and send particles of @p buffer to it. */
+std::unique_ptr<rpflex::SolverBackend> create_backend(rpflex::FlexBuffer& buffer, const NvFlexParams& params)
+{
+    const int count = buffer.positions.size();
+    buffer.unmap();
+
+    auto backend = rpflex::create_cpu_backend(count);
+    backend->set_params(params);
+    backend->set_particles(buffer.positions, count);
+    backend->set_velocities(buffer.velocities, count);
+    backend->set_phases(buffer.phases, count);
+    backend->set_active(buffer.active_indices, buffer.active_indices.size());
+
+    return backend;
+}
+
+/** Drop a particle at @p position onto a shape and get the final position. */
+LVecBase3f drop_on_shape(const NvFlexCollisionGeometry& geometry, int type, const LQuaternionf& rotation,
+    const LVecBase3f& position)
+{
+    rpflex::FlexBuffer buffer(nullptr);
+    buffer.positions.push_back(LVecBase4f(position, 1.0f));
+    buffer.velocities.push_back(LVecBase3f(0.0f));
+    buffer.phases.push_back(NvFlexMakePhase(0, eNvFlexPhaseSelfCollide));
+    buffer.active_indices.push_back(0);
+
+    buffer.shape_geometry.push_back(geometry);
+    buffer.shape_positions.push_back(LVecBase4f(0.0f));
+    buffer.shape_rotations.push_back(rotation);
+    buffer.shape_prev_positions.push_back(LVecBase4f(0.0f));
+    buffer.shape_prev_rotations.push_back(rotation);
+    buffer.shape_flags.push_back(NvFlexMakeShapeFlags(NvFlexCollisionShapeType(type), false));
+
+    auto backend = create_backend(buffer, make_params());
+    backend->set_shapes(buffer.shape_geometry, buffer.shape_positions, buffer.shape_rotations,
+        buffer.shape_prev_positions, buffer.shape_prev_rotations, buffer.shape_flags, 1);
+
+    for (int frame = 0; frame < 120; ++frame)
+        backend->update(1.0f / 60.0f, 2, false);
+
+    backend->get_particles(buffer.positions, 1);
+    buffer.positions.map();
+    return buffer.positions[0].get_xyz();
+}
+
+}
+
+RPFLEX_TEST(flex_vector_without_library)
+{
+    rpflex::FlexVector<int> vec(nullptr);
+    RPFLEX_CHECK(vec.buffer == nullptr);
+
+    for (int k = 0; k < 100; ++k)
+        vec.push_back(k);
+    vec.unmap();
+
+    RPFLEX_CHECK(vec.size() == 100);
+    RPFLEX_CHECK(vec.buffer == nullptr);
+    RPFLEX_CHECK(vec.mappedPtr == nullptr);
+    RPFLEX_CHECK(vec.get_host_data() != nullptr);
+
+    vec.map();
+    RPFLEX_CHECK(vec[0] == 0 && vec[99] == 99);
+
+    rpflex::FlexVector<int> other(nullptr);
+    other.resize(3, 7);
+    other.unmap();
+    vec.unmap();
+    vec.swap(other);
+    RPFLEX_CHECK(vec.size() == 3 && other.size() == 100);
+    RPFLEX_CHECK(vec.get_host_data()[2] == 7);
+}
+
+RPFLEX_TEST(cpu_backend_runs_without_flex)
+{
+    const int count = 10;
+
+    rpflex::FlexBuffer buffer(nullptr);
+    fill_column(buffer, count);
+    buffer.unmap();
+
+    auto backend = rpflex::create_cpu_backend(count);
+    RPFLEX_CHECK(backend->get_flex_solver() == nullptr);
+
+    backend->set_params(make_params());
+    backend->set_particles(buffer.positions, count);
+    backend->set_velocities(buffer.velocities, count);
+    backend->set_phases(buffer.phases, count);
+    backend->set_active(buffer.active_indices, count);
+
+    for (int frame = 0; frame < 120; ++frame)
+        backend->update(1.0f / 60.0f, 2, frame == 119);
+
+    NvFlexTimers timers;
+    RPFLEX_CHECK(backend->get_timers(timers));
+    RPFLEX_CHECK(timers.total >= 0.0f);
+
+    backend->get_particles(buffer.positions, count);
+    backend->get_velocities(buffer.velocities, count);
+
+    buffer.positions.map();
+    for (int k = 0; k < count; ++k)
+    {
+        // particles are stacked on the ground without penetration
+        RPFLEX_CHECK(buffer.positions[k][2] > 0.0f);
+        RPFLEX_CHECK(buffer.positions[k][2] < 0.5f + k * 0.1f);
+    }
+}
+
+RPFLEX_TEST(cpu_backend_fills_anisotropy)
+{
+    const int count = 4;
+
+    rpflex::FlexBuffer buffer(nullptr);
+    fill_column(buffer, count);
+    buffer.anisotropy1.resize(count);
+    buffer.anisotropy2.resize(count);
+    buffer.anisotropy3.resize(count);
+    buffer.unmap();
+
+    auto backend = rpflex::create_cpu_backend(count);
+    backend->set_params(make_params());
+    backend->get_anisotropy(buffer.anisotropy1, buffer.anisotropy2, buffer.anisotropy3);
+
+    buffer.anisotropy2.map();
+    RPFLEX_CHECK(buffer.anisotropy2[count - 1] == LVecBase4f(0.0f, 1.0f, 0.0f, 0.1f));
+}
+
+RPFLEX_TEST(cpu_backend_solves_springs)
+{
+    NvFlexParams params = make_params();
+    params.gravity[2] = 0.0f;
+    params.numPlanes = 0;
+
+    // stretched spring of three particles without self collision
+    rpflex::FlexBuffer buffer(nullptr);
+    for (int k = 0; k < 3; ++k)
+    {
+        buffer.positions.push_back(LVecBase4f(k * 0.5f, 0.0f, 1.0f, 1.0f));
+        buffer.velocities.push_back(LVecBase3f(0.0f));
+        buffer.phases.push_back(NvFlexMakePhase(0, 0));
+        buffer.active_indices.push_back(k);
+    }
+    for (int k = 0; k < 2; ++k)
+    {
+        buffer.spring_indices.push_back(k);
+        buffer.spring_indices.push_back(k + 1);
+        buffer.spring_lengths.push_back(1.0f);
+        buffer.spring_stiffness.push_back(1.0f);
+    }
+
+    auto backend = create_backend(buffer, params);
+    backend->set_springs(buffer.spring_indices, buffer.spring_lengths, buffer.spring_stiffness, 2);
+
+    for (int frame = 0; frame < 120; ++frame)
+        backend->update(1.0f / 60.0f, 2, false);
+
+    backend->get_particles(buffer.positions, 3);
+    buffer.positions.map();
+
+    for (int k = 0; k < 2; ++k)
+    {
+        const float length = (buffer.positions[k + 1].get_xyz() - buffer.positions[k].get_xyz()).length();
+        RPFLEX_CHECK_NEAR(length, 1.0f, 0.02f);
+    }
+
+    // springs do not move the center of equal masses
+    const LVecBase3f center = (buffer.positions[0].get_xyz() + buffer.positions[1].get_xyz() + buffer.positions[2].get_xyz()) / 3.0f;
+    RPFLEX_CHECK_NEAR(center[0], 0.5f, 1e-3f);
+    RPFLEX_CHECK_NEAR(center[2], 1.0f, 1e-3f);
+}
+
+RPFLEX_TEST(cpu_backend_matches_rigid_shapes)
+{
+    NvFlexParams params = make_params();
+    params.gravity[2] = 0.0f;
+    params.numPlanes = 0;
+
+    // cube rotated by 60 degrees about z from its local positions
+    const float angle = 3.14159265f / 3.0f;
+    const LQuaternionf expected_rotation(0.0f, 0.0f, std::sin(angle * 0.5f), std::cos(angle * 0.5f));
+    const LVecBase3f center(1.0f, 2.0f, 3.0f);
+
+    rpflex::FlexBuffer buffer(nullptr);
+    buffer.rigid_offsets.push_back(0);
+    for (int k = 0; k < 8; ++k)
+    {
+        const LVecBase3f local((k & 1) ? 0.5f : -0.5f, (k & 2) ? 0.5f : -0.5f, (k & 4) ? 0.5f : -0.5f);
+        const LVecBase3f rotated(
+            std::cos(angle) * local[0] - std::sin(angle) * local[1],
+            std::sin(angle) * local[0] + std::cos(angle) * local[1],
+            local[2]);
+
+        buffer.positions.push_back(LVecBase4f(center + rotated, 1.0f));
+        buffer.velocities.push_back(LVecBase3f(0.0f));
+        buffer.phases.push_back(NvFlexMakePhase(0, 0));
+        buffer.active_indices.push_back(k);
+        buffer.rigid_indices.push_back(k);
+        buffer.rigid_local_positions.push_back(local);
+    }
+    buffer.rigid_offsets.push_back(8);
+    buffer.rigid_coefficients.push_back(1.0f);
+    buffer.rigid_rotations.push_back(LQuaternionf(0.0f, 0.0f, 0.0f, 1.0f));
+    buffer.rigid_translations.push_back(LVecBase3f(0.0f));
+
+    auto backend = create_backend(buffer, params);
+    backend->set_rigids(buffer.rigid_offsets, buffer.rigid_indices, buffer.rigid_local_positions,
+        buffer.rigid_local_normals, buffer.rigid_coefficients, buffer.rigid_rotations, buffer.rigid_translations,
+        1, 8);
+
+    for (int frame = 0; frame < 30; ++frame)
+        backend->update(1.0f / 60.0f, 2, false);
+
+    backend->get_rigid_transforms(buffer.rigid_rotations, buffer.rigid_translations);
+    backend->get_particles(buffer.positions, 8);
+    buffer.map();
+
+    // rotation in Flex order (x, y, z, w), and q and -q are the same rotation
+    const LQuaternionf& rotation = buffer.rigid_rotations[0];
+    RPFLEX_CHECK_NEAR(std::abs(rotation.dot(expected_rotation)), 1.0f, 1e-4f);
+    RPFLEX_CHECK_NEAR(buffer.rigid_translations[0][0], center[0], 1e-4f);
+    RPFLEX_CHECK_NEAR(buffer.rigid_translations[0][1], center[1], 1e-4f);
+    RPFLEX_CHECK_NEAR(buffer.rigid_translations[0][2], center[2], 1e-4f);
+
+    // matched shape keeps the edge length
+    RPFLEX_CHECK_NEAR((buffer.positions[1].get_xyz() - buffer.positions[0].get_xyz()).length(), 1.0f, 1e-3f);
+}
+
+RPFLEX_TEST(cpu_backend_collides_with_shapes)
+{
+    // particles rest on shapes at the collision distance
+    const float margin = make_params().collisionDistance;
+
+    // 90 degrees about z in Flex order maps local x-axis to y-axis
+    const float s = std::sqrt(0.5f);
+    const LQuaternionf rotation(0.0f, 0.0f, s, s);
+
+    NvFlexCollisionGeometry sphere;
+    sphere.sphere.radius = 1.0f;
+    const LVecBase3f on_sphere = drop_on_shape(sphere, eNvFlexShapeSphere, rotation, LVecBase3f(0.0f, 0.0f, 1.5f));
+    RPFLEX_CHECK_NEAR(on_sphere[2], 1.0f + margin, 0.02f);
+
+    // capsule along x in local space lies along y, so the particle is above its end
+    NvFlexCollisionGeometry capsule;
+    capsule.capsule.radius = 0.5f;
+    capsule.capsule.halfHeight = 2.0f;
+    const LVecBase3f on_capsule = drop_on_shape(capsule, eNvFlexShapeCapsule, rotation, LVecBase3f(0.0f, 1.5f, 1.5f));
+    RPFLEX_CHECK_NEAR(on_capsule[2], 0.5f + margin, 0.02f);
+
+    NvFlexCollisionGeometry box;
+    box.box.halfExtents[0] = 1.0f;
+    box.box.halfExtents[1] = 0.2f;
+    box.box.halfExtents[2] = 0.2f;
+    const LVecBase3f on_box = drop_on_shape(box, eNvFlexShapeBox, rotation, LVecBase3f(0.0f, 0.8f, 1.0f));
+    RPFLEX_CHECK_NEAR(on_box[2], 0.2f + margin, 0.02f);
+}
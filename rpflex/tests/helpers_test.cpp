@@ -0,0 +1,93 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <random>
+#include <vector>
+
+#include <rpflex/utils/helpers.hpp>
+
+#include "test_common.hpp"
+
+RPFLEX_TEST(particle_bounds_match_scalar_loop)
+{
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+
+    // odd count checks the remainder of SIMD loop
+    std::vector<LVecBase4f> positions(1037);
+    for (auto& position: positions)
+        position = LVecBase4f(distribution(random), distribution(random), distribution(random), 1.0f);
+
+    for (int begin: { 0, 3, 1030 })
+    {
+        LVecBase3f expected_lower(FLT_MAX);
+        LVecBase3f expected_upper(-FLT_MAX);
+        for (int k = begin, k_end = int(positions.size()); k < k_end; ++k)
+        {
+            expected_lower = positions[k].get_xyz().fmin(expected_lower);
+            expected_upper = positions[k].get_xyz().fmax(expected_upper);
+        }
+
+        LVecBase3f lower;
+        LVecBase3f upper;
+        GetParticleBounds(positions.data(), begin, int(positions.size()), lower, upper);
+        RPFLEX_CHECK(lower == expected_lower);
+        RPFLEX_CHECK(upper == expected_upper);
+    }
+
+    rpflex::FlexBuffer buffer(nullptr);
+    buffer.positions.assign(positions.data(), int(positions.size()));
+
+    LVecBase3f lower;
+    LVecBase3f upper;
+    GetParticleBounds(buffer, lower, upper);
+
+    LVecBase3f expected_lower;
+    LVecBase3f expected_upper;
+    GetParticleBounds(positions.data(), 0, int(positions.size()), expected_lower, expected_upper);
+    RPFLEX_CHECK(lower == expected_lower);
+    RPFLEX_CHECK(upper == expected_upper);
+}
+
+RPFLEX_TEST(rigid_local_positions_are_centered)
+{
+    // two rigids far from the origin, and the second rigid uses shuffled indices
+    const std::vector<LVecBase4f> positions = {
+        LVecBase4f(1000.0f, 0.0f, 0.0f, 1.0f), LVecBase4f(1002.0f, 0.0f, 0.0f, 1.0f),
+        LVecBase4f(0.0f, 5.0f, 1.0f, 1.0f), LVecBase4f(0.0f, 5.0f, -1.0f, 1.0f), LVecBase4f(0.0f, 8.0f, 0.0f, 1.0f),
+    };
+    const std::vector<int> offsets = { 0, 2, 5 };
+    const std::vector<int> indices = { 0, 1, 4, 2, 3 };
+
+    std::vector<LVecBase3f> local_positions(indices.size());
+    CalculateRigidLocalPositions(positions.data(), int(positions.size()), offsets.data(), indices.data(), 2,
+        local_positions.data());
+
+    RPFLEX_CHECK_NEAR(local_positions[0][0], -1.0f, 1e-5f);
+    RPFLEX_CHECK_NEAR(local_positions[1][0], 1.0f, 1e-5f);
+    RPFLEX_CHECK_NEAR(local_positions[2][1], 2.0f, 1e-5f);
+    RPFLEX_CHECK_NEAR(local_positions[3][1], -1.0f, 1e-5f);
+    RPFLEX_CHECK_NEAR(local_positions[3][2], 1.0f, 1e-5f);
+    RPFLEX_CHECK_NEAR(local_positions[4][2], -1.0f, 1e-5f);
+}
@@ -0,0 +1,118 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <rpflex/utils/parallel_for.hpp>
+
+#include "test_common.hpp"
+
+RPFLEX_TEST(parallel_for_covers_range_once)
+{
+    for (int count: { 0, 1, 7, 1000, 100003 })
+    {
+        std::vector<std::atomic<int>> visits(count);
+        for (auto& visit: visits)
+            visit = 0;
+
+        rpflex::parallel_for(0, count, 16, [&](int begin, int end) {
+            for (int k = begin; k < end; ++k)
+                ++visits[k];
+        });
+
+        bool once = true;
+        for (auto& visit: visits)
+            once = once && visit == 1;
+        RPFLEX_CHECK(once);
+    }
+}
+
+RPFLEX_TEST(parallel_for_reuses_threads)
+{
+    std::vector<std::thread::id> first_ids;
+    std::mutex mutex;
+
+    for (int repeat = 0; repeat < 2; ++repeat)
+    {
+        std::vector<std::thread::id> ids;
+        rpflex::parallel_for(0, 1 << 16, 1, [&](int begin, int end) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ids.push_back(std::this_thread::get_id());
+        });
+
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+        if (repeat == 0)
+        {
+            first_ids = ids;
+            continue;
+        }
+
+        // every thread of the second call was used by the first call or is the caller
+        for (const auto& id: ids)
+            RPFLEX_CHECK(id == std::this_thread::get_id() || std::binary_search(first_ids.begin(), first_ids.end(), id));
+    }
+}
+
+RPFLEX_TEST(parallel_for_nested_and_concurrent)
+{
+    const int outer = 64;
+    const int inner = 1000;
+    std::atomic<int> total(0);
+
+    const auto nested = [&]() {
+        rpflex::parallel_for(0, outer, 1, [&](int begin, int end) {
+            for (int k = begin; k < end; ++k)
+            {
+                rpflex::parallel_for(0, inner, 1, [&](int inner_begin, int inner_end) {
+                    total += inner_end - inner_begin;
+                });
+            }
+        });
+    };
+
+    std::thread other(nested);
+    nested();
+    other.join();
+
+    RPFLEX_CHECK(total == 2 * outer * inner);
+}
+
+RPFLEX_TEST(worker_pool_runs_all_tasks)
+{
+    rpflex::WorkerPool pool(3);
+    RPFLEX_CHECK(pool.get_threads_count() == 4);
+
+    for (int repeat = 0; repeat < 100; ++repeat)
+    {
+        std::atomic<int> sum(0);
+        RPFLEX_CHECK(pool.run(50, [&](int index) { sum += index; }));
+        RPFLEX_CHECK(sum == 50 * 49 / 2);
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <vector>
+
+#include "particle_pool.hpp"
+#include "test_common.hpp"
+
+RPFLEX_TEST(pool_reset_with_indices)
+{
+    rpflex::ParticlePool pool;
+    const std::vector<int> indices = { 4, 0, 7 };
+    RPFLEX_CHECK(pool.reset(8, indices.data(), int(indices.size())));
+
+    RPFLEX_CHECK(pool.get_capacity() == 8);
+    RPFLEX_CHECK(pool.get_free_count() == 5);
+    RPFLEX_CHECK(pool.is_active(0) && pool.is_active(4) && pool.is_active(7));
+    RPFLEX_CHECK(!pool.is_active(1) && !pool.is_active(6));
+
+    rpflex::FlexVector<int> active_indices(nullptr);
+    active_indices.assign(indices.data(), int(indices.size()));
+    RPFLEX_CHECK(pool.free(0, active_indices));
+    RPFLEX_CHECK(active_indices.size() == 2 && active_indices[0] == 4 && active_indices[1] == 7);
+}
+
+RPFLEX_TEST(pool_reset_rejects_invalid_indices)
+{
+    rpflex::ParticlePool pool;
+    pool.reset(4, 2);
+
+    const std::vector<int> out_of_range = { 0, 4 };
+    const std::vector<int> negative = { -1 };
+    const std::vector<int> duplicated = { 1, 2, 1 };
+    const std::vector<int> too_many = { 0, 1, 2, 3, 0 };
+
+    RPFLEX_CHECK(!pool.reset(4, out_of_range.data(), int(out_of_range.size())));
+    RPFLEX_CHECK(!pool.reset(4, negative.data(), int(negative.size())));
+    RPFLEX_CHECK(!pool.reset(4, duplicated.data(), int(duplicated.size())));
+    RPFLEX_CHECK(!pool.reset(4, too_many.data(), int(too_many.size())));
+    RPFLEX_CHECK(!pool.reset(4, nullptr, -1));
+
+    // the pool is not changed by failures
+    RPFLEX_CHECK(pool.get_capacity() == 4);
+    RPFLEX_CHECK(pool.get_free_count() == 2);
+    RPFLEX_CHECK(pool.is_active(0) && pool.is_active(1));
+    RPFLEX_CHECK(!pool.is_active(2) && !pool.is_active(3));
+}
@@ -0,0 +1,227 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <rpflex/particle_query.hpp>
+
+#include "test_common.hpp"
+
+namespace {
+
+/** Random particles where every third particle is inactive and phases have three groups. */
+void make_random_scene(rpflex::FlexBuffer& buffer, int count, float extent)
+{
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> distribution(-extent, extent);
+
+    for (int k = 0; k < count; ++k)
+    {
+        buffer.positions.push_back(LVecBase4f(distribution(random), distribution(random), distribution(random), 1.0f));
+        buffer.phases.push_back(NvFlexMakePhase(k % 3, (k % 2) ? eNvFlexPhaseFluid : 0));
+        if (k % 3 != 2)
+            buffer.active_indices.push_back(k);
+    }
+}
+
+std::vector<int> brute_force_radius(const rpflex::FlexBuffer& buffer, const LVecBase3f& center, float radius,
+    const rpflex::ParticleQuery::Filter& filter)
+{
+    std::vector<int> indices;
+    for (int k = 0, k_end = buffer.active_indices.size(); k < k_end; ++k)
+    {
+        const int index = buffer.active_indices[k];
+        if ((buffer.positions[index].get_xyz() - center).length_squared() <= radius * radius &&
+            filter.test(buffer.phases[index]))
+        {
+            indices.push_back(index);
+        }
+    }
+    return indices;
+}
+
+std::vector<int> brute_force_aabb(const rpflex::FlexBuffer& buffer, const LVecBase3f& lower, const LVecBase3f& upper,
+    const rpflex::ParticleQuery::Filter& filter)
+{
+    std::vector<int> indices;
+    for (int k = 0, k_end = buffer.active_indices.size(); k < k_end; ++k)
+    {
+        const int index = buffer.active_indices[k];
+        const LVecBase3f pos = buffer.positions[index].get_xyz();
+        if (lower[0] <= pos[0] && pos[0] <= upper[0] && lower[1] <= pos[1] && pos[1] <= upper[1] &&
+            lower[2] <= pos[2] && pos[2] <= upper[2] && filter.test(buffer.phases[index]))
+        {
+            indices.push_back(index);
+        }
+    }
+    return indices;
+}
+
+/** Get the distance to the first hit, or -1 if nothing is hit. */
+float brute_force_ray(const rpflex::FlexBuffer& buffer, const LVecBase3f& origin, const LVecBase3f& direction,
+    float max_distance, float particle_radius, const rpflex::ParticleQuery::Filter& filter)
+{
+    float best_t = -1.0f;
+    for (int k = 0, k_end = buffer.active_indices.size(); k < k_end; ++k)
+    {
+        const int index = buffer.active_indices[k];
+        if (!filter.test(buffer.phases[index]))
+            continue;
+
+        const LVecBase3f oc = buffer.positions[index].get_xyz() - origin;
+        const float tc = oc.dot(direction);
+        const float dist_sq = oc.dot(oc) - tc * tc;
+        if (dist_sq > particle_radius * particle_radius)
+            continue;
+
+        const float half_chord = std::sqrt(particle_radius * particle_radius - dist_sq);
+        if (tc + half_chord < 0.0f)
+            continue;
+
+        const float t = (std::max)(0.0f, tc - half_chord);
+        if (t <= max_distance && (best_t < 0.0f || t < best_t))
+            best_t = t;
+    }
+    return best_t;
+}
+
+const rpflex::ParticleQuery::Filter FILTERS[] = {
+    rpflex::ParticleQuery::Filter(),
+    rpflex::ParticleQuery::Filter(1),
+    rpflex::ParticleQuery::Filter(-1, eNvFlexPhaseFluid, eNvFlexPhaseFluid),
+};
+
+}
+
+RPFLEX_TEST(particle_query_radius_and_aabb_match_brute_force)
+{
+    rpflex::FlexBuffer buffer(nullptr);
+    make_random_scene(buffer, 3000, 2.0f);
+
+    rpflex::ParticleQuery query;
+    query.build(buffer, 0.1f);
+    RPFLEX_CHECK(query.get_particles_count() == buffer.active_indices.size());
+
+    std::mt19937 random(9);
+    std::uniform_real_distribution<float> position(-2.5f, 2.5f);
+
+    std::vector<int> indices;
+    int mismatches = 0;
+    for (int k = 0; k < 200; ++k)
+    {
+        const LVecBase3f center(position(random), position(random), position(random));
+
+        // small radii use cells and large radii scan all particles
+        const float radius = (k % 4 == 0) ? 3.0f : 0.05f + 0.1f * (k % 5);
+        const LVecBase3f half_size(radius, radius * 0.5f, radius * 2.0f);
+        for (const auto& filter: FILTERS)
+        {
+            query.query_radius(center, radius, indices, filter);
+            std::sort(indices.begin(), indices.end());
+            if (indices != brute_force_radius(buffer, center, radius, filter))
+                ++mismatches;
+
+            query.query_aabb(center - half_size, center + half_size, indices, filter);
+            std::sort(indices.begin(), indices.end());
+            if (indices != brute_force_aabb(buffer, center - half_size, center + half_size, filter))
+                ++mismatches;
+        }
+    }
+    RPFLEX_CHECK(mismatches == 0);
+
+    // inactive particles are not indexed
+    query.query_radius(LVecBase3f(0.0f), 10.0f, indices);
+    RPFLEX_CHECK(int(indices.size()) == buffer.active_indices.size());
+    RPFLEX_CHECK(std::none_of(indices.begin(), indices.end(), [](int index) { return index % 3 == 2; }));
+}
+
+RPFLEX_TEST(particle_query_ray_matches_brute_force)
+{
+    rpflex::FlexBuffer buffer(nullptr);
+    make_random_scene(buffer, 2000, 2.0f);
+
+    std::mt19937 random(13);
+    std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // particles smaller and larger than cells check the neighborhood of DDA
+    for (float cell_size: { 0.1f, 0.4f })
+    {
+        rpflex::ParticleQuery query;
+        query.build(buffer, cell_size);
+
+        int mismatches = 0;
+        int hits = 0;
+        for (int k = 0; k < 500; ++k)
+        {
+            // origins are inside and outside of the bounds, and some directions are axis-aligned
+            const LVecBase3f origin(position(random), position(random), position(random));
+            LVecBase3f direction(unit(random), unit(random), unit(random));
+            if (k % 5 == 0)
+                direction = LVecBase3f(0.0f);
+            direction[k % 3] += (k % 2) ? 1.0f : -1.0f;
+            direction.normalize();
+
+            const float particle_radius = (k % 2) ? 0.05f : 0.3f;
+            const float max_distance = (k % 7 == 0) ? 1.0f : 100.0f;
+            for (const auto& filter: FILTERS)
+            {
+                float distance = -1.0f;
+                const int index = query.query_ray(origin, direction, max_distance, particle_radius, filter, &distance);
+                const float expected = brute_force_ray(buffer, origin, direction, max_distance, particle_radius, filter);
+
+                if ((index == -1) != (expected < 0.0f) || (index != -1 && std::abs(distance - expected) > 1e-4f))
+                {
+                    ++mismatches;
+                    continue;
+                }
+
+                if (index == -1)
+                    continue;
+
+                ++hits;
+
+                // the hit particle is the one at the distance
+                const LVecBase3f hit_point = origin + direction * distance;
+                const float center_distance = (buffer.positions[index].get_xyz() - hit_point).length();
+                if (distance > 0.0f ? std::abs(center_distance - particle_radius) > 1e-3f : center_distance > particle_radius + 1e-3f)
+                    ++mismatches;
+            }
+        }
+
+        RPFLEX_CHECK(mismatches == 0);
+        RPFLEX_CHECK(hits > 100);
+    }
+}
+
+RPFLEX_TEST(particle_query_empty_index)
+{
+    rpflex::ParticleQuery query;
+    std::vector<int> indices(3);
+    RPFLEX_CHECK(query.query_radius(LVecBase3f(0.0f), 1.0f, indices) == 0 && indices.empty());
+    RPFLEX_CHECK(query.query_aabb(LVecBase3f(-1.0f), LVecBase3f(1.0f), indices) == 0);
+    RPFLEX_CHECK(query.query_ray(LVecBase3f(0.0f), LVecBase3f(0, 0, 1), 10.0f, 0.1f) == -1);
+}
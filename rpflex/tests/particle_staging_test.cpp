@@ -0,0 +1,137 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <rpflex/flex_buffer.hpp>
+
+#include "particle_pool.hpp"
+#include "particle_staging.hpp"
+#include "test_common.hpp"
+
+namespace {
+
+const int MAX_PARTICLES = 100;
+
+/** Scene of FlexBuffer (without Flex) having [0, count) particles like Plugin::reset. */
+struct Scene
+{
+    Scene(int count): buffer(nullptr), staging(nullptr)
+    {
+        buffer.positions.resize(MAX_PARTICLES, LVecBase4f(0.0f));
+        buffer.velocities.resize(MAX_PARTICLES, LVecBase3f(0.0f));
+        buffer.phases.resize(MAX_PARTICLES, 0);
+        buffer.rest_positions.resize(MAX_PARTICLES, LVecBase4f(0.0f));
+        for (int k = 0; k < count; ++k)
+        {
+            buffer.positions[k] = LVecBase4f(float(k), 0.0f, 0.0f, 1.0f);
+            buffer.active_indices.push_back(k);
+        }
+        pool.reset(MAX_PARTICLES, count);
+    }
+
+    /** Add an instance appending @p count particles from @p begin. */
+    bool add_instance(int begin, int count)
+    {
+        staging.begin(buffer, begin);
+        for (int k = 0; k < count; ++k)
+        {
+            buffer.positions.push_back(LVecBase4f(-1.0f, float(k), 0.0f, 1.0f));
+            buffer.phases.push_back(7);
+        }
+        staging.end(buffer);
+
+        return staging.commit(buffer, pool, MAX_PARTICLES);
+    }
+
+    rpflex::FlexBuffer buffer;
+    rpflex::ParticlePool pool;
+    rpflex::ParticleStaging staging;
+};
+
+}
+
+RPFLEX_TEST(staging_commits_new_particles)
+{
+    Scene scene(10);
+
+    RPFLEX_CHECK(scene.add_instance(10, 5));
+    RPFLEX_CHECK(scene.staging.get_begin() == 10 && scene.staging.get_end() == 15);
+
+    auto& buffer = scene.buffer;
+    RPFLEX_CHECK(buffer.positions.size() == MAX_PARTICLES);
+    RPFLEX_CHECK(buffer.active_indices.size() == 15);
+    RPFLEX_CHECK(buffer.positions[9] == LVecBase4f(9.0f, 0.0f, 0.0f, 1.0f));
+    RPFLEX_CHECK(buffer.positions[14] == LVecBase4f(-1.0f, 4.0f, 0.0f, 1.0f));
+    RPFLEX_CHECK(buffer.phases[14] == 7);
+
+    // missing velocities are zero
+    RPFLEX_CHECK(buffer.velocities[14] == LVecBase3f(0.0f));
+    RPFLEX_CHECK(scene.pool.is_active(14) && !scene.pool.is_active(15));
+}
+
+RPFLEX_TEST(staging_keeps_spawned_particles)
+{
+    Scene scene(10);
+
+    // free particles are spawned from the end of buffers
+    const int spawned = scene.pool.allocate(scene.buffer.active_indices);
+    RPFLEX_CHECK(spawned == MAX_PARTICLES - 1);
+    scene.buffer.positions[spawned] = LVecBase4f(5.0f, 5.0f, 5.0f, 1.0f);
+    scene.buffer.velocities[spawned] = LVecBase3f(1.0f, 0.0f, 0.0f);
+
+    // the range overlaps the spawned particle
+    RPFLEX_CHECK(!scene.add_instance(MAX_PARTICLES - 3, 3));
+
+    auto& buffer = scene.buffer;
+    RPFLEX_CHECK(buffer.positions.size() == MAX_PARTICLES);
+    RPFLEX_CHECK(buffer.positions[spawned] == LVecBase4f(5.0f, 5.0f, 5.0f, 1.0f));
+    RPFLEX_CHECK(buffer.velocities[spawned] == LVecBase3f(1.0f, 0.0f, 0.0f));
+    RPFLEX_CHECK(buffer.positions[MAX_PARTICLES - 3] == LVecBase4f(0.0f));
+    RPFLEX_CHECK(buffer.active_indices.size() == 11);
+    RPFLEX_CHECK(!scene.pool.is_active(MAX_PARTICLES - 3));
+
+    // the range before the spawned particle is free
+    RPFLEX_CHECK(scene.add_instance(MAX_PARTICLES - 3, 2));
+    RPFLEX_CHECK(buffer.positions[MAX_PARTICLES - 2] == LVecBase4f(-1.0f, 1.0f, 0.0f, 1.0f));
+    RPFLEX_CHECK(buffer.positions[spawned] == LVecBase4f(5.0f, 5.0f, 5.0f, 1.0f));
+    RPFLEX_CHECK(buffer.active_indices.size() == 13);
+}
+
+RPFLEX_TEST(staging_rolls_back_overflow)
+{
+    Scene scene(10);
+
+    RPFLEX_CHECK(!scene.add_instance(10, MAX_PARTICLES));
+
+    auto& buffer = scene.buffer;
+    RPFLEX_CHECK(buffer.positions.size() == MAX_PARTICLES);
+    RPFLEX_CHECK(buffer.velocities.size() == MAX_PARTICLES);
+    RPFLEX_CHECK(buffer.phases.size() == MAX_PARTICLES);
+    RPFLEX_CHECK(buffer.positions[10] == LVecBase4f(0.0f));
+    RPFLEX_CHECK(buffer.active_indices.size() == 10);
+    RPFLEX_CHECK(scene.pool.get_free_count() == MAX_PARTICLES - 10);
+
+    // the staging buffers are reused after failure
+    RPFLEX_CHECK(scene.add_instance(10, 1));
+    RPFLEX_CHECK(buffer.positions[10] == LVecBase4f(-1.0f, 0.0f, 0.0f, 1.0f));
+}
@@ -0,0 +1,131 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <random>
+
+#include <rpflex/rigid_binding_table.hpp>
+
+#include "test_common.hpp"
+
+namespace {
+
+/** Rotate @p v by a quaternion in Flex order without matrices. */
+LVecBase3f rotate(const LQuaternionf& q, const LVecBase3f& v)
+{
+    const LVecBase3f u(q[0], q[1], q[2]);
+    const LVecBase3f c = u.cross(v);
+    return v + c * (2.0f * q[3]) + u.cross(c) * 2.0f;
+}
+
+}
+
+RPFLEX_TEST(rigid_world_matrix_uses_row_vectors)
+{
+    // 90 degrees about z in Flex order, and it maps x to y
+    const float s = std::sqrt(0.5f);
+    const LQuaternionf rotation(0.0f, 0.0f, s, s);
+    const LVecBase3f translation(1.0f, 2.0f, 3.0f);
+
+    LMatrix4f world_mat;
+    rpflex::RigidBindingTable::calc_world_mat(LMatrix4f::ident_mat(), rotation, translation, world_mat);
+    RPFLEX_CHECK(world_mat.almost_equal(LMatrix4f(
+        0, 1, 0, 0,
+        -1, 0, 0, 0,
+        0, 0, 1, 0,
+        1, 2, 3, 1), 1e-5f));
+
+    // local matrix is applied before the rigid transform
+    rpflex::RigidBindingTable::calc_world_mat(LMatrix4f::translate_mat(LVecBase3f(0.0f, 0.0f, 1.0f)),
+        rotation, translation, world_mat);
+    const LVecBase3f p = world_mat.xform_point(LVecBase3f(1.0f, 0.0f, 0.0f));
+    RPFLEX_CHECK_NEAR(p[0], 1.0f, 1e-5f);
+    RPFLEX_CHECK_NEAR(p[1], 3.0f, 1e-5f);
+    RPFLEX_CHECK_NEAR(p[2], 4.0f, 1e-5f);
+}
+
+RPFLEX_TEST(rigid_world_matrix_matches_quaternion_rotation)
+{
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    for (int k = 0; k < 100; ++k)
+    {
+        LQuaternionf rotation(distribution(random), distribution(random), distribution(random), distribution(random));
+        rotation /= std::sqrt(rotation.dot(rotation));
+        const LVecBase3f translation(distribution(random), distribution(random), distribution(random));
+        const LVecBase3f local_translation(distribution(random), distribution(random), distribution(random));
+        const LVecBase3f v(distribution(random), distribution(random), distribution(random));
+
+        LMatrix4f world_mat;
+        rpflex::RigidBindingTable::calc_world_mat(LMatrix4f::translate_mat(local_translation),
+            rotation, translation, world_mat);
+
+        const LVecBase3f expected = rotate(rotation, v + local_translation) + translation;
+        const LVecBase3f p = world_mat.xform_point(v);
+        RPFLEX_CHECK_NEAR(p[0], expected[0], 1e-4f);
+        RPFLEX_CHECK_NEAR(p[1], expected[1], 1e-4f);
+        RPFLEX_CHECK_NEAR(p[2], expected[2], 1e-4f);
+    }
+}
+
+RPFLEX_TEST(rigid_binding_skips_rigids_within_epsilon)
+{
+    rpflex::FlexBuffer buffer(nullptr);
+    buffer.rigid_rotations.push_back(LQuaternionf(0.0f, 0.0f, 0.0f, 1.0f));
+    buffer.rigid_rotations.push_back(LQuaternionf(0.0f, 0.0f, 0.0f, 1.0f));
+    buffer.rigid_translations.push_back(LVecBase3f(0.0f));
+    buffer.rigid_translations.push_back(LVecBase3f(0.0f));
+
+    rpflex::RigidBindingTable table;
+    table.set_epsilon(1e-6f, 1e-6f);
+    table.add_binding(0, NodePath("rigid0"), LMatrix4f::ident_mat());
+    table.add_binding(1, NodePath("rigid1"), LMatrix4f::ident_mat());
+
+    // first synchronization writes all bindings
+    RPFLEX_CHECK(table.sync(buffer) == 2);
+    RPFLEX_CHECK(table.sync(buffer) == 0);
+
+    // squared distance below the epsilon
+    buffer.rigid_translations[0] = LVecBase3f(1e-4f, 0.0f, 0.0f);
+    RPFLEX_CHECK(table.sync(buffer) == 0);
+
+    buffer.rigid_translations[0] = LVecBase3f(0.01f, 0.0f, 0.0f);
+    RPFLEX_CHECK(table.sync(buffer) == 1);
+
+    // q and -q are the same rotation
+    buffer.rigid_rotations[1] = LQuaternionf(0.0f, 0.0f, 0.0f, -1.0f);
+    RPFLEX_CHECK(table.sync(buffer) == 0);
+
+    const float angle = 0.1f;
+    buffer.rigid_rotations[1] = LQuaternionf(0.0f, 0.0f, std::sin(angle * 0.5f), std::cos(angle * 0.5f));
+    RPFLEX_CHECK(table.sync(buffer) == 1);
+
+    // rigids out of the buffer are skipped
+    table.add_binding(2, NodePath("rigid2"), LMatrix4f::ident_mat());
+    RPFLEX_CHECK(table.sync(buffer) == 0);
+
+    table.invalidate();
+    RPFLEX_CHECK(table.sync(buffer) == 2);
+}
@@ -0,0 +1,135 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+
+#include <rpflex/utils/sdf_builder.hpp>
+
+#include "test_common.hpp"
+
+namespace {
+
+/** Rotation about z and then x, so that faces of the box are not aligned to the grid. */
+LVecBase3f rotate(const LVecBase3f& v, float angle_z, float angle_x)
+{
+    const float cz = std::cos(angle_z);
+    const float sz = std::sin(angle_z);
+    const float cx = std::cos(angle_x);
+    const float sx = std::sin(angle_x);
+    const LVecBase3f r(cz * v[0] - sz * v[1], sz * v[0] + cz * v[1], v[2]);
+    return LVecBase3f(r[0], cx * r[1] - sx * r[2], sx * r[1] + cx * r[2]);
+}
+
+LVecBase3f inverse_rotate(const LVecBase3f& v, float angle_z, float angle_x)
+{
+    const float cz = std::cos(angle_z);
+    const float sz = std::sin(angle_z);
+    const float cx = std::cos(angle_x);
+    const float sx = std::sin(angle_x);
+    const LVecBase3f r(v[0], cx * v[1] + sx * v[2], -sx * v[1] + cx * v[2]);
+    return LVecBase3f(cz * r[0] + sz * r[1], -sz * r[0] + cz * r[1], r[2]);
+}
+
+float box_distance(const LVecBase3f& p, const LVecBase3f& half_extents)
+{
+    const LVecBase3f q(std::abs(p[0]) - half_extents[0], std::abs(p[1]) - half_extents[1], std::abs(p[2]) - half_extents[2]);
+    const LVecBase3f outside = q.fmax(LVecBase3f(0.0f));
+    return outside.length() + (std::min)((std::max)(q[0], (std::max)(q[1], q[2])), 0.0f);
+}
+
+rpflex::TriangleMeshData make_box_mesh(const LVecBase3f& half_extents, float angle_z, float angle_x)
+{
+    rpflex::TriangleMeshData mesh;
+    for (int k = 0; k < 8; ++k)
+    {
+        const LVecBase3f corner(
+            (k & 1) ? half_extents[0] : -half_extents[0],
+            (k & 2) ? half_extents[1] : -half_extents[1],
+            (k & 4) ? half_extents[2] : -half_extents[2]);
+        mesh.positions.push_back(rotate(corner, angle_z, angle_x));
+    }
+
+    mesh.indices = {
+        0, 2, 1, 1, 2, 3,   // -z
+        4, 5, 6, 5, 7, 6,   // +z
+        0, 1, 4, 1, 5, 4,   // -y
+        2, 6, 3, 3, 6, 7,   // +y
+        0, 4, 2, 2, 4, 6,   // -x
+        1, 3, 5, 3, 7, 5,   // +x
+    };
+    mesh.update_bounds();
+
+    return mesh;
+}
+
+}
+
+RPFLEX_TEST(sdf_of_box_matches_analytic_distance)
+{
+    const LVecBase3f half_extents(1.0f, 0.6f, 0.3f);
+    const float angle_z = 0.37f;
+    const float angle_x = 0.21f;
+    const auto mesh = make_box_mesh(half_extents, angle_z, angle_x);
+
+    rpflex::SignedDistanceField sdf;
+    RPFLEX_CHECK(rpflex::build_signed_distance_field(mesh, 32, sdf));
+    RPFLEX_CHECK(sdf.dimension == 32);
+    RPFLEX_CHECK(int(sdf.distances.size()) == 32 * 32 * 32);
+
+    const float cell_size = sdf.edge_length / sdf.dimension;
+    float max_error = 0.0f;
+    int wrong_signs = 0;
+    for (int z = 0; z < sdf.dimension; ++z)
+    {
+        for (int y = 0; y < sdf.dimension; ++y)
+        {
+            for (int x = 0; x < sdf.dimension; ++x)
+            {
+                const LVecBase3f center = sdf.origin + LVecBase3f(x + 0.5f, y + 0.5f, z + 0.5f) * cell_size;
+                const float expected = box_distance(inverse_rotate(center, angle_z, angle_x), half_extents);
+                const float distance = sdf.distances[sdf.get_index(x, y, z)];
+
+                max_error = (std::max)(max_error, std::abs(distance - expected));
+                if ((distance < 0.0f) != (expected < 0.0f) && std::abs(expected) > 1e-4f)
+                    ++wrong_signs;
+            }
+        }
+    }
+
+    // jump flooding is approximate far from the surface
+    RPFLEX_CHECK(max_error < 0.5f * cell_size);
+    RPFLEX_CHECK(wrong_signs == 0);
+
+    // trilinear sampling between cells
+    RPFLEX_CHECK_NEAR(sdf.sample(LPoint3f(0.0f)), -0.3f, cell_size);
+    const LVecBase3f outside_point = rotate(LVecBase3f(1.2f, 0.0f, 0.0f), angle_z, angle_x);
+    RPFLEX_CHECK_NEAR(sdf.sample(LPoint3f(outside_point)), 0.2f, cell_size);
+}
+
+RPFLEX_TEST(sdf_rejects_empty_mesh)
+{
+    rpflex::SignedDistanceField sdf;
+    RPFLEX_CHECK(!rpflex::build_signed_distance_field(rpflex::TriangleMeshData(), 32, sdf));
+    RPFLEX_CHECK(sdf.distances.empty());
+}
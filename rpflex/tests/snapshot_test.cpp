@@ -0,0 +1,150 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "snapshot.hpp"
+
+#include "test_common.hpp"
+
+namespace {
+
+const char* SNAPSHOT_PATH = "rpflex_snapshot_test.rpflexsnap";
+
+void fill_buffer(rpflex::FlexBuffer& buffer)
+{
+    for (int k = 0; k < 100; ++k)
+    {
+        buffer.positions.push_back(LVecBase4f(float(k), float(k * 2), float(k * 3), 1.0f));
+        buffer.velocities.push_back(LVecBase3f(0.0f, 0.0f, float(-k)));
+        buffer.phases.push_back(k % 3);
+    }
+    for (int k = 0; k < 100; k += 2)
+        buffer.active_indices.push_back(k);
+
+    NvFlexCollisionGeometry geometry;
+    geometry.sphere.radius = 0.5f;
+    buffer.shape_geometry.push_back(geometry);
+    buffer.shape_positions.push_back(LVecBase4f(1.0f, 2.0f, 3.0f, 0.0f));
+    buffer.shape_rotations.push_back(LQuaternionf(0.0f, 0.0f, 0.0f, 1.0f));
+    buffer.shape_prev_positions.push_back(LVecBase4f(1.0f, 2.0f, 3.0f, 0.0f));
+    buffer.shape_prev_rotations.push_back(LQuaternionf(0.0f, 0.0f, 0.0f, 1.0f));
+    buffer.shape_flags.push_back(NvFlexMakeShapeFlags(eNvFlexShapeSphere, false));
+
+    buffer.spring_indices.push_back(0);
+    buffer.spring_indices.push_back(2);
+    buffer.spring_lengths.push_back(1.5f);
+    buffer.spring_stiffness.push_back(0.8f);
+}
+
+/** Get raw data of all vectors to compare buffers. */
+std::vector<std::string> get_vectors_data(rpflex::FlexBuffer& buffer)
+{
+    std::vector<std::string> data;
+    rpflex::snapshot::visit_flex_vectors(buffer, [&](const char*, const auto& vec) {
+        if (vec.size() == 0)
+            data.emplace_back();
+        else
+            data.emplace_back(reinterpret_cast<const char*>(vec.mappedPtr), sizeof(*vec.mappedPtr) * vec.size());
+    });
+    return data;
+}
+
+}
+
+RPFLEX_TEST(snapshot_round_trip)
+{
+    rpflex::FlexBuffer buffer(nullptr);
+    fill_buffer(buffer);
+
+    NvFlexParams flex_params;
+    std::memset(&flex_params, 0, sizeof(flex_params));
+    flex_params.radius = 0.1f;
+    flex_params.numIterations = 3;
+
+    rpflex::Plugin::Parameters params{};
+    params.max_diffuse_particles = 7;
+    params.num_extra_particles = 50;
+
+    for (bool compress: { false, true })
+    {
+        RPFLEX_CHECK(rpflex::snapshot::write(SNAPSHOT_PATH, buffer, flex_params, params, compress).empty());
+
+        const rpflex::snapshot::Reader reader(SNAPSHOT_PATH);
+        RPFLEX_CHECK(reader.get_error().empty());
+
+        NvFlexParams loaded_flex_params;
+        rpflex::Plugin::Parameters loaded_params;
+        RPFLEX_CHECK(reader.read("flex_params", loaded_flex_params));
+        RPFLEX_CHECK(reader.read("plugin_params", loaded_params));
+        RPFLEX_CHECK(std::memcmp(&loaded_flex_params, &flex_params, sizeof(flex_params)) == 0);
+        RPFLEX_CHECK(std::memcmp(&loaded_params, &params, sizeof(params)) == 0);
+
+        std::vector<int> shape_flags;
+        RPFLEX_CHECK(reader.read("shape_flags", shape_flags));
+        RPFLEX_CHECK(shape_flags.size() == 1 && shape_flags[0] == buffer.shape_flags[0]);
+        RPFLEX_CHECK(reader.get_count("positions", sizeof(LVecBase4f)) == 100);
+
+        // stale data in the destination is replaced or cleared
+        rpflex::FlexBuffer loaded(nullptr);
+        loaded.rigid_offsets.push_back(0);
+        loaded.positions.push_back(LVecBase4f(-1.0f));
+        RPFLEX_CHECK(reader.read(loaded));
+
+        RPFLEX_CHECK(get_vectors_data(loaded) == get_vectors_data(buffer));
+    }
+
+    std::remove(SNAPSHOT_PATH);
+}
+
+RPFLEX_TEST(snapshot_rejects_truncated_file)
+{
+    rpflex::FlexBuffer buffer(nullptr);
+    fill_buffer(buffer);
+
+    NvFlexParams flex_params;
+    std::memset(&flex_params, 0, sizeof(flex_params));
+    rpflex::Plugin::Parameters params{};
+    RPFLEX_CHECK(rpflex::snapshot::write(SNAPSHOT_PATH, buffer, flex_params, params, false).empty());
+
+    std::vector<char> data;
+    {
+        std::ifstream file(SNAPSHOT_PATH, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream file(SNAPSHOT_PATH, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), data.size() / 2);
+    }
+
+    const rpflex::snapshot::Reader reader(SNAPSHOT_PATH);
+    RPFLEX_CHECK(!reader.get_error().empty());
+
+    std::remove(SNAPSHOT_PATH);
+}
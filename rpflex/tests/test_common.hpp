@@ -0,0 +1,81 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace rpflex {
+namespace test {
+
+/** Test case registered by RPFLEX_TEST. */
+struct TestCase
+{
+    const char* name;
+    std::function<void()> func;
+};
+
+inline std::vector<TestCase>& get_test_cases()
+{
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+inline int& get_failures_count()
+{
+    static int count = 0;
+    return count;
+}
+
+struct TestRegistrar
+{
+    TestRegistrar(const char* name, std::function<void()> func)
+    {
+        get_test_cases().push_back({ name, std::move(func) });
+    }
+};
+
+inline void report_failure(const char* file, int line, const char* expression)
+{
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    ++get_failures_count();
+}
+
+}
+}
+
+/** Define and register a test case. */
+#define RPFLEX_TEST(NAME) \
+    static void NAME(); \
+    static const rpflex::test::TestRegistrar NAME##_registrar(#NAME, NAME); \
+    static void NAME()
+
+#define RPFLEX_CHECK(EXPR) \
+    do { if (!(EXPR)) rpflex::test::report_failure(__FILE__, __LINE__, #EXPR); } while (false)
+
+#define RPFLEX_CHECK_NEAR(A, B, EPSILON) \
+    do { if (!(std::abs((A) - (B)) <= (EPSILON))) rpflex::test::report_failure(__FILE__, __LINE__, #A " ~= " #B); } while (false)
@@ -0,0 +1,201 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cfloat>
+#include <utility>
+#include <vector>
+
+#include <boost/dll/alias.hpp>
+
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/pluginbase/setting_types.hpp>
+
+#include <rpplugins/rpstat/gui_interface.hpp>
+
+#include <rpflex/plugin.hpp>
+#include <rpflex/profiler.hpp>
+
+namespace rpplugins {
+
+class PluginGUI : public GUIInterface
+{
+public:
+    PluginGUI(rpcore::RenderPipeline& pipeline);
+    virtual ~PluginGUI() = default;
+
+    void on_draw_menu() override;
+    void on_draw_new_frame() override;
+
+private:
+    void draw_phases(const rpflex::Profiler& profiler);
+    void draw_solver_timers(const rpflex::Profiler& profiler);
+
+    bool is_open_ = false;
+
+    rpcore::BoolType* enable_profiling_;
+
+    rpflex::Plugin* plugin_ = nullptr;
+    std::vector<float> history_;
+};
+
+// ************************************************************************************************
+
+PluginGUI::PluginGUI(rpcore::RenderPipeline& pipeline): GUIInterface(pipeline, RPPLUGINS_GUI_ID_STRING)
+{
+    enable_profiling_ = get_setting_handle<rpcore::BoolType>("enable_profiling");
+}
+
+void PluginGUI::on_draw_menu()
+{
+    if (ImGui::MenuItem("Flex"))
+        is_open_ = true;
+}
+
+void PluginGUI::on_draw_new_frame()
+{
+    if (!is_open_)
+        return;
+
+    if (!ImGui::Begin("Flex Plugin", &is_open_))
+        return ImGui::End();
+
+    if (!plugin_)
+        plugin_ = static_cast<rpflex::Plugin*>(plugin_mgr_->get_instance(plugin_id_)->downcast());
+
+    bool enable_profiling = enable_profiling_->get_value();
+    if (ImGui::Checkbox("enable_profiling", &enable_profiling))
+    {
+        enable_profiling_->set_value(enable_profiling);
+        plugin_mgr_->on_setting_changed(plugin_id_, "enable_profiling");
+    }
+
+    ImGui::Text("Readback Wait: %.3f ms", plugin_->get_readback_wait_time() * 1000.0);
+
+    const auto& profiler = plugin_->get_profiler();
+    if (profiler.is_enabled())
+    {
+        draw_phases(profiler);
+        draw_solver_timers(profiler);
+    }
+
+    ImGui::End();
+}
+
+void PluginGUI::draw_phases(const rpflex::Profiler& profiler)
+{
+    if (!ImGui::CollapsingHeader("Phases (ms)", ImGuiTreeNodeFlags_DefaultOpen))
+        return;
+
+    ImGui::Columns(5, "phases");
+    ImGui::Separator();
+    for (const char* label: { "Phase", "Last", "Average", "Min", "Max" })
+    {
+        ImGui::TextUnformatted(label);
+        ImGui::NextColumn();
+    }
+    ImGui::Separator();
+
+    double total_average = 0;
+    for (int phase = 0; phase < rpflex::Profiler::PHASE_COUNT; ++phase)
+    {
+        const auto stats = profiler.get_statistics(phase);
+        total_average += stats.average;
+
+        ImGui::TextUnformatted(rpflex::Profiler::get_phase_name(phase));
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.last);
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.average);
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.minimum);
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.maximum);
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+    ImGui::Separator();
+
+    ImGui::Text("Total Average: %.3f ms", total_average);
+
+    for (int phase = 0; phase < rpflex::Profiler::PHASE_COUNT; ++phase)
+    {
+        profiler.copy_history(phase, history_);
+        if (history_.empty())
+            continue;
+
+        ImGui::PlotLines(rpflex::Profiler::get_phase_name(phase), history_.data(), int(history_.size()),
+            0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+    }
+}
+
+void PluginGUI::draw_solver_timers(const rpflex::Profiler& profiler)
+{
+    if (!profiler.has_solver_timers())
+        return;
+
+    if (!ImGui::CollapsingHeader("Solver Stages (ms)"))
+        return;
+
+    static const std::pair<const char*, float NvFlexTimers::*> stages[] = {
+        { "predict", &NvFlexTimers::predict },
+        { "createCellIndices", &NvFlexTimers::createCellIndices },
+        { "sortCellIndices", &NvFlexTimers::sortCellIndices },
+        { "createGrid", &NvFlexTimers::createGrid },
+        { "reorder", &NvFlexTimers::reorder },
+        { "collideParticles", &NvFlexTimers::collideParticles },
+        { "collideShapes", &NvFlexTimers::collideShapes },
+        { "collideTriangles", &NvFlexTimers::collideTriangles },
+        { "collideFields", &NvFlexTimers::collideFields },
+        { "calculateDensity", &NvFlexTimers::calculateDensity },
+        { "solveDensities", &NvFlexTimers::solveDensities },
+        { "solveVelocities", &NvFlexTimers::solveVelocities },
+        { "solveShapes", &NvFlexTimers::solveShapes },
+        { "solveSprings", &NvFlexTimers::solveSprings },
+        { "solveContacts", &NvFlexTimers::solveContacts },
+        { "solveInflatables", &NvFlexTimers::solveInflatables },
+        { "applyDeltas", &NvFlexTimers::applyDeltas },
+        { "calculateAnisotropy", &NvFlexTimers::calculateAnisotropy },
+        { "updateDiffuse", &NvFlexTimers::updateDiffuse },
+        { "updateTriangles", &NvFlexTimers::updateTriangles },
+        { "updateNormals", &NvFlexTimers::updateNormals },
+        { "finalize", &NvFlexTimers::finalize },
+        { "updateBounds", &NvFlexTimers::updateBounds },
+    };
+
+    const auto& timers = profiler.get_solver_timers();
+    for (const auto& stage: stages)
+    {
+        // skip stages which are not used in the scene
+        const float time = timers.*(stage.second);
+        if (time > 0.0f)
+            ImGui::TextUnformatted(fmt::format("{:<20} {:8.3f}", stage.first, time).c_str());
+    }
+    ImGui::Separator();
+    ImGui::TextUnformatted(fmt::format("{:<20} {:8.3f}", "total", timers.total).c_str());
+}
+
+}
+
+RPPLUGINS_GUI_CREATOR(rpplugins::PluginGUI)